@@ -87,6 +87,7 @@ aql_clear(aql_adt_t *adt)
   adt->attribute_count = 0;
   adt->value_count = 0;
   adt->flags = 0;
+  adt->join_type = AQL_JOIN_AUTO;
   memset(adt->aggregators, 0, sizeof(adt->aggregators));
 }
 
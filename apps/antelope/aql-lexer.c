@@ -87,10 +87,13 @@ static const struct keyword keywords[] = {
   {"JOIN", JOIN},
   {"LONG", LONG},
   {"TYPE", TYPE},
+  {"HASH", HASH},
 
   {"WHERE", WHERE},
   {"COUNT", COUNT},
   {"INDEX", INDEX},
+  {"MERGE", MERGE},
+  {"BTREE", BTREE},
 
   {"INSERT", INSERT},
   {"SELECT", SELECT},
@@ -111,7 +114,7 @@ static const struct keyword keywords[] = {
 };
 
 /* Provides a pointer to the first keyword of a specific length. */
-static const int8_t skip_hint[] = {0, 13, 21, 27, 33, 36, 44, 47, 48};
+static const int8_t skip_hint[] = {0, 13, 21, 27, 34, 39, 47, 50, 51};
 
 static char separators[] = "#.;,() \t\n";
 
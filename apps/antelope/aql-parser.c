@@ -441,11 +441,39 @@ PARSER(where)
     }
   }
 
+  if(p.error) {
+    /* The condition did not fit into the bytecode buffer. */
+    RETURN(PLE_ERROR);
+  }
+
   lvm_print_code(&p);
 
   return OK;
 }
 
+PARSER_TOKEN(join_type)
+{
+  aql_join_type_t type;
+
+  NEXT;
+  switch(TOKEN) {
+  case INDEX:
+    type = AQL_JOIN_INDEX;
+    break;
+  case HASH:
+    type = AQL_JOIN_HASH;
+    break;
+  case MERGE:
+    type = AQL_JOIN_MERGE;
+    break;
+  default:
+    return NONE;
+  }
+
+  AQL_SET_JOIN_TYPE(adt, type);
+  return TOKEN;
+}
+
 PARSER(join)
 {
   AQL_SET_TYPE(adt, AQL_TYPE_JOIN);
@@ -474,6 +502,16 @@ PARSER(join)
     RETURN(SYNTAX_ERROR);
   }
 
+  /* An optional join strategy; it is otherwise selected automatically. */
+  NEXT;
+  if(TOKEN == TYPE) {
+    if(PARSE_TOKEN(join_type) == NONE) {
+      RETURN(SYNTAX_ERROR);
+    }
+  } else {
+    REWIND;
+  }
+
   CONSUME(END);
 
   RETURN(OK);
@@ -645,6 +683,9 @@ PARSER_TOKEN(index_type)
   case MEMHASH:
     type = INDEX_MEMHASH;
     break;
+  case BTREE:
+    type = INDEX_BTREE;
+    break;
   default:
     return NONE;
   };
@@ -104,6 +104,9 @@ enum token {
   MEMHASH = 46,
   RELATION = 47,
   ATTRIBUTE = 48,
+  HASH = 49,
+  MERGE = 50,
+  BTREE = 51,
 
   INTEGER_VALUE = 251,
   FLOAT_VALUE = 252,
@@ -137,6 +140,15 @@ enum aql_aggregator {
 
 typedef enum aql_aggregator aql_aggregator_t;
 
+enum aql_join_type {
+  AQL_JOIN_AUTO = 0,
+  AQL_JOIN_INDEX = 1,
+  AQL_JOIN_HASH = 2,
+  AQL_JOIN_MERGE = 3
+};
+
+typedef enum aql_join_type aql_join_type_t;
+
 struct aql_attribute {
   domain_t domain;
   uint8_t element_size;
@@ -151,6 +163,7 @@ struct aql_adt {
   aql_aggregator_t aggregators[AQL_ATTRIBUTE_LIMIT];
   attribute_value_t values[AQL_ATTRIBUTE_LIMIT];
   index_type_t index_type;
+  aql_join_type_t join_type;
   uint8_t relation_count;
   uint8_t attribute_count;
   uint8_t value_count;
@@ -185,6 +198,8 @@ typedef struct aql_adt aql_adt_t;
 #define AQL_GET_TYPE(adt)		((adt)->optype)
 #define AQL_SET_INDEX_TYPE(adt, type)	((adt)->index_type = (type))
 #define AQL_GET_INDEX_TYPE(adt)	((adt)->index_type)
+#define AQL_SET_JOIN_TYPE(adt, type)	((adt)->join_type = (type))
+#define AQL_GET_JOIN_TYPE(adt)		((adt)->join_type)
 
 #define AQL_SET_FLAG(adt, flag)	(((adt)->flags) |= (flag))
 #define AQL_GET_FLAGS(adt)		((adt)->flags)
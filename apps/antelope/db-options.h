@@ -69,6 +69,14 @@
 #define DB_FEATURE_INTEGRITY		0
 #endif /* DB_FEATURE_INTEGRITY */
 
+/* Keep inserted rows buffered when the last user releases a relation,
+   so that rows inserted by consecutive queries are written together.
+   Until the buffer is written, e.g., by db_flush(), the rows are lost
+   on a reset. */
+#ifndef DB_FEATURE_COALESCE_WRITES
+#define DB_FEATURE_COALESCE_WRITES	0
+#endif /* DB_FEATURE_COALESCE_WRITES */
+
 /*----------------------------------------------------------------------------*/
 
 /* Configuration parameters that may be trimmed to save space. */
@@ -110,6 +118,13 @@
 #define DB_VM_BYTECODE_SIZE		128
 #endif /* DB_VM_BYTECODE_SIZE */
 
+/* The size of the buffer used for reading several tuples at a time
+   when scanning a relation. It must hold at least one tuple. */
+#ifndef DB_SCAN_BUFFER_SIZE
+#define DB_SCAN_BUFFER_SIZE		(2 * DB_MAX_ATTRIBUTES_PER_RELATION * \
+                                         DB_MAX_ELEMENT_SIZE)
+#endif /* DB_SCAN_BUFFER_SIZE */
+
 /*----------------------------------------------------------------------------*/
 
 /* Language options. */
@@ -146,6 +161,14 @@
 #define DB_COFFEE_RESERVE_SIZE          (128 * 1024UL)
 #endif /* DB_COFFEE_RESERVE_SIZE */
 
+/* The size of the buffer that collects inserted rows before they are
+   written to a relation file, and that holds rows read ahead from the
+   file. Preferably a fraction of the flash page size. Rows that are
+   longer than the buffer are read and written directly. */
+#ifndef DB_ROW_BUFFER_SIZE
+#define DB_ROW_BUFFER_SIZE		128
+#endif /* DB_ROW_BUFFER_SIZE */
+
 /* The maximum size of the physical storage of a tuple (labelled a "row" 
    in Antelope's terminology. */
 #ifndef DB_MAX_CHAR_SIZE_PER_ROW
@@ -206,6 +229,51 @@
 #define DB_HEAP_CACHE_LIMIT		1
 #endif /* DB_HEAP_CACHE_LIMIT */
 
+/* The maximum number of B+-tree indexes. */
+#ifndef DB_BTREE_INDEX_LIMIT
+#define DB_BTREE_INDEX_LIMIT		1
+#endif /* DB_BTREE_INDEX_LIMIT */
+
+/* The size of a B+-tree page in bytes. */
+#ifndef DB_BTREE_PAGE_SIZE
+#define DB_BTREE_PAGE_SIZE		128
+#endif /* DB_BTREE_PAGE_SIZE */
+
+/* The number of B+-tree pages cached in memory. The cache is shared
+   by all B+-tree indexes, and must hold at least two pages. */
+#ifndef DB_BTREE_CACHE_LIMIT
+#define DB_BTREE_CACHE_LIMIT		4
+#endif /* DB_BTREE_CACHE_LIMIT */
+
+/* The maximum number of levels in a B+-tree. */
+#ifndef DB_BTREE_MAX_HEIGHT
+#define DB_BTREE_MAX_HEIGHT		6
+#endif /* DB_BTREE_MAX_HEIGHT */
+
+/* The number of keys that a B+-tree index must be able to hold. The
+   B+-tree file size is derived from it in index-btree.c, unless
+   DB_BTREE_FILE_SIZE is set. Insertions fail with DB_INDEX_ERROR once
+   the file is full. */
+#ifndef DB_BTREE_KEY_CAPACITY
+#define DB_BTREE_KEY_CAPACITY		1024
+#endif /* DB_BTREE_KEY_CAPACITY */
+
+/*----------------------------------------------------------------------------*/
+
+/* Join options. */
+
+/* The maximum number of tuples of the right relation that the hash join
+   keeps in its hash table. Larger right relations are joined in several
+   passes over the left relation. */
+#ifndef DB_JOIN_HASH_ENTRIES
+#define DB_JOIN_HASH_ENTRIES		32
+#endif /* DB_JOIN_HASH_ENTRIES */
+
+/* The number of buckets in the hash join table. */
+#ifndef DB_JOIN_HASH_BUCKETS
+#define DB_JOIN_HASH_BUCKETS		16
+#endif /* DB_JOIN_HASH_BUCKETS */
+
 /*----------------------------------------------------------------------------*/
 
 /* LVM options. */
@@ -219,7 +287,7 @@
 /* The maximum variable identifier number in the LVM. The default 
    value corresponds to the highest attribute ID. */
 #ifndef LVM_MAX_VARIABLE_ID
-#define LVM_MAX_VARIABLE_ID		AQL_ATTRIBUTE_LIMIT - 1
+#define LVM_MAX_VARIABLE_ID		(AQL_ATTRIBUTE_LIMIT - 1)
 #endif /* LVM_MAX_VARIABLE_ID */
 
 /* Specify whether floats should be used or not inside the LVM. */
@@ -227,5 +295,16 @@
 #define LVM_USE_FLOATS			DB_FEATURE_FLOATS
 #endif /* LVM_USE_FLOATS */
 
+/* The maximum number of instructions in a compiled LVM program. Each
+   operator and operand of a condition becomes one instruction. */
+#ifndef LVM_MAX_INSTRUCTIONS
+#define LVM_MAX_INSTRUCTIONS		16
+#endif /* LVM_MAX_INSTRUCTIONS */
+
+/* The maximum evaluation stack depth of a compiled LVM program. */
+#ifndef LVM_STACK_SIZE
+#define LVM_STACK_SIZE			8
+#endif /* LVM_STACK_SIZE */
+
 
 #endif /* !DB_OPTIONS_H */
@@ -0,0 +1,879 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *     A B+-tree index for flash memory.
+ *
+ *     The tree is stored in fixed-size pages in a single file. Page 0
+ *     holds the tree metadata, and the other pages are either leaves
+ *     with (key, tuple ID) entries, or branches with (lowest key, child
+ *     page) entries. The pages on each level are linked from left to
+ *     right, so that range queries can iterate over the leaves in key
+ *     order after a single descent through the tree.
+ *
+ *     Pages are accessed through a small write-back cache, which keeps
+ *     the upper levels of the tree in memory and lets an insertion
+ *     write each modified page only once. When a full page is split at
+ *     the end of the rightmost path, the old page is left full instead
+ *     of being split in half, so that keys inserted in increasing order
+ *     (e.g., timestamps) produce a compact tree.
+ *
+ *     The index is bulk loaded when it is created for a relation that
+ *     already has tuples. If the keys are stored in increasing order,
+ *     the tree is built bottom-up, writing each page exactly once.
+ *     Otherwise, the tuples are inserted one by one through the cache,
+ *     which is flushed when all tuples have been inserted.
+ */
+
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "cfs/cfs.h"
+#include "lib/memb.h"
+
+#include "db-options.h"
+#include "index.h"
+#include "result.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#if DB_BTREE_CACHE_LIMIT < 2
+#error "The B+-tree index requires a cache of at least two pages."
+#endif
+
+#define PAGE_LEAF		0x01
+
+#define NO_PAGE			0
+
+typedef int32_t btree_key_t;
+typedef uint16_t btree_page_id_t;
+
+#define KEY_MIN			INT32_MIN
+#define KEY_MAX			INT32_MAX
+
+struct btree_entry {
+  btree_key_t key;
+  /* A tuple ID in a leaf, or a page ID in a branch. */
+  uint32_t value;
+};
+
+#define PAGE_HEADER_SIZE	4
+#define PAGE_ENTRIES		((DB_BTREE_PAGE_SIZE - PAGE_HEADER_SIZE) / \
+                                 sizeof(struct btree_entry))
+
+/* The file size to reserve for a tree of DB_BTREE_KEY_CAPACITY keys.
+   Pages split in the middle of the tree are only half full, so the
+   leaves are counted at half their capacity. Each branch page has at
+   least half as many children, and each level may have one extra page
+   at its end. Page 0 holds the metadata. */
+#ifndef DB_BTREE_FILE_SIZE
+#define HALF_PAGE_ENTRIES	(PAGE_ENTRIES / 2)
+#define LEAF_PAGES		((DB_BTREE_KEY_CAPACITY + HALF_PAGE_ENTRIES - 1) / \
+                                 HALF_PAGE_ENTRIES)
+#define DB_BTREE_FILE_SIZE	((1 + LEAF_PAGES + \
+                                  LEAF_PAGES / (HALF_PAGE_ENTRIES - 1) + \
+                                  DB_BTREE_MAX_HEIGHT) * \
+                                 (unsigned long)DB_BTREE_PAGE_SIZE)
+#endif /* DB_BTREE_FILE_SIZE */
+
+#define MAX_PAGES		(DB_BTREE_FILE_SIZE / DB_BTREE_PAGE_SIZE)
+
+struct btree_page {
+  uint8_t flags;
+  uint8_t count;
+  btree_page_id_t next;
+  struct btree_entry entries[PAGE_ENTRIES];
+};
+
+struct btree_meta {
+  btree_page_id_t root;
+  btree_page_id_t page_count;
+  uint8_t height;
+};
+
+struct btree {
+  db_storage_id_t storage;
+  struct btree_meta meta;
+  uint8_t meta_dirty;
+};
+typedef struct btree btree_t;
+
+struct page_cache {
+  btree_t *tree;
+  btree_page_id_t page_id;
+  uint8_t dirty;
+  uint16_t last_used;
+  struct btree_page page;
+};
+
+static struct page_cache page_cache[DB_BTREE_CACHE_LIMIT];
+static uint16_t cache_clock;
+MEMB(trees, btree_t, DB_BTREE_INDEX_LIMIT);
+
+static db_result_t create(index_t *);
+static db_result_t destroy(index_t *);
+static db_result_t load(index_t *);
+static db_result_t release(index_t *);
+static db_result_t insert(index_t *, attribute_value_t *, tuple_id_t);
+static db_result_t delete(index_t *, attribute_value_t *);
+static tuple_id_t get_next(index_iterator_t *);
+
+index_api_t index_btree = {
+  INDEX_BTREE,
+  INDEX_API_EXTERNAL | INDEX_API_COMPLETE | INDEX_API_RANGE_QUERIES |
+    INDEX_API_BULK_LOAD,
+  create,
+  destroy,
+  load,
+  release,
+  insert,
+  delete,
+  get_next
+};
+
+static btree_key_t
+to_key(attribute_value_t *value)
+{
+  long long_value;
+
+  long_value = db_value_to_long(value);
+  if(long_value < KEY_MIN) {
+    return KEY_MIN;
+  } else if(long_value > KEY_MAX) {
+    return KEY_MAX;
+  }
+  return (btree_key_t)long_value;
+}
+
+static unsigned long
+page_offset(btree_page_id_t page_id)
+{
+  return (unsigned long)page_id * DB_BTREE_PAGE_SIZE;
+}
+
+static int
+page_write(btree_t *tree, btree_page_id_t page_id, struct btree_page *page)
+{
+  return !DB_ERROR(storage_write(tree->storage, page, page_offset(page_id),
+                                 sizeof(*page)));
+}
+
+static int
+cache_write_back(struct page_cache *cache)
+{
+  if(cache->dirty) {
+    if(!page_write(cache->tree, cache->page_id, &cache->page)) {
+      PRINTF("DB: Failed to write B+-tree page %u\n",
+             (unsigned)cache->page_id);
+      return 0;
+    }
+    cache->dirty = 0;
+  }
+  return 1;
+}
+
+static struct page_cache *
+cache_get_free(void)
+{
+  struct page_cache *cache;
+  struct page_cache *lru;
+
+  lru = NULL;
+  for(cache = page_cache; cache < &page_cache[DB_BTREE_CACHE_LIMIT]; cache++) {
+    if(cache->tree == NULL) {
+      return cache;
+    }
+    if(lru == NULL || (uint16_t)(cache_clock - cache->last_used) >
+                      (uint16_t)(cache_clock - lru->last_used)) {
+      lru = cache;
+    }
+  }
+
+  if(!cache_write_back(lru)) {
+    return NULL;
+  }
+  lru->tree = NULL;
+  return lru;
+}
+
+static int
+flush(btree_t *tree)
+{
+  struct page_cache *cache;
+  int ok;
+
+  ok = 1;
+  for(cache = page_cache; cache < &page_cache[DB_BTREE_CACHE_LIMIT]; cache++) {
+    if(cache->tree == tree && !cache_write_back(cache)) {
+      ok = 0;
+    }
+  }
+
+  if(tree->meta_dirty) {
+    if(DB_ERROR(storage_write(tree->storage, &tree->meta, 0,
+                              sizeof(tree->meta)))) {
+      return 0;
+    }
+    tree->meta_dirty = 0;
+  }
+
+  return ok;
+}
+
+static void
+invalidate_cache(btree_t *tree)
+{
+  struct page_cache *cache;
+
+  for(cache = page_cache; cache < &page_cache[DB_BTREE_CACHE_LIMIT]; cache++) {
+    if(cache->tree == tree) {
+      cache->tree = NULL;
+    }
+  }
+}
+
+/*
+ * Get a page from the cache, or read it in from storage. The returned
+ * pointer is valid until the cache has been accessed for two other
+ * pages.
+ */
+static struct btree_page *
+page_get(btree_t *tree, btree_page_id_t page_id)
+{
+  struct page_cache *cache;
+
+  for(cache = page_cache; cache < &page_cache[DB_BTREE_CACHE_LIMIT]; cache++) {
+    if(cache->tree == tree && cache->page_id == page_id) {
+      cache->last_used = ++cache_clock;
+      return &cache->page;
+    }
+  }
+
+  cache = cache_get_free();
+  if(cache == NULL) {
+    return NULL;
+  }
+
+  if(DB_ERROR(storage_read(tree->storage, &cache->page, page_offset(page_id),
+                           sizeof(cache->page)))) {
+    PRINTF("DB: Failed to read B+-tree page %u\n", (unsigned)page_id);
+    return NULL;
+  }
+
+  cache->tree = tree;
+  cache->page_id = page_id;
+  cache->dirty = 0;
+  cache->last_used = ++cache_clock;
+
+  return &cache->page;
+}
+
+static void
+page_set_dirty(btree_t *tree, struct btree_page *page)
+{
+  struct page_cache *cache;
+
+  cache = (struct page_cache *)((char *)page - offsetof(struct page_cache, page));
+  cache->dirty = 1;
+}
+
+/* Reserve the next page ID at the end of the file. */
+static int
+page_alloc(btree_t *tree, btree_page_id_t *page_id)
+{
+  if(tree->meta.page_count >= MAX_PAGES ||
+     tree->meta.page_count == (btree_page_id_t)-1) {
+    PRINTF("DB: The B+-tree file is full (%lu bytes); increase DB_BTREE_KEY_CAPACITY\n",
+           (unsigned long)DB_BTREE_FILE_SIZE);
+    return 0;
+  }
+
+  *page_id = tree->meta.page_count++;
+  tree->meta_dirty = 1;
+  return 1;
+}
+
+/* Allocate a new page at the end of the file. The page is only written
+   to storage when it is evicted from the cache or flushed. */
+static struct btree_page *
+page_new(btree_t *tree, btree_page_id_t *page_id, uint8_t flags)
+{
+  struct page_cache *cache;
+
+  cache = cache_get_free();
+  if(cache == NULL || !page_alloc(tree, page_id)) {
+    return NULL;
+  }
+
+  memset(&cache->page, 0, sizeof(cache->page));
+  cache->page.flags = flags;
+  cache->tree = tree;
+  cache->page_id = *page_id;
+  cache->dirty = 1;
+  cache->last_used = ++cache_clock;
+
+  return &cache->page;
+}
+
+/* Select the child page to descend into in a branch. Searches use the
+   last child whose lowest key is strictly smaller than the key, since
+   duplicates of the key may span several children. */
+static int
+find_child(struct btree_page *page, btree_key_t key, int inclusive)
+{
+  int i;
+
+  for(i = page->count - 1; i > 0; i--) {
+    if(page->entries[i].key < key ||
+       (inclusive && page->entries[i].key == key)) {
+      break;
+    }
+  }
+  return i;
+}
+
+static btree_page_id_t
+find_leaf(btree_t *tree, btree_key_t key)
+{
+  struct btree_page *page;
+  btree_page_id_t page_id;
+
+  page_id = tree->meta.root;
+  for(;;) {
+    page = page_get(tree, page_id);
+    if(page == NULL) {
+      return NO_PAGE;
+    }
+    if(page->flags & PAGE_LEAF) {
+      return page_id;
+    }
+    page_id = page->entries[find_child(page, key, 0)].value;
+  }
+}
+
+static void
+page_insert(struct btree_page *page, int pos, struct btree_entry *entry)
+{
+  memmove(&page->entries[pos + 1], &page->entries[pos],
+          (page->count - pos) * sizeof(struct btree_entry));
+  page->entries[pos] = *entry;
+  page->count++;
+}
+
+static int
+tree_insert(btree_t *tree, btree_key_t key, uint32_t value)
+{
+  btree_page_id_t path[DB_BTREE_MAX_HEIGHT];
+  uint8_t path_pos[DB_BTREE_MAX_HEIGHT];
+  struct btree_page *page;
+  struct btree_page *new_page;
+  struct btree_page *root;
+  btree_page_id_t page_id;
+  btree_page_id_t new_page_id;
+  btree_page_id_t root_id;
+  struct btree_entry entry;
+  int level;
+  int pos;
+  int half;
+
+  /* Descend to the leaf, and remember the path for splits. */
+  page_id = tree->meta.root;
+  for(level = 0;; level++) {
+    page = page_get(tree, page_id);
+    if(page == NULL) {
+      return 0;
+    }
+    path[level] = page_id;
+    if(page->flags & PAGE_LEAF) {
+      break;
+    }
+    path_pos[level] = find_child(page, key, 1);
+    page_id = page->entries[path_pos[level]].value;
+  }
+
+  /* Insert the entry after any duplicates of the key. */
+  for(pos = page->count; pos > 0 && page->entries[pos - 1].key > key; pos--);
+  entry.key = key;
+  entry.value = value;
+
+  for(;;) {
+    if(page->count < PAGE_ENTRIES) {
+      page_insert(page, pos, &entry);
+      page_set_dirty(tree, page);
+      return 1;
+    }
+
+    /* The page is full, so it must be split. */
+    new_page = page_new(tree, &new_page_id, page->flags);
+    if(new_page == NULL) {
+      PRINTF("DB: Failed to allocate a B+-tree page\n");
+      return 0;
+    }
+
+    new_page->next = page->next;
+    page->next = new_page_id;
+
+    if(pos == page->count && new_page->next == NO_PAGE) {
+      /* Appending to the rightmost page: keep the old page full. */
+      page_insert(new_page, 0, &entry);
+    } else {
+      half = page->count / 2;
+      memcpy(new_page->entries, &page->entries[half],
+             (page->count - half) * sizeof(struct btree_entry));
+      new_page->count = page->count - half;
+      page->count = half;
+      if(pos <= half) {
+        page_insert(page, pos, &entry);
+      } else {
+        page_insert(new_page, pos - half, &entry);
+      }
+    }
+    page_set_dirty(tree, page);
+
+    /* Insert a reference to the new page in the parent. */
+    entry.key = new_page->entries[0].key;
+    entry.value = new_page_id;
+
+    if(level == 0) {
+      if(tree->meta.height == DB_BTREE_MAX_HEIGHT) {
+        PRINTF("DB: The B+-tree has reached its maximum height\n");
+        return 0;
+      }
+      root = page_new(tree, &root_id, 0);
+      if(root == NULL) {
+        return 0;
+      }
+      root->entries[0].key = KEY_MIN;
+      root->entries[0].value = path[0];
+      root->entries[1] = entry;
+      root->count = 2;
+      tree->meta.root = root_id;
+      tree->meta.height++;
+      return 1;
+    }
+
+    level--;
+    page = page_get(tree, path[level]);
+    if(page == NULL) {
+      return 0;
+    }
+    pos = path_pos[level] + 1;
+  }
+}
+
+/*
+ * Build one level of the tree from a sequence of pages on the level
+ * below, which are stored consecutively from the first to the last
+ * page ID. Each page on the new level is written once.
+ */
+static db_result_t
+build_level(btree_t *tree, btree_page_id_t first, btree_page_id_t last,
+            uint8_t flags, struct btree_page *page)
+{
+  btree_page_id_t child;
+  btree_page_id_t page_id;
+  btree_key_t key;
+
+  memset(page, 0, sizeof(*page));
+  page->flags = flags;
+
+  for(child = first; child <= last; child++) {
+    if(page->count == PAGE_ENTRIES) {
+      if(!page_alloc(tree, &page_id)) {
+        return DB_INDEX_ERROR;
+      }
+      page->next = page_id + 1;
+      if(!page_write(tree, page_id, page)) {
+        return DB_STORAGE_ERROR;
+      }
+      memset(page, 0, sizeof(*page));
+      page->flags = flags;
+    }
+
+    if(DB_ERROR(storage_read(tree->storage, &key,
+                             page_offset(child) +
+                             offsetof(struct btree_page, entries),
+                             sizeof(key)))) {
+      return DB_STORAGE_ERROR;
+    }
+    page->entries[page->count].key = page->count == 0 &&
+      child == first ? KEY_MIN : key;
+    page->entries[page->count].value = child;
+    page->count++;
+  }
+
+  if(!page_alloc(tree, &page_id)) {
+    return DB_INDEX_ERROR;
+  }
+  return page_write(tree, page_id, page) ? DB_OK : DB_STORAGE_ERROR;
+}
+
+static db_result_t
+bulk_load(index_t *index, btree_t *tree)
+{
+  static unsigned char row[DB_MAX_CHAR_SIZE_PER_ROW];
+  static struct btree_page page;
+  attribute_t *attr;
+  attribute_value_t value;
+  tuple_id_t tuple_id;
+  btree_key_t key;
+  btree_key_t last_key;
+  btree_page_id_t first;
+  btree_page_id_t last;
+  btree_page_id_t page_id;
+  int offset;
+  int sorted;
+  db_result_t result;
+
+  offset = 0;
+  for(attr = list_head(index->rel->attributes);
+      attr != index->attr;
+      attr = attr->next) {
+    offset += attr->element_size;
+  }
+
+  /* Check whether the tuples are stored in the key order. */
+  sorted = 1;
+  last_key = KEY_MIN;
+  for(tuple_id = 0;; tuple_id++) {
+    result = storage_get_row(index->rel, &tuple_id, row);
+    if(result == DB_FINISHED) {
+      break;
+    } else if(DB_ERROR(result) ||
+              DB_ERROR(db_phy_to_value(&value, attr, row + offset))) {
+      return DB_STORAGE_ERROR;
+    }
+    key = to_key(&value);
+    if(key < last_key) {
+      sorted = 0;
+      break;
+    }
+    last_key = key;
+  }
+
+  PRINTF("DB: Bulk loading a B+-tree over %s.%s from %s tuples\n",
+         index->rel->name, attr->name, sorted ? "sorted" : "unsorted");
+
+  if(!sorted) {
+    if(page_new(tree, &tree->meta.root, PAGE_LEAF) == NULL) {
+      return DB_ALLOCATION_ERROR;
+    }
+    for(tuple_id = 0;; tuple_id++) {
+      result = storage_get_row(index->rel, &tuple_id, row);
+      if(result == DB_FINISHED) {
+        break;
+      } else if(DB_ERROR(result) ||
+                DB_ERROR(db_phy_to_value(&value, attr, row + offset))) {
+        return DB_STORAGE_ERROR;
+      }
+      if(!tree_insert(tree, to_key(&value), tuple_id)) {
+        return DB_INDEX_ERROR;
+      }
+    }
+    return flush(tree) ? DB_OK : DB_STORAGE_ERROR;
+  }
+
+  /* Fill the leaves completely in key order. */
+  memset(&page, 0, sizeof(page));
+  page.flags = PAGE_LEAF;
+  first = tree->meta.page_count;
+  for(tuple_id = 0;; tuple_id++) {
+    result = storage_get_row(index->rel, &tuple_id, row);
+    if(result == DB_FINISHED) {
+      break;
+    } else if(DB_ERROR(result) ||
+              DB_ERROR(db_phy_to_value(&value, attr, row + offset))) {
+      return DB_STORAGE_ERROR;
+    }
+
+    if(page.count == PAGE_ENTRIES) {
+      if(!page_alloc(tree, &page_id)) {
+        return DB_INDEX_ERROR;
+      }
+      page.next = page_id + 1;
+      if(!page_write(tree, page_id, &page)) {
+        return DB_STORAGE_ERROR;
+      }
+      memset(&page, 0, sizeof(page));
+      page.flags = PAGE_LEAF;
+    }
+    page.entries[page.count].key = to_key(&value);
+    page.entries[page.count].value = tuple_id;
+    page.count++;
+  }
+  if(!page_alloc(tree, &page_id)) {
+    return DB_INDEX_ERROR;
+  }
+  if(!page_write(tree, page_id, &page)) {
+    return DB_STORAGE_ERROR;
+  }
+  last = page_id;
+
+  /* Build the branch levels until a single root page remains. */
+  for(tree->meta.height = 1; first != last; tree->meta.height++) {
+    if(tree->meta.height == DB_BTREE_MAX_HEIGHT) {
+      return DB_INDEX_ERROR;
+    }
+    result = build_level(tree, first, last, 0, &page);
+    if(result != DB_OK) {
+      return result;
+    }
+    first = last + 1;
+    last = tree->meta.page_count - 1;
+  }
+  tree->meta.root = last;
+  tree->meta_dirty = 1;
+
+  PRINTF("DB: Bulk loaded %lu tuples into %u pages; the tree height is %u\n",
+         (unsigned long)tuple_id, (unsigned)tree->meta.page_count - 1,
+         (unsigned)tree->meta.height);
+
+  return flush(tree) ? DB_OK : DB_STORAGE_ERROR;
+}
+
+static db_result_t
+create(index_t *index)
+{
+  char *filename;
+  btree_t *tree;
+  struct btree_page *root;
+  db_result_t result;
+
+  filename = storage_generate_file("btree", DB_BTREE_FILE_SIZE);
+  if(filename == NULL) {
+    PRINTF("DB: Failed to generate a B+-tree file\n");
+    return DB_INDEX_ERROR;
+  }
+
+  memcpy(index->descriptor_file, filename, sizeof(index->descriptor_file));
+
+  index->opaque_data = tree = memb_alloc(&trees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    cfs_remove(index->descriptor_file);
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->storage = storage_open(index->descriptor_file);
+  if(tree->storage < 0) {
+    result = DB_STORAGE_ERROR;
+    goto end;
+  }
+
+  /* Page 0 is reserved for the metadata. */
+  tree->meta.page_count = 1;
+  tree->meta.height = 1;
+  tree->meta_dirty = 1;
+
+  if(relation_cardinality(index->rel) > 0) {
+    result = bulk_load(index, tree);
+  } else {
+    root = page_new(tree, &tree->meta.root, PAGE_LEAF);
+    result = root != NULL && flush(tree) ? DB_OK : DB_STORAGE_ERROR;
+  }
+
+ end:
+  if(result != DB_OK) {
+    invalidate_cache(tree);
+    storage_close(tree->storage);
+    memb_free(&trees, tree);
+    index->opaque_data = NULL;
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return result;
+  }
+
+  PRINTF("DB: Created a B+-tree index in %s\n", index->descriptor_file);
+
+  return DB_OK;
+}
+
+static db_result_t
+destroy(index_t *index)
+{
+  if(index->opaque_data != NULL) {
+    release(index);
+  }
+  cfs_remove(index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+load(index_t *index)
+{
+  btree_t *tree;
+
+  index->opaque_data = tree = memb_alloc(&trees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->storage = storage_open(index->descriptor_file);
+  if(tree->storage < 0 ||
+     DB_ERROR(storage_read(tree->storage, &tree->meta, 0,
+                           sizeof(tree->meta)))) {
+    storage_close(tree->storage);
+    memb_free(&trees, tree);
+    index->opaque_data = NULL;
+    return DB_STORAGE_ERROR;
+  }
+  tree->meta_dirty = 0;
+
+  PRINTF("DB: Loaded a B+-tree index from %s; root %u, height %u\n",
+         index->descriptor_file, (unsigned)tree->meta.root,
+         (unsigned)tree->meta.height);
+
+  return DB_OK;
+}
+
+static db_result_t
+release(index_t *index)
+{
+  btree_t *tree;
+  db_result_t result;
+
+  tree = index->opaque_data;
+  result = flush(tree) ? DB_OK : DB_STORAGE_ERROR;
+
+  invalidate_cache(tree);
+  storage_close(tree->storage);
+  memb_free(&trees, tree);
+  index->opaque_data = NULL;
+
+  return result;
+}
+
+static db_result_t
+insert(index_t *index, attribute_value_t *key, tuple_id_t value)
+{
+  btree_t *tree;
+
+  tree = (btree_t *)index->opaque_data;
+
+  if(!tree_insert(tree, to_key(key), value) || !flush(tree)) {
+    PRINTF("DB: Failed to insert key %ld into a B+-tree index\n",
+           (long)to_key(key));
+    return DB_INDEX_ERROR;
+  }
+  return DB_OK;
+}
+
+static db_result_t
+delete(index_t *index, attribute_value_t *value)
+{
+  btree_t *tree;
+  struct btree_page *page;
+  btree_page_id_t page_id;
+  btree_key_t key;
+  int i;
+
+  tree = (btree_t *)index->opaque_data;
+  key = to_key(value);
+
+  /* Remove all entries with the key. Pages are not merged, but empty
+     leaves are skipped when iterating. */
+  for(page_id = find_leaf(tree, key); page_id != NO_PAGE;) {
+    page = page_get(tree, page_id);
+    if(page == NULL) {
+      return DB_STORAGE_ERROR;
+    }
+    for(i = 0; i < page->count;) {
+      if(page->entries[i].key > key) {
+        return flush(tree) ? DB_OK : DB_STORAGE_ERROR;
+      } else if(page->entries[i].key == key) {
+        page->count--;
+        memmove(&page->entries[i], &page->entries[i + 1],
+                (page->count - i) * sizeof(struct btree_entry));
+        page_set_dirty(tree, page);
+      } else {
+        i++;
+      }
+    }
+    page_id = page->next;
+  }
+
+  return flush(tree) ? DB_OK : DB_STORAGE_ERROR;
+}
+
+static tuple_id_t
+get_next(index_iterator_t *iterator)
+{
+  struct iteration_cache {
+    index_iterator_t *index_iterator;
+    btree_page_id_t page_id;
+    uint8_t slot;
+    btree_key_t min;
+    btree_key_t max;
+  };
+  static struct iteration_cache cache;
+  btree_t *tree;
+  struct btree_page *page;
+  struct btree_entry *entry;
+
+  tree = (btree_t *)iterator->index->opaque_data;
+
+  if(cache.index_iterator != iterator || iterator->next_item_no == 0) {
+    /* Initialize the cache for a new search. */
+    cache.index_iterator = iterator;
+    cache.min = to_key(&iterator->min_value);
+    cache.max = to_key(&iterator->max_value);
+    cache.page_id = find_leaf(tree, cache.min);
+    cache.slot = 0;
+  }
+
+  /* Follow the leaf links until a key beyond the range is found. */
+  while(cache.page_id != NO_PAGE) {
+    page = page_get(tree, cache.page_id);
+    if(page == NULL) {
+      return INVALID_TUPLE;
+    }
+
+    for(; cache.slot < page->count; cache.slot++) {
+      entry = &page->entries[cache.slot];
+      if(entry->key > cache.max) {
+        cache.page_id = NO_PAGE;
+        return INVALID_TUPLE;
+      } else if(entry->key >= cache.min) {
+        cache.slot++;
+        iterator->next_item_no++;
+        return (tuple_id_t)entry->value;
+      }
+    }
+
+    cache.page_id = page->next;
+    cache.slot = 0;
+  }
+
+  return INVALID_TUPLE;
+}
@@ -100,29 +100,40 @@ get_value(tuple_id_t *index, relation_t *rel, attribute_t *attr)
   return &value;
 }
 
+/*
+ * Find the first tuple whose value is at least the target value, or,
+ * if upper_bound is set, the last tuple whose value is at most the 
+ * target value. Several tuples may share the same value, so the search
+ * must not stop at the first match.
+ */
 static tuple_id_t
 binary_search(index_iterator_t *index_iterator,
               attribute_value_t *target_value,
-              int exact_match)
+              int upper_bound)
 {
   relation_t *rel;
   attribute_t *attr;
   attribute_value_t *cmp_value;
+  tuple_id_t cardinality;
   tuple_id_t min;
   tuple_id_t max;
   tuple_id_t center;
+  long target;
+  long cmp;
 
   rel = index_iterator->index->rel;
   attr = index_iterator->index->attr;
 
-  max = relation_cardinality(rel);
-  if(max == INVALID_TUPLE) {
+  cardinality = relation_cardinality(rel);
+  if(cardinality == INVALID_TUPLE) {
     return INVALID_TUPLE;
   }
-  max--;
+
+  target = db_value_to_long(target_value);
   min = 0;
+  max = cardinality;
 
-  do {
+  while(min < max) {
     center = min + ((max - min) / 2);
 
     cmp_value = get_value(&center, rel, attr);
@@ -132,22 +143,18 @@ binary_search(index_iterator_t *index_iterator,
       return INVALID_TUPLE;
     }
 
-    if(db_value_to_long(target_value) > db_value_to_long(cmp_value)) {
+    cmp = db_value_to_long(cmp_value);
+    if(cmp < target || (upper_bound && cmp == target)) {
       min = center + 1;
     } else {
-      max = center - 1;
+      max = center;
     }
-  } while(min <= max &&
-          db_value_to_long(target_value) != db_value_to_long(cmp_value));
-
-  if(exact_match &&
-     db_value_to_long(target_value) != db_value_to_long(cmp_value)) {
-    PRINTF("DB: Could not find value %ld in the inline index\n",
-           db_value_to_long(target_value));
-    return INVALID_TUPLE;
   }
 
-  return center;
+  if(upper_bound) {
+    return min == 0 ? INVALID_TUPLE : min - 1;
+  }
+  return min == cardinality ? INVALID_TUPLE : min;
 }
 
 static tuple_id_t
@@ -156,7 +163,6 @@ range_search(index_iterator_t *index_iterator,
 {
   attribute_value_t *low_target;
   attribute_value_t *high_target;
-  int exact_match;
 
   low_target = &index_iterator->min_value;
   high_target = &index_iterator->max_value;
@@ -164,17 +170,16 @@ range_search(index_iterator_t *index_iterator,
   PRINTF("DB: Search index for value range (%ld, %ld)\n",
     db_value_to_long(low_target), db_value_to_long(high_target));
 
-  exact_match = db_value_to_long(low_target) == db_value_to_long(high_target);
-
   /* Optimize later so that the other search uses the result
      from the first one. */
-  *start = binary_search(index_iterator, low_target, exact_match);
+  *start = binary_search(index_iterator, low_target, 0);
   if(*start == INVALID_TUPLE) {
     return DB_INDEX_ERROR;
   }
 
-  *end = binary_search(index_iterator, high_target, exact_match);
-  if(*end == INVALID_TUPLE) {
+  *end = binary_search(index_iterator, high_target, 1);
+  if(*end == INVALID_TUPLE || *end < *start) {
+    PRINTF("DB: No values in the range in the inline index\n");
     return DB_INDEX_ERROR;
   }
   return DB_OK;
@@ -49,7 +49,7 @@
 #include "storage.h"
 
 static index_api_t *index_components[] = {&index_inline,
-	&index_maxheap};
+	&index_maxheap, &index_btree};
 
 LIST(indices);
 MEMB(index_memb, index_t, DB_INDEX_POOL_SIZE);
@@ -131,8 +131,9 @@ index_create(index_type_t index_type, relation_t *rel, attribute_t *attr)
   attr->index = index;
   list_push(indices, index);
 
-  if(index->descriptor_file[0] != '\0' &&
-     DB_ERROR(storage_put_index(index))) {
+  /* Store a record of the index also when it has no descriptor file,
+     so that it is loaded again along with the relation. */
+  if(DB_ERROR(storage_put_index(index))) {
     api->destroy(index);
     memb_free(&index_memb, index);
     PRINTF("DB: Failed to store index data in file \"%s\"\n",
@@ -140,7 +141,8 @@ index_create(index_type_t index_type, relation_t *rel, attribute_t *attr)
     return DB_INDEX_ERROR;
   }
 
-  if(!(api->flags & INDEX_API_INLINE) && cardinality > 0) {
+  if(!(api->flags & (INDEX_API_INLINE | INDEX_API_BULK_LOAD)) &&
+     cardinality > 0) {
     PRINTF("DB: Created an index for an old relation; issuing a load request\n");
     index->flags = INDEX_LOAD_NEEDED;
     process_post(&db_indexer, load_request_event, NULL);
@@ -369,11 +371,11 @@ PROCESS_THREAD(db_indexer, ev, data)
   load_request_event = process_alloc_event();
 
   for(;;) {
-    PROCESS_WAIT_EVENT_UNTIL(ev == load_request_event);
-
+    /* Load requests may arrive while another index is being loaded,
+       so keep going until no index needs to be loaded. */
     index = get_next_index_to_load();
     if(index == NULL) {
-      PRINTF("DB: Request to load an index, but no index is set to be loaded\n");
+      PROCESS_WAIT_EVENT_UNTIL(ev == load_request_event);
       continue;
     }
 
@@ -388,7 +390,7 @@ PROCESS_THREAD(db_indexer, ev, data)
       continue;
     }
 
-    for(;; row++) {
+    for(row = 0;; row++) {
       PROCESS_PAUSE();
 
       result = db_process(&handle);
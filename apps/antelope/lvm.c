@@ -64,6 +64,14 @@
 #define LVM_USE_FLOATS			0
 #endif
 
+#ifndef LVM_MAX_INSTRUCTIONS
+#define LVM_MAX_INSTRUCTIONS		16
+#endif
+
+#ifndef LVM_STACK_SIZE
+#define LVM_STACK_SIZE			8
+#endif
+
 #define IS_CONNECTIVE(op) ((op) & LVM_CONNECTIVE)
 
 struct variable {
@@ -82,10 +90,40 @@ typedef struct derivation derivation_t;
 
 /* Registered variables for a LVM expression. Their values may be 
    changed between executions of the expression. */
-static variable_t variables[LVM_MAX_VARIABLE_ID - 1];
+static variable_t variables[LVM_MAX_VARIABLE_ID];
 
 /* Range derivations of variables that are used for index searches. */
-static derivation_t derivations[LVM_MAX_VARIABLE_ID - 1];
+static derivation_t derivations[LVM_MAX_VARIABLE_ID];
+
+/*
+ * An expression can be compiled into a flat program in postfix order,
+ * which is evaluated on a stack of long values without recursion or
+ * type dispatching. Variables that have been bound to an offset in a
+ * stored tuple are loaded directly from the tuple. The opcodes of the
+ * operators are the same as their operator values.
+ */
+enum opcode {
+  LOAD_CONSTANT = 1,
+  LOAD_VARIABLE = 2,
+  LOAD_INT = 3,
+  LOAD_LONG = 4
+};
+
+struct instruction {
+  uint8_t opcode;
+  uint8_t offset;
+  long value;
+};
+
+struct binding {
+  uint8_t offset;
+  uint8_t size;
+};
+
+static struct binding bindings[LVM_MAX_VARIABLE_ID];
+static struct instruction program[LVM_MAX_INSTRUCTIONS];
+static uint8_t program_length;
+static uint8_t stack_height;
 
 #if DEBUG
 static void
@@ -297,6 +335,122 @@ eval_logic(lvm_instance_t *p, operator_t *op)
   return EXECUTION_ERROR;
 }
 
+static lvm_status_t
+emit(uint8_t opcode, uint8_t offset, long value)
+{
+  struct instruction *instruction;
+
+  if(program_length == LVM_MAX_INSTRUCTIONS) {
+    return STACK_OVERFLOW;
+  }
+
+  /* Loads push a value; binary operators pop two values and push one. */
+  if(opcode < LVM_ARITH_OP) {
+    if(++stack_height > LVM_STACK_SIZE) {
+      return STACK_OVERFLOW;
+    }
+  } else if(opcode != LVM_NOT) {
+    stack_height--;
+  }
+
+  instruction = &program[program_length++];
+  instruction->opcode = opcode;
+  instruction->offset = offset;
+  instruction->value = value;
+
+  return TRUE;
+}
+
+static lvm_status_t
+compile_operand(lvm_instance_t *p)
+{
+  operand_t operand;
+  struct binding *binding;
+
+  get_operand(p, &operand);
+
+  switch(operand.type) {
+  case LVM_LONG:
+    return emit(LOAD_CONSTANT, 0, operand.value.l);
+#if LVM_USE_FLOATS
+  case LVM_FLOAT:
+    return emit(LOAD_CONSTANT, 0, (long)operand.value.f);
+#endif /* LVM_USE_FLOATS */
+  case LVM_VARIABLE:
+    if(operand.value.id >= LVM_MAX_VARIABLE_ID) {
+      return INVALID_IDENTIFIER;
+    }
+    binding = &bindings[operand.value.id];
+    if(binding->size == 2) {
+      return emit(LOAD_INT, binding->offset, 0);
+    } else if(binding->size == 4) {
+      return emit(LOAD_LONG, binding->offset, 0);
+    }
+    return emit(LOAD_VARIABLE, 0, operand.value.id);
+  default:
+    return emit(LOAD_CONSTANT, 0, 0);
+  }
+}
+
+static lvm_status_t
+compile_expr(lvm_instance_t *p, operator_t op)
+{
+  int i;
+  lvm_status_t r;
+
+  for(i = 0; i < 2; i++) {
+    switch(get_type(p)) {
+    case LVM_ARITH_OP:
+      r = compile_expr(p, *get_operator(p));
+      break;
+    case LVM_OPERAND:
+      r = compile_operand(p);
+      break;
+    default:
+      return SEMANTIC_ERROR;
+    }
+    if(LVM_ERROR(r)) {
+      return r;
+    }
+  }
+
+  return emit(op, 0, 0);
+}
+
+static lvm_status_t
+compile_logic(lvm_instance_t *p, operator_t op)
+{
+  int i;
+  unsigned arguments;
+  lvm_status_t r;
+
+  if(IS_CONNECTIVE(op)) {
+    arguments = op == LVM_NOT ? 1 : 2;
+    for(i = 0; i < arguments; i++) {
+      if(get_type(p) != LVM_CMP_OP) {
+	return SEMANTIC_ERROR;
+      }
+      r = compile_logic(p, *get_operator(p));
+      if(LVM_ERROR(r)) {
+	return r;
+      }
+    }
+    return emit(op, 0, 0);
+  }
+
+  return compile_expr(p, op);
+}
+
+static int
+reserve(lvm_instance_t *p, lvm_ip_t size)
+{
+  if(p->end + size > p->size) {
+    p->error = __LINE__;
+    return 0;
+  }
+  return 1;
+}
+
 void
 lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size)
 {
@@ -309,6 +463,8 @@ lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size)
 
   memset(variables, 0, sizeof(variables));
   memset(derivations, 0, sizeof(derivations));
+  memset(bindings, 0, sizeof(bindings));
+  program_length = 0;
 }
 
 lvm_ip_t
@@ -334,7 +490,8 @@ lvm_shift_for_operator(lvm_instance_t *p, lvm_ip_t end)
 
   old_end = p->end;
 
-  if(p->end + sizeof(operator_t) > p->size || end >= old_end) {
+  if(p->end + sizeof(operator_t) + sizeof(node_type_t) > p->size ||
+     end >= old_end) {
     p->error = __LINE__;
     return 0;
   }
@@ -372,6 +529,9 @@ lvm_set_end(lvm_instance_t *p, lvm_ip_t end)
 void
 lvm_set_type(lvm_instance_t *p, node_type_t type)
 {
+  if(!reserve(p, sizeof(type))) {
+    return;
+  }
   *(node_type_t *)(p->code + p->end) = type;
   p->end += sizeof(type);
 }
@@ -403,9 +563,131 @@ lvm_execute(lvm_instance_t *p)
   return status;
 }
 
+lvm_status_t
+lvm_compile(lvm_instance_t *p)
+{
+  lvm_status_t r;
+
+  p->ip = 0;
+  program_length = 0;
+  stack_height = 0;
+
+  if(p->error) {
+    return SEMANTIC_ERROR;
+  }
+
+  if(get_type(p) != LVM_CMP_OP) {
+    PRINTF("Error: The code must start with a relational operator\n");
+    return SEMANTIC_ERROR;
+  }
+
+  r = compile_logic(p, *get_operator(p));
+  if(LVM_ERROR(r)) {
+    PRINTF("Compilation error: %d\n", (int)r);
+    program_length = 0;
+    return r;
+  }
+
+  PRINTF("Compiled %d bytes of code into %d instructions\n",
+         p->end, program_length);
+
+  return TRUE;
+}
+
+lvm_status_t
+lvm_execute_row(lvm_instance_t *p, const unsigned char *row)
+{
+  long stack[LVM_STACK_SIZE];
+  long *top;
+  long value;
+  const unsigned char *ptr;
+  struct instruction *instruction;
+  struct instruction *end;
+
+  top = stack - 1;
+  end = &program[program_length];
+
+  for(instruction = program; instruction < end; instruction++) {
+    switch(instruction->opcode) {
+    case LOAD_CONSTANT:
+      *++top = instruction->value;
+      continue;
+    case LOAD_VARIABLE:
+      *++top = variables[instruction->value].value.l;
+      continue;
+    case LOAD_INT:
+      ptr = row + instruction->offset;
+      *++top = ptr[0] << 8 | ptr[1];
+      continue;
+    case LOAD_LONG:
+      ptr = row + instruction->offset;
+      *++top = (uint32_t)ptr[0] << 24 | (uint32_t)ptr[1] << 16 |
+               (uint32_t)ptr[2] << 8 | ptr[3];
+      continue;
+    case LVM_NOT:
+      *top = !*top;
+      continue;
+    }
+
+    value = *top--;
+    switch(instruction->opcode) {
+    case LVM_ADD:
+      *top += value;
+      break;
+    case LVM_SUB:
+      *top -= value;
+      break;
+    case LVM_MUL:
+      *top *= value;
+      break;
+    case LVM_DIV:
+      if(value == 0) {
+        return MATH_ERROR;
+      }
+      *top /= value;
+      break;
+    case LVM_EQ:
+      *top = *top == value;
+      break;
+    case LVM_NEQ:
+      *top = *top != value;
+      break;
+    case LVM_GE:
+      *top = *top > value;
+      break;
+    case LVM_GEQ:
+      *top = *top >= value;
+      break;
+    case LVM_LE:
+      *top = *top < value;
+      break;
+    case LVM_LEQ:
+      *top = *top <= value;
+      break;
+    case LVM_AND:
+      *top = *top && value;
+      break;
+    case LVM_OR:
+      *top = *top || value;
+      break;
+    default:
+      return EXECUTION_ERROR;
+    }
+  }
+
+  if(top != stack) {
+    return EXECUTION_ERROR;
+  }
+
+  return *top ? TRUE : FALSE;
+}
+
 void
 lvm_set_op(lvm_instance_t *p, operator_t op)
 {
+  if(!reserve(p, sizeof(node_type_t) + sizeof(op))) {
+    return;
+  }
   lvm_set_type(p, LVM_ARITH_OP);
   memcpy(&p->code[p->end], &op, sizeof(op));
   p->end += sizeof(op);
@@ -414,6 +696,9 @@ lvm_set_op(lvm_instance_t *p, operator_t op)
 void
 lvm_set_relation(lvm_instance_t *p, operator_t op)
 {
+  if(!reserve(p, sizeof(node_type_t) + sizeof(op))) {
+    return;
+  }
   lvm_set_type(p, LVM_CMP_OP);
   memcpy(&p->code[p->end], &op, sizeof(op));
   p->end += sizeof(op);
@@ -422,6 +707,9 @@ lvm_set_relation(lvm_instance_t *p, operator_t op)
 void
 lvm_set_operand(lvm_instance_t *p, operand_t *op)
 {
+  if(!reserve(p, sizeof(node_type_t) + sizeof(*op))) {
+    return;
+  }
   lvm_set_type(p, LVM_OPERAND);
   memcpy(&p->code[p->end], op, sizeof(*op));
   p->end += sizeof(*op);
@@ -472,6 +760,26 @@ lvm_set_variable_value(char *name, operand_value_t value)
   return TRUE;
 }
 
+lvm_status_t
+lvm_bind_variable(char *name, unsigned offset, unsigned size)
+{
+  variable_id_t id;
+
+  id = lookup(name);
+  if(id == LVM_MAX_VARIABLE_ID || variables[id].name[0] == '\0') {
+    return INVALID_IDENTIFIER;
+  }
+
+  if((size != 2 && size != 4) || offset > UINT8_MAX) {
+    return TYPE_ERROR;
+  }
+
+  bindings[id].offset = offset;
+  bindings[id].size = size;
+
+  return TRUE;
+}
+
 void
 lvm_set_variable(lvm_instance_t *p, char *name)
 {
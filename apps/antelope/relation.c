@@ -79,6 +79,34 @@ struct source_map {
 };
 
 static struct source_map source_map[AQL_ATTRIBUTE_LIMIT];
+
+/*
+ * The join_hash_entry structure holds the join attribute value of a
+ * tuple in the right relation. A hash join builds a table of such
+ * entries over a chunk of the right relation, and then probes the
+ * table with each tuple in the left relation.
+ */
+struct join_hash_entry {
+  struct join_hash_entry *next;
+  long value;
+  tuple_id_t tuple_id;
+};
+
+static struct join_hash_entry join_entries[DB_JOIN_HASH_ENTRIES];
+static struct join_hash_entry *join_buckets[DB_JOIN_HASH_BUCKETS];
+
+/*
+ * The join_state structure holds the progress of a hash join or a
+ * merge join between two calls to relation_process_join.
+ */
+static struct {
+  struct join_hash_entry *probe;
+  unsigned char *left_value_ptr;
+  unsigned char *right_value_ptr;
+  long left_value;
+  tuple_id_t right_tuple_id;
+  tuple_id_t group_start;
+} join_state;
 #endif /* DB_FEATURE_JOIN */
 
 static unsigned char row[DB_MAX_ATTRIBUTES_PER_RELATION * DB_MAX_ELEMENT_SIZE];
@@ -88,6 +116,15 @@ static unsigned char * const left_row = row;
 static unsigned char * const right_row = extra_row;
 static unsigned char * const join_row = result_row;
 
+#if DB_SCAN_BUFFER_SIZE < DB_MAX_ATTRIBUTES_PER_RELATION * DB_MAX_ELEMENT_SIZE
+#error "DB_SCAN_BUFFER_SIZE must be large enough to hold a row."
+#endif
+
+/* Relation scans read a batch of rows at a time into this buffer. */
+static unsigned char scan_buffer[DB_SCAN_BUFFER_SIZE];
+static unsigned scan_rows;
+static unsigned scan_pos;
+
 LIST(relations);
 MEMB(relations_memb, relation_t, DB_RELATION_POOL_SIZE);
 MEMB(attributes_memb, attribute_t, DB_ATTRIBUTE_POOL_SIZE);
@@ -205,6 +242,9 @@ relation_free(relation_t *rel)
 {
   attribute_t *attr;
 
+  /* Write the rows that may still be buffered after the last release */
+  storage_unload(rel);
+
   while((attr = list_pop(rel->attributes)) != NULL) {
     attribute_free(rel, attr);
   }
@@ -266,7 +306,7 @@ relation_release(relation_t *rel)
   }
 
   if(rel->references == 0) {
-    storage_unload(rel);
+    return storage_release(rel);
   }
 
   return DB_OK;
@@ -630,45 +670,40 @@ generate_attribute_map(struct source_dest_map *attr_map, unsigned attribute_coun
 static void
 select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
 {
-  index_t *index;
   attribute_t *attr;
   operand_value_t min;
   operand_value_t max;
   attribute_value_t av_min;
   attribute_value_t av_max;
-  long range;
+  unsigned long range;
   unsigned long min_range;
 
-  index = NULL;
   min_range = ULONG_MAX;
 
   /* Find all indexed and derived attributes, and select the index of 
-     the attribute with the smallest range. */
+     the attribute with the smallest range that the index can search.
+     Indexes without range query support refuse wide ranges. */
   for(attr = list_head(handle->rel->attributes);
       attr != NULL;
       attr = attr->next) {
     if(attr->index != NULL &&
        !LVM_ERROR(lvm_get_derived_range(lvm_instance, attr->name, &min, &max))) {
       range = (unsigned long)max.l - (unsigned long)min.l;
-      PRINTF("DB: The search range for attribute \"%s\" comprises %ld values\n",
+      PRINTF("DB: The search range for attribute \"%s\" comprises %lu values\n",
              attr->name, range + 1);
 
       if(range <= min_range) {
-        index = attr->index;
-        av_min.domain = av_max.domain = DOMAIN_INT;
+        av_min.domain = av_max.domain = DOMAIN_LONG;
         VALUE_LONG(&av_min) = min.l;
         VALUE_LONG(&av_max) = max.l;
+        if(index_get_iterator(&handle->index_iterator, attr->index,
+                              &av_min, &av_max) == DB_OK) {
+          handle->flags |= DB_HANDLE_FLAG_SEARCH_INDEX;
+          min_range = range;
+        }
       }
     }
   }
-
-  if(index != NULL) {
-    /* We found a suitable index; get an iterator for it. */
-    if(index_get_iterator(&handle->index_iterator, index, 
-                          &av_min, &av_max) == DB_OK) {
-      handle->flags |= DB_HANDLE_FLAG_SEARCH_INDEX;
-    }
-  }
 }
 
 static db_result_t
@@ -677,6 +712,7 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
   relation_t *result_rel;
   unsigned attribute_count;
   attribute_t *attr;
+  struct source_dest_map *attr_map_ptr;
 
   result_rel = handle->result_rel;
 
@@ -696,11 +732,29 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
     return DB_IMPLEMENTATION_ERROR;
   }
 
+  scan_rows = scan_pos = 0;
+
   if(adt->lvm_instance != NULL) {
     /* Try to establish acceptable ranges for the attribute values. */
     if(!LVM_ERROR(lvm_derive(adt->lvm_instance))) {
       select_index(handle, adt->lvm_instance);
     }
+
+    /* Compile the condition into a program that reads the attribute
+       values directly from the stored rows. If this fails, the
+       condition is interpreted for each row instead. */
+    for(attr_map_ptr = attr_map;
+        attr_map_ptr < attr_map + attribute_count;
+        attr_map_ptr++) {
+      attr = attr_map_ptr->from_attr;
+      if(attr->domain == DOMAIN_INT || attr->domain == DOMAIN_LONG) {
+        lvm_bind_variable(attr->name, attr_map_ptr->from_offset,
+                          attr->domain == DOMAIN_INT ? 2 : 4);
+      }
+    }
+    if(!LVM_ERROR(lvm_compile(adt->lvm_instance))) {
+      handle->flags |= DB_HANDLE_FLAG_COMPILED;
+    }
   }
 
   handle->flags |= DB_HANDLE_FLAG_PROCESSING;
@@ -731,6 +785,42 @@ relation_process_remove(void *handle_ptr)
 }
 #endif
 
+/* Get the next tuple to evaluate in a selection, either through an
+   index or from a batch of rows read in a sequential scan. */
+static db_result_t
+get_next_tuple(db_handle_t *handle, unsigned char **tuple)
+{
+  db_result_t result;
+  unsigned count;
+
+  if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
+    handle->tuple_id = index_get_next(&handle->index_iterator);
+    if(handle->tuple_id == INVALID_TUPLE) {
+      PRINTF("DB: No more matching attribute values in the index\n");
+      return DB_FINISHED;
+    }
+
+    result = storage_get_row(handle->rel, &handle->tuple_id, row);
+    handle->tuple_id++;
+    *tuple = row;
+    return result;
+  }
+
+  if(scan_pos == scan_rows) {
+    count = sizeof(scan_buffer) / handle->rel->row_length;
+    result = storage_get_rows(handle->rel, handle->tuple_id, scan_buffer, &count);
+    if(result != DB_OK) {
+      return result;
+    }
+    handle->tuple_id += count;
+    scan_rows = count;
+    scan_pos = 0;
+  }
+
+  *tuple = scan_buffer + scan_pos++ * handle->rel->row_length;
+  return DB_OK;
+}
+
 db_result_t
 relation_process_select(void *handle_ptr)
 {
@@ -740,12 +830,14 @@ relation_process_select(void *handle_ptr)
   unsigned attribute_count;
   struct source_dest_map *attr_map_ptr, *attr_map_end;
   attribute_t *result_attr;
+  unsigned char *tuple;
   unsigned char *from_ptr;
   unsigned char *to_ptr;
   operand_value_t operand_value;
   uint8_t intbuf[2];
   attribute_value_t value;
   lvm_status_t wanted_result;
+  lvm_status_t status;
 
   handle = (db_handle_t *)handle_ptr;
   adt = (aql_adt_t *)handle->adt;
@@ -753,96 +845,90 @@ relation_process_select(void *handle_ptr)
   attribute_count = handle->result_rel->attribute_count;
   attr_map_end = attr_map + attribute_count;
 
-  if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
-    handle->tuple_id = index_get_next(&handle->index_iterator);
-    if(handle->tuple_id == INVALID_TUPLE) {
-      PRINTF("DB: An attribute value could not be found in the index\n");
-      if(handle->index_iterator.next_item_no == 0) {
-        return DB_INDEX_ERROR;
-      }
+  wanted_result = TRUE;
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC) {
+    wanted_result = FALSE;
+  }
 
-      if(adt->flags & AQL_FLAG_AGGREGATE) {
+  /* Evaluate the condition for the tuples in the current batch until
+     one of them fulfils it. */
+  for(;;) {
+    result = get_next_tuple(handle, &tuple);
+    if(DB_ERROR(result)) {
+      PRINTF("DB: Failed to get a row in relation %s!\n", handle->rel->name);
+      return result;
+    } else if(result == DB_FINISHED) {
+      if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
         goto end_aggregation;
       }
-
       return DB_FINISHED;
     }
-  }
 
-  /* Put the tuples fulfilling the given condition into a new relation.
-     The tuples may be projected. */
-  result = storage_get_row(handle->rel, &handle->tuple_id, row);
-  handle->tuple_id++;
-  if(DB_ERROR(result)) {
-    PRINTF("DB: Failed to get a row in relation %s!\n", handle->rel->name);
-    return result;
-  } else if(result == DB_FINISHED) {
-    if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
-      goto end_aggregation;
+    if(adt->lvm_instance == NULL) {
+      break;
     }
-    return DB_FINISHED;
-  }
 
-  /* Process the attributes in the result relation. */
-  for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-    from_ptr = row + attr_map_ptr->from_offset;
-    result_attr = attr_map_ptr->to_attr;
-
-    /* Update the internal state of the PLE. */
-    if(result_attr->domain == DOMAIN_INT) {
-      operand_value.l = from_ptr[0] << 8 | from_ptr[1];
-      lvm_set_variable_value(result_attr->name, operand_value);
-    } else if(result_attr->domain == DOMAIN_LONG) {
-      operand_value.l = (uint32_t)from_ptr[0] << 24 |
-                        (uint32_t)from_ptr[1] << 16 |
-                        (uint32_t)from_ptr[2] << 8 |
-                        from_ptr[3];
-      lvm_set_variable_value(result_attr->name, operand_value);
+    if(handle->flags & DB_HANDLE_FLAG_COMPILED) {
+      status = lvm_execute_row(adt->lvm_instance, tuple);
+    } else {
+      /* Update the internal state of the LVM. */
+      for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+        from_ptr = tuple + attr_map_ptr->from_offset;
+        result_attr = attr_map_ptr->to_attr;
+
+        if(result_attr->domain == DOMAIN_INT) {
+          operand_value.l = from_ptr[0] << 8 | from_ptr[1];
+          lvm_set_variable_value(result_attr->name, operand_value);
+        } else if(result_attr->domain == DOMAIN_LONG) {
+          operand_value.l = (uint32_t)from_ptr[0] << 24 |
+                            (uint32_t)from_ptr[1] << 16 |
+                            (uint32_t)from_ptr[2] << 8 |
+                            from_ptr[3];
+          lvm_set_variable_value(result_attr->name, operand_value);
+        }
+      }
+      status = lvm_execute(adt->lvm_instance);
     }
 
-    if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
-      /* The attribute is used just for the predicate,
-         so do not copy the current value into the result. */
-      continue;
+    if(status == wanted_result) {
+      break;
     }
 
-    if(!(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE)) {
-      /* No aggregators. Copy the original value into the resulting tuple. */
-      memcpy(result_row + attr_map_ptr->to_offset, from_ptr,
-             result_attr->element_size);
+    if(scan_pos == scan_rows) {
+      /* Let other processes run between the batches. */
+      return DB_OK;
     }
   }
 
-  wanted_result = TRUE;
-  if(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC) {
-    wanted_result = FALSE;
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
+    for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+      from_ptr = tuple + attr_map_ptr->from_offset;
+      result = db_phy_to_value(&value, attr_map_ptr->to_attr, from_ptr);
+      if(DB_ERROR(result)) {
+        return result;
+      }
+      aggregate(attr_map_ptr->to_attr, &value);
+    }
+    return DB_OK;
   }
 
-  /* Check whether the given predicate is true for this tuple. */
-  if(adt->lvm_instance == NULL ||
-     lvm_execute(adt->lvm_instance) == wanted_result) {
-    if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
-      for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-        from_ptr = row + attr_map_ptr->from_offset;
-        result = db_phy_to_value(&value, attr_map_ptr->to_attr, from_ptr);
-        if(DB_ERROR(result)) {
-	  return result;
-        }
-        aggregate(attr_map_ptr->to_attr, &value);
-      }
-    } else {
-      if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
-        if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
-          PRINTF("DB: Failed to store a row in the result relation!\n");
-          return DB_STORAGE_ERROR;
-        }
-      }
-      handle->current_row++;
-      return DB_GOT_ROW;
+  /* Project the tuple into the result. */
+  for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+    result_attr = attr_map_ptr->to_attr;
+    if(!(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE)) {
+      memcpy(result_row + attr_map_ptr->to_offset,
+             tuple + attr_map_ptr->from_offset, result_attr->element_size);
     }
   }
 
-  return DB_OK;
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
+      PRINTF("DB: Failed to store a row in the result relation!\n");
+      return DB_STORAGE_ERROR;
+    }
+  }
+  handle->current_row++;
+  return DB_GOT_ROW;
 
 end_aggregation:
   /* Generate aggregated result if requested. */
@@ -880,6 +966,7 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
   attribute_t *attr;
   int i;
   int normal_attributes;
+  int aggregated_attributes;
 
   adt = (aql_adt_t *)adt_ptr;
 
@@ -903,7 +990,8 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     return DB_ALLOCATION_ERROR;
   }
 
-  for(i = normal_attributes = 0; i < AQL_ATTRIBUTE_COUNT(adt); i++) {
+  normal_attributes = aggregated_attributes = 0;
+  for(i = 0; i < AQL_ATTRIBUTE_COUNT(adt); i++) {
     attribute_name = adt->attributes[i].name;
 
     attr = relation_attribute_get(rel, attribute_name);
@@ -927,6 +1015,9 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     }
 
     attr->aggregator = adt->aggregators[i];
+    if(attr->aggregator != AQL_NONE) {
+      aggregated_attributes++;
+    }
     switch(attr->aggregator) {
     case AQL_NONE:
       if(!(adt->attributes[i].flags & ATTRIBUTE_FLAG_NO_STORE)) {
@@ -949,9 +1040,9 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
   }
 
   /* Preclude mixes of normal attributes and aggregated ones in 
-     selection results. */
-  if(normal_attributes > 0 &&
-     handle->result_rel->attribute_count > normal_attributes) {
+     selection results. Attributes that are only used in the
+     condition are neither. */
+  if(normal_attributes > 0 && aggregated_attributes > 0) {
      return DB_RELATIONAL_ERROR;
   }
 
@@ -959,24 +1050,66 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
 }
 
 #if DB_FEATURE_JOIN
-db_result_t
-relation_process_join(void *handle_ptr)
+static long
+join_value(attribute_t *attr, unsigned char *ptr)
+{
+  attribute_value_t value;
+
+  if(DB_ERROR(db_phy_to_value(&value, attr, ptr))) {
+    return 0;
+  }
+  return db_value_to_long(&value);
+}
+
+static db_result_t
+join_output(db_handle_t *handle, tuple_id_t right_tuple_id)
 {
-  db_handle_t *handle;
   db_result_t result;
-  relation_t *left_rel;
-  relation_t *right_rel;
-  relation_t *join_rel;
   unsigned char *join_next_attribute_ptr;
   size_t element_size;
+  int i;
+
+  result = storage_get_row(handle->right_rel, &right_tuple_id, right_row);
+  if(DB_ERROR(result)) {
+    PRINTF("DB: Failed to get a row in right relation %s!\n",
+           handle->right_rel->name);
+    return result;
+  } else if(result == DB_FINISHED) {
+    PRINTF("DB: The join refers to an invalid row: %lu\n",
+           (unsigned long)right_tuple_id);
+    return DB_IMPLEMENTATION_ERROR;
+  }
+
+  /* Use the source attribute map to fill in the physical representation
+     of the resulting tuple. */
+  join_next_attribute_ptr = join_row;
+
+  for(i = 0; i < handle->join_rel->attribute_count; i++) {
+    element_size = source_map[i].attr->element_size;
+
+    memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
+    join_next_attribute_ptr += element_size;
+  }
+
+  if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(storage_put_row(handle->join_rel, join_row))) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  handle->current_row++;
+  return DB_GOT_ROW;
+}
+
+static db_result_t
+process_index_join(db_handle_t *handle)
+{
+  db_result_t result;
+  relation_t *left_rel;
   tuple_id_t right_tuple_id;
   attribute_value_t value;
-  int i;
 
-  handle = (db_handle_t *)handle_ptr;
   left_rel = handle->left_rel;
-  right_rel = handle->right_rel;
-  join_rel = handle->join_rel;
 
   if(!(handle->flags & DB_HANDLE_FLAG_INDEX_STEP)) {
     goto inner_loop;
@@ -984,7 +1117,7 @@ relation_process_join(void *handle_ptr)
 
   /* Equi-join for indexed attributes only. In the outer loop, we iterate over
      each tuple in the left relation. */
-  for(handle->tuple_id = 0;; handle->tuple_id++) {
+  for(;; handle->tuple_id++) {
     result = storage_get_row(left_rel, &handle->tuple_id, left_row);
     if(DB_ERROR(result)) {
       PRINTF("DB: Failed to get a row in left relation %s!\n", left_rel->name);
@@ -1010,49 +1143,179 @@ relation_process_join(void *handle_ptr)
     /* In the inner loop, we iterate over all rows with a matching value for the
        join attribute. The index component provides an iterator for this purpose. */
 inner_loop:
-    for(;;) {
-      /* Get all rows matching the attribute value in the right relation. */
-      right_tuple_id = index_get_next(&handle->index_iterator);
-      if(right_tuple_id == INVALID_TUPLE) {
-        /* Exclude this row from the left relation in the result,
-           and step to the next value in the index iteration. */
-        handle->flags |= DB_HANDLE_FLAG_INDEX_STEP;
-        break;
+    /* Get all rows matching the attribute value in the right relation. */
+    right_tuple_id = index_get_next(&handle->index_iterator);
+    if(right_tuple_id != INVALID_TUPLE) {
+      return join_output(handle, right_tuple_id);
+    }
+
+    /* Exclude this row from the left relation in the result,
+       and step to the next value in the index iteration. */
+    handle->flags |= DB_HANDLE_FLAG_INDEX_STEP;
+  }
+}
+
+static db_result_t
+build_join_hash(db_handle_t *handle)
+{
+  db_result_t result;
+  struct join_hash_entry *entry;
+  unsigned bucket;
+
+  memset(join_buckets, 0, sizeof(join_buckets));
+
+  /* Insert the join attribute values of the next chunk of tuples
+     in the right relation into the hash table. */
+  for(entry = join_entries;
+      entry < &join_entries[DB_JOIN_HASH_ENTRIES];
+      entry++, join_state.right_tuple_id++) {
+    result = storage_get_row(handle->right_rel, &join_state.right_tuple_id,
+                             right_row);
+    if(DB_ERROR(result)) {
+      PRINTF("DB: Failed to get a row in right relation %s!\n",
+             handle->right_rel->name);
+      return result;
+    } else if(result == DB_FINISHED) {
+      break;
+    }
+
+    entry->value = join_value(handle->right_join_attr,
+                              join_state.right_value_ptr);
+    entry->tuple_id = join_state.right_tuple_id;
+    bucket = (unsigned long)entry->value % DB_JOIN_HASH_BUCKETS;
+    entry->next = join_buckets[bucket];
+    join_buckets[bucket] = entry;
+  }
+
+  PRINTF("DB: Built a join hash table over %u tuples\n",
+         (unsigned)(entry - join_entries));
+
+  return entry == join_entries ? DB_FINISHED : DB_OK;
+}
+
+static db_result_t
+process_hash_join(db_handle_t *handle)
+{
+  db_result_t result;
+  struct join_hash_entry *entry;
+
+  for(;;) {
+    /* Output the remaining matches for the current left tuple. */
+    while(join_state.probe != NULL) {
+      entry = join_state.probe;
+      join_state.probe = entry->next;
+      if(entry->value == join_state.left_value) {
+        return join_output(handle, entry->tuple_id);
       }
+    }
 
-      result = storage_get_row(right_rel, &right_tuple_id, right_row);
-      if(DB_ERROR(result)) {
-        PRINTF("DB: Failed to get a row in right relation %s!\n", right_rel->name);
+    if(handle->flags & DB_HANDLE_FLAG_INDEX_STEP) {
+      /* The left relation has been joined with the current chunk of the
+         right relation; continue with the next chunk. */
+      result = build_join_hash(handle);
+      if(result != DB_OK) {
         return result;
-      } else if(result == DB_FINISHED) {
-	PRINTF("DB: The index refers to an invalid row: %lu\n",
-	       (unsigned long)right_tuple_id);
-        return DB_IMPLEMENTATION_ERROR;
       }
+      handle->tuple_id = 0;
+      handle->flags &= ~DB_HANDLE_FLAG_INDEX_STEP;
+    }
+
+    result = storage_get_row(handle->left_rel, &handle->tuple_id, left_row);
+    if(DB_ERROR(result)) {
+      PRINTF("DB: Failed to get a row in left relation %s!\n",
+             handle->left_rel->name);
+      return result;
+    } else if(result == DB_FINISHED) {
+      handle->flags |= DB_HANDLE_FLAG_INDEX_STEP;
+      continue;
+    }
+    handle->tuple_id++;
 
-      /* Use the source attribute map to fill in the physical representation
-	 of the resulting tuple. */
-      join_next_attribute_ptr = join_row;
+    join_state.left_value = join_value(handle->left_join_attr,
+                                       join_state.left_value_ptr);
+    join_state.probe = join_buckets[(unsigned long)join_state.left_value %
+                                    DB_JOIN_HASH_BUCKETS];
+  }
+}
 
-      for(i = 0; i < join_rel->attribute_count; i++) {
-	element_size = source_map[i].attr->element_size;
+static db_result_t
+process_merge_join(db_handle_t *handle)
+{
+  db_result_t result;
+  long left_value;
+  long right_value;
+
+  /*
+   * Both relations are stored in the order of the join attribute.
+   * We scan them in parallel, and rewind the right relation to the
+   * start of the current group of equal values whenever the next
+   * left tuple has the same value as the previous one.
+   */
+  for(;;) {
+    if(handle->flags & DB_HANDLE_FLAG_INDEX_STEP) {
+      result = storage_get_row(handle->left_rel, &handle->tuple_id, left_row);
+      if(DB_ERROR(result)) {
+        PRINTF("DB: Failed to get a row in left relation %s!\n",
+               handle->left_rel->name);
+        return result;
+      } else if(result == DB_FINISHED) {
+        return DB_FINISHED;
+      }
 
-	memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
-	join_next_attribute_ptr += element_size;
+      left_value = join_value(handle->left_join_attr,
+                              join_state.left_value_ptr);
+      if(handle->tuple_id > 0 && left_value == join_state.left_value) {
+        join_state.right_tuple_id = join_state.group_start;
+      } else {
+        join_state.group_start = join_state.right_tuple_id;
       }
+      join_state.left_value = left_value;
+      handle->tuple_id++;
+      handle->flags &= ~DB_HANDLE_FLAG_INDEX_STEP;
+    }
 
-      if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
-        if(DB_ERROR(storage_put_row(join_rel, join_row))) {
-          return DB_STORAGE_ERROR;
-        }
+    result = storage_get_row(handle->right_rel, &join_state.right_tuple_id,
+                             right_row);
+    if(DB_ERROR(result)) {
+      PRINTF("DB: Failed to get a row in right relation %s!\n",
+             handle->right_rel->name);
+      return result;
+    } else if(result == DB_FINISHED) {
+      if(join_state.group_start == join_state.right_tuple_id) {
+        /* No remaining right tuple can match this or any later left tuple. */
+        return DB_FINISHED;
       }
+      handle->flags |= DB_HANDLE_FLAG_INDEX_STEP;
+      continue;
+    }
 
-      handle->current_row++;
-      return DB_GOT_ROW;
+    right_value = join_value(handle->right_join_attr,
+                             join_state.right_value_ptr);
+    if(right_value < join_state.left_value) {
+      join_state.group_start = ++join_state.right_tuple_id;
+    } else if(right_value > join_state.left_value) {
+      handle->flags |= DB_HANDLE_FLAG_INDEX_STEP;
+    } else {
+      return join_output(handle, join_state.right_tuple_id++);
     }
   }
+}
 
-  return DB_OK;
+db_result_t
+relation_process_join(void *handle_ptr)
+{
+  db_handle_t *handle;
+
+  handle = (db_handle_t *)handle_ptr;
+
+  switch(handle->join_type) {
+  case AQL_JOIN_HASH:
+    return process_hash_join(handle);
+  case AQL_JOIN_MERGE:
+    return process_merge_join(handle);
+  default:
+    return process_index_join(handle);
+  }
 }
 
 static db_result_t
@@ -1102,11 +1365,85 @@ generate_join_result(db_handle_t *handle)
     source_pair->from_ptr = from_ptr;
   }
 
+  /* Locate the join attribute values for the hash join and the merge join. */
+  memset(&join_state, 0, sizeof(join_state));
+  join_state.left_value_ptr = left_row +
+    get_attribute_value_offset(left_rel, handle->left_join_attr);
+  join_state.right_value_ptr = right_row +
+    get_attribute_value_offset(right_rel, handle->right_join_attr);
+
   handle->flags |= DB_HANDLE_FLAG_PROCESSING;
 
   return DB_OK;
 }
 
+static int
+is_stored_in_order(attribute_t *attr)
+{
+  /* An inline index requires the tuples to be stored in the order of
+     the attribute values. */
+  return index_exists(attr) && ((index_t *)attr->index)->type == INDEX_INLINE;
+}
+
+static db_result_t
+select_join_type(db_handle_t *handle, aql_adt_t *adt)
+{
+  attribute_t *left_attr;
+  attribute_t *right_attr;
+  tuple_id_t cardinality;
+  aql_join_type_t join_type;
+
+  left_attr = handle->left_join_attr;
+  right_attr = handle->right_join_attr;
+
+  join_type = AQL_GET_JOIN_TYPE(adt);
+  if(join_type == AQL_JOIN_AUTO) {
+    /*
+     * Prefer a merge join over relations stored in the join order.
+     * Otherwise, an index lookup per left tuple is cheaper than a
+     * hash join only when the right relation does not fit into the
+     * hash table, because each extra chunk requires another pass
+     * over the left relation.
+     */
+    cardinality = relation_cardinality(handle->right_rel);
+    if(is_stored_in_order(left_attr) && is_stored_in_order(right_attr)) {
+      join_type = AQL_JOIN_MERGE;
+    } else if(index_exists(right_attr) && cardinality != INVALID_TUPLE &&
+              cardinality > DB_JOIN_HASH_ENTRIES) {
+      join_type = AQL_JOIN_INDEX;
+    } else {
+      join_type = AQL_JOIN_HASH;
+    }
+  }
+
+  switch(join_type) {
+  case AQL_JOIN_INDEX:
+    if(!index_exists(right_attr)) {
+      PRINTF("DB: The attribute to join on is not indexed\n");
+      return DB_INDEX_ERROR;
+    }
+    break;
+  case AQL_JOIN_MERGE:
+    if(!is_stored_in_order(left_attr) || !is_stored_in_order(right_attr)) {
+      PRINTF("DB: A merge join requires inline indexes in both relations\n");
+      return DB_INDEX_ERROR;
+    }
+    break;
+  default:
+    if((left_attr->domain != DOMAIN_INT && left_attr->domain != DOMAIN_LONG) ||
+       (right_attr->domain != DOMAIN_INT && right_attr->domain != DOMAIN_LONG)) {
+      PRINTF("DB: Cannot join on a non-number attribute\n");
+      return DB_TYPE_ERROR;
+    }
+    break;
+  }
+
+  PRINTF("DB: Join strategy %d\n", join_type);
+  handle->join_type = join_type;
+
+  return DB_OK;
+}
+
 db_result_t
 relation_join(void *query_result, void *adt_ptr)
 {
@@ -1120,6 +1457,7 @@ relation_join(void *query_result, void *adt_ptr)
   int i;
   char *attribute_name;
   attribute_t *attr;
+  db_result_t result;
 
   adt = (aql_adt_t *)adt_ptr;
 
@@ -1158,9 +1496,9 @@ relation_join(void *query_result, void *adt_ptr)
     return DB_RELATIONAL_ERROR;
   }
 
-  if(!index_exists(handle->right_join_attr)) {
-    PRINTF("DB: The attribute to join on is not indexed\n");
-    return DB_INDEX_ERROR;
+  result = select_join_type(handle, adt);
+  if(DB_ERROR(result)) {
+    return result;
   }
 
   /*
@@ -49,6 +49,7 @@ typedef unsigned char *tuple_t;
 #define DB_HANDLE_FLAG_INDEX_STEP	0x01
 #define DB_HANDLE_FLAG_SEARCH_INDEX	0x02
 #define DB_HANDLE_FLAG_PROCESSING	0x04
+#define DB_HANDLE_FLAG_COMPILED		0x08
 
 struct db_handle {
   index_iterator_t index_iterator;
@@ -64,6 +65,7 @@ struct db_handle {
   tuple_t tuple;
   uint8_t flags;
   uint8_t ncolumns;
+  uint8_t join_type;
   void *adt;
 };
 typedef struct db_handle db_handle_t;
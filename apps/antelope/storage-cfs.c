@@ -68,6 +68,24 @@ struct index_record {
 
 #define ROW_XOR 0xf6U
 
+/*
+ * The row buffer is shared by all relations. It holds either rows
+ * that have been inserted into a relation but not yet written to its
+ * file, or rows that have been read ahead from the file. The rows are
+ * kept in their stored format.
+ */
+struct row_buffer {
+  relation_t *rel;
+  tuple_id_t first_row;
+  unsigned row_count;
+  uint8_t dirty;
+  unsigned char rows[DB_ROW_BUFFER_SIZE];
+};
+
+static struct row_buffer row_buffer;
+
+#define ROW_BUFFER_CAPACITY(rel) (sizeof(row_buffer.rows) / (rel)->row_length)
+
 static void
 merge_strings(char *dest, char *prefix, char *suffix)
 {
@@ -75,6 +93,137 @@ merge_strings(char *dest, char *prefix, char *suffix)
   strcat(dest, suffix);
 }
 
+static db_result_t
+get_file_row_amount(relation_t *rel, tuple_id_t *amount)
+{
+  cfs_offset_t offset;
+
+  if(rel->row_length == 0) {
+    *amount = 0;
+  } else {
+    offset = cfs_seek(rel->tuple_storage, 0, CFS_SEEK_END);
+    if(offset == (cfs_offset_t)-1) {
+      return DB_STORAGE_ERROR;
+    }
+
+    *amount = (tuple_id_t)(offset / rel->row_length);
+  }
+
+  return DB_OK;
+}
+
+static db_result_t
+read_rows(relation_t *rel, tuple_id_t tuple_id, unsigned char *rows,
+          unsigned count)
+{
+  unsigned length;
+  unsigned i;
+  int r;
+
+  if(cfs_seek(rel->tuple_storage, tuple_id * rel->row_length, CFS_SEEK_SET) ==
+              (cfs_offset_t)-1) {
+    return DB_STORAGE_ERROR;
+  }
+
+  length = count * rel->row_length;
+  for(i = 0; i < length; i += r) {
+    r = cfs_read(rel->tuple_storage, rows + i, length - i);
+    if(r <= 0) {
+      PRINTF("DB: Reading failed on fd %d\n", rel->tuple_storage);
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  PRINTF("DB: Read %u rows from relation %s\n", count, rel->name);
+
+  return DB_OK;
+}
+
+/* Append rows in their stored format to the relation file. */
+static db_result_t
+write_rows(relation_t *rel, unsigned char *rows, unsigned count)
+{
+  cfs_offset_t end;
+  unsigned remaining;
+  int r;
+#if DB_FEATURE_INTEGRITY
+  int missing_bytes;
+  char buf[rel->row_length];
+#endif
+
+  end = cfs_seek(rel->tuple_storage, 0, CFS_SEEK_END);
+  if(end == (cfs_offset_t)-1) {
+    return DB_STORAGE_ERROR;
+  }
+
+#if DB_FEATURE_INTEGRITY
+  missing_bytes = end % rel->row_length;
+  if(missing_bytes > 0) {
+    memset(buf, 0xff, sizeof(buf));
+    r = cfs_write(rel->tuple_storage, buf, sizeof(buf));
+    if(r != missing_bytes) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+#endif
+
+  remaining = count * rel->row_length;
+  do {
+    r = cfs_write(rel->tuple_storage, rows, remaining);
+    if(r < 0) {
+      PRINTF("DB: Failed to store %u bytes\n", remaining);
+      return DB_STORAGE_ERROR;
+    }
+    rows += r;
+    remaining -= r;
+  } while(remaining > 0);
+
+  PRINTF("DB: Stored %u rows of %d bytes\n", count, rel->row_length);
+
+  return DB_OK;
+}
+
+static void
+close_released(relation_t *rel)
+{
+  /* The tuple file of a relation that has no users any longer is only
+     kept open until its buffered rows have been written. */
+  if(rel->references == 0 && rel->tuple_storage >= 0) {
+    cfs_close(rel->tuple_storage);
+    rel->tuple_storage = -1;
+  }
+}
+
+static db_result_t
+flush_row_buffer(void)
+{
+  relation_t *rel;
+  db_result_t result;
+
+  result = DB_OK;
+  if(row_buffer.dirty) {
+    rel = row_buffer.rel;
+    row_buffer.dirty = 0;
+    if(DB_ERROR(write_rows(rel, row_buffer.rows, row_buffer.row_count))) {
+      row_buffer.rel = NULL;
+      row_buffer.row_count = 0;
+      result = DB_STORAGE_ERROR;
+    }
+    close_released(rel);
+  }
+  return result;
+}
+
+static void
+discard_row_buffer(relation_t *rel)
+{
+  if(row_buffer.rel == rel) {
+    row_buffer.rel = NULL;
+    row_buffer.row_count = 0;
+    row_buffer.dirty = 0;
+  }
+}
+
 char *
 storage_generate_file(char *prefix, unsigned long size)
 {
@@ -103,6 +252,11 @@ storage_generate_file(char *prefix, unsigned long size)
 db_result_t
 storage_load(relation_t *rel)
 {
+  if(rel->tuple_storage >= 0) {
+    /* Still open, either by another user or since the last release */
+    return DB_OK;
+  }
+
   PRINTF("DB: Opening the tuple file %s\n", rel->tuple_filename);
   rel->tuple_storage = cfs_open(rel->tuple_filename,
                                 CFS_READ | CFS_WRITE | CFS_APPEND);
@@ -120,9 +274,36 @@ storage_unload(relation_t *rel)
   if(RELATION_HAS_TUPLES(rel)) {
     PRINTF("DB: Unload tuple file %s\n", rel->tuple_filename);
 
-    cfs_close(rel->tuple_storage);
-    rel->tuple_storage = -1;
+    storage_flush(rel);
+    discard_row_buffer(rel);
+
+    if(rel->tuple_storage >= 0) {
+      cfs_close(rel->tuple_storage);
+      rel->tuple_storage = -1;
+    }
+  }
+}
+
+/* storage_release: Called when the last user of a relation releases
+   it. The rows that are still buffered for the relation are written
+   and the tuple file is closed. With DB_FEATURE_COALESCE_WRITES, the
+   rows instead stay in the buffer, so that rows inserted by
+   consecutive queries are written together, and the tuple file is
+   closed once they have been written. */
+db_result_t
+storage_release(relation_t *rel)
+{
+  db_result_t result;
+
+#if DB_FEATURE_COALESCE_WRITES
+  if(row_buffer.rel == rel && row_buffer.dirty) {
+    return DB_OK;
   }
+#endif /* DB_FEATURE_COALESCE_WRITES */
+
+  result = storage_flush(rel);
+  storage_unload(rel);
+  return result;
 }
 
 db_result_t
@@ -279,6 +460,7 @@ storage_put_attribute(relation_t *rel, attribute_t *attr)
 db_result_t
 storage_drop_relation(relation_t *rel, int remove_tuples)
 {
+  discard_row_buffer(rel);
   if(remove_tuples && RELATION_HAS_TUPLES(rel)) {
     cfs_remove(rel->tuple_filename);
   }
@@ -400,39 +582,100 @@ storage_put_index(index_t *index)
   return result;
 }
 
+/* storage_flush: Write the rows that have been inserted into the
+   relation, but are still buffered, to the relation file. With a NULL
+   relation, the buffered rows of any relation are written. */
+db_result_t
+storage_flush(relation_t *rel)
+{
+  if(rel != NULL && row_buffer.rel != rel) {
+    return DB_OK;
+  }
+  return flush_row_buffer();
+}
+
 db_result_t
 storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
 {
-  int r;
   tuple_id_t nrows;
+  unsigned count;
+  unsigned char *ptr;
+
+  if(row_buffer.rel == rel && *tuple_id >= row_buffer.first_row &&
+     *tuple_id < row_buffer.first_row + row_buffer.row_count) {
+    ptr = row_buffer.rows +
+          (*tuple_id - row_buffer.first_row) * rel->row_length;
+  } else {
+    if(DB_ERROR(flush_row_buffer()) ||
+       DB_ERROR(get_file_row_amount(rel, &nrows))) {
+      return DB_STORAGE_ERROR;
+    }
+
+    if(*tuple_id >= nrows) {
+      return DB_FINISHED;
+    }
+
+    if(rel->row_length > sizeof(row_buffer.rows)) {
+      if(DB_ERROR(read_rows(rel, *tuple_id, row, 1))) {
+        return DB_STORAGE_ERROR;
+      }
+      row[rel->row_length - 1] ^= ROW_XOR;
+      return DB_OK;
+    }
+
+    /* Read ahead the following rows, as relations are often scanned
+       sequentially. */
+    count = ROW_BUFFER_CAPACITY(rel);
+    if(count > nrows - *tuple_id) {
+      count = nrows - *tuple_id;
+    }
+
+    row_buffer.rel = NULL;
+    if(DB_ERROR(read_rows(rel, *tuple_id, row_buffer.rows, count))) {
+      return DB_STORAGE_ERROR;
+    }
+    row_buffer.rel = rel;
+    row_buffer.first_row = *tuple_id;
+    row_buffer.row_count = count;
+    ptr = row_buffer.rows;
+  }
+
+  memcpy(row, ptr, rel->row_length);
+  row[rel->row_length - 1] ^= ROW_XOR;
+
+  return DB_OK;
+}
+
+/* storage_get_rows: Read up to *count consecutive rows, starting at
+   tuple_id, in a single read operation. */
+db_result_t
+storage_get_rows(relation_t *rel, tuple_id_t tuple_id, storage_row_t rows,
+                 unsigned *count)
+{
+  tuple_id_t nrows;
+  unsigned i;
 
-  if(DB_ERROR(storage_get_row_amount(rel, &nrows))) {
+  if(DB_ERROR(storage_flush(rel)) ||
+     DB_ERROR(get_file_row_amount(rel, &nrows))) {
     return DB_STORAGE_ERROR;
   }
 
-  if(*tuple_id >= nrows) {
+  if(tuple_id >= nrows) {
+    *count = 0;
     return DB_FINISHED;
   }
 
-  if(cfs_seek(rel->tuple_storage, *tuple_id * rel->row_length, CFS_SEEK_SET) ==
-              (cfs_offset_t)-1) {
-    return DB_STORAGE_ERROR;
+  if(*count > nrows - tuple_id) {
+    *count = nrows - tuple_id;
   }
 
-  r = cfs_read(rel->tuple_storage, row, rel->row_length);
-  if(r < 0) {
-    PRINTF("DB: Reading failed on fd %d\n", rel->tuple_storage);
-    return DB_STORAGE_ERROR;
-  } else if(r == 0) {
-    return DB_FINISHED;
-  } else if(r < rel->row_length) {
-    PRINTF("DB: Incomplete record: %d < %d\n", r, rel->row_length);
+  if(DB_ERROR(read_rows(rel, tuple_id, rows, *count))) {
     return DB_STORAGE_ERROR;
   }
 
-  row[rel->row_length - 1] ^= ROW_XOR;
-
-  PRINTF("DB: Read %d bytes from relation %s\n", rel->row_length, rel->name);
+  for(i = 1; i <= *count; i++) {
+    rows[i * rel->row_length - 1] ^= ROW_XOR;
+  }
 
   return DB_OK;
 }
@@ -440,51 +683,45 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
 db_result_t
 storage_put_row(relation_t *rel, storage_row_t row)
 {
-  cfs_offset_t end;
-  unsigned remaining;
-  int r;
-  unsigned char *last_byte;
-#if DB_FEATURE_INTEGRITY
-  int missing_bytes;
-  char buf[rel->row_length];
-#endif
+  db_result_t result;
+  unsigned char *ptr;
 
-  end = cfs_seek(rel->tuple_storage, 0, CFS_SEEK_END);
-  if(end == (cfs_offset_t)-1) {
-    return DB_STORAGE_ERROR;
+  if(rel->row_length > sizeof(row_buffer.rows)) {
+    /* Ensure that last written byte is separated from 0, to make file
+       lengths correct in Coffee. */
+    row[rel->row_length - 1] ^= ROW_XOR;
+    result = write_rows(rel, row, 1);
+    row[rel->row_length - 1] ^= ROW_XOR;
+    return result;
   }
 
-#if DB_FEATURE_INTEGRITY
-  missing_bytes = end % rel->row_length;
-  if(missing_bytes > 0) {
-    memset(buf, 0xff, sizeof(buf));
-    r = cfs_write(rel->tuple_storage, buf, sizeof(buf));
-    if(r != missing_bytes) {
+  /* Start collecting a new batch of rows to write if the buffer holds
+     rows of another relation or rows that have already been written. */
+  if(row_buffer.rel != rel || !row_buffer.dirty) {
+    if(DB_ERROR(flush_row_buffer())) {
       return DB_STORAGE_ERROR;
     }
-  }
-#endif
-
-  /* Ensure that last written byte is separated from 0, to make file
-     lengths correct in Coffee. */
-  last_byte = row + rel->row_length - 1;
-  *last_byte ^= ROW_XOR;
-
-  remaining = rel->row_length;
-  do {
-    r = cfs_write(rel->tuple_storage, row, remaining);
-    if(r < 0) {
-      PRINTF("DB: Failed to store %u bytes\n", remaining);
-      *last_byte ^= ROW_XOR;
+    row_buffer.rel = NULL;
+    if(DB_ERROR(get_file_row_amount(rel, &row_buffer.first_row))) {
       return DB_STORAGE_ERROR;
     }
-    row += r;
-    remaining -= r;
-  } while(remaining > 0);
+    row_buffer.rel = rel;
+    row_buffer.row_count = 0;
+    row_buffer.dirty = 1;
+  }
 
-  PRINTF("DB: Stored a of %d bytes\n", rel->row_length);
+  ptr = row_buffer.rows + row_buffer.row_count * rel->row_length;
+  memcpy(ptr, row, rel->row_length);
+  ptr[rel->row_length - 1] ^= ROW_XOR;
+  row_buffer.row_count++;
 
-  *last_byte ^= ROW_XOR;
+  PRINTF("DB: Buffered a row of %d bytes\n", rel->row_length);
+
+  /* Write the rows once the buffer is full. They remain in the buffer
+     until another batch starts, so they can still be read from it. */
+  if(row_buffer.row_count == ROW_BUFFER_CAPACITY(rel)) {
+    return flush_row_buffer();
+  }
 
   return DB_OK;
 }
@@ -492,17 +729,12 @@ storage_put_row(relation_t *rel, storage_row_t row)
 db_result_t
 storage_get_row_amount(relation_t *rel, tuple_id_t *amount)
 {
-  cfs_offset_t offset;
-
-  if(rel->row_length == 0) {
-    *amount = 0;
-  } else {
-    offset = cfs_seek(rel->tuple_storage, 0, CFS_SEEK_END);
-    if(offset == (cfs_offset_t)-1) {
-      return DB_STORAGE_ERROR;
-    }
+  if(DB_ERROR(get_file_row_amount(rel, amount))) {
+    return DB_STORAGE_ERROR;
+  }
 
-    *amount = (tuple_id_t)(offset / rel->row_length);
+  if(row_buffer.rel == rel && row_buffer.dirty) {
+    *amount += row_buffer.row_count;
   }
 
   return DB_OK;
@@ -54,6 +54,7 @@ char *storage_generate_file(char *, unsigned long);
 
 db_result_t storage_load(relation_t *);
 void storage_unload(relation_t *);
+db_result_t storage_release(relation_t *);
 
 db_result_t storage_get_relation(relation_t *, char *);
 db_result_t storage_put_relation(relation_t *);
@@ -65,7 +66,10 @@ db_result_t storage_get_index(index_t *, relation_t *, attribute_t *);
 db_result_t storage_put_index(index_t *);
 
 db_result_t storage_get_row(relation_t *, tuple_id_t *, storage_row_t);
+db_result_t storage_get_rows(relation_t *, tuple_id_t, storage_row_t,
+                             unsigned *);
 db_result_t storage_put_row(relation_t *, storage_row_t);
+db_result_t storage_flush(relation_t *);
 db_result_t storage_get_row_amount(relation_t *, tuple_id_t *);
 
 db_storage_id_t storage_open(const char *);
@@ -50,32 +50,97 @@
 #define PRINTF(...)
 #endif
 
+/* The context currently being filled by jsontree_fill(). Any other
+   context writes through its putchar callback. */
+static struct jsontree_context *fill_ctx;
+/*---------------------------------------------------------------------------*/
+static void
+write_char(struct jsontree_context *js_ctx, int c)
+{
+  if(js_ctx != fill_ctx) {
+    js_ctx->putchar(c);
+  } else if(js_ctx->pos++ >= js_ctx->skip &&
+            js_ctx->buf_pos < js_ctx->buf_size) {
+    js_ctx->buf[js_ctx->buf_pos++] = c;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_data(struct jsontree_context *js_ctx, const char *data, uint32_t len)
+{
+  uint32_t n;
+
+  if(js_ctx != fill_ctx) {
+    while(len-- > 0) {
+      js_ctx->putchar(*data++);
+    }
+    return;
+  }
+
+  if(js_ctx->pos < js_ctx->skip) {
+    /* Drop the output before the current chunk */
+    n = js_ctx->skip - js_ctx->pos;
+    if(n >= len) {
+      js_ctx->pos += len;
+      return;
+    }
+    data += n;
+    len -= n;
+    js_ctx->pos += n;
+  }
+
+  js_ctx->pos += len;
+  n = js_ctx->buf_size - js_ctx->buf_pos;
+  if(len < n) {
+    n = len;
+  }
+  memcpy(&js_ctx->buf[js_ctx->buf_pos], data, n);
+  js_ctx->buf_pos += n;
+}
+/*---------------------------------------------------------------------------*/
+static int
+fill_putchar(int c)
+{
+  /* Used for callbacks writing through js_ctx->putchar in buffered mode */
+  if(fill_ctx != NULL) {
+    write_char(fill_ctx, c);
+  }
+  return c;
+}
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_atom(const struct jsontree_context *js_ctx, const char *text)
 {
+  /* The output state is updated even though the context is const */
+  struct jsontree_context *ctx = (struct jsontree_context *)js_ctx;
+
   if(text == NULL) {
-    js_ctx->putchar('0');
+    write_char(ctx, '0');
   } else {
-    while(*text != '\0') {
-      js_ctx->putchar(*text++);
-    }
+    write_data(ctx, text, strlen(text));
   }
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_string(const struct jsontree_context *js_ctx, const char *text)
 {
-  js_ctx->putchar('"');
+  struct jsontree_context *ctx = (struct jsontree_context *)js_ctx;
+  uint32_t len;
+
+  write_char(ctx, '"');
   if(text != NULL) {
     while(*text != '\0') {
+      /* Write the longest run of characters not needing escape at once */
+      for(len = 0; text[len] != '\0' && text[len] != '"'; len++);
+      write_data(ctx, text, len);
+      text += len;
       if(*text == '"') {
-        js_ctx->putchar('\\');
+        write_char(ctx, '\\');
+        write_char(ctx, *text++);
       }
-      js_ctx->putchar(*text++);
     }
   }
-  js_ctx->putchar('"');
+  write_char(ctx, '"');
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -90,16 +155,15 @@ jsontree_write_uint(const struct jsontree_context *js_ctx, unsigned int value)
     value /= 10;
   } while(value > 0 && l >= 0);
 
-  while(++l < sizeof(buf)) {
-    js_ctx->putchar(buf[l]);
-  }
+  l++;
+  write_data((struct jsontree_context *)js_ctx, &buf[l], sizeof(buf) - l);
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_int(const struct jsontree_context *js_ctx, int value)
 {
   if(value < 0) {
-    js_ctx->putchar('-');
+    write_char((struct jsontree_context *)js_ctx, '-');
     value = -value;
   }
 
@@ -121,6 +185,83 @@ jsontree_reset(struct jsontree_context *js_ctx)
 {
   js_ctx->depth = 0;
   js_ctx->index[0] = 0;
+  js_ctx->pos = 0;
+  js_ctx->skip = 0;
+  js_ctx->done = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+jsontree_seek(struct jsontree_context *js_ctx, uint32_t offset)
+{
+  if(offset < js_ctx->skip) {
+    /* The output before the current position is gone: start over */
+    jsontree_reset(js_ctx);
+  }
+  js_ctx->skip = offset;
+}
+/*---------------------------------------------------------------------------*/
+int
+jsontree_fill(struct jsontree_context *js_ctx, char *buf, int size)
+{
+  int (* putchar)(int);
+  struct jsontree_context *prev_ctx;
+  uint32_t pos;
+  int callback_state;
+  uint16_t index;
+  uint16_t parent_index;
+  uint8_t depth;
+  int len;
+
+  if(js_ctx->done || size <= 0) {
+    return 0;
+  }
+
+  putchar = js_ctx->putchar;
+  prev_ctx = fill_ctx;
+  fill_ctx = js_ctx;
+  js_ctx->putchar = fill_putchar;
+  js_ctx->buf = buf;
+  js_ctx->buf_size = size;
+  js_ctx->buf_pos = 0;
+
+  while(js_ctx->buf_pos < size) {
+    /*
+     * A step only modifies the depth, the callback state and the index
+     * of the current and parent level. Remember them so that a step
+     * whose output does not fit can be replayed by the next call.
+     */
+    depth = js_ctx->depth;
+    index = js_ctx->index[depth];
+    parent_index = depth > 0 ? js_ctx->index[depth - 1] : 0;
+    callback_state = js_ctx->callback_state;
+    pos = js_ctx->pos;
+
+    if(!jsontree_print_next(js_ctx) || js_ctx->path > js_ctx->depth) {
+      js_ctx->done = 1;
+    }
+
+    if(js_ctx->pos > js_ctx->skip + js_ctx->buf_pos) {
+      /* Output was cut: rewind to the start of the step */
+      js_ctx->depth = depth;
+      js_ctx->index[depth] = index;
+      if(depth > 0) {
+        js_ctx->index[depth - 1] = parent_index;
+      }
+      js_ctx->callback_state = callback_state;
+      js_ctx->pos = pos;
+      js_ctx->done = 0;
+      break;
+    }
+    if(js_ctx->done) {
+      break;
+    }
+  }
+
+  len = js_ctx->buf_pos;
+  js_ctx->skip += len;
+  js_ctx->putchar = putchar;
+  fill_ctx = prev_ctx;
+  return len;
 }
 /*---------------------------------------------------------------------------*/
 const char *
@@ -153,46 +294,46 @@ jsontree_print_next(struct jsontree_context *js_ctx)
 
     index = js_ctx->index[js_ctx->depth];
     if(index == 0) {
-      js_ctx->putchar(v->type);
+      write_char(js_ctx, v->type);
 #if JSONTREE_PRETTY
-      js_ctx->putchar('\n');
+      write_char(js_ctx, '\n');
 #endif
     }
     if(index >= o->count) {
 #if JSONTREE_PRETTY
-      js_ctx->putchar('\n');
+      write_char(js_ctx, '\n');
       indent = js_ctx->depth;
       while (indent--) {
-        js_ctx->putchar(' ');
-        js_ctx->putchar(' ');
+        write_char(js_ctx, ' ');
+        write_char(js_ctx, ' ');
       }
 #endif
-      js_ctx->putchar(v->type + 2);
+      write_char(js_ctx, v->type + 2);
       /* Default operation: back up one level! */
       break;
     }
 
     if(index > 0) {
-      js_ctx->putchar(',');
+      write_char(js_ctx, ',');
 #if JSONTREE_PRETTY
-      js_ctx->putchar('\n');
+      write_char(js_ctx, '\n');
 #endif
     }
 
 #if JSONTREE_PRETTY
     indent = js_ctx->depth + 1;
     while (indent--) {
-      js_ctx->putchar(' ');
-      js_ctx->putchar(' ');
+      write_char(js_ctx, ' ');
+      write_char(js_ctx, ' ');
     }
 #endif
 
     if(v->type == JSON_TYPE_OBJECT) {
       jsontree_write_string(js_ctx,
                             ((struct jsontree_object *)o)->pairs[index].name);
-      js_ctx->putchar(':');
+      write_char(js_ctx, ':');
 #if JSONTREE_PRETTY
-      js_ctx->putchar(' ');
+      write_char(js_ctx, ' ');
 #endif
       ov = ((struct jsontree_object *)o)->pairs[index].value;
     } else {
@@ -62,6 +62,13 @@ struct jsontree_context {
   uint8_t depth;
   uint8_t path;
   int callback_state;
+  /* Buffered output state, see jsontree_fill() */
+  char *buf;
+  uint32_t pos;
+  uint32_t skip;
+  uint16_t buf_size;
+  uint16_t buf_pos;
+  uint8_t done;
 };
 
 struct jsontree_value {
@@ -154,6 +161,44 @@ void jsontree_write_atom(const struct jsontree_context *js_ctx,
 void jsontree_write_string(const struct jsontree_context *js_ctx,
                            const char *text);
 int jsontree_print_next(struct jsontree_context *js_ctx);
+
+/**
+ * \brief      Render the next chunk of JSON output into a buffer
+ * \param js_ctx The JSON context, set up with jsontree_setup() or
+ *               jsontree_reset()
+ * \param buf   The buffer to fill
+ * \param size  The size of the buffer
+ * \return      The number of bytes written to the buffer
+ *
+ *             This function writes the output directly into the buffer
+ *             instead of going through the putchar callback. Output that
+ *             does not fit is not lost: the next call continues exactly
+ *             where the previous one stopped, so the JSON tree can be
+ *             streamed in chunks of any size. js_ctx->done is set once
+ *             the whole tree (or the subtree selected by js_ctx->path)
+ *             has been written.
+ *
+ *             Callbacks may be invoked again for the chunk following the
+ *             one where their output was cut, and must therefore produce
+ *             the same output when called with the same callback_state.
+ */
+int jsontree_fill(struct jsontree_context *js_ctx, char *buf, int size);
+
+/**
+ * \brief      Skip output up to an offset
+ * \param js_ctx The JSON context
+ * \param offset The absolute offset in the JSON output
+ *
+ *             The next call to jsontree_fill() starts at the given
+ *             offset. A forward seek resumes from where the previous
+ *             jsontree_fill() stopped, and the output in between is
+ *             generated but never copied. A CoAP Block2 handler that
+ *             keeps its context between requests therefore renders the
+ *             tree only once for a whole transfer. A backward seek
+ *             starts over from the root.
+ */
+void jsontree_seek(struct jsontree_context *js_ctx, uint32_t offset);
+
 struct jsontree_value *jsontree_find_next(struct jsontree_context *js_ctx,
                                           int type);
 
@@ -49,6 +49,8 @@
 #define ORCHESTRA_RULES { &eb_per_time_source, &unicast_per_neighbor_rpl_storing, &default_common }
 /* Example configuration for RPL non-storing mode: */
 /* #define ORCHESTRA_RULES { &eb_per_time_source, &unicast_per_neighbor_rpl_ns, &default_common } */
+/* Example configuration with additional unicast cells allocated according to the traffic: */
+/* #define ORCHESTRA_RULES { &eb_per_time_source, &unicast_adaptive, &unicast_per_neighbor_rpl_storing, &default_common } */
 
 #endif /* ORCHESTRA_CONF_RULES */
 
@@ -81,6 +83,42 @@
 #define ORCHESTRA_UNICAST_SENDER_BASED            0
 #endif /* ORCHESTRA_CONF_UNICAST_SENDER_BASED */
 
+/* Length of the slotframe of the traffic-adaptive unicast rule */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_PERIOD
+#define ORCHESTRA_ADAPTIVE_PERIOD                 ORCHESTRA_CONF_ADAPTIVE_PERIOD
+#else /* ORCHESTRA_CONF_ADAPTIVE_PERIOD */
+#define ORCHESTRA_ADAPTIVE_PERIOD                 13
+#endif /* ORCHESTRA_CONF_ADAPTIVE_PERIOD */
+
+/* Maximum number of cells the traffic-adaptive rule allocates to a child */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_MAX_CELLS
+#define ORCHESTRA_ADAPTIVE_MAX_CELLS              ORCHESTRA_CONF_ADAPTIVE_MAX_CELLS
+#else /* ORCHESTRA_CONF_ADAPTIVE_MAX_CELLS */
+#define ORCHESTRA_ADAPTIVE_MAX_CELLS              4
+#endif /* ORCHESTRA_CONF_ADAPTIVE_MAX_CELLS */
+
+/* Maximum number of children the traffic-adaptive rule allocates cells to */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_MAX_CHILDREN
+#define ORCHESTRA_ADAPTIVE_MAX_CHILDREN           ORCHESTRA_CONF_ADAPTIVE_MAX_CHILDREN
+#else /* ORCHESTRA_CONF_ADAPTIVE_MAX_CHILDREN */
+#define ORCHESTRA_ADAPTIVE_MAX_CHILDREN           8
+#endif /* ORCHESTRA_CONF_ADAPTIVE_MAX_CHILDREN */
+
+/* How often the traffic-adaptive rule re-evaluates the allocated cells */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_UPDATE_INTERVAL
+#define ORCHESTRA_ADAPTIVE_UPDATE_INTERVAL        ORCHESTRA_CONF_ADAPTIVE_UPDATE_INTERVAL
+#else /* ORCHESTRA_CONF_ADAPTIVE_UPDATE_INTERVAL */
+#define ORCHESTRA_ADAPTIVE_UPDATE_INTERVAL        (4 * CLOCK_SECOND)
+#endif /* ORCHESTRA_CONF_ADAPTIVE_UPDATE_INTERVAL */
+
+/* OUI of the vendor specific IE the traffic-adaptive rule piggybacks on
+ * enhanced ACKs. The default is a locally administered value */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_IE_OUI
+#define ORCHESTRA_ADAPTIVE_IE_OUI                 ORCHESTRA_CONF_ADAPTIVE_IE_OUI
+#else /* ORCHESTRA_CONF_ADAPTIVE_IE_OUI */
+#define ORCHESTRA_ADAPTIVE_IE_OUI                 0x0ac0de
+#endif /* ORCHESTRA_CONF_ADAPTIVE_IE_OUI */
+
 /* The hash function used to assign timeslot to a given node (based on its link-layer address) */
 #ifdef ORCHESTRA_CONF_LINKADDR_HASH
 #define ORCHESTRA_LINKADDR_HASH                   ORCHESTRA_CONF_LINKADDR_HASH
@@ -83,4 +83,6 @@ struct orchestra_rule default_common = {
   select_packet,
   NULL,
   NULL,
+  NULL,
+  NULL,
 };
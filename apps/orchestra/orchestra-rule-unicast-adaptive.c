@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Orchestra: a slotframe with unicast cells allocated on the fly to
+ *         the children that have traffic for us, in addition to the static
+ *         cells of the other rules.
+ *         Senders announce a backlog through the frame pending bit of their
+ *         frames. Every ORCHESTRA_ADAPTIVE_UPDATE_INTERVAL, the receiver
+ *         grants one more cell to a child that was backlogged, and takes one
+ *         back from a child that no longer needs it. The number of cells
+ *         granted is piggybacked on every enhanced ACK, in a vendor specific
+ *         header IE. A child uses the cells granted by its preferred parent.
+ *           Cell k of child c is at timeslot
+ *             (hash(c.MAC) + k * (ORCHESTRA_ADAPTIVE_PERIOD / ORCHESTRA_ADAPTIVE_MAX_CELLS))
+ *             % ORCHESTRA_ADAPTIVE_PERIOD
+ *         Packets to the parent use these cells only while some are granted.
+ *         Place this rule before the other unicast rules in ORCHESTRA_RULES,
+ *         and set TSCH_CALLBACK_EACK_IE_CREATE and TSCH_CALLBACK_EACK_IE_RECEIVED.
+ */
+
+#include "contiki.h"
+#include "orchestra.h"
+#include "net/packetbuf.h"
+#include "lib/ringbufindex.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#if ORCHESTRA_ADAPTIVE_MAX_CELLS > ORCHESTRA_ADAPTIVE_PERIOD
+#error ORCHESTRA_ADAPTIVE_MAX_CELLS must not exceed ORCHESTRA_ADAPTIVE_PERIOD
+#endif
+
+/* Distance between two consecutive cells of a child */
+#define CELL_STRIDE (ORCHESTRA_ADAPTIVE_PERIOD / ORCHESTRA_ADAPTIVE_MAX_CELLS)
+
+/* Backlogged neighbors that are not children yet, queued from interrupt
+ * until the process adds them. Must be a power of two */
+#define NEW_CHILDREN_QUEUE_LEN 4
+
+/* A neighbor we received unicast frames from. Entries are added and
+ * removed by the process only; the interrupt looks them up and counts */
+struct adaptive_child {
+  linkaddr_t addr;
+  /* Set once addr is valid, and cleared before the entry is reused */
+  volatile uint8_t in_use;
+  /* Number of cells granted to the child */
+  uint8_t cells;
+  /* Frames received, and how many of them had the frame pending bit set.
+   * Free-running, incremented from interrupt only */
+  volatile uint16_t rx_count;
+  volatile uint16_t pending_count;
+  /* The counters as of the last update */
+  uint16_t rx_last;
+  uint16_t pending_last;
+};
+
+static uint16_t slotframe_handle = 0;
+static uint16_t channel_offset = 0;
+static struct tsch_slotframe *sf_adaptive;
+
+static struct adaptive_child children[ORCHESTRA_ADAPTIVE_MAX_CHILDREN];
+static linkaddr_t new_children[NEW_CHILDREN_QUEUE_LEN];
+static struct ringbufindex new_children_ringbuf;
+/* Number of cells granted to us by our parent, as last announced in an
+ * ACK (set from interrupt), and in use in our schedule */
+static volatile uint8_t tx_cells_granted;
+static uint8_t tx_cells;
+
+PROCESS(orchestra_adaptive_process, "Orchestra adaptive unicast");
+
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get_cell_timeslot(const linkaddr_t *addr, uint8_t cell)
+{
+  return (ORCHESTRA_LINKADDR_HASH(addr) + cell * CELL_STRIDE) % ORCHESTRA_ADAPTIVE_PERIOD;
+}
+/*---------------------------------------------------------------------------*/
+static int
+uses_timeslot(const linkaddr_t *addr, uint8_t cells, uint16_t timeslot)
+{
+  uint8_t i;
+  for(i = 0; i < cells; i++) {
+    if(get_cell_timeslot(addr, i) == timeslot) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Bring the slotframe in line with the cells granted by and to us */
+static void
+update_links(void)
+{
+  uint16_t timeslot;
+  uint8_t link_options;
+  struct tsch_link *l;
+  int i;
+
+  for(timeslot = 0; timeslot < ORCHESTRA_ADAPTIVE_PERIOD; timeslot++) {
+    link_options = 0;
+    if(uses_timeslot(&linkaddr_node_addr, tx_cells, timeslot)) {
+      /* Siblings may be granted the same cell */
+      link_options |= LINK_OPTION_TX | LINK_OPTION_SHARED;
+    }
+    for(i = 0; i < ORCHESTRA_ADAPTIVE_MAX_CHILDREN; i++) {
+      if(children[i].in_use
+         && uses_timeslot(&children[i].addr, children[i].cells, timeslot)) {
+        link_options |= LINK_OPTION_RX;
+        break;
+      }
+    }
+
+    l = tsch_schedule_get_link_by_timeslot(sf_adaptive, timeslot);
+    if(link_options == 0) {
+      if(l != NULL) {
+        tsch_schedule_remove_link(sf_adaptive, l);
+      }
+    } else if(l == NULL || l->link_options != link_options) {
+      /* Add/update link */
+      tsch_schedule_add_link(sf_adaptive, link_options, LINK_TYPE_NORMAL, &tsch_broadcast_address,
+            timeslot, channel_offset);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Grant or take back cells according to the traffic of the last interval */
+static void
+update_children(void)
+{
+  struct adaptive_child *c;
+  uint32_t cell_capacity;
+  uint16_t rx_count;
+  uint16_t pending_count;
+  int i;
+
+  /* How many frames one cell can carry in an interval */
+  cell_capacity = (uint32_t)ORCHESTRA_ADAPTIVE_UPDATE_INTERVAL * RTIMER_SECOND / CLOCK_SECOND
+    / ((uint32_t)ORCHESTRA_ADAPTIVE_PERIOD * tsch_timing[tsch_ts_timeslot_length]);
+
+  for(i = 0; i < ORCHESTRA_ADAPTIVE_MAX_CHILDREN; i++) {
+    c = &children[i];
+    if(!c->in_use) {
+      continue;
+    }
+    /* Frames since the last update. The counters are only read here,
+     * so that no increment from interrupt gets lost */
+    rx_count = c->rx_count - c->rx_last;
+    pending_count = c->pending_count - c->pending_last;
+    c->rx_last += rx_count;
+    c->pending_last += pending_count;
+
+    if(pending_count > 0 && 2 * pending_count >= rx_count) {
+      /* The queue of the child did not drain for most of the interval */
+      if(c->cells < ORCHESTRA_ADAPTIVE_MAX_CELLS) {
+        c->cells++;
+      }
+    } else if(pending_count == 0 && c->cells > 0
+              && rx_count <= (uint32_t)(c->cells - 1) * cell_capacity) {
+      /* The traffic fits in one cell less */
+      c->cells--;
+    }
+
+    if(c->cells == 0 && rx_count == 0) {
+      /* Idle child, forget it */
+      c->in_use = 0;
+    }
+
+    PRINTF("Orchestra adaptive: child %u rx %u pending %u cells %u\n",
+           ORCHESTRA_LINKADDR_HASH(&c->addr), rx_count, pending_count, c->cells);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct adaptive_child *
+get_child(const linkaddr_t *addr)
+{
+  int i;
+
+  for(i = 0; i < ORCHESTRA_ADAPTIVE_MAX_CHILDREN; i++) {
+    if(children[i].in_use && linkaddr_cmp(&children[i].addr, addr)) {
+      return &children[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Add the neighbors queued from interrupt as children, if there is room */
+static void
+add_new_children(void)
+{
+  struct adaptive_child *c;
+  int16_t get_index;
+  int i;
+
+  while((get_index = ringbufindex_peek_get(&new_children_ringbuf)) != -1) {
+    if(get_child(&new_children[get_index]) == NULL) {
+      c = NULL;
+      for(i = 0; i < ORCHESTRA_ADAPTIVE_MAX_CHILDREN; i++) {
+        if(!children[i].in_use) {
+          c = &children[i];
+          break;
+        }
+      }
+      if(c != NULL) {
+        linkaddr_copy(&c->addr, &new_children[get_index]);
+        c->cells = 0;
+        c->rx_last = c->rx_count;
+        c->pending_last = c->pending_count;
+        c->in_use = 1;
+      }
+    }
+    ringbufindex_get(&new_children_ringbuf);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(orchestra_adaptive_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  etimer_set(&et, ORCHESTRA_ADAPTIVE_UPDATE_INTERVAL);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et) || ev == PROCESS_EVENT_POLL);
+    add_new_children();
+    if(etimer_expired(&et)) {
+      update_children();
+      etimer_reset(&et);
+    }
+    /* Apply the grant last announced by our parent */
+    tx_cells = tx_cells_granted;
+    update_links();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+/* Called from interrupt, when an ACK is built for a received frame */
+static int
+eack_ie_create(const linkaddr_t *addr, int frame_pending, struct ieee802154_ies *ies)
+{
+  struct adaptive_child *c;
+  int16_t put_index;
+
+  /* Our parent sends us downwards traffic, we do not grant it cells */
+  if(linkaddr_cmp(addr, &orchestra_parent_linkaddr)) {
+    return 0;
+  }
+
+  c = get_child(addr);
+  if(c != NULL) {
+    c->rx_count++;
+    if(frame_pending) {
+      c->pending_count++;
+    }
+  } else if(frame_pending) {
+    /* Track only the children that were backlogged at least once.
+     * The process adds them */
+    put_index = ringbufindex_peek_put(&new_children_ringbuf);
+    if(put_index != -1) {
+      linkaddr_copy(&new_children[put_index], addr);
+      ringbufindex_put(&new_children_ringbuf);
+      process_poll(&orchestra_adaptive_process);
+    }
+  }
+
+  /* Always announce the grant, so that the child learns when
+   * it is taken back */
+  ies->ie_vendor_oui = ORCHESTRA_ADAPTIVE_IE_OUI;
+  ies->ie_vendor_len = 1;
+  ies->ie_vendor_data[0] = c != NULL ? c->cells : 0;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+eack_ie_received(const linkaddr_t *addr, const struct ieee802154_ies *ies)
+{
+  uint8_t cells;
+
+  if(ies->ie_vendor_len == 1
+     && ies->ie_vendor_oui == ORCHESTRA_ADAPTIVE_IE_OUI
+     && linkaddr_cmp(addr, &orchestra_parent_linkaddr)) {
+    cells = MIN(ies->ie_vendor_data[0], ORCHESTRA_ADAPTIVE_MAX_CELLS);
+    if(cells != tx_cells_granted) {
+      tx_cells_granted = cells;
+      process_poll(&orchestra_adaptive_process);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+select_packet(uint16_t *slotframe, uint16_t *timeslot)
+{
+  /* Select data packets to our parent if it granted us cells */
+  const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  if(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) == FRAME802154_DATAFRAME
+     && tx_cells > 0
+     && !linkaddr_cmp(&orchestra_parent_linkaddr, &linkaddr_null)
+     && linkaddr_cmp(&orchestra_parent_linkaddr, dest)) {
+    if(slotframe != NULL) {
+      *slotframe = slotframe_handle;
+    }
+    if(timeslot != NULL) {
+      /* Any of our cells */
+      *timeslot = 0xffff;
+    }
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+new_time_source(const struct tsch_neighbor *old, const struct tsch_neighbor *new)
+{
+  if(new != old) {
+    /* The cells were granted by our previous parent */
+    tx_cells_granted = 0;
+    tx_cells = 0;
+    update_links();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(uint16_t sf_handle)
+{
+  slotframe_handle = sf_handle;
+  channel_offset = sf_handle;
+  /* Slotframe for unicast transmissions over cells allocated on the fly.
+   * It is empty until cells are granted. */
+  sf_adaptive = tsch_schedule_add_slotframe(slotframe_handle, ORCHESTRA_ADAPTIVE_PERIOD);
+  ringbufindex_init(&new_children_ringbuf, NEW_CHILDREN_QUEUE_LEN);
+  process_start(&orchestra_adaptive_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+struct orchestra_rule unicast_adaptive = {
+  init,
+  new_time_source,
+  select_packet,
+  NULL,
+  NULL,
+  eack_ie_create,
+  eack_ie_received,
+};
@@ -116,4 +116,6 @@ struct orchestra_rule unicast_per_neighbor_rpl_ns = {
   select_packet,
   child_added,
   child_removed,
+  NULL,
+  NULL,
 };
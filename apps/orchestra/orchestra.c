@@ -105,6 +105,34 @@ orchestra_callback_child_removed(const linkaddr_t *addr)
   }
 }
 /*---------------------------------------------------------------------------*/
+int
+orchestra_callback_eack_ie_create(const linkaddr_t *addr, int frame_pending, struct ieee802154_ies *ies)
+{
+  /* Called from interrupt. Let the first rule that has information
+   * for this neighbor fill in the IE */
+  int i;
+  for(i = 0; i < NUM_RULES; i++) {
+    if(all_rules[i]->eack_ie_create != NULL) {
+      if(all_rules[i]->eack_ie_create(addr, frame_pending, ies)) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+orchestra_callback_eack_ie_received(const linkaddr_t *addr, const struct ieee802154_ies *ies)
+{
+  /* Called from interrupt. Notify all Orchestra rules */
+  int i;
+  for(i = 0; i < NUM_RULES; i++) {
+    if(all_rules[i]->eack_ie_received != NULL) {
+      all_rules[i]->eack_ie_received(addr, ies);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 void
 orchestra_callback_packet_ready(void)
 {
@@ -50,12 +50,15 @@ struct orchestra_rule {
   int  (* select_packet)(uint16_t *slotframe, uint16_t *timeslot);
   void (* child_added)(const linkaddr_t *addr);
   void (* child_removed)(const linkaddr_t *addr);
+  int  (* eack_ie_create)(const linkaddr_t *addr, int frame_pending, struct ieee802154_ies *ies);
+  void (* eack_ie_received)(const linkaddr_t *addr, const struct ieee802154_ies *ies);
 };
 
 struct orchestra_rule eb_per_time_source;
 struct orchestra_rule unicast_per_neighbor_rpl_storing;
 struct orchestra_rule unicast_per_neighbor_rpl_ns;
 struct orchestra_rule default_common;
+struct orchestra_rule unicast_adaptive;
 
 extern linkaddr_t orchestra_parent_linkaddr;
 extern int orchestra_parent_knows_us;
@@ -71,5 +74,10 @@ void orchestra_callback_new_time_source(const struct tsch_neighbor *old, const s
 void orchestra_callback_child_added(const linkaddr_t *addr);
 /* Set with #define NETSTACK_CONF_ROUTING_NEIGHBOR_REMOVED_CALLBACK orchestra_callback_child_removed */
 void orchestra_callback_child_removed(const linkaddr_t *addr);
+/* Required by the unicast_adaptive rule only. Set with
+ * #define TSCH_CALLBACK_EACK_IE_CREATE orchestra_callback_eack_ie_create
+ * #define TSCH_CALLBACK_EACK_IE_RECEIVED orchestra_callback_eack_ie_received */
+int orchestra_callback_eack_ie_create(const linkaddr_t *addr, int frame_pending, struct ieee802154_ies *ies);
+void orchestra_callback_eack_ie_received(const linkaddr_t *addr, const struct ieee802154_ies *ies);
 
 #endif /* __ORCHESTRA_H__ */
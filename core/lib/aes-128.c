@@ -64,7 +64,9 @@ static const uint8_t sbox[256] =   {
 0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
 0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16 };
 
-static uint8_t round_keys[11][AES_128_KEY_LENGTH];
+static uint8_t schedule[11][AES_128_KEY_LENGTH];
+/* Points either to the schedule above or to the one of a context */
+static const uint8_t (*round_keys)[AES_128_KEY_LENGTH] = schedule;
 
 /*---------------------------------------------------------------------------*/
 /* multiplies by 2 in GF(2) */
@@ -76,27 +78,46 @@ galois_mul2(uint8_t value)
 }
 /*---------------------------------------------------------------------------*/
 static void
-set_key(const uint8_t *key)
+expand_key(uint8_t rk[][AES_128_KEY_LENGTH], const uint8_t *key)
 {
   uint8_t i;
   uint8_t j;
   uint8_t rcon;
   
   rcon = 0x01;
-  memcpy(round_keys[0], key, AES_128_KEY_LENGTH);
+  memcpy(rk[0], key, AES_128_KEY_LENGTH);
   for(i = 1; i <= 10; i++) {
-    round_keys[i][0] = sbox[round_keys[i - 1][13]] ^ round_keys[i - 1][0] ^ rcon;
-    round_keys[i][1] = sbox[round_keys[i - 1][14]] ^ round_keys[i - 1][1];
-    round_keys[i][2] = sbox[round_keys[i - 1][15]] ^ round_keys[i - 1][2];
-    round_keys[i][3] = sbox[round_keys[i - 1][12]] ^ round_keys[i - 1][3];
+    rk[i][0] = sbox[rk[i - 1][13]] ^ rk[i - 1][0] ^ rcon;
+    rk[i][1] = sbox[rk[i - 1][14]] ^ rk[i - 1][1];
+    rk[i][2] = sbox[rk[i - 1][15]] ^ rk[i - 1][2];
+    rk[i][3] = sbox[rk[i - 1][12]] ^ rk[i - 1][3];
     for(j = 4; j < AES_128_BLOCK_SIZE; j++) {
-      round_keys[i][j] = round_keys[i - 1][j] ^ round_keys[i][j - 4];
+      rk[i][j] = rk[i - 1][j] ^ rk[i][j - 4];
     }
     rcon = galois_mul2(rcon);
   }
 }
 /*---------------------------------------------------------------------------*/
 static void
+set_key(const uint8_t *key)
+{
+  expand_key(schedule, key);
+  round_keys = schedule;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init_context(struct aes_128_context *context)
+{
+  expand_key((uint8_t (*)[AES_128_KEY_LENGTH])context->schedule, context->key);
+}
+/*---------------------------------------------------------------------------*/
+static void
+select_context(const struct aes_128_context *context)
+{
+  round_keys = (const uint8_t (*)[AES_128_KEY_LENGTH])context->schedule;
+}
+/*---------------------------------------------------------------------------*/
+static void
 encrypt(uint8_t *state)
 {
   uint8_t buf1, buf2, buf3, buf4, round, i;
@@ -176,8 +197,29 @@ aes_128_set_padded_key(uint8_t *key, uint8_t key_len)
   AES_128.set_key(block);
 }
 /*---------------------------------------------------------------------------*/
+void
+aes_128_init_context(struct aes_128_context *context, const uint8_t *key)
+{
+  memcpy(context->key, key, AES_128_KEY_LENGTH);
+  if(AES_128.init_context != NULL) {
+    AES_128.init_context(context);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+aes_128_select_context(const struct aes_128_context *context)
+{
+  if(AES_128.select_context != NULL) {
+    AES_128.select_context(context);
+  } else {
+    AES_128.set_key(context->key);
+  }
+}
+/*---------------------------------------------------------------------------*/
 const struct aes_128_driver aes_128_driver = {
   set_key,
-  encrypt
+  encrypt,
+  init_context,
+  select_context
 };
 /*---------------------------------------------------------------------------*/
@@ -44,6 +44,8 @@
 
 #define AES_128_BLOCK_SIZE 16
 #define AES_128_KEY_LENGTH 16
+/* 4 words for each of the 11 round keys */
+#define AES_128_SCHEDULE_WORDS 44
 
 #ifdef AES_128_CONF
 #define AES_128            AES_128_CONF
@@ -51,6 +53,19 @@
 #define AES_128            aes_128_driver
 #endif /* AES_128_CONF */
 
+/**
+ * A key along with its expanded key schedule. Switching between keys
+ * that are in use at the same time is then a matter of selecting their
+ * context, instead of running the key expansion again. Contexts are
+ * used in place by the drivers, so a selected context must remain
+ * valid until another key is set or selected.
+ */
+struct aes_128_context {
+  uint8_t key[AES_128_KEY_LENGTH];
+  /* The layout of the schedule is driver-specific */
+  uint32_t schedule[AES_128_SCHEDULE_WORDS];
+};
+
 /**
  * Structure of AES drivers.
  */
@@ -65,6 +80,16 @@ struct aes_128_driver {
    * \brief Encrypts.
    */
   void (* encrypt)(uint8_t *plaintext_and_result);
+
+  /**
+   * \brief Expands the key of a context. Optional.
+   */
+  void (* init_context)(struct aes_128_context *context);
+
+  /**
+   * \brief Makes the key of an initialized context the current key. Optional.
+   */
+  void (* select_context)(const struct aes_128_context *context);
 };
 
 /**
@@ -72,6 +97,23 @@ struct aes_128_driver {
  */
 void aes_128_set_padded_key(uint8_t *key, uint8_t key_len);
 
+/**
+ * \brief Stores a key in a context and expands it with AES_128
+ */
+void aes_128_init_context(struct aes_128_context *context, const uint8_t *key);
+
+/**
+ * \brief Makes the key of a context the current key of AES_128. Falls
+ *        back to AES_128.set_key if the driver does not support contexts.
+ */
+void aes_128_select_context(const struct aes_128_context *context);
+
 extern const struct aes_128_driver AES_128;
 
+/**
+ * The byte-oriented software implementation, which is the default
+ * AES_128 driver.
+ */
+extern const struct aes_128_driver aes_128_driver;
+
 #endif /* AES_128_H_ */
@@ -46,6 +46,9 @@
 #define CCM_STAR_AUTH_FLAGS(Adata, M) ((Adata ? (1u << 6) : 0) | (((M - 2u) >> 1) << 3) | 1u)
 #define CCM_STAR_ENCRYPTION_FLAGS     1
 
+/* The context whose key is in use, if any */
+static const struct aes_128_context *selected_context;
+
 /*---------------------------------------------------------------------------*/
 static void
 set_iv(uint8_t *iv,
@@ -59,119 +62,140 @@ set_iv(uint8_t *iv,
   iv[15] = counter;
 }
 /*---------------------------------------------------------------------------*/
-/* XORs the block m[pos] ... m[pos + 15] with K_{counter} */
+/* XORs src into dst, a word at a time for aligned full blocks */
 static void
-ctr_step(const uint8_t *nonce,
-    uint8_t pos,
-    uint8_t *m_and_result,
-    uint8_t m_len,
-    uint8_t counter)
+xor_bytes(uint8_t *dst, const uint8_t *src, uint8_t len)
 {
-  uint8_t a[AES_128_BLOCK_SIZE];
   uint8_t i;
-  
-  set_iv(a, CCM_STAR_ENCRYPTION_FLAGS, nonce, counter);
-  AES_128.encrypt(a);
-  
-  for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-    m_and_result[pos + i] ^= a[i];
+
+  if(len == AES_128_BLOCK_SIZE
+     && (((uintptr_t)dst | (uintptr_t)src) & (sizeof(uint32_t) - 1)) == 0) {
+    for(i = 0; i < AES_128_BLOCK_SIZE / sizeof(uint32_t); i++) {
+      ((uint32_t *)dst)[i] ^= ((const uint32_t *)src)[i];
+    }
+  } else {
+    for(i = 0; i < len; i++) {
+      dst[i] ^= src[i];
+    }
   }
 }
 /*---------------------------------------------------------------------------*/
 static void
-mic(const uint8_t *nonce,
-    const uint8_t *m, uint8_t m_len,
-    const uint8_t *a, uint8_t a_len,
-    uint8_t *result,
-    uint8_t mic_len)
+set_key(const uint8_t *key)
 {
-  uint8_t x[AES_128_BLOCK_SIZE];
-  uint8_t pos;
-  uint8_t i;
+  AES_128.set_key(key);
+  ccm_star_deselect_context();
+}
+/*---------------------------------------------------------------------------*/
+static void
+init_context(struct aes_128_context *context)
+{
+  if(AES_128.init_context != NULL) {
+    AES_128.init_context(context);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Authentication and encryption are done in a single walk over the
+ * message: each block of the message is fed to the CBC-MAC and XORed
+ * with its key stream block before moving on to the next one.
+ */
+static void
+aead(const uint8_t* nonce,
+    uint8_t* m, uint8_t m_len,
+    const uint8_t* a, uint8_t a_len,
+    uint8_t *result, uint8_t mic_len,
+    int forward)
+{
+  /* words, so that blocks can be XORed a word at a time */
+  uint32_t x_words[AES_128_BLOCK_SIZE / sizeof(uint32_t)];
+  uint32_t iv_words[AES_128_BLOCK_SIZE / sizeof(uint32_t)];
+  uint32_t s_words[AES_128_BLOCK_SIZE / sizeof(uint32_t)];
+  uint8_t *x = (uint8_t *)x_words;
+  uint8_t *iv = (uint8_t *)iv_words;
+  uint8_t *s = (uint8_t *)s_words;
+  uint8_t counter;
+  uint16_t pos;
+  uint8_t len;
   
+  /* CBC-MAC of B_0 */
   set_iv(x, CCM_STAR_AUTH_FLAGS(a_len, mic_len), nonce, m_len);
   AES_128.encrypt(x);
   
+  /* CBC-MAC of the additional authenticated data, which is prefixed
+     with its length */
   if(a_len) {
-    x[1] = x[1] ^ a_len;
-    for(i = 2; (i - 2 < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
-      x[i] ^= a[i - 2];
-    }
-    
+    x[1] ^= a_len;
+    len = MIN(a_len, AES_128_BLOCK_SIZE - 2);
+    xor_bytes(x + 2, a, len);
     AES_128.encrypt(x);
-    
-    pos = 14;
-    while(pos < a_len) {
-      for(i = 0; (pos + i < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
-        x[i] ^= a[pos + i];
-      }
-      pos += AES_128_BLOCK_SIZE;
+    for(pos = len; pos < a_len; pos += AES_128_BLOCK_SIZE) {
+      xor_bytes(x, a + pos, MIN(a_len - pos, AES_128_BLOCK_SIZE));
       AES_128.encrypt(x);
     }
   }
   
-  if(m_len) {
-    pos = 0;
-    while(pos < m_len) {
-      for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-        x[i] ^= m[pos + i];
-      }
-      pos += AES_128_BLOCK_SIZE;
-      AES_128.encrypt(x);
+  /* CBC-MAC of the plaintext and CTR mode encryption or decryption */
+  set_iv(iv, CCM_STAR_ENCRYPTION_FLAGS, nonce, 0);
+  counter = 1;
+  for(pos = 0; pos < m_len; pos += AES_128_BLOCK_SIZE) {
+    len = MIN(m_len - pos, AES_128_BLOCK_SIZE);
+    memcpy(s, iv, AES_128_BLOCK_SIZE);
+    s[AES_128_BLOCK_SIZE - 1] = counter++;
+    AES_128.encrypt(s);
+    if(forward) {
+      xor_bytes(x, m + pos, len);
+      xor_bytes(m + pos, s, len);
+    } else {
+      xor_bytes(m + pos, s, len);
+      xor_bytes(x, m + pos, len);
     }
+    AES_128.encrypt(x);
   }
   
-  ctr_step(nonce, 0, x, AES_128_BLOCK_SIZE, 0);
-  
+  /* The MIC is the CBC-MAC encrypted with the key stream block A_0 */
+  AES_128.encrypt(iv);
+  xor_bytes(x, iv, AES_128_BLOCK_SIZE);
   memcpy(result, x, mic_len);
 }
 /*---------------------------------------------------------------------------*/
-static void
-ctr(const uint8_t *nonce, uint8_t *m, uint8_t m_len)
+void
+ccm_star_init_context(struct aes_128_context *context, const uint8_t *key)
 {
-  uint8_t pos;
-  uint8_t counter;
-  
-  pos = 0;
-  counter = 1;
-  while(pos < m_len) {
-    ctr_step(nonce, pos, m, m_len, counter++);
-    pos += AES_128_BLOCK_SIZE;
+  memcpy(context->key, key, AES_128_KEY_LENGTH);
+  if(CCM_STAR.init_context != NULL) {
+    CCM_STAR.init_context(context);
+  }
+  if(context == selected_context) {
+    /* The context holds a new key, which is not in use yet */
+    selected_context = NULL;
   }
 }
 /*---------------------------------------------------------------------------*/
-static void
-set_key(const uint8_t *key)
+void
+ccm_star_deselect_context(void)
 {
-  AES_128.set_key(key);
+  selected_context = NULL;
 }
 /*---------------------------------------------------------------------------*/
-static void
-aead(const uint8_t* nonce,
-    uint8_t* m, uint8_t m_len,
-    const uint8_t* a, uint8_t a_len,
-    uint8_t *result, uint8_t mic_len,
-    int forward)
+void
+ccm_star_select_context(const struct aes_128_context *context)
 {
-  if(!forward) {
-    /* decrypt */
-    ctr(nonce, m, m_len);
+  if(context == selected_context) {
+    return;
   }
-  
-  mic(nonce,
-    m, m_len,
-    a, a_len,
-    result,
-    mic_len);
-  
-  if(forward) {
-    /* encrypt */
-    ctr(nonce, m, m_len);
+  if(CCM_STAR.select_context != NULL) {
+    CCM_STAR.select_context(context);
+  } else {
+    CCM_STAR.set_key(context->key);
   }
+  selected_context = context;
 }
 /*---------------------------------------------------------------------------*/
 const struct ccm_star_driver ccm_star_driver = {
   set_key,
-  aead
+  aead,
+  init_context,
+  aes_128_select_context
 };
 /*---------------------------------------------------------------------------*/
@@ -41,6 +41,7 @@
 #define CCM_STAR_H_
 
 #include "contiki.h"
+#include "lib/aes-128.h"
 
 #ifdef CCM_STAR_CONF
 #define CCM_STAR CCM_STAR_CONF
@@ -57,6 +58,7 @@ struct ccm_star_driver {
   
   /**
    * \brief         Sets the key in use. Default implementation calls AES_128.set_key().
+   *                Implementations call ccm_star_deselect_context().
    * \param key     The key to use.
    */
   void (* set_key)(const uint8_t* key);
@@ -75,8 +77,43 @@ struct ccm_star_driver {
       const uint8_t* a, uint8_t a_len,
       uint8_t *result, uint8_t mic_len,
       int forward);
+
+  /**
+   * \brief         Prepares a context for use with select_context(). Optional.
+   *                Default implementation calls AES_128.init_context().
+   * \param context A context whose key field holds the key.
+   */
+  void (* init_context)(struct aes_128_context *context);
+
+  /**
+   * \brief         Sets the key of a prepared context as the key in use,
+   *                which is cheaper than set_key(). Optional.
+   *                Default implementation calls aes_128_select_context().
+   * \param context The context to use.
+   */
+  void (* select_context)(const struct aes_128_context *context);
 };
 
 extern const struct ccm_star_driver CCM_STAR;
 
+/**
+ * \brief         Stores a key in a context and prepares it with CCM_STAR.
+ */
+void ccm_star_init_context(struct aes_128_context *context, const uint8_t *key);
+
+/**
+ * \brief         Sets the key of a context as the key in use. Falls back to
+ *                CCM_STAR.set_key() if the driver does not support contexts.
+ *                Does nothing if the context was the last one selected, so
+ *                it may be called before every frame.
+ */
+void ccm_star_select_context(const struct aes_128_context *context);
+
+/**
+ * \brief         Forgets which context was selected, so that the next
+ *                ccm_star_select_context() sets its key again. Called by
+ *                the set_key() function of every CCM* driver.
+ */
+void ccm_star_deselect_context(void);
+
 #endif /* CCM_STAR_H_ */
@@ -43,8 +43,23 @@
  */
 
 #include <string.h>
+#include "sys/cc.h"
 #include "lib/ringbufindex.h"
 
+/* Each side of the ring buffer owns one of the two indices: only the
+ * producer writes ->put_ptr and only the consumer writes ->get_ptr.
+ * The index owned by the other side is read exactly once per call,
+ * through CC_ACCESS_NOW, so that the compiler can neither cache it nor
+ * read it twice with different values. A compiler barrier orders the
+ * accesses to the elements with respect to the index updates: the
+ * producer fills an element before publishing it, and the consumer is
+ * done with an element before releasing it. */
+#define READ_PTR(p) CC_ACCESS_NOW(uint8_t, p)
+#define WRITE_PTR(p, v) do { \
+    CC_COMPILER_BARRIER(); \
+    CC_ACCESS_NOW(uint8_t, p) = (v); \
+  } while(0)
+
 /* Initialize a ring buffer. The size must be a power of two */
 void
 ringbufindex_init(struct ringbufindex *r, uint8_t size)
@@ -57,19 +72,19 @@ ringbufindex_init(struct ringbufindex *r, uint8_t size)
 int
 ringbufindex_put(struct ringbufindex *r)
 {
+  uint8_t put_ptr = r->put_ptr;
+
   /* Check if buffer is full. If it is full, return 0 to indicate that
      the element was not inserted.
 
-     XXX: there is a potential risk for a race condition here, because
-     the ->get_ptr field may be written concurrently by the
-     ringbufindex_get() function. To avoid this, access to ->get_ptr must
-     be atomic. We use an uint8_t type, which makes access atomic on
-     most platforms, but C does not guarantee this.
+     The ->get_ptr field may be written concurrently by the
+     ringbufindex_get() function. We use an uint8_t type, which makes
+     access atomic on most platforms, but C does not guarantee this.
    */
-  if(((r->put_ptr - r->get_ptr) & r->mask) == r->mask) {
+  if(((put_ptr - READ_PTR(r->get_ptr)) & r->mask) == r->mask) {
     return 0;
   }
-  r->put_ptr = (r->put_ptr + 1) & r->mask;
+  WRITE_PTR(r->put_ptr, (put_ptr + 1) & r->mask);
   return 1;
 }
 /* Check if there is space to put an element.
@@ -77,33 +92,32 @@ ringbufindex_put(struct ringbufindex *r)
 int
 ringbufindex_peek_put(const struct ringbufindex *r)
 {
-  /* Check if there are bytes in the buffer. If so, we return the
-     first one. If there are no bytes left, we return -1.
+  uint8_t put_ptr = r->put_ptr;
+
+  /* Check if there is space left in the buffer. If so, we return the
+     index of the next free element. Otherwise, we return -1.
    */
-  if(((r->put_ptr - r->get_ptr) & r->mask) == r->mask) {
+  if(((put_ptr - READ_PTR(r->get_ptr)) & r->mask) == r->mask) {
     return -1;
   }
-  return r->put_ptr;
+  return put_ptr;
 }
 /* Remove the first element and return its index */
 int
 ringbufindex_get(struct ringbufindex *r)
 {
-  int get_ptr;
+  uint8_t get_ptr = r->get_ptr;
 
   /* Check if there are bytes in the buffer. If so, we return the
      first one and increase the pointer. If there are no bytes left, we
      return -1.
 
-     XXX: there is a potential risk for a race condition here, because
-     the ->put_ptr field may be written concurrently by the
-     ringbufindex_put() function. To avoid this, access to ->get_ptr must
-     be atomic. We use an uint8_t type, which makes access atomic on
-     most platforms, but C does not guarantee this.
+     The ->put_ptr field may be written concurrently by the
+     ringbufindex_put() function. We use an uint8_t type, which makes
+     access atomic on most platforms, but C does not guarantee this.
    */
-  if(((r->put_ptr - r->get_ptr) & r->mask) > 0) {
-    get_ptr = r->get_ptr;
-    r->get_ptr = (r->get_ptr + 1) & r->mask;
+  if(((READ_PTR(r->put_ptr) - get_ptr) & r->mask) > 0) {
+    WRITE_PTR(r->get_ptr, (get_ptr + 1) & r->mask);
     return get_ptr;
   } else {
     return -1;
@@ -114,15 +128,50 @@ ringbufindex_get(struct ringbufindex *r)
 int
 ringbufindex_peek_get(const struct ringbufindex *r)
 {
+  uint8_t get_ptr = r->get_ptr;
+
   /* Check if there are bytes in the buffer. If so, we return the
      first one. If there are no bytes left, we return -1.
    */
-  if(((r->put_ptr - r->get_ptr) & r->mask) > 0) {
-    return r->get_ptr;
+  if(((READ_PTR(r->put_ptr) - get_ptr) & r->mask) > 0) {
+    CC_COMPILER_BARRIER();
+    return get_ptr;
   } else {
     return -1;
   }
 }
+/* Return the number of elements that can be removed at once, and the
+ * index of the first of them */
+int
+ringbufindex_peek_get_batch(const struct ringbufindex *r, int *first)
+{
+  uint8_t get_ptr = r->get_ptr;
+  int count;
+
+  count = (READ_PTR(r->put_ptr) - get_ptr) & r->mask;
+  /* The elements of the batch must not be read before ->put_ptr */
+  CC_COMPILER_BARRIER();
+  if(first != NULL) {
+    *first = get_ptr;
+  }
+  return count;
+}
+/* Remove the n first elements at once */
+int
+ringbufindex_get_batch(struct ringbufindex *r, int n)
+{
+  uint8_t get_ptr = r->get_ptr;
+  int count;
+
+  count = (READ_PTR(r->put_ptr) - get_ptr) & r->mask;
+  if(n > count) {
+    n = count;
+  }
+  if(n > 0) {
+    WRITE_PTR(r->get_ptr, (get_ptr + n) & r->mask);
+  }
+  return n;
+}
 /* Return the ring buffer size */
 int
 ringbufindex_size(const struct ringbufindex *r)
@@ -133,13 +182,13 @@ ringbufindex_size(const struct ringbufindex *r)
 int
 ringbufindex_elements(const struct ringbufindex *r)
 {
-  return (r->put_ptr - r->get_ptr) & r->mask;
+  return (READ_PTR(r->put_ptr) - READ_PTR(r->get_ptr)) & r->mask;
 }
 /* Is the ring buffer full? */
 int
 ringbufindex_full(const struct ringbufindex *r)
 {
-  return ((r->put_ptr - r->get_ptr) & r->mask) == r->mask;
+  return ringbufindex_elements(r) == r->mask;
 }
 /* Is the ring buffer empty? */
 int
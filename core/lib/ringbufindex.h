@@ -42,9 +42,12 @@
 
 #include "contiki-conf.h"
 
+/* A ring buffer of indices, for one producer and one consumer that may
+ * run in different contexts, e.g., an interrupt and a process. */
 struct ringbufindex {
   uint8_t mask;
-  /* These must be 8-bit quantities to avoid race conditions. */
+  /* These must be 8-bit quantities to avoid race conditions.
+   * put_ptr is written by the producer only, get_ptr by the consumer only. */
   uint8_t put_ptr, get_ptr;
 };
 
@@ -88,6 +91,27 @@ int ringbufindex_get(struct ringbufindex *r);
  */
 int ringbufindex_peek_get(const struct ringbufindex *r);
 
+/**
+ * \brief Return the number of elements that can be removed in one batch,
+ *        i.e., all elements currently in the ring buffer, and the index of
+ *        the first of them. The i-th element of the batch is at index
+ *        (first + i) modulo the ring buffer size. The elements remain in the
+ *        ring buffer until released with ringbufindex_get_batch.
+ * \param r Pointer to ringbufindex
+ * \param first Where to store the index of the first element, or NULL
+ * \return The number of elements in the batch
+ */
+int ringbufindex_peek_get_batch(const struct ringbufindex *r, int *first);
+
+/**
+ * \brief Remove the n first elements at once, once they were consumed.
+ *        The producer sees the freed space only after this call.
+ * \param r Pointer to ringbufindex
+ * \param n Number of elements to remove
+ * \return The number of elements actually removed
+ */
+int ringbufindex_get_batch(struct ringbufindex *r, int n);
+
 /**
  * \brief Return the ring buffer size
  * \param r Pinter to ringbufindex
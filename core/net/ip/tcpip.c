@@ -586,6 +586,12 @@ tcpip_ipv6_output(void)
       if(route == NULL) {
         PRINTF("tcpip_ipv6_output: no route found, using default route\n");
         nexthop = uip_ds6_defrt_choose();
+#if UIP_CONF_IPV6_RPL && RPL_WITH_MULTIPATH
+        if(nexthop != NULL) {
+          /* Spread upward traffic over the best RPL parents */
+          nexthop = rpl_multipath_get_next_hop(nexthop);
+        }
+#endif /* UIP_CONF_IPV6_RPL && RPL_WITH_MULTIPATH */
         if(nexthop == NULL) {
 #ifdef UIP_FALLBACK_INTERFACE
           PRINTF("FALLBACK: removing ext hdrs & setting proto %d %d\n",
@@ -532,6 +532,23 @@ void uip_log(char *msg);
 #define UIP_ARPTAB_SIZE 8
 #endif
 
+/**
+ * The number of entries an IP address is looked up in, in the ARP table.
+ *
+ * The ARP table is a hash table split into sets of this many
+ * entries. Lookups are faster with smaller sets, but addresses that
+ * hash to the same set may evict each other while other sets still
+ * have unused entries. Use UIP_ARPTAB_SIZE for a single set, i.e., a
+ * linear table.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_ARP_SET_SIZE
+#define UIP_ARP_SET_SIZE (UIP_CONF_ARP_SET_SIZE)
+#else
+#define UIP_ARP_SET_SIZE 4
+#endif
+
 /**
  * The maximum age of ARP table entries measured in 10ths of seconds.
  *
@@ -176,6 +176,44 @@ static struct fwcache_entry fwcache[FWCACHE_SIZE];
  */
 #define FW_TIME 20
 
+/*
+ * A cache of the network interface to use for recent destinations,
+ * so that the interfaces do not need to be matched for every packet.
+ * A destination that matches no interface is cached as well, with a
+ * NULL netif: it goes to the default interface.
+ */
+struct route_cache_entry {
+  uip_ipaddr_t destipaddr;
+  struct uip_fw_netif *netif;
+  uint8_t timer;
+};
+
+/*
+ * The number of destinations in the route cache. The cache is direct
+ * mapped: a destination can only be cached in the entry its address
+ * hashes to. Set to 0 to disable the cache.
+ */
+#ifdef UIP_CONF_FW_ROUTE_CACHE_SIZE
+#define ROUTE_CACHE_SIZE UIP_CONF_FW_ROUTE_CACHE_SIZE
+#else
+#define ROUTE_CACHE_SIZE 8
+#endif
+
+/**
+ * \internal
+ * The time that a route cache entry is valid, in calls to
+ * uip_fw_periodic().
+ */
+#define ROUTE_CACHE_TIME 20
+
+#if ROUTE_CACHE_SIZE > 0
+static struct route_cache_entry route_cache[ROUTE_CACHE_SIZE];
+#endif /* ROUTE_CACHE_SIZE > 0 */
+
+#if UIP_STATISTICS == 1
+struct uip_fw_stats uip_fw_stat;
+#endif /* UIP_STATISTICS == 1 */
+
 /*------------------------------------------------------------------------------*/
 /**
  * Initialize the uIP packet forwarding module.
@@ -191,6 +229,24 @@ uip_fw_init(void)
     netifs = netifs->next;
     t->next = NULL;
   }
+  uip_fw_flush_routes();
+}
+/*------------------------------------------------------------------------------*/
+/**
+ * Flush the cache of the network interfaces used for recent
+ * destinations.
+ *
+ * This function must be called when the IP address or netmask of a
+ * registered network interface changes. Registering interfaces
+ * flushes the cache automatically.
+ */
+/*------------------------------------------------------------------------------*/
+void
+uip_fw_flush_routes(void)
+{
+#if ROUTE_CACHE_SIZE > 0
+  memset(route_cache, 0, sizeof(route_cache));
+#endif /* ROUTE_CACHE_SIZE > 0 */
 }
 /*------------------------------------------------------------------------------*/
 /**
@@ -320,18 +376,41 @@ static struct uip_fw_netif *
 find_netif(void)
 {
   struct uip_fw_netif *netif;
-  
+#if ROUTE_CACHE_SIZE > 0
+  struct route_cache_entry *route;
+
+  /* First check if the interface for this destination is cached. The
+     hash uses every byte of the address, in the same way on all byte
+     orders, so that hosts of the same subnet spread over the cache. */
+  route = &route_cache[(BUF->destipaddr.u8[0] ^ BUF->destipaddr.u8[1] ^
+                        BUF->destipaddr.u8[2] ^ BUF->destipaddr.u8[3]) %
+                       ROUTE_CACHE_SIZE];
+  if(route->timer != 0 &&
+     uip_ipaddr_cmp(&route->destipaddr, &BUF->destipaddr)) {
+    UIP_STAT(++uip_fw_stat.route_cache_hits);
+    return route->netif != NULL ? route->netif : defaultnetif;
+  }
+#endif /* ROUTE_CACHE_SIZE > 0 */
+  UIP_STAT(++uip_fw_stat.route_cache_misses);
+
   /* Walk through every network interface to check for a match. */
   for(netif = netifs; netif != NULL; netif = netif->next) {
     if(ipaddr_maskcmp(&BUF->destipaddr, &netif->ipaddr,
 		      &netif->netmask)) {
       /* If there was a match, we break the loop. */
-      return netif;
+      break;
     }
   }
-  
+
+#if ROUTE_CACHE_SIZE > 0
+  /* Cache the result, including when no interface matched. */
+  uip_ipaddr_copy(&route->destipaddr, &BUF->destipaddr);
+  route->netif = netif;
+  route->timer = ROUTE_CACHE_TIME;
+#endif /* ROUTE_CACHE_SIZE > 0 */
+
   /* If no matching netif was found, we use default netif. */
-  return defaultnetif;
+  return netif != NULL ? netif : defaultnetif;
 }
 /*------------------------------------------------------------------------------*/
 /**
@@ -499,6 +578,7 @@ uip_fw_register(struct uip_fw_netif *netif)
 {
   netif->next = netifs;
   netifs = netif;
+  uip_fw_flush_routes();
 }
 /*------------------------------------------------------------------------------*/
 /**
@@ -525,11 +605,22 @@ void
 uip_fw_periodic(void)
 {
   struct fwcache_entry *fw;
+#if ROUTE_CACHE_SIZE > 0
+  struct route_cache_entry *route;
+#endif /* ROUTE_CACHE_SIZE > 0 */
+
   for(fw = fwcache; fw < &fwcache[FWCACHE_SIZE]; ++fw) {
     if(fw->timer > 0) {
       --fw->timer;
     }
   }
+#if ROUTE_CACHE_SIZE > 0
+  for(route = route_cache; route < &route_cache[ROUTE_CACHE_SIZE]; ++route) {
+    if(route->timer > 0) {
+      --route->timer;
+    }
+  }
+#endif /* ROUTE_CACHE_SIZE > 0 */
 }
 /*------------------------------------------------------------------------------*/
 /** @} */
@@ -114,6 +114,20 @@ uint8_t uip_fw_output(void);
 void uip_fw_register(struct uip_fw_netif *netif);
 void uip_fw_default(struct uip_fw_netif *netif);
 void uip_fw_periodic(void);
+void uip_fw_flush_routes(void);
+
+#if UIP_STATISTICS == 1
+/**
+ * Route cache statistics, gathered if UIP_STATISTICS is set to 1.
+ */
+struct uip_fw_stats {
+  unsigned long route_cache_hits;   /**< Packets whose interface was
+				       found in the route cache. */
+  unsigned long route_cache_misses; /**< Packets whose interface was
+				       looked up. */
+};
+extern struct uip_fw_stats uip_fw_stat;
+#endif /* UIP_STATISTICS == 1 */
 
 
 /**
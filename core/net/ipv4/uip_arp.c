@@ -102,6 +102,17 @@ struct arp_entry {
 static const struct uip_eth_addr broadcast_ethaddr =
   {{0xff,0xff,0xff,0xff,0xff,0xff}};
 
+/* The ARP table is split into sets of UIP_ARP_SET_SIZE entries. An
+   IP address is hashed to a set and only stored in that set, so that
+   a lookup checks at most UIP_ARP_SET_SIZE entries whatever the size
+   of the table. The last set also holds the remaining entries when
+   UIP_ARPTAB_SIZE is not a multiple of UIP_ARP_SET_SIZE. */
+#if UIP_ARPTAB_SIZE >= 2 * UIP_ARP_SET_SIZE
+#define ARP_NUM_SETS (UIP_ARPTAB_SIZE / UIP_ARP_SET_SIZE)
+#else
+#define ARP_NUM_SETS 1
+#endif
+
 static struct arp_entry arp_table[UIP_ARPTAB_SIZE];
 static uip_ipaddr_t ipaddr;
 static uint8_t i, c;
@@ -120,6 +131,39 @@ static uint8_t tmpage;
 #define PRINTF(...)
 #endif
 
+/*-----------------------------------------------------------------------------------*/
+/* Return the first entry of the set of an IP address, and the number
+   of entries of the set in c. */
+static struct arp_entry *
+arp_set(const uip_ipaddr_t *addr)
+{
+#if ARP_NUM_SETS > 1
+  uint8_t set;
+
+  set = (addr->u8[0] ^ addr->u8[1] ^ addr->u8[2] ^ addr->u8[3]) % ARP_NUM_SETS;
+  c = set == ARP_NUM_SETS - 1 ?
+    UIP_ARPTAB_SIZE - set * UIP_ARP_SET_SIZE : UIP_ARP_SET_SIZE;
+  return &arp_table[set * UIP_ARP_SET_SIZE];
+#else /* ARP_NUM_SETS > 1 */
+  c = UIP_ARPTAB_SIZE;
+  return arp_table;
+#endif /* ARP_NUM_SETS > 1 */
+}
+/*-----------------------------------------------------------------------------------*/
+/* Return the ARP table entry of an IP address, or NULL if there is none. */
+static struct arp_entry *
+arp_lookup(const uip_ipaddr_t *addr)
+{
+  struct arp_entry *tabptr;
+
+  for(tabptr = arp_set(addr); c > 0; --c, ++tabptr) {
+    if(uip_ipaddr_cmp(addr, &tabptr->ipaddr) &&
+       !uip_ipaddr_cmp(&tabptr->ipaddr, &uip_all_zeroes_addr)) {
+      return tabptr;
+    }
+  }
+  return NULL;
+}
 /*-----------------------------------------------------------------------------------*/
 /**
  * Initialize the ARP module.
@@ -151,8 +195,10 @@ uip_arp_timer(void)
   ++arptime;
   for(i = 0; i < UIP_ARPTAB_SIZE; ++i) {
     tabptr = &arp_table[i];
-    if(uip_ipaddr_cmp(&tabptr->ipaddr, &uip_all_zeroes_addr) &&
-       arptime - tabptr->time >= UIP_ARP_MAXAGE) {
+    /* Flush the entries in use that are too old. The age is computed
+       modulo 256, as arptime wraps around. */
+    if(!uip_ipaddr_cmp(&tabptr->ipaddr, &uip_all_zeroes_addr) &&
+       (uint8_t)(arptime - tabptr->time) >= UIP_ARP_MAXAGE) {
       memset(&tabptr->ipaddr, 0, 4);
     }
   }
@@ -163,60 +209,38 @@ uip_arp_timer(void)
 static void
 uip_arp_update(uip_ipaddr_t *ipaddr, struct uip_eth_addr *ethaddr)
 {
-  register struct arp_entry *tabptr = arp_table;
-
-  /* Walk through the ARP mapping table and try to find an entry to
-     update. If none is found, the IP -> MAC address mapping is
-     inserted in the ARP table. */
-  for(i = 0; i < UIP_ARPTAB_SIZE; ++i) {
-    tabptr = &arp_table[i];
-
-    /* Only check those entries that are actually in use. */
-    if(!uip_ipaddr_cmp(&tabptr->ipaddr, &uip_all_zeroes_addr)) {
-
-      /* Check if the source IP address of the incoming packet matches
-         the IP address in this ARP table entry. */
-      if(uip_ipaddr_cmp(ipaddr, &tabptr->ipaddr)) {
-	 
-	/* An old entry found, update this and return. */
-	memcpy(tabptr->ethaddr.addr, ethaddr->addr, 6);
-	tabptr->time = arptime;
-
-	return;
-      }
-    }
-	tabptr++;
+  struct arp_entry *tabptr;
+  struct arp_entry *set;
+
+  /* Look for an entry to update in the set of the IP address. If none
+     is found, the IP -> MAC address mapping is inserted in the set. */
+  tabptr = arp_lookup(ipaddr);
+  if(tabptr != NULL) {
+    /* An old entry found, update this and return. */
+    memcpy(tabptr->ethaddr.addr, ethaddr->addr, 6);
+    tabptr->time = arptime;
+    return;
   }
 
   /* If we get here, no existing ARP table entry was found, so we
-     create one. */
-
-  /* First, we try to find an unused entry in the ARP table. */
-  for(i = 0; i < UIP_ARPTAB_SIZE; ++i) {
-    tabptr = &arp_table[i];
-    if(uip_ipaddr_cmp(&tabptr->ipaddr, &uip_all_zeroes_addr)) {
+     create one. We try to find an unused entry in the set, and
+     otherwise throw away the oldest entry of the set. */
+  set = arp_set(ipaddr);
+  tabptr = set;
+  tmpage = 0;
+  for(i = 0; i < c; ++i) {
+    if(uip_ipaddr_cmp(&set[i].ipaddr, &uip_all_zeroes_addr)) {
+      tabptr = &set[i];
       break;
     }
-  }
-
-  /* If no unused entry is found, we try to find the oldest entry and
-     throw it away. */
-  if(i == UIP_ARPTAB_SIZE) {
-    tmpage = 0;
-    c = 0;
-    for(i = 0; i < UIP_ARPTAB_SIZE; ++i) {
-      tabptr = &arp_table[i];
-      if(arptime - tabptr->time > tmpage) {
-	tmpage = arptime - tabptr->time;
-	c = i;
-      }
+    if((uint8_t)(arptime - set[i].time) > tmpage) {
+      tmpage = arptime - set[i].time;
+      tabptr = &set[i];
     }
-    i = c;
-    tabptr = &arp_table[i];
   }
 
-  /* Now, i is the ARP table entry which we will fill with the new
-     information. */
+  /* Now, tabptr is the ARP table entry which we will fill with the
+     new information. */
   uip_ipaddr_copy(&tabptr->ipaddr, ipaddr);
   memcpy(tabptr->ethaddr.addr, ethaddr->addr, 6);
   tabptr->time = arptime;
@@ -362,7 +386,7 @@ uip_arp_arpin(void)
 void
 uip_arp_out(void)
 {
-  struct arp_entry *tabptr = arp_table;
+  struct arp_entry *tabptr;
   
   /* Find the destination IP address in the ARP table and construct
      the Ethernet header. If the destination IP addres isn't on the
@@ -393,14 +417,9 @@ uip_arp_out(void)
       /* Else, we use the destination IP address. */
       uip_ipaddr_copy(&ipaddr, &IPBUF->destipaddr);
     }
-    for(i = 0; i < UIP_ARPTAB_SIZE; ++i) {
-      if(uip_ipaddr_cmp(&ipaddr, &tabptr->ipaddr)) {
-	break;
-      }
-	  tabptr++;
-    }
+    tabptr = arp_lookup(&ipaddr);
 
-    if(i == UIP_ARPTAB_SIZE) {
+    if(tabptr == NULL) {
       /* The destination address was not in our ARP table, so we
 	 overwrite the IP packet with an ARP request. */
 
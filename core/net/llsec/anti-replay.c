@@ -46,12 +46,15 @@
 #include "net/llsec/anti-replay.h"
 #include "net/packetbuf.h"
 #include "net/llsec/llsec802154.h"
+#include <string.h>
 
 #if LLSEC802154_USES_FRAME_COUNTER
 
 /* This node's current frame counter value */
 static uint32_t counter;
 
+struct anti_replay_stats anti_replay_stats;
+
 /*---------------------------------------------------------------------------*/
 void
 anti_replay_set_counter(void)
@@ -79,9 +82,69 @@ anti_replay_get_counter(void)
 void
 anti_replay_init_info(struct anti_replay_info *info)
 {
-  info->last_broadcast_counter
-      = info->last_unicast_counter
+  memset(info, 0, sizeof(struct anti_replay_info));
+  info->broadcast.last_counter
+      = info->unicast.last_counter
       = anti_replay_get_counter();
+  info->broadcast.bitmap[0] = info->unicast.bitmap[0] = 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Slides the window so that it ends shift counters later */
+static void
+slide_window(struct anti_replay_window *window, uint32_t shift)
+{
+  uint32_t word;
+  uint8_t words;
+  uint8_t bits;
+  int8_t i;
+
+  if(shift >= ANTI_REPLAY_WINDOW_WORDS * 32) {
+    memset(window->bitmap, 0, sizeof(window->bitmap));
+    return;
+  }
+
+  words = shift / 32;
+  bits = shift % 32;
+  for(i = ANTI_REPLAY_WINDOW_WORDS - 1; i >= 0; i--) {
+    word = 0;
+    if(i - words >= 0) {
+      word = window->bitmap[i - words] << bits;
+      if(bits && i - words - 1 >= 0) {
+        word |= window->bitmap[i - words - 1] >> (32 - bits);
+      }
+    }
+    window->bitmap[i] = word;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_window(struct anti_replay_window *window, uint32_t received_counter)
+{
+  uint32_t age;
+  uint32_t mask;
+
+  if(received_counter > window->last_counter) {
+    slide_window(window, received_counter - window->last_counter);
+    window->last_counter = received_counter;
+    window->bitmap[0] |= 1;
+    return 0;
+  }
+
+  age = window->last_counter - received_counter;
+  if(age >= ANTI_REPLAY_WINDOW_SIZE) {
+    /* too old to tell */
+    anti_replay_stats.replays++;
+    return 1;
+  }
+
+  mask = (uint32_t)1 << (age % 32);
+  if(window->bitmap[age / 32] & mask) {
+    anti_replay_stats.replays++;
+    return 1;
+  }
+  window->bitmap[age / 32] |= mask;
+  anti_replay_stats.reorders++;
+  return 0;
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -92,21 +155,9 @@ anti_replay_was_replayed(struct anti_replay_info *info)
   received_counter = anti_replay_get_counter();
   
   if(packetbuf_holds_broadcast()) {
-    /* broadcast */
-    if(received_counter <= info->last_broadcast_counter) {
-      return 1;
-    } else {
-      info->last_broadcast_counter = received_counter;
-      return 0;
-    }
+    return check_window(&info->broadcast, received_counter);
   } else {
-    /* unicast */
-    if(received_counter <= info->last_unicast_counter) {
-      return 1;
-    } else {
-      info->last_unicast_counter = received_counter;
-      return 0;
-    }
+    return check_window(&info->unicast, received_counter);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -47,11 +47,42 @@
 
 #include "contiki.h"
 
+/*
+ * Frames may arrive out of order, e.g., when a retransmission overtakes
+ * a later frame. Besides the highest frame counter received so far, a
+ * bitmap of the ANTI_REPLAY_WINDOW_SIZE counters up to and including
+ * it is thus kept. Older frames are accepted as long as they are in
+ * the window and were not received yet. A window size of 1 only
+ * accepts frames with increasing counters.
+ */
+#ifdef ANTI_REPLAY_CONF_WINDOW_SIZE
+#define ANTI_REPLAY_WINDOW_SIZE ANTI_REPLAY_CONF_WINDOW_SIZE
+#else /* ANTI_REPLAY_CONF_WINDOW_SIZE */
+#define ANTI_REPLAY_WINDOW_SIZE 32
+#endif /* ANTI_REPLAY_CONF_WINDOW_SIZE */
+
+#define ANTI_REPLAY_WINDOW_WORDS ((ANTI_REPLAY_WINDOW_SIZE + 31) / 32)
+
+struct anti_replay_window {
+  uint32_t last_counter;
+  /* Bit i is set if frame counter last_counter - i was received */
+  uint32_t bitmap[ANTI_REPLAY_WINDOW_WORDS];
+};
+
 struct anti_replay_info {
-  uint32_t last_broadcast_counter;
-  uint32_t last_unicast_counter;
+  struct anti_replay_window broadcast;
+  struct anti_replay_window unicast;
+};
+
+struct anti_replay_stats {
+  /* Frames that were dropped as replayed or too old */
+  uint32_t replays;
+  /* Frames that arrived out of order and were accepted */
+  uint32_t reorders;
 };
 
+extern struct anti_replay_stats anti_replay_stats;
+
 /**
  * \brief Sets the frame counter packetbuf attributes.
  */
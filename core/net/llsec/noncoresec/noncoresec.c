@@ -94,6 +94,8 @@ extern const struct framer DECORATED_FRAMER;
 
 /* network-wide CCM* key */
 static uint8_t key[16] = NONCORESEC_KEY;
+/* the key along with its expanded schedule */
+static struct aes_128_context key_context;
 NBR_TABLE(struct anti_replay_info, anti_replay_table);
 
 /*---------------------------------------------------------------------------*/
@@ -126,6 +128,9 @@ aead(uint8_t hdrlen, int forward)
   mic = a + totlen;
   result = forward ? mic : generated_mic;
   
+  /* Sets the key only if another user of CCM* selected its own key
+     since the last frame */
+  ccm_star_select_context(&key_context);
   CCM_STAR.aead(nonce,
       m, m_len,
       a, a_len,
@@ -228,8 +233,9 @@ parse(void)
     anti_replay_init_info(info);
   } else {
     if(anti_replay_was_replayed(info)) {
-       PRINTF("noncoresec: received replayed frame %lu\n",
-           anti_replay_get_counter());
+       PRINTF("noncoresec: received replayed frame %lu (%lu replays, %lu reorders)\n",
+           anti_replay_get_counter(),
+           anti_replay_stats.replays, anti_replay_stats.reorders);
        return FRAMER_FAILED;
     }
   }
@@ -253,7 +259,7 @@ length(void)
 static void
 init(void)
 {
-  CCM_STAR.set_key(key);
+  ccm_star_init_context(&key_context, key);
   nbr_table_register(anti_replay_table, NULL);
 }
 /*---------------------------------------------------------------------------*/
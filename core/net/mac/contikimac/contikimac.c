@@ -112,6 +112,27 @@ static int we_are_receiving_burst = 0;
 #define INTER_PACKET_DEADLINE               CLOCK_SECOND / 32
 #endif
 
+/* CONTIKIMAC_CONF_WITH_BURST enables burst transmissions: the packets
+   that are queued for the same neighbor are sent back-to-back after a
+   single wake-up strobe, with FRAME_PENDING set on all but the last
+   one. Broadcast packets are never sent in bursts, as every neighbor
+   would otherwise have to stay awake. */
+#ifdef CONTIKIMAC_CONF_WITH_BURST
+#define WITH_BURST                          CONTIKIMAC_CONF_WITH_BURST
+#else
+#define WITH_BURST                          1
+#endif
+
+#if WITH_BURST
+/* The receiver of the last acknowledged frame that had FRAME_PENDING
+   set, and when it was acknowledged. The receiver stays awake for
+   INTER_PACKET_DEADLINE after such a frame, so a burst that was cut
+   short can be resumed without a new wake-up strobe. */
+static linkaddr_t burst_receiver;
+static clock_time_t burst_time;
+static uint8_t burst_active;
+#endif /* WITH_BURST */
+
 /* ContikiMAC performs periodic channel checks. Each channel check
    consists of two or more CCA checks. CCA_COUNT_MAX is the number of
    CCAs to be done for each periodic channel check. The default is
@@ -870,9 +891,11 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
     queuebuf_to_packetbuf(curr->buf);
     if(!packetbuf_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED)) {
       /* create and secure this frame */
-      if(next != NULL) {
+#if WITH_BURST
+      if(next != NULL && !packetbuf_holds_broadcast()) {
         packetbuf_set_attr(PACKETBUF_ATTR_PENDING, 1);
       }
+#endif /* WITH_BURST */
 #if !NETSTACK_CONF_BRIDGE_MODE
       /* If NETSTACK_CONF_BRIDGE_MODE is set, assume PACKETBUF_ADDR_SENDER is already set. */
       packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
@@ -890,8 +913,18 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
     curr = next;
   } while(next != NULL);
 
-  /* The receiver needs to be awoken before we send */
+  /* The receiver needs to be awoken before we send, unless it is
+     still waiting for the rest of a burst that we started */
   is_receiver_awake = 0;
+#if WITH_BURST
+  if(burst_active &&
+     linkaddr_cmp(queuebuf_addr(buf_list->buf, PACKETBUF_ADDR_RECEIVER),
+                  &burst_receiver) &&
+     clock_time() - burst_time < INTER_PACKET_DEADLINE / 2) {
+    PRINTF("contikimac: resuming burst\n");
+    is_receiver_awake = 1;
+  }
+#endif /* WITH_BURST */
   curr = buf_list;
   do { /* A loop sending a burst of packets from buf_list */
     next = list_item_next(curr);
@@ -903,6 +936,17 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
 
     /* Send the current packet */
     ret = send_packet(sent, ptr, curr, is_receiver_awake);
+#if WITH_BURST
+    if(ret == MAC_TX_OK) {
+      /* Remember whether the receiver keeps its radio on for us. This
+         must be done before the callback, which may reuse packetbuf. */
+      burst_active = pending;
+      if(pending) {
+        linkaddr_copy(&burst_receiver, packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+        burst_time = clock_time();
+      }
+    }
+#endif /* WITH_BURST */
     if(ret != MAC_TX_DEFERRED) {
       mac_call_sent_callback(sent, ptr, ret, 1);
     }
@@ -965,8 +1009,13 @@ input_packet(void)
       /* This is a regular packet that is destined to us or to the
          broadcast address. */
 
-      /* If FRAME_PENDING is set, we are receiving a packets in a burst */
-      we_are_receiving_burst = packetbuf_attr(PACKETBUF_ATTR_PENDING);
+      /* If FRAME_PENDING is set, we are receiving a packets in a
+         burst. We stay awake until its last packet, which has
+         FRAME_PENDING cleared, or until INTER_PACKET_DEADLINE has
+         passed without a new packet. Bursts are only sent in unicast,
+         so a pending broadcast does not keep us awake. */
+      we_are_receiving_burst = packetbuf_attr(PACKETBUF_ATTR_PENDING) &&
+        !packetbuf_holds_broadcast();
       if(we_are_receiving_burst) {
         on();
         /* Set a timer to turn the radio off in case we do not receive
@@ -45,6 +45,7 @@
 
 /* c.f. IEEE 802.15.4e Table 4b */
 enum ieee802154e_header_ie_id {
+  HEADER_IE_VENDOR_SPECIFIC = 0x00,
   HEADER_IE_LE_CSL = 0x1a,
   HEADER_IE_LE_RIT,
   HEADER_IE_DSME_PAN_DESCRIPTOR,
@@ -148,6 +149,26 @@ frame80215e_create_ie_header_ack_nack_time_correction(uint8_t *buf, int len,
   }
 }
 
+/* Header IE. Vendor specific: an OUI followed by vendor-defined content */
+int
+frame80215e_create_ie_header_vendor_specific(uint8_t *buf, int len,
+    struct ieee802154_ies *ies)
+{
+  int ie_len;
+  if(ies != NULL && ies->ie_vendor_len <= FRAME802154E_IE_MAX_VENDOR_LEN) {
+    ie_len = 3 + ies->ie_vendor_len;
+    if(len >= 2 + ie_len) {
+      buf[2] = ies->ie_vendor_oui & 0xff;
+      buf[3] = (ies->ie_vendor_oui >> 8) & 0xff;
+      buf[4] = (ies->ie_vendor_oui >> 16) & 0xff;
+      memcpy(buf + 5, ies->ie_vendor_data, ies->ie_vendor_len);
+      create_header_ie_descriptor(buf, HEADER_IE_VENDOR_SPECIFIC, ie_len);
+      return 2 + ie_len;
+    }
+  }
+  return -1;
+}
+
 /* Header IE. List termination 1 (Signals the end of the Header IEs when
  * followed by payload IEs) */
 int
@@ -348,6 +369,16 @@ frame802154e_parse_header_ie(const uint8_t *buf, int len,
         return len;
       }
       break;
+    case HEADER_IE_VENDOR_SPECIFIC:
+      if(len >= 3 && len <= 3 + FRAME802154E_IE_MAX_VENDOR_LEN) {
+        if(ies != NULL) {
+          ies->ie_vendor_oui = buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16);
+          ies->ie_vendor_len = len - 3;
+          memcpy(ies->ie_vendor_data, buf + 3, len - 3);
+        }
+        return len;
+      }
+      break;
   }
   return -1;
 }
@@ -45,6 +45,8 @@
 #include "net/mac/tsch/tsch-private.h"
 
 #define FRAME802154E_IE_MAX_LINKS       4
+/* Maximum length of the content of a vendor specific IE, OUI excluded */
+#define FRAME802154E_IE_MAX_VENDOR_LEN  4
 
 /* Structures used for the Slotframe and Links information element */
 struct tsch_slotframe_and_links_link {
@@ -65,6 +67,9 @@ struct ieee802154_ies {
   /* Header IEs */
   int16_t ie_time_correction;
   uint8_t ie_is_nack;
+  uint32_t ie_vendor_oui;
+  uint8_t ie_vendor_len; /* 0 if no vendor specific IE is present */
+  uint8_t ie_vendor_data[FRAME802154E_IE_MAX_VENDOR_LEN];
   /* Payload MLME */
   uint8_t ie_payload_ie_offset;
   uint16_t ie_mlme_len;
@@ -86,6 +91,9 @@ struct ieee802154_ies {
 /* Header IE. ACK/NACK time correction. Used in enhanced ACKs */
 int frame80215e_create_ie_header_ack_nack_time_correction(uint8_t *buf, int len,
     struct ieee802154_ies *ies);
+/* Header IE. Vendor specific: an OUI followed by vendor-defined content */
+int frame80215e_create_ie_header_vendor_specific(uint8_t *buf, int len,
+    struct ieee802154_ies *ies);
 /* Header IE. List termination 1 (Signals the end of the Header IEs when
  * followed by payload IEs) */
 int frame80215e_create_ie_header_list_termination_1(uint8_t *buf, int len,
@@ -44,16 +44,26 @@
 #include "net/queuebuf.h"
 #include "net/nbr-table.h"
 
-#if PHASE_CONF_DRIFT_CORRECT
+#ifdef PHASE_CONF_DRIFT_CORRECT
 #define PHASE_DRIFT_CORRECT PHASE_CONF_DRIFT_CORRECT
 #else
 #define PHASE_DRIFT_CORRECT 0
 #endif
 
+/* Drift estimates are kept in 1/DRIFT_SCALE rtimer ticks per cycle. */
+#define DRIFT_SCALE           256
+
+/* The drift estimate is only updated from phases that are at least
+   this many cycles apart, since the error of each phase observation
+   is of the order of a strobe and would otherwise dominate. */
+#define DRIFT_MIN_CYCLES      8
+
 struct phase {
   rtimer_clock_t time;
 #if PHASE_DRIFT_CORRECT
-  rtimer_clock_t drift;
+  clock_time_t updated;
+  int16_t drift;
+  uint16_t jitter;
 #endif
   uint8_t noacks;
   struct timer noacks_timer;
@@ -77,6 +87,17 @@ struct phase_queueitem {
 MEMB(queued_packets_memb, struct phase_queueitem, PHASE_QUEUESIZE);
 NBR_TABLE(struct phase, nbr_phase);
 
+/* The entry that was looked up last. The MAC layer asks for the same
+   neighbor in phase_wait() and phase_update(), so this saves a search
+   of the neighbor table. */
+static struct phase *last_phase;
+
+#if PHASE_DRIFT_CORRECT
+/* The cycle time of the duty cycling protocol, as passed to
+   phase_wait(). */
+static rtimer_clock_t phase_cycle_time;
+#endif
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -87,6 +108,104 @@ NBR_TABLE(struct phase, nbr_phase);
 #define PRINTDEBUG(...)
 #endif
 /*---------------------------------------------------------------------------*/
+static struct phase *
+find_phase(const linkaddr_t *neighbor)
+{
+  if(last_phase == NULL ||
+     !linkaddr_cmp(nbr_table_get_lladdr(nbr_phase, last_phase), neighbor)) {
+    last_phase = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  }
+  return last_phase;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_phase(struct phase *e)
+{
+  if(e == last_phase) {
+    last_phase = NULL;
+  }
+  nbr_table_remove(nbr_phase, e);
+}
+/*---------------------------------------------------------------------------*/
+static void
+phase_evicted(void *item)
+{
+  if(item == last_phase) {
+    last_phase = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if PHASE_DRIFT_CORRECT
+/* The number of whole cycles since the phase was last observed. Long
+   intervals are measured with the clock, since the rtimer may have
+   wrapped around. */
+static uint32_t
+cycles_since_update(struct phase *e, rtimer_clock_t cycle_time)
+{
+  clock_time_t elapsed;
+
+  elapsed = clock_time() - e->updated;
+  if(cycle_time == 0 ||
+     elapsed > 0xffffffffUL / (RTIMER_ARCH_SECOND / CLOCK_SECOND)) {
+    return 0;
+  }
+  return ((uint32_t)elapsed * (RTIMER_ARCH_SECOND / CLOCK_SECOND) +
+          cycle_time / 2) / cycle_time;
+}
+/*---------------------------------------------------------------------------*/
+/* The phase predicted for the given number of cycles after the last
+   observation. */
+static rtimer_clock_t
+predicted_phase(struct phase *e, uint32_t cycles)
+{
+  return e->time + (rtimer_clock_t)((int32_t)e->drift * (int32_t)cycles /
+                                    DRIFT_SCALE);
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_drift(struct phase *e, rtimer_clock_t time)
+{
+  uint32_t cycles;
+  int32_t error;
+  int32_t sample;
+
+  cycles = cycles_since_update(e, phase_cycle_time);
+  if(cycles < DRIFT_MIN_CYCLES || cycles > 0x7fff) {
+    return;
+  }
+
+  /* The error of the prediction, folded into half a cycle on either
+     side of the predicted phase. */
+  error = (rtimer_clock_t)(time - predicted_phase(e, cycles)) %
+    phase_cycle_time;
+  if(error >= phase_cycle_time / 2) {
+    error -= phase_cycle_time;
+  }
+
+  if(error > (int32_t)phase_cycle_time / 4 ||
+     error < -(int32_t)phase_cycle_time / 4) {
+    /* The neighbor has most likely changed its phase, for example
+       after a reboot, so we start over. */
+    e->drift = 0;
+    e->jitter = 0;
+    return;
+  }
+
+  /* Move the estimate a quarter of the way towards the drift that
+     would have predicted this phase, and track the average size of
+     the correction to know how much the prediction can be trusted. */
+  sample = error * DRIFT_SCALE / (int32_t)cycles;
+  e->drift += (int16_t)(sample / 4);
+  if(sample < 0) {
+    sample = -sample;
+  }
+  e->jitter = (uint16_t)(((int32_t)e->jitter * 3 + MIN(sample, 0xffff)) / 4);
+
+  PRINTF("phase drift %d jitter %u after %lu cycles, error %ld\n",
+         e->drift, e->jitter, (unsigned long)cycles, (long)error);
+}
+#endif /* PHASE_DRIFT_CORRECT */
+/*---------------------------------------------------------------------------*/
 void
 phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
              int mac_status)
@@ -94,11 +213,12 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
   struct phase *e;
 
   /* If we have an entry for this neighbor already, we renew it. */
-  e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  e = find_phase(neighbor);
   if(e != NULL) {
     if(mac_status == MAC_TX_OK) {
 #if PHASE_DRIFT_CORRECT
-      e->drift = time-e->time;
+      update_drift(e, time);
+      e->updated = clock_time();
 #endif
       e->time = time;
     }
@@ -113,7 +233,7 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
       }
       if(e->noacks >= MAX_NOACKS || timer_expired(&e->noacks_timer)) {
         PRINTF("drop %d\n", neighbor->u8[0]);
-        nbr_table_remove(nbr_phase, e);
+        remove_phase(e);
         return;
       }
     } else if(mac_status == MAC_TX_OK) {
@@ -126,14 +246,28 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
       if(e) {
         e->time = time;
 #if PHASE_DRIFT_CORRECT
-      e->drift = 0;
+        e->updated = clock_time();
+        e->drift = 0;
+        e->jitter = 0;
 #endif
-      e->noacks = 0;
+        e->noacks = 0;
+        last_phase = e;
       }
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+phase_remove(const linkaddr_t *neighbor)
+{
+  struct phase *e;
+
+  e = find_phase(neighbor);
+  if(e != NULL) {
+    remove_phase(e);
+  }
+}
+/*---------------------------------------------------------------------------*/
 static void
 send_packet(void *ptr)
 {
@@ -162,7 +296,10 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
      phase for this particular neighbor. If so, we can compute the
      time for the next expected phase and setup a ctimer to switch on
      the radio just before the phase. */
-  e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+#if PHASE_DRIFT_CORRECT
+  phase_cycle_time = cycle_time;
+#endif
+  e = find_phase(neighbor);
   if(e != NULL) {
     rtimer_clock_t wait, now, expected, sync;
     clock_time_t ctimewait;
@@ -174,24 +311,23 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
        on the radio within the CYCLE_TIME period, we compute the
        waiting time with modulo CYCLE_TIME. */
     
-    /*      printf("neighbor phase 0x%02x (cycle 0x%02x)\n", e->time & (cycle_time - 1),
-            cycle_time);*/
-
-    /*      if(e->noacks > 0) {
-            printf("additional wait %d\n", additional_wait);
-            }*/
-    
     now = RTIMER_NOW();
 
-    sync = (e == NULL) ? now : e->time;
+    sync = e->time;
 
 #if PHASE_DRIFT_CORRECT
     {
-      int32_t s;
-      if(e->drift > cycle_time) {
-        s = e->drift % cycle_time / (e->drift / cycle_time);  /* drift per cycle */
-        s = s * (now - sync) / cycle_time;                    /* estimated drift to now */
-        sync += s;                                            /* add it in */
+      uint32_t cycles;
+      uint32_t uncertainty;
+
+      /* Move the phase by the drift that has accumulated since it
+         was observed, and wake up earlier by as much as the
+         prediction may be off. */
+      cycles = cycles_since_update(e, cycle_time);
+      if(cycles > 0 && cycles <= 0x7fff) {
+        sync = predicted_phase(e, cycles);
+        uncertainty = (uint32_t)e->jitter * cycles / DRIFT_SCALE;
+        guard_time += MIN(uncertainty, cycle_time / 8);
       }
     }
 #endif
@@ -247,6 +383,6 @@ void
 phase_init(void)
 {
   memb_init(&queued_packets_memb);
-  nbr_table_register(nbr_phase, NULL);
+  nbr_table_register(nbr_phase, phase_evicted);
 }
 /*---------------------------------------------------------------------------*/
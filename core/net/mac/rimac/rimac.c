@@ -0,0 +1,764 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A receiver-initiated radio duty cycling protocol, after
+ *         RI-MAC (Y. Sun, O. Gurewitz, D. B. Johnson. RI-MAC: A
+ *         Receiver-Initiated Asynchronous Duty Cycle MAC Protocol for
+ *         Dynamic Traffic Loads in Wireless Sensor Networks, SenSys
+ *         2008)
+ *
+ * Every node periodically turns its radio on and broadcasts a short
+ * probe, then listens for a short while. A node that has a unicast
+ * packet to send keeps its radio on until it hears a probe from the
+ * receiver, and sends the packet right after the probe. The receiver
+ * answers every packet it gets with a new probe, which invites the
+ * next packet of the sender or of another node that waits for it.
+ * Compared to sender-initiated protocols, no channel time is spent on
+ * strobes, which matters in dense or deep networks where most nodes
+ * forward traffic.
+ *
+ * Nodes that receive traffic probe more often: the probe interval is
+ * halved every cycle in which a packet was received, down to
+ * MIN_PROBE_INTERVAL, and grows back linearly to MAX_PROBE_INTERVAL
+ * when the traffic stops. Probes carry the current interval, so that
+ * a sender can predict the next probe of a neighbor and keep its
+ * radio off until shortly before it.
+ *
+ * Broadcast packets cannot wait for the probes of all neighbors, so
+ * they are sent sender-initiated: the packet is repeated back-to-back
+ * for a full MAX_PROBE_INTERVAL, so that every neighbor receives it
+ * during the listen period that follows its probe.
+ */
+
+#include "contiki-conf.h"
+#include "dev/radio.h"
+#include "dev/watchdog.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+#include "lib/random.h"
+#include "net/mac/frame802154.h"
+#include "net/mac/mac-sequence.h"
+#include "net/mac/rimac/rimac.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "sys/cc.h"
+#include "sys/ctimer.h"
+#include "sys/pt.h"
+#include "sys/rtimer.h"
+
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* The longest interval between two probes, used when there is no
+   traffic. */
+#ifdef RIMAC_CONF_MAX_PROBE_INTERVAL
+#define MAX_PROBE_INTERVAL RIMAC_CONF_MAX_PROBE_INTERVAL
+#else
+#define MAX_PROBE_INTERVAL (CLOCK_SECOND / NETSTACK_RDC_CHANNEL_CHECK_RATE)
+#endif
+
+/* The shortest interval between two probes, used under heavy
+   traffic. */
+#ifdef RIMAC_CONF_MIN_PROBE_INTERVAL
+#define MIN_PROBE_INTERVAL RIMAC_CONF_MIN_PROBE_INTERVAL
+#else
+#define MIN_PROBE_INTERVAL (MAX_PROBE_INTERVAL / 4)
+#endif
+
+/* How long a node listens after each of its probes. */
+#ifdef RIMAC_CONF_LISTEN_TIME
+#define LISTEN_TIME RIMAC_CONF_LISTEN_TIME
+#else
+#define LISTEN_TIME (CLOCK_SECOND / 64)
+#endif
+
+/* The number of unicast packets that may wait for a probe. */
+#ifdef RIMAC_CONF_MAX_QUEUED_PACKETS
+#define MAX_QUEUED_PACKETS RIMAC_CONF_MAX_QUEUED_PACKETS
+#else
+#define MAX_QUEUED_PACKETS 4
+#endif
+
+/* The number of neighbors whose probe schedule is remembered. */
+#ifdef RIMAC_CONF_MAX_ENCOUNTERS
+#define MAX_ENCOUNTERS RIMAC_CONF_MAX_ENCOUNTERS
+#else
+#define MAX_ENCOUNTERS 4
+#endif
+
+/* With a low CLOCK_SECOND, make sure that the listen period is at
+   least two clock ticks and that there is time to sleep between two
+   probes. */
+#if LISTEN_TIME < 2
+#undef LISTEN_TIME
+#define LISTEN_TIME 2
+#endif
+
+#if MIN_PROBE_INTERVAL < 2 * LISTEN_TIME
+#undef MIN_PROBE_INTERVAL
+#define MIN_PROBE_INTERVAL (2 * LISTEN_TIME)
+#endif
+
+/* A sender turns its radio on GUARD_TIME before the predicted probe
+   of the receiver. */
+#define GUARD_TIME (LISTEN_TIME + MIN_PROBE_INTERVAL / 4)
+
+/* A unicast packet that did not meet a probe from its receiver
+   within UNICAST_TIMEOUT is reported as not acknowledged. */
+#define UNICAST_TIMEOUT (3 * MAX_PROBE_INTERVAL)
+
+/* The probe schedule of a neighbor is not trusted after
+   ENCOUNTER_LIFETIME, as the neighbor may have adapted its interval
+   in the meantime. */
+#define ENCOUNTER_LIFETIME (8 * MAX_PROBE_INTERVAL)
+
+/* Broadcast packets are repeated for BROADCAST_STROBE_TIME, which
+   covers the listen period of every neighbor. */
+#define BROADCAST_STROBE_TIME \
+  ((rtimer_clock_t)((unsigned long)RTIMER_ARCH_SECOND *             \
+                    (MAX_PROBE_INTERVAL + LISTEN_TIME) / CLOCK_SECOND))
+
+/* Senders that answer the same probe pick one of BACKOFF_SLOTS
+   backoff periods before checking the channel. */
+#define BACKOFF_SLOTS 4
+#define BACKOFF_PERIOD (RTIMER_ARCH_SECOND / 3125)
+
+/* The time to wait for an ACK after a transmission, and the time to
+   wait for the rest of an ACK whose start has been detected. */
+#define INTER_PACKET_INTERVAL (RTIMER_ARCH_SECOND / 2500)
+#define AFTER_ACK_DETECTED_WAIT_TIME (RTIMER_ARCH_SECOND / 1500)
+#define ACK_LEN 3
+
+#define TYPE_PROBE 1
+#define TYPE_DATA  2
+
+/* A probe consists of its type and the current probe interval of its
+   sender, in milliseconds, low byte first. Data packets only carry
+   their type. */
+#define PROBE_LEN 3
+#define DATA_HDR_LEN 1
+
+struct queue_item {
+  struct queue_item *next;
+  struct queuebuf *packet;
+  struct ctimer removal_timer;
+  struct ctimer wakeup_timer;
+  mac_callback_t sent_callback;
+  void *sent_callback_ptr;
+  uint8_t num_transmissions;
+  /* The radio is on and the packet waits for a probe */
+  uint8_t is_waiting;
+};
+
+LIST(queue);
+MEMB(queue_memb, struct queue_item, MAX_QUEUED_PACKETS);
+
+struct encounter {
+  struct encounter *next;
+  linkaddr_t neighbor;
+  /* When the last probe of the neighbor was heard */
+  clock_time_t time;
+  /* The probe interval that the neighbor announced */
+  clock_time_t interval;
+};
+
+LIST(encounter_list);
+MEMB(encounter_memb, struct encounter, MAX_ENCOUNTERS);
+
+static uint8_t rimac_is_on;
+static uint8_t rimac_keep_radio_on;
+
+static struct pt dutycycle_pt;
+static struct ctimer dutycycle_timer;
+
+static clock_time_t probe_interval = MAX_PROBE_INTERVAL;
+static clock_time_t probe_backoff;
+/* Are we in the listen period that follows our probe? */
+static uint8_t is_listening;
+/* Has a packet been received during the current listen period? */
+static uint8_t listen_extended;
+/* The number of packets that were received during the current cycle */
+static uint8_t received;
+/* The number of queued packets that wait for a probe */
+static uint8_t num_waiting;
+
+/*---------------------------------------------------------------------------*/
+static void
+update_radio(void)
+{
+  if(is_listening || num_waiting > 0 ||
+     (!rimac_is_on && rimac_keep_radio_on)) {
+    NETSTACK_RADIO.on();
+  } else if(!NETSTACK_RADIO.receiving_packet()) {
+    NETSTACK_RADIO.off();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct encounter *
+lookup_encounter(const linkaddr_t *neighbor)
+{
+  struct encounter *e;
+
+  for(e = list_head(encounter_list); e != NULL; e = list_item_next(e)) {
+    if(linkaddr_cmp(neighbor, &e->neighbor)) {
+      return e;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+register_encounter(const linkaddr_t *neighbor, clock_time_t interval)
+{
+  struct encounter *e;
+
+  e = lookup_encounter(neighbor);
+  if(e == NULL) {
+    e = memb_alloc(&encounter_memb);
+    if(e == NULL) {
+      /* Replace the least recently heard neighbor, which is at the
+         end of the list */
+      e = list_chop(encounter_list);
+    }
+    linkaddr_copy(&e->neighbor, neighbor);
+  } else {
+    list_remove(encounter_list, e);
+  }
+  e->time = clock_time();
+  e->interval = interval;
+  list_push(encounter_list, e);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_probe(void)
+{
+  uint8_t *probe;
+  uint16_t interval_ms;
+
+  packetbuf_clear();
+  probe = packetbuf_dataptr();
+  interval_ms = (uint32_t)probe_interval * 1000 / CLOCK_SECOND;
+  probe[0] = TYPE_PROBE;
+  probe[1] = interval_ms & 0xff;
+  probe[2] = interval_ms >> 8;
+  packetbuf_set_datalen(PROBE_LEN);
+
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_DATAFRAME);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_null);
+  if(NETSTACK_FRAMER.create() < 0) {
+    PRINTF("rimac: failed to create probe\n");
+    return;
+  }
+
+  if(NETSTACK_RADIO.channel_clear()) {
+    NETSTACK_RADIO.send(packetbuf_hdrptr(), packetbuf_totlen());
+  } else {
+    /* Someone else is using the channel. Our probe schedule may
+       collide with another node's, so we move it a little. */
+    probe_backoff = random_rand() % (MIN_PROBE_INTERVAL / 2 + 1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+adapt_probe_interval(void)
+{
+  if(received > 0) {
+    probe_interval = MAX(probe_interval / 2, MIN_PROBE_INTERVAL);
+  } else if(probe_interval < MAX_PROBE_INTERVAL) {
+    probe_interval = MIN(probe_interval + MIN_PROBE_INTERVAL,
+                         MAX_PROBE_INTERVAL);
+  }
+  received = 0;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Probe, listen and sleep. This function is called repeatedly by a
+ * ctimer. The cycles start every probe_interval, also when the listen
+ * period has been extended by incoming packets.
+ */
+static int
+dutycycle(void *ptr)
+{
+  struct ctimer *t = ptr;
+  static clock_time_t cycle_start;
+  clock_time_t elapsed;
+
+  PT_BEGIN(&dutycycle_pt);
+
+  while(1) {
+    cycle_start = clock_time();
+
+    if(rimac_is_on) {
+      /* The interval that we announce in the probe is the one that
+         we use until the next probe */
+      adapt_probe_interval();
+
+      is_listening = 1;
+      update_radio();
+      send_probe();
+
+      do {
+        listen_extended = 0;
+        ctimer_set(t, LISTEN_TIME, (void (*)(void *))dutycycle, t);
+        PT_YIELD(&dutycycle_pt);
+      } while(listen_extended && rimac_is_on);
+
+      is_listening = 0;
+      update_radio();
+    }
+
+    elapsed = clock_time() - cycle_start;
+    ctimer_set(t, (elapsed < probe_interval ? probe_interval - elapsed : 1) +
+               probe_backoff, (void (*)(void *))dutycycle, t);
+    probe_backoff = 0;
+    PT_YIELD(&dutycycle_pt);
+  }
+
+  PT_END(&dutycycle_pt);
+}
+/*---------------------------------------------------------------------------*/
+static void
+restart_dutycycle(clock_time_t initial_wait)
+{
+  PT_INIT(&dutycycle_pt);
+  ctimer_set(&dutycycle_timer, initial_wait,
+             (void (*)(void *))dutycycle, &dutycycle_timer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_queued_packet(struct queue_item *i, int status)
+{
+  mac_callback_t sent;
+  void *ptr;
+  int num_transmissions;
+
+  ctimer_stop(&i->removal_timer);
+  ctimer_stop(&i->wakeup_timer);
+  if(i->is_waiting) {
+    num_waiting--;
+  }
+  list_remove(queue, i);
+
+  /* Restore the packet for the callback, which identifies the packet
+     by its attributes */
+  queuebuf_to_packetbuf(i->packet);
+  queuebuf_free(i->packet);
+
+  sent = i->sent_callback;
+  ptr = i->sent_callback_ptr;
+  /* A packet that timed out without having been sent still counts as
+     one transmission, so that the MAC layer gives up eventually */
+  num_transmissions = MAX(i->num_transmissions, 1);
+  memb_free(&queue_memb, i);
+
+  update_radio();
+  mac_call_sent_callback(sent, ptr, status, num_transmissions);
+}
+/*---------------------------------------------------------------------------*/
+static void
+packet_timedout(void *ptr)
+{
+  struct queue_item *i = ptr;
+
+  PRINTF("rimac: no probe from %u\n",
+         queuebuf_addr(i->packet, PACKETBUF_ADDR_RECEIVER)->u8[0]);
+  remove_queued_packet(i, MAC_TX_NOACK);
+}
+/*---------------------------------------------------------------------------*/
+static void
+wait_for_probe(void *ptr)
+{
+  struct queue_item *i = ptr;
+
+  if(!i->is_waiting) {
+    i->is_waiting = 1;
+    num_waiting++;
+    update_radio();
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Transmit a queued packet to a receiver that is known to be awake,
+ * and wait for its ACK.
+ */
+static int
+transmit(struct queue_item *i)
+{
+  rtimer_clock_t wt;
+  int ret;
+#if !RDC_CONF_HARDWARE_ACK
+  uint8_t seqno;
+  uint8_t ackbuf[ACK_LEN];
+  int len;
+#endif
+
+  NETSTACK_RADIO.on();
+
+  /* Other nodes may answer the same probe */
+  wt = RTIMER_NOW() + (random_rand() % BACKOFF_SLOTS) * BACKOFF_PERIOD;
+  while(RTIMER_CLOCK_LT(RTIMER_NOW(), wt)) { }
+  if(!NETSTACK_RADIO.channel_clear() || NETSTACK_RADIO.receiving_packet()) {
+    return MAC_TX_COLLISION;
+  }
+
+  i->num_transmissions++;
+#if RDC_CONF_HARDWARE_ACK
+  ret = NETSTACK_RADIO.send(queuebuf_dataptr(i->packet),
+                            queuebuf_datalen(i->packet));
+  if(ret == RADIO_TX_OK) {
+    ret = MAC_TX_OK;
+  } else if(ret == RADIO_TX_COLLISION) {
+    ret = MAC_TX_COLLISION;
+  } else {
+    ret = MAC_TX_NOACK;
+  }
+#else /* RDC_CONF_HARDWARE_ACK */
+  seqno = queuebuf_attr(i->packet, PACKETBUF_ATTR_MAC_SEQNO);
+  NETSTACK_RADIO.send(queuebuf_dataptr(i->packet),
+                      queuebuf_datalen(i->packet));
+
+  ret = MAC_TX_NOACK;
+  wt = RTIMER_NOW();
+  while(RTIMER_CLOCK_LT(RTIMER_NOW(), wt + INTER_PACKET_INTERVAL)) { }
+  if(NETSTACK_RADIO.receiving_packet() ||
+     NETSTACK_RADIO.pending_packet() ||
+     NETSTACK_RADIO.channel_clear() == 0) {
+    wt = RTIMER_NOW();
+    while(RTIMER_CLOCK_LT(RTIMER_NOW(), wt + AFTER_ACK_DETECTED_WAIT_TIME)) { }
+
+    len = NETSTACK_RADIO.read(ackbuf, ACK_LEN);
+    if(len == ACK_LEN && ackbuf[ACK_LEN - 1] == seqno) {
+      ret = MAC_TX_OK;
+    } else {
+      ret = MAC_TX_COLLISION;
+    }
+  }
+#endif /* RDC_CONF_HARDWARE_ACK */
+
+  PRINTF("rimac: sent to %u, status %d\n",
+         queuebuf_addr(i->packet, PACKETBUF_ADDR_RECEIVER)->u8[0], ret);
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Send the first packet that waits for a probe from the neighbor. The
+ * neighbor sends a new probe when it gets the packet, so the next
+ * packet is sent then.
+ */
+static void
+probe_received(const linkaddr_t *neighbor)
+{
+  struct queue_item *i;
+  int ret;
+
+  for(i = list_head(queue); i != NULL; i = list_item_next(i)) {
+    if(linkaddr_cmp(queuebuf_addr(i->packet, PACKETBUF_ADDR_RECEIVER),
+                    neighbor)) {
+      break;
+    }
+  }
+  if(i == NULL) {
+    return;
+  }
+
+  ret = transmit(i);
+  if(ret == MAC_TX_COLLISION) {
+    /* Try again at the next probe */
+    wait_for_probe(i);
+  } else {
+    remove_queued_packet(i, ret);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Queue a unicast packet until the receiver probes. If we know the
+ * probe schedule of the receiver, the radio is kept off until shortly
+ * before its next probe.
+ */
+static void
+queue_packet(mac_callback_t sent, void *ptr)
+{
+  struct queue_item *i;
+  struct encounter *e;
+  clock_time_t elapsed;
+  clock_time_t wait;
+
+  i = memb_alloc(&queue_memb);
+  if(i == NULL) {
+    PRINTF("rimac: queue full\n");
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
+    return;
+  }
+  i->packet = queuebuf_new_from_packetbuf();
+  if(i->packet == NULL) {
+    memb_free(&queue_memb, i);
+    PRINTF("rimac: could not allocate queuebuf\n");
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
+    return;
+  }
+  i->sent_callback = sent;
+  i->sent_callback_ptr = ptr;
+  i->num_transmissions = 0;
+  i->is_waiting = 0;
+  list_add(queue, i);
+  ctimer_set(&i->removal_timer, UNICAST_TIMEOUT, packet_timedout, i);
+
+  e = lookup_encounter(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  if(e != NULL && e->interval > 0) {
+    elapsed = clock_time() - e->time;
+    if(elapsed < LISTEN_TIME / 2) {
+      /* The receiver has just probed and is still listening */
+      probe_received(&e->neighbor);
+      return;
+    }
+    if(elapsed < ENCOUNTER_LIFETIME) {
+      wait = e->interval - elapsed % e->interval;
+      if(wait > GUARD_TIME) {
+        ctimer_set(&i->wakeup_timer, wait - GUARD_TIME, wait_for_probe, i);
+        return;
+      }
+    }
+  }
+  wait_for_probe(i);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Send a broadcast packet by repeating it for a full probe interval.
+ */
+static int
+send_broadcast(void)
+{
+  rtimer_clock_t t0;
+  rtimer_clock_t wt;
+  int transmit_len;
+
+  transmit_len = packetbuf_totlen();
+  NETSTACK_RADIO.prepare(packetbuf_hdrptr(), transmit_len);
+
+  NETSTACK_RADIO.on();
+  if(!NETSTACK_RADIO.channel_clear() || NETSTACK_RADIO.receiving_packet()) {
+    update_radio();
+    return MAC_TX_COLLISION;
+  }
+
+  watchdog_periodic();
+  t0 = RTIMER_NOW();
+  while(RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + BROADCAST_STROBE_TIME)) {
+    watchdog_periodic();
+    NETSTACK_RADIO.transmit(transmit_len);
+    wt = RTIMER_NOW();
+    while(RTIMER_CLOCK_LT(RTIMER_NOW(), wt + INTER_PACKET_INTERVAL)) { }
+  }
+
+  update_radio();
+  return MAC_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_packet(mac_callback_t sent, void *ptr)
+{
+  int ret;
+
+  if(!rimac_is_on && !rimac_keep_radio_on) {
+    PRINTF("rimac: radio is turned off\n");
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+    return;
+  }
+
+  if(packetbuf_hdralloc(DATA_HDR_LEN) == 0) {
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+    return;
+  }
+  ((uint8_t *)packetbuf_hdrptr())[0] = TYPE_DATA;
+  packetbuf_compact();
+
+#if !NETSTACK_CONF_BRIDGE_MODE
+  /* If NETSTACK_CONF_BRIDGE_MODE is set, assume PACKETBUF_ADDR_SENDER is already set. */
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
+#endif
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
+  if(NETSTACK_FRAMER.create() < 0) {
+    PRINTF("rimac: framer failed\n");
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+    return;
+  }
+
+  if(packetbuf_holds_broadcast()) {
+    ret = send_broadcast();
+    mac_call_sent_callback(sent, ptr, ret, 1);
+  } else {
+    queue_packet(sent, ptr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
+{
+  if(buf_list != NULL) {
+    queuebuf_to_packetbuf(buf_list->buf);
+    send_packet(sent, ptr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_packet(void)
+{
+  uint8_t *hdr;
+  uint16_t interval_ms;
+  linkaddr_t sender;
+  uint8_t is_unicast;
+
+  if(packetbuf_datalen() == ACK_LEN) {
+    /* Ignore ack packets */
+    return;
+  }
+
+  if(NETSTACK_FRAMER.parse() < 0 || packetbuf_datalen() < DATA_HDR_LEN) {
+    PRINTF("rimac: failed to parse (%u)\n", packetbuf_totlen());
+    return;
+  }
+  hdr = packetbuf_dataptr();
+
+  if(hdr[0] == TYPE_PROBE) {
+    if(packetbuf_datalen() < PROBE_LEN) {
+      return;
+    }
+    interval_ms = hdr[1] | (hdr[2] << 8);
+    linkaddr_copy(&sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+    register_encounter(&sender,
+                       (clock_time_t)((uint32_t)interval_ms * CLOCK_SECOND / 1000));
+    probe_received(&sender);
+
+  } else if(hdr[0] == TYPE_DATA) {
+    packetbuf_hdrreduce(DATA_HDR_LEN);
+
+    is_unicast = !packetbuf_holds_broadcast();
+    if(!is_unicast) {
+      /* The sender repeats the packet, so we can go back to sleep */
+      if(is_listening) {
+        is_listening = 0;
+        update_radio();
+      }
+    } else if(linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                           &linkaddr_node_addr)) {
+      /* Keep listening for more packets */
+      received++;
+      if(is_listening) {
+        listen_extended = 1;
+      }
+    } else {
+      /* Not for us */
+      return;
+    }
+
+#if RDC_WITH_DUPLICATE_DETECTION
+    if(mac_sequence_is_duplicate()) {
+      PRINTF("rimac: drop duplicate\n");
+    } else {
+      mac_sequence_register_seqno();
+      NETSTACK_MAC.input();
+    }
+#else /* RDC_WITH_DUPLICATE_DETECTION */
+    NETSTACK_MAC.input();
+#endif /* RDC_WITH_DUPLICATE_DETECTION */
+
+    if(is_unicast && rimac_is_on) {
+      /* The new probe invites the sender to send its next packet */
+      send_probe();
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  if(rimac_is_on == 0) {
+    rimac_is_on = 1;
+    rimac_keep_radio_on = 0;
+    restart_dutycycle(random_rand() % MAX_PROBE_INTERVAL);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(int keep_radio_on)
+{
+  rimac_is_on = 0;
+  rimac_keep_radio_on = keep_radio_on;
+  is_listening = 0;
+  if(keep_radio_on) {
+    return NETSTACK_RADIO.on();
+  }
+  update_radio();
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+channel_check_interval(void)
+{
+  return probe_interval;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  memb_init(&queue_memb);
+  list_init(queue);
+  memb_init(&encounter_memb);
+  list_init(encounter_list);
+
+  rimac_is_on = 1;
+  restart_dutycycle(random_rand() % MAX_PROBE_INTERVAL);
+}
+/*---------------------------------------------------------------------------*/
+const struct rdc_driver rimac_driver = {
+  "RI-MAC",
+  init,
+  send_packet,
+  send_list,
+  input_packet,
+  on,
+  off,
+  channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
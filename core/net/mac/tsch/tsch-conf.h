@@ -177,6 +177,32 @@
 #define TSCH_ADAPTIVE_TIMESYNC 1
 #endif
 
+/* Maximum number of consecutive timeslots used to send packets to the same
+ * neighbor. When a node has more packets queued for the neighbor it is
+ * transmitting to, it sets the frame pending bit, and both nodes stay on the
+ * same link in the next timeslot, regardless of the schedule. 0 disables
+ * bursts. All nodes of a network must use the same setting. */
+#ifdef TSCH_CONF_BURST_MAX_LEN
+#define TSCH_BURST_MAX_LEN TSCH_CONF_BURST_MAX_LEN
+#else /* TSCH_CONF_BURST_MAX_LEN */
+#define TSCH_BURST_MAX_LEN 0
+#endif /* TSCH_CONF_BURST_MAX_LEN */
+
+/* Set the frame pending bit of unicast frames when more packets are queued
+ * for the same neighbor? Needed by bursts, and by the enhanced ACK IE
+ * callbacks of Orchestra's unicast_adaptive rule, which turn it on. */
+#ifdef TSCH_CONF_WITH_FRAME_PENDING
+#define TSCH_WITH_FRAME_PENDING TSCH_CONF_WITH_FRAME_PENDING
+#elif TSCH_BURST_MAX_LEN > 0 || defined(TSCH_CALLBACK_EACK_IE_CREATE)
+#define TSCH_WITH_FRAME_PENDING 1
+#else
+#define TSCH_WITH_FRAME_PENDING 0
+#endif /* TSCH_CONF_WITH_FRAME_PENDING */
+
+#if TSCH_BURST_MAX_LEN > 0 && !TSCH_WITH_FRAME_PENDING
+#error TSCH_CONF_BURST_MAX_LEN requires TSCH_CONF_WITH_FRAME_PENDING
+#endif
+
 /* HW frame filtering enabled */
 #ifdef TSCH_CONF_HW_FRAME_FILTERING
 #define TSCH_HW_FRAME_FILTERING TSCH_CONF_HW_FRAME_FILTERING
@@ -76,14 +76,18 @@ void
 tsch_log_process_pending(void)
 {
   static int last_log_dropped = 0;
-  int16_t log_index;
-  /* Loop on accessing (without removing) a pending input packet */
+  int first;
+  int count;
+  int i;
   if(log_dropped != last_log_dropped) {
     printf("TSCH:! logs dropped %u\n", log_dropped);
     last_log_dropped = log_dropped;
   }
-  while((log_index = ringbufindex_peek_get(&log_ringbuf)) != -1) {
-    struct tsch_log_t *log = &log_array[log_index];
+  /* Print the logs that are pending when we start, and release them
+   * all at once */
+  count = ringbufindex_peek_get_batch(&log_ringbuf, &first);
+  for(i = 0; i < count; i++) {
+    struct tsch_log_t *log = &log_array[(first + i) & (TSCH_LOG_QUEUE_LEN - 1)];
     if(log->link == NULL) {
       printf("TSCH: {asn-%x.%lx link-NULL} ", log->asn.ms1b, log->asn.ls4b);
     } else {
@@ -119,9 +123,9 @@ tsch_log_process_pending(void)
         printf("%s\n", log->message);
         break;
     }
-    /* Remove input from ringbuf */
-    ringbufindex_get(&log_ringbuf);
   }
+  /* Remove the printed logs from ringbuf */
+  ringbufindex_get_batch(&log_ringbuf, count);
 }
 /*---------------------------------------------------------------------------*/
 /* Prepare addition of a new log.
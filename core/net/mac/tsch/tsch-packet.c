@@ -344,6 +344,18 @@ tsch_packet_update_eb(uint8_t *buf, int buf_size, uint8_t tsch_sync_ie_offset)
   return 1;
 }
 /*---------------------------------------------------------------------------*/
+/* Set or clear the frame pending bit of a frame, i.e., bit 4 of the first
+ * byte of the frame control field */
+void
+tsch_packet_set_frame_pending(uint8_t *buf, int set)
+{
+  if(set) {
+    buf[0] |= 1 << 4;
+  } else {
+    buf[0] &= ~(1 << 4);
+  }
+}
+/*---------------------------------------------------------------------------*/
 /* Parse a IEEE 802.15.4e TSCH Enhanced Beacon (EB) */
 int
 tsch_packet_parse_eb(const uint8_t *buf, int buf_size,
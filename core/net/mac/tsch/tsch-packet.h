@@ -101,5 +101,7 @@ int tsch_packet_update_eb(uint8_t *buf, int buf_size, uint8_t tsch_sync_ie_offse
 int tsch_packet_parse_eb(const uint8_t *buf, int buf_size,
     frame802154_t *frame, struct ieee802154_ies *ies,
     uint8_t *hdrlen, int frame_without_mic);
+/* Set or clear the frame pending bit of a frame */
+void tsch_packet_set_frame_pending(uint8_t *buf, int set);
 
 #endif /* __TSCH_PACKET_H__ */
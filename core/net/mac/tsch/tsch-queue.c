@@ -68,11 +68,39 @@
 #error TSCH_QUEUE_NUM_PER_NEIGHBOR must be power of two
 #endif
 
+/* Size of the ringbuf used to signal ready neighbors to the slot operation.
+ * Every neighbor has at most one pending signal at a time, so the ringbuf
+ * holds one more element than there are neighbors (power of two) */
+#if TSCH_QUEUE_MAX_NEIGHBOR_QUEUES < 8
+#define TSCH_QUEUE_READY_RINGBUF_SIZE 8
+#elif TSCH_QUEUE_MAX_NEIGHBOR_QUEUES < 16
+#define TSCH_QUEUE_READY_RINGBUF_SIZE 16
+#elif TSCH_QUEUE_MAX_NEIGHBOR_QUEUES < 32
+#define TSCH_QUEUE_READY_RINGBUF_SIZE 32
+#elif TSCH_QUEUE_MAX_NEIGHBOR_QUEUES < 64
+#define TSCH_QUEUE_READY_RINGBUF_SIZE 64
+#elif TSCH_QUEUE_MAX_NEIGHBOR_QUEUES < 128
+#define TSCH_QUEUE_READY_RINGBUF_SIZE 128
+#else
+#error TSCH_QUEUE_MAX_NEIGHBOR_QUEUES must be lower than 128
+#endif
+
 /* We have as many packets are there are queuebuf in the system */
 MEMB(packet_memb, struct tsch_packet, QUEUEBUF_NUM);
 MEMB(neighbor_memb, struct tsch_neighbor, TSCH_QUEUE_MAX_NEIGHBOR_QUEUES);
 LIST(neighbor_list);
 
+/* Unicast neighbors with pending packets, served in a round-robin
+ * fashion over shared links. The ready list is owned by the slot
+ * operation. Neighbors are signaled to it by tsch_queue_add_packet
+ * through the ready ringbuf (lockfree, single producer). */
+static struct tsch_neighbor *ready_array[TSCH_QUEUE_MAX_NEIGHBOR_QUEUES];
+static uint8_t ready_count;
+/* Position in the ready list of the next neighbor to be served */
+static uint8_t ready_next;
+static struct tsch_neighbor *ready_ringbuf_array[TSCH_QUEUE_READY_RINGBUF_SIZE];
+static struct ringbufindex ready_ringbuf;
+
 /* Broadcast and EB virtual neighbors */
 struct tsch_neighbor *n_broadcast;
 struct tsch_neighbor *n_eb;
@@ -187,6 +215,56 @@ tsch_queue_update_time_source(const linkaddr_t *new_addr)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/* Signal to the slot operation that a neighbor has pending packets.
+ * Called outside of slot operation. The flags are checked after the
+ * packet was put, so that a neighbor removed from the ready list by
+ * the slot operation because its queue was empty gets signaled again */
+static void
+tsch_queue_ready_signal(struct tsch_neighbor *n)
+{
+  int16_t put_index;
+  if(!n->is_ready && !n->ready_signaled) {
+    put_index = ringbufindex_peek_put(&ready_ringbuf);
+    if(put_index != -1) {
+      n->ready_signaled = 1;
+      ready_ringbuf_array[put_index] = n;
+      ringbufindex_put(&ready_ringbuf);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a neighbor from the ready list at a given position */
+static void
+tsch_queue_ready_remove(uint8_t pos)
+{
+  ready_array[pos]->is_ready = 0;
+  ready_count--;
+  memmove(&ready_array[pos], &ready_array[pos + 1],
+          (ready_count - pos) * sizeof(struct tsch_neighbor *));
+  if(ready_next > pos) {
+    ready_next--;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Remove all references to a neighbor that is about to be deallocated.
+ * To be called with the lock held */
+static void
+tsch_queue_ready_forget(struct tsch_neighbor *n)
+{
+  uint8_t i;
+  for(i = 0; i < ready_count; i++) {
+    if(ready_array[i] == n) {
+      tsch_queue_ready_remove(i);
+      break;
+    }
+  }
+  for(i = 0; i < TSCH_QUEUE_READY_RINGBUF_SIZE; i++) {
+    if(ready_ringbuf_array[i] == n) {
+      ready_ringbuf_array[i] = NULL;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 /* Flush a neighbor queue */
 static void
 tsch_queue_flush_nbr_queue(struct tsch_neighbor *n)
@@ -215,6 +293,8 @@ tsch_queue_remove_nbr(struct tsch_neighbor *n)
 
       /* Remove neighbor from list */
       list_remove(neighbor_list, n);
+      /* And from the ready list, which is safe as we hold the lock */
+      tsch_queue_ready_forget(n);
 
       tsch_release_lock();
 
@@ -254,6 +334,9 @@ tsch_queue_add_packet(const linkaddr_t *addr, mac_callback_t sent, void *ptr)
             /* Add to ringbuf (actual add committed through atomic operation) */
             n->tx_array[put_index] = p;
             ringbufindex_put(&n->tx_ringbuf);
+            if(!n->is_broadcast) {
+              tsch_queue_ready_signal(n);
+            }
             PRINTF("TSCH-queue: packet is added put_index=%u, packet=%p\n",
                    put_index, p);
             return p;
@@ -282,6 +365,16 @@ tsch_queue_packet_count(const linkaddr_t *addr)
   return -1;
 }
 /*---------------------------------------------------------------------------*/
+/* Returns the number of packets currently in a neighbor queue */
+int
+tsch_queue_nbr_packet_count(const struct tsch_neighbor *n)
+{
+  if(!tsch_is_locked() && n != NULL) {
+    return ringbufindex_elements(&n->tx_ringbuf);
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
 /* Remove first packet from a neighbor queue */
 struct tsch_packet *
 tsch_queue_remove_packet_from_queue(struct tsch_neighbor *n)
@@ -395,25 +488,60 @@ tsch_queue_get_packet_for_dest_addr(const linkaddr_t *addr, struct tsch_link *li
 }
 /*---------------------------------------------------------------------------*/
 /* Returns the head packet of any neighbor queue with zero backoff counter.
- * Writes pointer to the neighbor in *n */
+ * Neighbors with pending packets are served in a round-robin fashion.
+ * Writes pointer to the neighbor in *n. To be called from slot operation only. */
 struct tsch_packet *
 tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link *link)
 {
   if(!tsch_is_locked()) {
-    struct tsch_neighbor *curr_nbr = list_head(neighbor_list);
+    struct tsch_neighbor *curr_nbr;
     struct tsch_packet *p = NULL;
-    while(curr_nbr != NULL) {
-      if(!curr_nbr->is_broadcast && curr_nbr->tx_links_count == 0) {
-        /* Only look up for non-broadcast neighbors we do not have a tx link to */
+    int first;
+    int count;
+    int i;
+    uint8_t checked;
+    uint8_t pos;
+
+    /* Move newly signaled neighbors to the ready list */
+    count = ringbufindex_peek_get_batch(&ready_ringbuf, &first);
+    for(i = 0; i < count; i++) {
+      curr_nbr = ready_ringbuf_array[(first + i) & (TSCH_QUEUE_READY_RINGBUF_SIZE - 1)];
+      if(curr_nbr != NULL) {
+        curr_nbr->ready_signaled = 0;
+        if(!curr_nbr->is_ready && ready_count < TSCH_QUEUE_MAX_NEIGHBOR_QUEUES) {
+          curr_nbr->is_ready = 1;
+          ready_array[ready_count++] = curr_nbr;
+        }
+      }
+    }
+    ringbufindex_get_batch(&ready_ringbuf, count);
+
+    /* Visit the ready neighbors, starting after the last one served */
+    checked = 0;
+    pos = ready_next;
+    while(checked < ready_count) {
+      if(pos >= ready_count) {
+        pos = 0;
+      }
+      curr_nbr = ready_array[pos];
+      if(tsch_queue_is_empty(curr_nbr)) {
+        /* Not ready anymore, the next neighbor takes its position */
+        tsch_queue_ready_remove(pos);
+        continue;
+      }
+      if(curr_nbr->tx_links_count == 0) {
+        /* Only look up for neighbors we do not have a tx link to */
         p = tsch_queue_get_packet_for_nbr(curr_nbr, link);
         if(p != NULL) {
+          ready_next = pos + 1;
           if(n != NULL) {
             *n = curr_nbr;
           }
           return p;
         }
       }
-      curr_nbr = list_item_next(curr_nbr);
+      pos++;
+      checked++;
     }
   }
   return NULL;
@@ -474,6 +602,9 @@ tsch_queue_init(void)
   list_init(neighbor_list);
   memb_init(&neighbor_memb);
   memb_init(&packet_memb);
+  ready_count = 0;
+  ready_next = 0;
+  ringbufindex_init(&ready_ringbuf, TSCH_QUEUE_READY_RINGBUF_SIZE);
   /* Add virtual EB and the broadcast neighbors */
   n_eb = tsch_queue_add_nbr(&tsch_eb_address);
   n_broadcast = tsch_queue_add_nbr(&tsch_broadcast_address);
@@ -135,6 +135,8 @@ struct tsch_neighbor {
   uint8_t last_backoff_window; /* Last CSMA backoff window */
   uint8_t tx_links_count; /* How many links do we have to this neighbor? */
   uint8_t dedicated_tx_links_count; /* How many dedicated links do we have to this neighbor? */
+  uint8_t is_ready; /* is this neighbor in the ready list of the slot operation? */
+  uint8_t ready_signaled; /* has this neighbor been signaled to the slot operation as ready? */
   /* Array for the ringbuf. Contains pointers to packets.
    * Its size must be a power of two to allow for atomic put */
   struct tsch_packet *tx_array[TSCH_QUEUE_NUM_PER_NEIGHBOR];
@@ -162,6 +164,8 @@ int tsch_queue_update_time_source(const linkaddr_t *new_addr);
 struct tsch_packet *tsch_queue_add_packet(const linkaddr_t *addr, mac_callback_t sent, void *ptr);
 /* Returns the number of packets currently a given neighbor queue */
 int tsch_queue_packet_count(const linkaddr_t *addr);
+/* Returns the number of packets currently in a neighbor queue */
+int tsch_queue_nbr_packet_count(const struct tsch_neighbor *n);
 /* Remove first packet from a neighbor queue. The packet is stored in a separate
  * dequeued packet list, for later processing. Return the packet. */
 struct tsch_packet *tsch_queue_remove_packet_from_queue(struct tsch_neighbor *n);
@@ -178,7 +182,8 @@ struct tsch_packet *tsch_queue_get_packet_for_nbr(const struct tsch_neighbor *n,
 /* Returns the head packet from a neighbor queue (from neighbor address) */
 struct tsch_packet *tsch_queue_get_packet_for_dest_addr(const linkaddr_t *addr, struct tsch_link *link);
 /* Returns the head packet of any neighbor queue with zero backoff counter.
- * Writes pointer to the neighbor in *n */
+ * Neighbors with pending packets are served in a round-robin fashion.
+ * Writes pointer to the neighbor in *n. To be called from slot operation only. */
 struct tsch_packet *tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link *link);
 /* May the neighbor transmit over a share link? */
 int tsch_queue_backoff_expired(const struct tsch_neighbor *n);
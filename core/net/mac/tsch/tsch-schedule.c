@@ -68,6 +68,77 @@ MEMB(link_memb, struct tsch_link, TSCH_SCHEDULE_MAX_LINKS);
 MEMB(slotframe_memb, struct tsch_slotframe, TSCH_SCHEDULE_MAX_SLOTFRAMES);
 /* List of slotframes (each slotframe holds its own list of links) */
 LIST(slotframe_list);
+/* Links removed from the schedule but possibly still in use by the slot operation */
+LIST(retired_link_list);
+
+/* The schedule is edited from process context only, through the lists
+ * above. The slot operation, which runs from interrupt, reads a compact
+ * version of it instead: the slotframe sizes and pointers to the links
+ * of each slotframe. After every edit, a new version is built in the
+ * buffer that is not in use, and published by updating a single byte.
+ * The slot operation never preempts itself nor runs in the middle of
+ * an interrupt, so it always reads a complete version, and it never
+ * has to skip a timeslot because the schedule is being edited.
+ * Links are not modified after they were published. Removed links are
+ * freed only once the slot operation no longer holds them as current
+ * or backup link. */
+struct tsch_schedule_version {
+  uint8_t num_slotframes;
+  struct {
+    struct tsch_asn_divisor_t size;
+    uint16_t num_links;
+  } slotframes[TSCH_SCHEDULE_MAX_SLOTFRAMES];
+  struct tsch_link *links[TSCH_SCHEDULE_MAX_LINKS];
+};
+static struct tsch_schedule_version schedule_versions[2];
+/* Index of the version read by the slot operation */
+static uint8_t published_version;
+
+/*---------------------------------------------------------------------------*/
+/* Frees the removed links that the slot operation is done with */
+static void
+reclaim_retired_links(void)
+{
+  struct tsch_link *l = list_head(retired_link_list);
+  while(l != NULL) {
+    struct tsch_link *next = list_item_next(l);
+    if(!tsch_slot_operation_link_in_use(l)) {
+      list_remove(retired_link_list, l);
+      memb_free(&link_memb, l);
+    }
+    l = next;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Builds a version of the schedule from the lists, and publishes it to the
+ * slot operation */
+static void
+publish_schedule(void)
+{
+  struct tsch_schedule_version *v = &schedule_versions[published_version ^ 1];
+  struct tsch_slotframe *sf;
+  struct tsch_link *l;
+  uint16_t num_links = 0;
+
+  v->num_slotframes = 0;
+  for(sf = list_head(slotframe_list); sf != NULL; sf = list_item_next(sf)) {
+    v->slotframes[v->num_slotframes].size = sf->size;
+    v->slotframes[v->num_slotframes].num_links = 0;
+    for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+      v->links[num_links++] = l;
+      v->slotframes[v->num_slotframes].num_links++;
+    }
+    v->num_slotframes++;
+  }
+
+  /* The version must be complete before the slot operation can see it */
+  CC_COMPILER_BARRIER();
+  CC_ACCESS_NOW(uint8_t, published_version) = published_version ^ 1;
+
+  /* The slot operation will no longer select the retired links */
+  reclaim_retired_links();
+}
+/*---------------------------------------------------------------------------*/
 
 /* Adds and returns a slotframe (NULL if failure) */
 struct tsch_slotframe *
@@ -82,22 +153,19 @@ tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
     return NULL;
   }
 
-  if(tsch_get_lock()) {
-    struct tsch_slotframe *sf = memb_alloc(&slotframe_memb);
-    if(sf != NULL) {
-      /* Initialize the slotframe */
-      sf->handle = handle;
-      TSCH_ASN_DIVISOR_INIT(sf->size, size);
-      LIST_STRUCT_INIT(sf, links_list);
-      /* Add the slotframe to the global list */
-      list_add(slotframe_list, sf);
-    }
-    PRINTF("TSCH-schedule: add_slotframe %u %u\n",
-           handle, size);
-    tsch_release_lock();
-    return sf;
+  struct tsch_slotframe *sf = memb_alloc(&slotframe_memb);
+  if(sf != NULL) {
+    /* Initialize the slotframe */
+    sf->handle = handle;
+    TSCH_ASN_DIVISOR_INIT(sf->size, size);
+    LIST_STRUCT_INIT(sf, links_list);
+    /* Add the slotframe to the global list */
+    list_add(slotframe_list, sf);
+    publish_schedule();
   }
-  return NULL;
+  PRINTF("TSCH-schedule: add_slotframe %u %u\n",
+         handle, size);
+  return sf;
 }
 /*---------------------------------------------------------------------------*/
 /* Removes all slotframes, resulting in an empty schedule */
@@ -124,14 +192,13 @@ tsch_schedule_remove_slotframe(struct tsch_slotframe *slotframe)
       tsch_schedule_remove_link(slotframe, l);
     }
 
-    /* Now that the slotframe has no links, remove it. */
-    if(tsch_get_lock()) {
-      PRINTF("TSCH-schedule: remove slotframe %u %u\n", slotframe->handle, slotframe->size.val);
-      memb_free(&slotframe_memb, slotframe);
-      list_remove(slotframe_list, slotframe);
-      tsch_release_lock();
-      return 1;
-    }
+    /* Now that the slotframe has no links, remove it. The slot operation
+     * only uses the copy of its size held in the published version. */
+    PRINTF("TSCH-schedule: remove slotframe %u %u\n", slotframe->handle, slotframe->size.val);
+    list_remove(slotframe_list, slotframe);
+    memb_free(&slotframe_memb, slotframe);
+    publish_schedule();
+    return 1;
   }
   return 0;
 }
@@ -140,14 +207,12 @@ tsch_schedule_remove_slotframe(struct tsch_slotframe *slotframe)
 struct tsch_slotframe *
 tsch_schedule_get_slotframe_by_handle(uint16_t handle)
 {
-  if(!tsch_is_locked()) {
-    struct tsch_slotframe *sf = list_head(slotframe_list);
-    while(sf != NULL) {
-      if(sf->handle == handle) {
-        return sf;
-      }
-      sf = list_item_next(sf);
+  struct tsch_slotframe *sf = list_head(slotframe_list);
+  while(sf != NULL) {
+    if(sf->handle == handle) {
+      return sf;
     }
+    sf = list_item_next(sf);
   }
   return NULL;
 }
@@ -156,19 +221,17 @@ tsch_schedule_get_slotframe_by_handle(uint16_t handle)
 struct tsch_link *
 tsch_schedule_get_link_by_handle(uint16_t handle)
 {
-  if(!tsch_is_locked()) {
-    struct tsch_slotframe *sf = list_head(slotframe_list);
-    while(sf != NULL) {
-      struct tsch_link *l = list_head(sf->links_list);
-      /* Loop over all items. Assume there is max one link per timeslot */
-      while(l != NULL) {
-        if(l->handle == handle) {
-          return l;
-        }
-        l = list_item_next(l);
+  struct tsch_slotframe *sf = list_head(slotframe_list);
+  while(sf != NULL) {
+    struct tsch_link *l = list_head(sf->links_list);
+    /* Loop over all items. Assume there is max one link per timeslot */
+    while(l != NULL) {
+      if(l->handle == handle) {
+        return l;
       }
-      sf = list_item_next(sf);
+      l = list_item_next(l);
     }
+    sf = list_item_next(sf);
   }
   return NULL;
 }
@@ -185,45 +248,43 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
     /* Start with removing the link currently installed at this timeslot (needed
      * to keep neighbor state in sync with link options etc.) */
     tsch_schedule_remove_link_by_timeslot(slotframe, timeslot);
-    if(!tsch_get_lock()) {
-      PRINTF("TSCH-schedule:! add_link memb_alloc couldn't take lock\n");
-    } else {
+    l = memb_alloc(&link_memb);
+    if(l == NULL) {
+      /* Try again after freeing the retired links the slot operation is done with */
+      reclaim_retired_links();
       l = memb_alloc(&link_memb);
-      if(l == NULL) {
-        PRINTF("TSCH-schedule:! add_link memb_alloc failed\n");
-        tsch_release_lock();
-      } else {
-        static int current_link_handle = 0;
-        struct tsch_neighbor *n;
-        /* Add the link to the slotframe */
-        list_add(slotframe->links_list, l);
-        /* Initialize link */
-        l->handle = current_link_handle++;
-        l->link_options = link_options;
-        l->link_type = link_type;
-        l->slotframe_handle = slotframe->handle;
-        l->timeslot = timeslot;
-        l->channel_offset = channel_offset;
-        l->data = NULL;
-        if(address == NULL) {
-          address = &linkaddr_null;
-        }
-        linkaddr_copy(&l->addr, address);
-
-        PRINTF("TSCH-schedule: add_link %u %u %u %u %u %u\n",
-               slotframe->handle, link_options, link_type, timeslot, channel_offset, TSCH_LOG_ID_FROM_LINKADDR(address));
+    }
+    if(l == NULL) {
+      PRINTF("TSCH-schedule:! add_link memb_alloc failed\n");
+    } else {
+      static int current_link_handle = 0;
+      struct tsch_neighbor *n;
+      /* Initialize link, before it is published */
+      l->handle = current_link_handle++;
+      l->link_options = link_options;
+      l->link_type = link_type;
+      l->slotframe_handle = slotframe->handle;
+      l->timeslot = timeslot;
+      l->channel_offset = channel_offset;
+      l->data = NULL;
+      if(address == NULL) {
+        address = &linkaddr_null;
+      }
+      linkaddr_copy(&l->addr, address);
+      /* Add the link to the slotframe */
+      list_add(slotframe->links_list, l);
+      publish_schedule();
 
-        /* Release the lock before we update the neighbor (will take the lock) */
-        tsch_release_lock();
+      PRINTF("TSCH-schedule: add_link %u %u %u %u %u %u\n",
+             slotframe->handle, link_options, link_type, timeslot, channel_offset, TSCH_LOG_ID_FROM_LINKADDR(address));
 
-        if(l->link_options & LINK_OPTION_TX) {
-          n = tsch_queue_add_nbr(&l->addr);
-          /* We have a tx link to this neighbor, update counters */
-          if(n != NULL) {
-            n->tx_links_count++;
-            if(!(l->link_options & LINK_OPTION_SHARED)) {
-              n->dedicated_tx_links_count++;
-            }
+      if(l->link_options & LINK_OPTION_TX) {
+        n = tsch_queue_add_nbr(&l->addr);
+        /* We have a tx link to this neighbor, update counters */
+        if(n != NULL) {
+          n->tx_links_count++;
+          if(!(l->link_options & LINK_OPTION_SHARED)) {
+            n->dedicated_tx_links_count++;
           }
         }
       }
@@ -237,45 +298,36 @@ int
 tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
 {
   if(slotframe != NULL && l != NULL && l->slotframe_handle == slotframe->handle) {
-    if(tsch_get_lock()) {
-      uint8_t link_options;
-      linkaddr_t addr;
+    uint8_t link_options;
+    linkaddr_t addr;
 
-      /* Save link option and addr in local variables as we need them
-       * after freeing the link */
-      link_options = l->link_options;
-      linkaddr_copy(&addr, &l->addr);
+    /* Save link option and addr in local variables as we need them
+     * after freeing the link */
+    link_options = l->link_options;
+    linkaddr_copy(&addr, &l->addr);
 
-      /* The link to be removed is scheduled as next, set it to NULL
-       * to abort the next link operation */
-      if(l == current_link) {
-        current_link = NULL;
-      }
-      PRINTF("TSCH-schedule: remove_link %u %u %u %u %u\n",
-             slotframe->handle, l->link_options, l->timeslot, l->channel_offset,
-             TSCH_LOG_ID_FROM_LINKADDR(&l->addr));
-
-      list_remove(slotframe->links_list, l);
-      memb_free(&link_memb, l);
+    PRINTF("TSCH-schedule: remove_link %u %u %u %u %u\n",
+           slotframe->handle, l->link_options, l->timeslot, l->channel_offset,
+           TSCH_LOG_ID_FROM_LINKADDR(&l->addr));
 
-      /* Release the lock before we update the neighbor (will take the lock) */
-      tsch_release_lock();
+    /* Retire the link. If it is scheduled as next link, the slot operation
+     * still runs it once; it is freed after that. */
+    list_remove(slotframe->links_list, l);
+    list_add(retired_link_list, l);
+    publish_schedule();
 
-      /* This was a tx link to this neighbor, update counters */
-      if(link_options & LINK_OPTION_TX) {
-        struct tsch_neighbor *n = tsch_queue_add_nbr(&addr);
-        if(n != NULL) {
-          n->tx_links_count--;
-          if(!(link_options & LINK_OPTION_SHARED)) {
-            n->dedicated_tx_links_count--;
-          }
+    /* This was a tx link to this neighbor, update counters */
+    if(link_options & LINK_OPTION_TX) {
+      struct tsch_neighbor *n = tsch_queue_add_nbr(&addr);
+      if(n != NULL) {
+        n->tx_links_count--;
+        if(!(link_options & LINK_OPTION_SHARED)) {
+          n->dedicated_tx_links_count--;
         }
       }
-
-      return 1;
-    } else {
-      PRINTF("TSCH-schedule:! remove_link memb_alloc couldn't take lock\n");
     }
+
+    return 1;
   }
   return 0;
 }
@@ -292,18 +344,16 @@ tsch_schedule_remove_link_by_timeslot(struct tsch_slotframe *slotframe, uint16_t
 struct tsch_link *
 tsch_schedule_get_link_by_timeslot(struct tsch_slotframe *slotframe, uint16_t timeslot)
 {
-  if(!tsch_is_locked()) {
-    if(slotframe != NULL) {
-      struct tsch_link *l = list_head(slotframe->links_list);
-      /* Loop over all items. Assume there is max one link per timeslot */
-      while(l != NULL) {
-        if(l->timeslot == timeslot) {
-          return l;
-        }
-        l = list_item_next(l);
+  if(slotframe != NULL) {
+    struct tsch_link *l = list_head(slotframe->links_list);
+    /* Loop over all items. Assume there is max one link per timeslot */
+    while(l != NULL) {
+      if(l->timeslot == timeslot) {
+        return l;
       }
-      return l;
+      l = list_item_next(l);
     }
+    return l;
   }
   return NULL;
 }
@@ -319,64 +369,62 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
   turns out useless when the time comes. For instance, for a Tx-only link, if there is
   no outgoing packet in queue. In that case, run the backup link instead. The backup link
   must have Rx flag set. */
-  if(!tsch_is_locked()) {
-    struct tsch_slotframe *sf = list_head(slotframe_list);
-    /* For each slotframe, look for the earliest occurring link */
-    while(sf != NULL) {
-      /* Get timeslot from ASN, given the slotframe length */
-      uint16_t timeslot = TSCH_ASN_MOD(*asn, sf->size);
-      struct tsch_link *l = list_head(sf->links_list);
-      while(l != NULL) {
-        uint16_t time_to_timeslot =
-          l->timeslot > timeslot ?
-          l->timeslot - timeslot :
-          sf->size.val + l->timeslot - timeslot;
-        if(curr_best == NULL || time_to_timeslot < time_to_curr_best) {
-          time_to_curr_best = time_to_timeslot;
-          curr_best = l;
-          curr_backup = NULL;
-        } else if(time_to_timeslot == time_to_curr_best) {
-          struct tsch_link *new_best = NULL;
-          /* Two links are overlapping, we need to select one of them.
-           * By standard: prioritize Tx links first, second by lowest handle */
-          if((curr_best->link_options & LINK_OPTION_TX) == (l->link_options & LINK_OPTION_TX)) {
-            /* Both or neither links have Tx, select the one with lowest handle */
-            if(l->slotframe_handle < curr_best->slotframe_handle) {
-              new_best = l;
-            }
-          } else {
-            /* Select the link that has the Tx option */
-            if(l->link_options & LINK_OPTION_TX) {
-              new_best = l;
-            }
+  const struct tsch_schedule_version *v = &schedule_versions[published_version];
+  uint16_t link_index = 0;
+  uint8_t sf_index;
+  uint16_t i;
+  /* For each slotframe, look for the earliest occurring link */
+  for(sf_index = 0; sf_index < v->num_slotframes; sf_index++) {
+    /* Get timeslot from ASN, given the slotframe length */
+    uint16_t timeslot = TSCH_ASN_MOD(*asn, v->slotframes[sf_index].size);
+    for(i = 0; i < v->slotframes[sf_index].num_links; i++) {
+      struct tsch_link *l = v->links[link_index++];
+      uint16_t time_to_timeslot =
+        l->timeslot > timeslot ?
+        l->timeslot - timeslot :
+        v->slotframes[sf_index].size.val + l->timeslot - timeslot;
+      if(curr_best == NULL || time_to_timeslot < time_to_curr_best) {
+        time_to_curr_best = time_to_timeslot;
+        curr_best = l;
+        curr_backup = NULL;
+      } else if(time_to_timeslot == time_to_curr_best) {
+        struct tsch_link *new_best = NULL;
+        /* Two links are overlapping, we need to select one of them.
+         * By standard: prioritize Tx links first, second by lowest handle */
+        if((curr_best->link_options & LINK_OPTION_TX) == (l->link_options & LINK_OPTION_TX)) {
+          /* Both or neither links have Tx, select the one with lowest handle */
+          if(l->slotframe_handle < curr_best->slotframe_handle) {
+            new_best = l;
           }
-
-          /* Maintain backup_link */
-          if(curr_backup == NULL) {
-            /* Check if 'l' best can be used as backup */
-            if(new_best != l && (l->link_options & LINK_OPTION_RX)) { /* Does 'l' have Rx flag? */
-              curr_backup = l;
-            }
-            /* Check if curr_best can be used as backup */
-            if(new_best != curr_best && (curr_best->link_options & LINK_OPTION_RX)) { /* Does curr_best have Rx flag? */
-              curr_backup = curr_best;
-            }
+        } else {
+          /* Select the link that has the Tx option */
+          if(l->link_options & LINK_OPTION_TX) {
+            new_best = l;
           }
+        }
 
-          /* Maintain curr_best */
-          if(new_best != NULL) {
-            curr_best = new_best;
+        /* Maintain backup_link */
+        if(curr_backup == NULL) {
+          /* Check if 'l' best can be used as backup */
+          if(new_best != l && (l->link_options & LINK_OPTION_RX)) { /* Does 'l' have Rx flag? */
+            curr_backup = l;
+          }
+          /* Check if curr_best can be used as backup */
+          if(new_best != curr_best && (curr_best->link_options & LINK_OPTION_RX)) { /* Does curr_best have Rx flag? */
+            curr_backup = curr_best;
           }
         }
 
-        l = list_item_next(l);
+        /* Maintain curr_best */
+        if(new_best != NULL) {
+          curr_best = new_best;
+        }
       }
-      sf = list_item_next(sf);
-    }
-    if(time_offset != NULL) {
-      *time_offset = time_to_curr_best;
     }
   }
+  if(time_offset != NULL) {
+    *time_offset = time_to_curr_best;
+  }
   if(backup_link != NULL) {
     *backup_link = curr_backup;
   }
@@ -387,15 +435,12 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
 int
 tsch_schedule_init(void)
 {
-  if(tsch_get_lock()) {
-    memb_init(&link_memb);
-    memb_init(&slotframe_memb);
-    list_init(slotframe_list);
-    tsch_release_lock();
-    return 1;
-  } else {
-    return 0;
-  }
+  memb_init(&link_memb);
+  memb_init(&slotframe_memb);
+  list_init(slotframe_list);
+  list_init(retired_link_list);
+  publish_schedule();
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
 /* Create a 6TiSCH minimal schedule */
@@ -422,27 +467,25 @@ tsch_schedule_create_minimal(void)
 void
 tsch_schedule_print(void)
 {
-  if(!tsch_is_locked()) {
-    struct tsch_slotframe *sf = list_head(slotframe_list);
+  struct tsch_slotframe *sf = list_head(slotframe_list);
 
-    printf("Schedule: slotframe list\n");
+  printf("Schedule: slotframe list\n");
 
-    while(sf != NULL) {
-      struct tsch_link *l = list_head(sf->links_list);
+  while(sf != NULL) {
+    struct tsch_link *l = list_head(sf->links_list);
 
-      printf("[Slotframe] Handle %u, size %u\n", sf->handle, sf->size.val);
-      printf("List of links:\n");
+    printf("[Slotframe] Handle %u, size %u\n", sf->handle, sf->size.val);
+    printf("List of links:\n");
 
-      while(l != NULL) {
-        printf("[Link] Options %02x, type %u, timeslot %u, channel offset %u, address %u\n",
-               l->link_options, l->link_type, l->timeslot, l->channel_offset, l->addr.u8[7]);
-        l = list_item_next(l);
-      }
-
-      sf = list_item_next(sf);
+    while(l != NULL) {
+      printf("[Link] Options %02x, type %u, timeslot %u, channel offset %u, address %u\n",
+             l->link_options, l->link_type, l->timeslot, l->channel_offset, l->addr.u8[7]);
+      l = list_item_next(l);
     }
 
-    printf("Schedule: end of slotframe list\n");
+    sf = list_item_next(sf);
   }
+
+  printf("Schedule: end of slotframe list\n");
 }
 /*---------------------------------------------------------------------------*/
@@ -70,6 +70,21 @@ static aes_key keys[] = {
 };
 #define N_KEYS (sizeof(keys) / sizeof(aes_key))
 
+/* The keys along with their expanded schedules, so that securing or
+ * parsing a frame does not run the key expansion again */
+static struct aes_128_context contexts[N_KEYS];
+
+/*---------------------------------------------------------------------------*/
+void
+tsch_security_init(void)
+{
+  uint8_t i;
+
+  for(i = 0; i < N_KEYS; i++) {
+    ccm_star_init_context(&contexts[i], keys[i]);
+  }
+}
+
 /*---------------------------------------------------------------------------*/
 static void
 tsch_security_init_nonce(uint8_t *nonce,
@@ -188,7 +203,7 @@ tsch_security_secure_frame(uint8_t *hdr, uint8_t *outbuf,
     memcpy(outbuf, hdr, a_len + m_len);
   }
 
-  CCM_STAR.set_key(keys[key_index - 1]);
+  ccm_star_select_context(&contexts[key_index - 1]);
 
   CCM_STAR.aead(nonce,
                 outbuf + a_len, m_len,
@@ -246,7 +261,7 @@ tsch_security_parse_frame(const uint8_t *hdr, int hdrlen, int datalen,
     m_len = 0;
   }
 
-  CCM_STAR.set_key(keys[key_index - 1]);
+  ccm_star_select_context(&contexts[key_index - 1]);
 
   CCM_STAR.aead(nonce,
                 (uint8_t *)hdr + a_len, m_len,
@@ -118,6 +118,11 @@
 typedef uint8_t aes_key[16];
 
 /********** Functions *********/
+/**
+ * \brief Initialize the contexts of the TSCH keys
+ */
+void tsch_security_init(void);
+
 /**
  * \brief Return MIC length
  * \return The length of MIC (>= 0)
@@ -51,6 +51,7 @@
 #include "net/mac/tsch/tsch-queue.h"
 #include "net/mac/tsch/tsch-private.h"
 #include "net/mac/tsch/tsch-log.h"
+#include "net/mac/tsch/tsch-trace.h"
 #include "net/mac/tsch/tsch-packet.h"
 #include "net/mac/tsch/tsch-security.h"
 #include "net/mac/tsch/tsch-adaptive-timesync.h"
@@ -174,6 +175,22 @@ static struct tsch_link *backup_link = NULL;
 static struct tsch_packet *current_packet = NULL;
 static struct tsch_neighbor *current_neighbor = NULL;
 
+#if TSCH_BURST_MAX_LEN > 0
+/* Role of this node in the burst timeslot scheduled right after the
+ * current one, if any */
+enum tsch_burst_role {
+  BURST_NONE,
+  BURST_TX,
+  BURST_RX,
+};
+static enum tsch_burst_role burst_link_scheduled = BURST_NONE;
+/* Number of burst timeslots since the last scheduled timeslot */
+static uint8_t burst_count = 0;
+/* The neighbor we are sending a burst to. The neighbor is looked up again in
+ * the burst timeslot, as it may have been removed in between. */
+static linkaddr_t burst_neighbor_addr;
+#endif /* TSCH_BURST_MAX_LEN > 0 */
+
 /* Protothread for association */
 PT_THREAD(tsch_scan(struct pt *pt));
 /* Protothread for slot operation, called from rtimer interrupt
@@ -243,6 +260,15 @@ tsch_release_lock(void)
   tsch_locked = 0;
 }
 
+/* Is a link in use by the slot operation, i.e., scheduled as current
+ * or backup link? Called from process context, with no slot operation
+ * running at the same time. */
+int
+tsch_slot_operation_link_in_use(const struct tsch_link *link)
+{
+  return link == current_link || link == backup_link;
+}
+
 /*---------------------------------------------------------------------------*/
 /* Channel hopping utility functions */
 
@@ -297,6 +323,9 @@ tsch_schedule_slot_operation(struct rtimer *tm, rtimer_clock_t ref_time, rtimer_
                     "!dl-miss %s %d %d",
                         str, (int)(now-ref_time), (int)offset);
     );
+    TSCH_TRACE_ADD(TSCH_TRACE_DEADLINE_MISS,
+        rec->delta = (int16_t)(now - (rtimer_clock_t)(ref_time + offset));
+    );
 
     return 0;
   }
@@ -480,11 +509,19 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
   uint8_t in_queue;
   static int dequeued_index;
   static int packet_ready = 1;
+#if TSCH_BURST_MAX_LEN > 0
+  /* did we announce more packets with the frame pending bit? */
+  static uint8_t burst_requested;
+#endif /* TSCH_BURST_MAX_LEN > 0 */
 
   PT_BEGIN(pt);
 
   TSCH_DEBUG_TX_EVENT();
 
+#if TSCH_BURST_MAX_LEN > 0
+  burst_requested = 0;
+#endif /* TSCH_BURST_MAX_LEN > 0 */
+
   /* First check if we have space to store a newly dequeued packet (in case of
    * successful Tx or Drop) */
   dequeued_index = ringbufindex_peek_put(&dequeued_ringbuf);
@@ -524,6 +561,19 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
         packet_ready = 1;
       }
 
+#if TSCH_WITH_FRAME_PENDING
+      /* Unicast: set the frame pending bit if more packets are queued for
+       * the same neighbor. The bit is set before securing the frame. */
+      if(!is_broadcast) {
+        int frame_pending = tsch_queue_nbr_packet_count(current_neighbor) > 1;
+        tsch_packet_set_frame_pending(packet, frame_pending);
+#if TSCH_BURST_MAX_LEN > 0
+        /* Ask the neighbor to stay on this link in the next timeslot */
+        burst_requested = frame_pending && burst_count + 1 < TSCH_BURST_MAX_LEN;
+#endif /* TSCH_BURST_MAX_LEN > 0 */
+      }
+#endif /* TSCH_WITH_FRAME_PENDING */
+
 #if LLSEC802154_ENABLED
       if(tsch_is_pan_secured) {
         /* If we are going to encrypt, we need to generate the output in a separate buffer and keep
@@ -664,6 +714,9 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
                   last_sync_asn = tsch_current_asn;
                   tsch_schedule_keepalive();
                 }
+#ifdef TSCH_CALLBACK_EACK_IE_RECEIVED
+                TSCH_CALLBACK_EACK_IE_RECEIVED(&current_neighbor->addr, &ack_ies);
+#endif
                 mac_tx_status = MAC_TX_OK;
               } else {
                 mac_tx_status = MAC_TX_NOACK;
@@ -686,6 +739,14 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
     /* Post TX: Update neighbor state */
     in_queue = update_neighbor_state(current_neighbor, current_packet, current_link, mac_tx_status);
 
+#if TSCH_BURST_MAX_LEN > 0
+    /* The neighbor acknowledged a frame with the frame pending bit set */
+    if(burst_requested && mac_tx_status == MAC_TX_OK) {
+      burst_link_scheduled = BURST_TX;
+      linkaddr_copy(&burst_neighbor_addr, &current_neighbor->addr);
+    }
+#endif /* TSCH_BURST_MAX_LEN > 0 */
+
     /* The packet was dequeued, add it to dequeued_ringbuf for later processing */
     if(in_queue == 0) {
       dequeued_array[dequeued_index] = current_packet;
@@ -707,6 +768,15 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 #endif /* LLSEC802154_ENABLED */
     log->tx.dest = TSCH_LOG_ID_FROM_LINKADDR(queuebuf_addr(current_packet->qb, PACKETBUF_ADDR_RECEIVER));
     );
+    TSCH_TRACE_ADD(TSCH_TRACE_TX,
+        rec->status = mac_tx_status;
+        rec->nbr = TSCH_LOG_ID_FROM_LINKADDR(queuebuf_addr(current_packet->qb, PACKETBUF_ADDR_RECEIVER));
+        rec->delta = is_drift_correction_used ? drift_correction : 0;
+        rec->len = queuebuf_datalen(current_packet->qb);
+        rec->info = MIN(current_packet->transmissions, TSCH_TRACE_INFO_NUM_TX)
+          | (current_neighbor != NULL && !current_neighbor->is_broadcast ? TSCH_TRACE_INFO_UNICAST : 0)
+          | ((((((uint8_t *)(queuebuf_dataptr(current_packet->qb)))[0]) & 7) == FRAME802154_DATAFRAME) ? TSCH_TRACE_INFO_DATA : 0);
+    );
 
     /* Poll process for later processing of packet sent events and logs */
     process_poll(&tsch_pending_events_process);
@@ -861,6 +931,22 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
               ack_len = tsch_packet_create_eack(ack_buf, sizeof(ack_buf),
                   &source_address, frame.seq, (int16_t)RTIMERTICKS_TO_US(estimated_drift), do_nack);
 
+#ifdef TSCH_CALLBACK_EACK_IE_CREATE
+              if(ack_len > 0) {
+                /* Piggyback upper-layer information on the ACK */
+                struct ieee802154_ies ack_ies;
+                int ie_len;
+                memset(&ack_ies, 0, sizeof(ack_ies));
+                if(TSCH_CALLBACK_EACK_IE_CREATE(&source_address, frame.fcf.frame_pending, &ack_ies)) {
+                  ie_len = frame80215e_create_ie_header_vendor_specific(ack_buf + ack_len,
+                      sizeof(ack_buf) - ack_len, &ack_ies);
+                  if(ie_len > 0) {
+                    ack_len += ie_len;
+                  }
+                }
+              }
+#endif
+
               if(ack_len > 0) {
 #if LLSEC802154_ENABLED
                 if(tsch_is_pan_secured) {
@@ -878,6 +964,14 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
                 TSCH_DEBUG_RX_EVENT();
                 NETSTACK_RADIO.transmit(ack_len);
                 tsch_radio_off(TSCH_RADIO_CMD_OFF_WITHIN_TIMESLOT);
+
+#if TSCH_BURST_MAX_LEN > 0
+                /* The sender has more packets for us and will send the
+                 * next one in the next timeslot, on the same link */
+                if(frame.fcf.frame_pending && burst_count + 1 < TSCH_BURST_MAX_LEN) {
+                  burst_link_scheduled = BURST_RX;
+                }
+#endif /* TSCH_BURST_MAX_LEN > 0 */
               }
             }
 
@@ -908,6 +1002,13 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
               log->rx.sec_level = frame.aux_hdr.security_control.security_level;
               log->rx.estimated_drift = estimated_drift;
             );
+            TSCH_TRACE_ADD(TSCH_TRACE_RX,
+              rec->nbr = TSCH_LOG_ID_FROM_LINKADDR((linkaddr_t*)&frame.src_addr);
+              rec->delta = estimated_drift;
+              rec->len = current_input->len;
+              rec->info = (frame.fcf.ack_required ? TSCH_TRACE_INFO_UNICAST : 0)
+                | (frame.fcf.frame_type == FRAME802154_DATAFRAME ? TSCH_TRACE_INFO_DATA : 0);
+            );
           }
 
           /* Poll process for processing of pending input and logs */
@@ -953,23 +1054,48 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
                             tsch_lock_requested,
                             current_link == NULL);
       );
+      TSCH_TRACE_ADD(TSCH_TRACE_SKIPPED_SLOT,
+          rec->status = tsch_lock_requested;
+      );
+#if TSCH_BURST_MAX_LEN > 0
+      /* The burst is over, the neighbor will give up after a missed slot */
+      burst_link_scheduled = BURST_NONE;
+#endif /* TSCH_BURST_MAX_LEN > 0 */
 
     } else {
       int is_active_slot;
+#if TSCH_BURST_MAX_LEN > 0
+      enum tsch_burst_role burst_role = burst_link_scheduled;
+      burst_link_scheduled = BURST_NONE;
+#endif /* TSCH_BURST_MAX_LEN > 0 */
       TSCH_DEBUG_SLOT_START();
       tsch_in_slot_operation = 1;
       /* Reset drift correction */
       drift_correction = 0;
       is_drift_correction_used = 0;
-      /* Get a packet ready to be sent */
-      current_packet = get_packet_and_neighbor_for_link(current_link, &current_neighbor);
-      /* There is no packet to send, and this link does not have Rx flag. Instead of doing
-       * nothing, switch to the backup link (has Rx flag) if any. */
-      if(current_packet == NULL && !(current_link->link_options & LINK_OPTION_RX) && backup_link != NULL) {
-        current_link = backup_link;
+#if TSCH_BURST_MAX_LEN > 0
+      if(burst_role == BURST_RX) {
+        /* Burst timeslot: listen for the next packet of the sender */
+        current_packet = NULL;
+        is_active_slot = 1;
+      } else if(burst_role == BURST_TX) {
+        /* Burst timeslot: send the next packet queued for the neighbor */
+        current_neighbor = tsch_queue_get_nbr(&burst_neighbor_addr);
+        current_packet = tsch_queue_get_packet_for_nbr(current_neighbor, current_link);
+        is_active_slot = current_packet != NULL;
+      } else
+#endif /* TSCH_BURST_MAX_LEN > 0 */
+      {
+        /* Get a packet ready to be sent */
         current_packet = get_packet_and_neighbor_for_link(current_link, &current_neighbor);
+        /* There is no packet to send, and this link does not have Rx flag. Instead of doing
+         * nothing, switch to the backup link (has Rx flag) if any. */
+        if(current_packet == NULL && !(current_link->link_options & LINK_OPTION_RX) && backup_link != NULL) {
+          current_link = backup_link;
+          current_packet = get_packet_and_neighbor_for_link(current_link, &current_neighbor);
+        }
+        is_active_slot = current_packet != NULL || (current_link->link_options & LINK_OPTION_RX);
       }
-      is_active_slot = current_packet != NULL || (current_link->link_options & LINK_OPTION_RX);
       if(is_active_slot) {
         /* Hop channel */
         current_channel = tsch_calculate_channel(&tsch_current_asn, current_link->channel_offset);
@@ -1024,6 +1150,17 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
           tsch_queue_update_all_backoff_windows(&current_link->addr);
         }
 
+#if TSCH_BURST_MAX_LEN > 0
+        if(burst_link_scheduled != BURST_NONE && timeslot_diff == 0) {
+          /* Stay on the current link for the next timeslot. If we missed
+           * the deadline of the burst timeslot, the burst is over. */
+          timeslot_diff = 1;
+          backup_link = NULL;
+          burst_count++;
+        } else {
+          burst_link_scheduled = BURST_NONE;
+          burst_count = 0;
+#endif /* TSCH_BURST_MAX_LEN > 0 */
         /* Get next active link */
         current_link = tsch_schedule_get_next_active_link(&tsch_current_asn, &timeslot_diff, &backup_link);
         if(current_link == NULL) {
@@ -1031,6 +1168,9 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
            * behavior: wake up at the next slot. */
           timeslot_diff = 1;
         }
+#if TSCH_BURST_MAX_LEN > 0
+        }
+#endif /* TSCH_BURST_MAX_LEN > 0 */
         /* Update ASN */
         TSCH_ASN_INC(tsch_current_asn, timeslot_diff);
         /* Time to next wake up */
@@ -1060,6 +1200,10 @@ tsch_slot_operation_start(void)
   rtimer_clock_t time_to_next_active_slot;
   rtimer_clock_t prev_slot_start;
   TSCH_DEBUG_INIT();
+#if TSCH_BURST_MAX_LEN > 0
+  burst_link_scheduled = BURST_NONE;
+  burst_count = 0;
+#endif /* TSCH_BURST_MAX_LEN > 0 */
   do {
     uint16_t timeslot_diff;
     /* Get next active link */
@@ -82,6 +82,19 @@
 int TSCH_CALLBACK_DO_NACK(struct tsch_link *link, linkaddr_t *src, linkaddr_t *dst);
 #endif
 
+/* Called by TSCH from interrupt before sending an enhanced ACK to addr,
+ * enables upper-layer to piggyback a vendor specific IE on the ACK.
+ * frame_pending is the frame pending bit of the acknowledged frame.
+ * Returns 1 if the vendor specific IE in ies is to be added */
+#ifdef TSCH_CALLBACK_EACK_IE_CREATE
+int TSCH_CALLBACK_EACK_IE_CREATE(const linkaddr_t *addr, int frame_pending, struct ieee802154_ies *ies);
+#endif
+
+/* Called by TSCH from interrupt after receiving a valid enhanced ACK from addr */
+#ifdef TSCH_CALLBACK_EACK_IE_RECEIVED
+void TSCH_CALLBACK_EACK_IE_RECEIVED(const linkaddr_t *addr, const struct ieee802154_ies *ies);
+#endif
+
 /************ Types ***********/
 
 /* Stores data about an incoming packet */
@@ -114,6 +127,8 @@ int tsch_is_locked(void);
 int tsch_get_lock(void);
 /* Release TSCH lock */
 void tsch_release_lock(void);
+/* Is a link in use by the slot operation? */
+int tsch_slot_operation_link_in_use(const struct tsch_link *link);
 /* Set global time before starting slot operation,
  * with a rtimer time and an ASN */
 void tsch_slot_operation_sync(rtimer_clock_t next_slot_start,
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2017, SICS Swedish ICT.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Binary event tracing for TSCH. Records are written from the
+ *         slot operation interrupt without any formatting, queued in a
+ *         ringbuf, and output in bulk from the TSCH pending events
+ *         process. See tools/tsch-trace for the host-side decoder.
+ *
+ */
+
+#include "contiki.h"
+#include <stdio.h>
+#include <string.h>
+#include "net/mac/tsch/tsch.h"
+#include "net/mac/tsch/tsch-private.h"
+#include "net/mac/tsch/tsch-log.h"
+#include "net/mac/tsch/tsch-trace.h"
+#include "net/mac/tsch/tsch-schedule.h"
+#include "lib/ringbufindex.h"
+
+#if TSCH_TRACE_ENABLED
+
+PROCESS_NAME(tsch_pending_events_process);
+
+/* Check if TSCH_TRACE_QUEUE_LEN is a power of two */
+#if (TSCH_TRACE_QUEUE_LEN & (TSCH_TRACE_QUEUE_LEN - 1)) != 0
+#error TSCH_TRACE_QUEUE_LEN must be power of two
+#endif
+static struct ringbufindex trace_ringbuf;
+/* Not static, so that the queue can be located in a memory dump */
+struct tsch_trace_record tsch_trace_array[TSCH_TRACE_QUEUE_LEN];
+static uint16_t trace_dropped = 0;
+
+/*---------------------------------------------------------------------------*/
+/* Encode a record as little-endian bytes */
+static void
+encode_record(const struct tsch_trace_record *rec, uint8_t *buf)
+{
+  buf[0] = rec->asn_ls4b & 0xff;
+  buf[1] = (rec->asn_ls4b >> 8) & 0xff;
+  buf[2] = (rec->asn_ls4b >> 16) & 0xff;
+  buf[3] = (rec->asn_ls4b >> 24) & 0xff;
+  buf[4] = rec->asn_ms1b;
+  buf[5] = rec->event;
+  buf[6] = rec->status;
+  buf[7] = rec->slotframe_handle;
+  buf[8] = rec->timeslot & 0xff;
+  buf[9] = rec->timeslot >> 8;
+  buf[10] = rec->channel_offset;
+  buf[11] = rec->nbr;
+  buf[12] = (uint16_t)rec->delta & 0xff;
+  buf[13] = (uint16_t)rec->delta >> 8;
+  buf[14] = rec->len;
+  buf[15] = rec->info;
+}
+/*---------------------------------------------------------------------------*/
+#ifndef TSCH_TRACE_OUTPUT
+/* Default output: one line of hexadecimal per call */
+static void
+output_hex(const uint8_t *buf, int len)
+{
+  int i;
+  printf(TSCH_TRACE_LINE_PREFIX);
+  for(i = 0; i < len; i++) {
+    printf("%02x", buf[i]);
+  }
+  printf("\n");
+}
+#define TSCH_TRACE_OUTPUT(buf, len) output_hex(buf, len)
+#endif /* TSCH_TRACE_OUTPUT */
+/*---------------------------------------------------------------------------*/
+/* Output pending records */
+void
+tsch_trace_process_pending(void)
+{
+  static uint16_t last_trace_dropped = 0;
+  uint8_t buf[TSCH_TRACE_RECORDS_PER_OUTPUT * TSCH_TRACE_RECORD_LEN];
+  int first;
+  int count;
+  int n;
+  int i;
+
+  if(trace_dropped != last_trace_dropped) {
+    /* Report lost records in-band, so that the decoder can account for them */
+    struct tsch_trace_record rec;
+    uint16_t dropped = trace_dropped - last_trace_dropped;
+    memset(&rec, 0, sizeof(rec));
+    rec.event = TSCH_TRACE_DROPPED;
+    rec.slotframe_handle = 0xff;
+    rec.delta = dropped > 0x7fff ? 0x7fff : dropped;
+    last_trace_dropped += dropped;
+    encode_record(&rec, buf);
+    TSCH_TRACE_OUTPUT(buf, TSCH_TRACE_RECORD_LEN);
+  }
+
+  /* Output the records that are pending when we start, a chunk at a time */
+  count = ringbufindex_peek_get_batch(&trace_ringbuf, &first);
+  while(count > 0) {
+    n = MIN(count, TSCH_TRACE_RECORDS_PER_OUTPUT);
+    for(i = 0; i < n; i++) {
+      encode_record(&tsch_trace_array[(first + i) & (TSCH_TRACE_QUEUE_LEN - 1)],
+                    buf + i * TSCH_TRACE_RECORD_LEN);
+    }
+    /* The records were copied, release them before the output */
+    ringbufindex_get_batch(&trace_ringbuf, n);
+    TSCH_TRACE_OUTPUT(buf, n * TSCH_TRACE_RECORD_LEN);
+    first += n;
+    count -= n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Prepare addition of a new record, with ASN and link filled in.
+ * Returns pointer to the record if success, NULL otherwise */
+struct tsch_trace_record *
+tsch_trace_prepare_add(uint8_t event)
+{
+  int trace_index = ringbufindex_peek_put(&trace_ringbuf);
+  if(trace_index != -1) {
+    struct tsch_trace_record *rec = &tsch_trace_array[trace_index];
+    memset(rec, 0, sizeof(*rec));
+    rec->asn_ls4b = tsch_current_asn.ls4b;
+    rec->asn_ms1b = tsch_current_asn.ms1b;
+    rec->event = event;
+    if(current_link != NULL) {
+      rec->slotframe_handle = current_link->slotframe_handle;
+      rec->timeslot = current_link->timeslot;
+      rec->channel_offset = current_link->channel_offset;
+    } else {
+      rec->slotframe_handle = 0xff;
+    }
+    return rec;
+  } else {
+    trace_dropped++;
+    return NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Actually add the previously prepared record */
+void
+tsch_trace_commit(void)
+{
+  ringbufindex_put(&trace_ringbuf);
+  process_poll(&tsch_pending_events_process);
+}
+/*---------------------------------------------------------------------------*/
+/* Initialize trace module */
+void
+tsch_trace_init(void)
+{
+  ringbufindex_init(&trace_ringbuf, TSCH_TRACE_QUEUE_LEN);
+}
+
+#endif /* TSCH_TRACE_ENABLED */
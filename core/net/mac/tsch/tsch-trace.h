@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2017, SICS Swedish ICT.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+#ifndef __TSCH_TRACE_H__
+#define __TSCH_TRACE_H__
+
+/********** Includes **********/
+
+#include "contiki.h"
+#include "net/mac/tsch/tsch-private.h"
+
+/******** Configuration *******/
+
+/* Enable binary event tracing from the slot operation. Unlike tsch-log,
+ * tracing does not format anything from interrupt nor when draining:
+ * fixed-size records are output in bulk, to be decoded on a host with
+ * tools/tsch-trace/tsch-trace-decode.py */
+#ifdef TSCH_TRACE_CONF_ENABLED
+#define TSCH_TRACE_ENABLED TSCH_TRACE_CONF_ENABLED
+#else /* TSCH_TRACE_CONF_ENABLED */
+#define TSCH_TRACE_ENABLED 0
+#endif /* TSCH_TRACE_CONF_ENABLED */
+
+/* The length of the trace queue, i.e. maximum number of records
+ * pending output. Must be a power of two. */
+#ifdef TSCH_TRACE_CONF_QUEUE_LEN
+#define TSCH_TRACE_QUEUE_LEN TSCH_TRACE_CONF_QUEUE_LEN
+#else /* TSCH_TRACE_CONF_QUEUE_LEN */
+#define TSCH_TRACE_QUEUE_LEN 32
+#endif /* TSCH_TRACE_CONF_QUEUE_LEN */
+
+/* Function used to output encoded records, called with a buffer and
+ * its length. By default, records are printed as hexadecimal lines
+ * starting with TSCH_TRACE_LINE_PREFIX, so that they can share the
+ * serial line with other logs. Platforms with a dedicated binary
+ * channel can output the raw bytes instead. */
+#ifdef TSCH_TRACE_CONF_OUTPUT
+#define TSCH_TRACE_OUTPUT(buf, len) TSCH_TRACE_CONF_OUTPUT(buf, len)
+#endif /* TSCH_TRACE_CONF_OUTPUT */
+
+/* Number of records per output line or output call */
+#ifdef TSCH_TRACE_CONF_RECORDS_PER_OUTPUT
+#define TSCH_TRACE_RECORDS_PER_OUTPUT TSCH_TRACE_CONF_RECORDS_PER_OUTPUT
+#else /* TSCH_TRACE_CONF_RECORDS_PER_OUTPUT */
+#define TSCH_TRACE_RECORDS_PER_OUTPUT 4
+#endif /* TSCH_TRACE_CONF_RECORDS_PER_OUTPUT */
+
+/********** Constants *********/
+
+#define TSCH_TRACE_LINE_PREFIX "#TT "
+
+/* Size of an encoded record */
+#define TSCH_TRACE_RECORD_LEN 16
+
+/* Event types */
+enum tsch_trace_event {
+  TSCH_TRACE_TX = 1,          /* A transmission attempt */
+  TSCH_TRACE_RX,              /* A frame was received */
+  TSCH_TRACE_DEADLINE_MISS,   /* A wakeup could not be scheduled in time */
+  TSCH_TRACE_SKIPPED_SLOT,    /* An active slot was skipped */
+  TSCH_TRACE_DROPPED,         /* Records were lost, the queue was full */
+};
+
+/* Bits of the info field. For TSCH_TRACE_TX, the lower bits hold the
+ * number of transmissions of the packet so far. */
+#define TSCH_TRACE_INFO_UNICAST 0x80
+#define TSCH_TRACE_INFO_DATA    0x40
+#define TSCH_TRACE_INFO_NUM_TX  0x3f
+
+/************ Types ***********/
+
+/* A trace record. The fields are ordered so that the structure has no
+ * padding, hence on little-endian platforms its memory is the encoded
+ * record, and the queue can be read directly from a memory dump. */
+struct tsch_trace_record {
+  uint32_t asn_ls4b;
+  uint8_t asn_ms1b;
+  uint8_t event;              /* enum tsch_trace_event */
+  uint8_t status;             /* TX: MAC_TX_ status. Unused otherwise */
+  uint8_t slotframe_handle;   /* 0xff if there was no link */
+  uint16_t timeslot;
+  uint8_t channel_offset;
+  uint8_t nbr;                /* Neighbor, as of TSCH_LOG_ID_FROM_LINKADDR */
+  int16_t delta;              /* Timing delta, in rtimer ticks. TX, RX: drift
+                                 correction, DEADLINE_MISS: lateness.
+                                 DROPPED: number of records lost */
+  uint8_t len;                /* Frame length */
+  uint8_t info;               /* TSCH_TRACE_INFO_ bits */
+};
+
+/********** Functions *********/
+
+#if TSCH_TRACE_ENABLED
+
+/* Prepare addition of a new record, with ASN and link filled in.
+ * Returns pointer to the record if success, NULL otherwise */
+struct tsch_trace_record *tsch_trace_prepare_add(uint8_t event);
+/* Actually add the previously prepared record */
+void tsch_trace_commit(void);
+/* Initialize trace module */
+void tsch_trace_init(void);
+/* Output pending records */
+void tsch_trace_process_pending(void);
+
+/************ Macros **********/
+
+/* Use this macro to add a record to the queue, from the slot operation */
+#define TSCH_TRACE_ADD(trace_event, init_code) do { \
+    struct tsch_trace_record *rec = tsch_trace_prepare_add(trace_event); \
+    if(rec != NULL) { \
+      init_code; \
+      tsch_trace_commit(); \
+    } \
+} while(0);
+
+#else /* TSCH_TRACE_ENABLED */
+
+#define tsch_trace_init()
+#define tsch_trace_process_pending()
+#define TSCH_TRACE_ADD(trace_event, init_code)
+
+#endif /* TSCH_TRACE_ENABLED */
+
+#endif /* __TSCH_TRACE_H__ */
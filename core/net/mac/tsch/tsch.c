@@ -52,6 +52,7 @@
 #include "net/mac/tsch/tsch-queue.h"
 #include "net/mac/tsch/tsch-private.h"
 #include "net/mac/tsch/tsch-log.h"
+#include "net/mac/tsch/tsch-trace.h"
 #include "net/mac/tsch/tsch-packet.h"
 #include "net/mac/tsch/tsch-security.h"
 #include "net/mac/mac-sequence.h"
@@ -341,9 +342,15 @@ eb_input(struct input_packet *current_input)
 static void
 tsch_rx_process_pending()
 {
-  int16_t input_index;
-  /* Loop on accessing (without removing) a pending input packet */
-  while((input_index = ringbufindex_peek_get(&input_ringbuf)) != -1) {
+  int first;
+  int count;
+  int i;
+  /* Process the packets that are pending when we start. Packets received
+   * in the meantime are left for the next poll of the process, so that a
+   * busy network does not starve other processes. */
+  count = ringbufindex_peek_get_batch(&input_ringbuf, &first);
+  for(i = 0; i < count; i++) {
+    int16_t input_index = (first + i) & (TSCH_MAX_INCOMING_PACKETS - 1);
     struct input_packet *current_input = &input_array[input_index];
     frame802154_t frame;
     uint8_t ret = frame802154_parse(current_input->payload, current_input->len, &frame);
@@ -358,16 +365,16 @@ tsch_rx_process_pending()
       packetbuf_copyfrom(current_input->payload, current_input->len);
       packetbuf_set_attr(PACKETBUF_ATTR_RSSI, current_input->rssi);
       packetbuf_set_attr(PACKETBUF_ATTR_CHANNEL, current_input->channel);
-    }
-
-    /* Remove input from ringbuf */
-    ringbufindex_get(&input_ringbuf);
-
-    if(is_data) {
+      /* Remove input from ringbuf, as it was copied */
+      ringbufindex_get_batch(&input_ringbuf, 1);
       /* Pass to upper layers */
       packet_input();
-    } else if(is_eb) {
-      eb_input(current_input);
+    } else {
+      if(is_eb) {
+        eb_input(current_input);
+      }
+      /* Remove input from ringbuf, only now that it was processed */
+      ringbufindex_get_batch(&input_ringbuf, 1);
     }
   }
 }
@@ -377,10 +384,13 @@ tsch_rx_process_pending()
 static void
 tsch_tx_process_pending()
 {
-  int16_t dequeued_index;
-  /* Loop on accessing (without removing) a pending input packet */
-  while((dequeued_index = ringbufindex_peek_get(&dequeued_ringbuf)) != -1) {
-    struct tsch_packet *p = dequeued_array[dequeued_index];
+  int first;
+  int count;
+  int i;
+  /* Process the packets that are pending when we start */
+  count = ringbufindex_peek_get_batch(&dequeued_ringbuf, &first);
+  for(i = 0; i < count; i++) {
+    struct tsch_packet *p = dequeued_array[(first + i) & (TSCH_DEQUEUED_ARRAY_SIZE - 1)];
     /* Put packet into packetbuf for packet_sent callback */
     queuebuf_to_packetbuf(p->qb);
     /* Call packet_sent callback */
@@ -390,7 +400,7 @@ tsch_tx_process_pending()
     /* Free all unused neighbors */
     tsch_queue_free_unused_neighbors();
     /* Remove dequeued packet from ringbuf */
-    ringbufindex_get(&dequeued_ringbuf);
+    ringbufindex_get_batch(&dequeued_ringbuf, 1);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -788,6 +798,7 @@ PROCESS_THREAD(tsch_pending_events_process, ev, data)
     tsch_rx_process_pending();
     tsch_tx_process_pending();
     tsch_log_process_pending();
+    tsch_trace_process_pending();
   }
   PROCESS_END();
 }
@@ -849,6 +860,10 @@ tsch_init(void)
   tsch_queue_init();
   tsch_schedule_init();
   tsch_log_init();
+  tsch_trace_init();
+#if LLSEC802154_ENABLED
+  tsch_security_init();
+#endif /* LLSEC802154_ENABLED */
   ringbufindex_init(&input_ringbuf, TSCH_MAX_INCOMING_PACKETS);
   ringbufindex_init(&dequeued_ringbuf, TSCH_DEQUEUED_ARRAY_SIZE);
 
@@ -49,6 +49,7 @@
 #include "net/rime/collect-neighbor.h"
 #include "net/rime/collect-link-estimate.h"
 #include "net/rime/packetqueue.h"
+#include "net/rime/dupcache.h"
 
 #include "dev/radio-sensor.h"
 
@@ -65,31 +66,43 @@ static const struct packetbuf_attrlist attributes[] =
   };
 
 
-/* The recent_packets list holds the sequence number, the originator,
-   and the connection for packets that have been recently
-   forwarded. This list is maintained to avoid forwarding duplicate
-   packets. */
-#define NUM_RECENT_PACKETS 16
-
-struct recent_packet {
-  struct collect_conn *conn;
-  linkaddr_t originator;
-  uint8_t eseqno;
-};
-
-static struct recent_packet recent_packets[NUM_RECENT_PACKETS];
-static uint8_t recent_packet_ptr;
+/* Recently forwarded packets are remembered in the dupcache, to
+   avoid forwarding duplicate packets. DUPCACHE_CONF_LIFETIME must
+   cover the time that a packet stays in the send queue, see
+   FORWARD_PACKET_LIFETIME_BASE. */
 
 
 /* This is the header of data packets. The header comtains the routing
    metric of the last hop sender. This is used to avoid routing loops:
    if a node receives a packet with a lower routing metric than its
-   own, it drops the packet. */
+   own, it drops the packet. The flags tell if the frame holds several
+   aggregated packets (DATA_FLAGS_AGGREGATE) and if it is part of a
+   burst (DATA_FLAGS_BURST), in which case burst_index is the position
+   of the frame in the burst and only the last frame of the burst
+   (DATA_FLAGS_ACK_REQUEST) is acknowledged. */
 struct data_msg_hdr {
-  uint8_t flags, dummy;
+  uint8_t flags, burst_index;
   uint16_t rtmetric;
 };
 
+#define DATA_FLAGS_AGGREGATE            0x80
+#define DATA_FLAGS_BURST                0x40
+#define DATA_FLAGS_ACK_REQUEST          0x20
+
+#if COLLECT_AGGREGATION
+/* In an aggregated frame, each packet is preceded by this header,
+   which holds the packet attributes that otherwise would be sent in
+   the packet header. */
+struct aggregate_hdr {
+  linkaddr_t originator;
+  uint8_t eseqno, hops, ttl, max_rexmit;
+  uint8_t len;
+};
+
+/* The received frame is kept here while its packets are unpacked. */
+static uint8_t aggregate_buf[PACKETBUF_SIZE];
+#endif /* COLLECT_AGGREGATION */
+
 
 /* This is the header of ACK packets. It contains a flags field that
    indicates if the node is congested (ACK_FLAGS_CONGESTED), if the
@@ -99,9 +112,11 @@ struct data_msg_hdr {
    (ACK_FLAGS_RTMETRIC_NEEDS_UPDATE). The flags can contain any
    combination of the flags. The ACK header also contains the routing
    metric of the node that sends tha ACK. This is used to keep an
-   up-to-date routing state in the network. */
+   up-to-date routing state in the network. When acknowledging a
+   burst, burst_acks has one bit set for each frame of the burst that
+   was received. */
 struct ack_msg {
-  uint8_t flags, dummy;
+  uint8_t flags, burst_acks;
   uint16_t rtmetric;
 };
 
@@ -110,6 +125,22 @@ struct ack_msg {
 #define ACK_FLAGS_LIFETIME_EXCEEDED     0x20
 #define ACK_FLAGS_RTMETRIC_NEEDS_UPDATE 0x10
 
+#if COLLECT_BURST_LENGTH > 1
+/* The frames received in the current burst of the most recent
+   senders. A burst is identified by the packet ID of its frames. */
+#define NUM_BURST_SENDERS 4
+
+struct burst_sender {
+  struct collect_conn *conn;
+  linkaddr_t addr;
+  uint8_t seqno;
+  uint8_t received;
+};
+
+static struct burst_sender burst_senders[NUM_BURST_SENDERS];
+static uint8_t burst_sender_ptr;
+#endif /* COLLECT_BURST_LENGTH > 1 */
+
 
 /* These are configuration knobs that normally should not be
    tweaked. MAX_MAC_REXMITS defines how many times the underlying CSMA
@@ -206,6 +237,9 @@ struct {
   uint32_t ttldrop;
   uint32_t ackdrop;
   uint32_t timedout;
+
+  uint32_t aggsent;
+  uint32_t burstsent;
 } stats;
 
 /* Debug definition: draw routing tree in Cooja. */
@@ -223,6 +257,8 @@ static void send_queued_packet(struct collect_conn *c);
 static void retransmit_callback(void *ptr);
 static void retransmit_not_sent_callback(void *ptr);
 static void set_keepalive_timer(struct collect_conn *c);
+static void send_ack(struct collect_conn *tc, const linkaddr_t *to, int flags,
+                     uint8_t burst_acks);
 
 /*---------------------------------------------------------------------------*/
 /**
@@ -558,6 +594,203 @@ proactive_probing_callback(void *ptr)
   }
 }
 /*---------------------------------------------------------------------------*/
+/* The queued packets of the current burst are marked with the number
+   of their frame plus one, so that they are found even if other
+   packets time out of the queue during the burst. MARK_AGGREGATED
+   tells that the packet has been counted as sent in an aggregate. */
+#define MARK_FRAME      0x0f
+#define MARK_AGGREGATED 0x80
+/*---------------------------------------------------------------------------*/
+/**
+ * This function returns the number of queued packets, starting with
+ * the packet i, that are sent in one frame. Without aggregation, each
+ * frame holds one packet. With aggregation, as many data packets as
+ * fit into COLLECT_AGGREGATION_MAX_LEN bytes are sent together.
+ */
+static int
+count_frame_packets(struct packetqueue_item *i)
+{
+#if COLLECT_AGGREGATION
+  int len, plen, n;
+
+  len = sizeof(struct data_msg_hdr);
+  for(n = 0; i != NULL && n < 255; n++, i = list_item_next(i)) {
+    plen = queuebuf_datalen(packetqueue_queuebuf(i)) -
+      sizeof(struct data_msg_hdr);
+    /* Dummy packets, which have no data, are never aggregated. */
+    if(plen <= 0 ||
+       len + sizeof(struct aggregate_hdr) + plen > COLLECT_AGGREGATION_MAX_LEN) {
+      break;
+    }
+    len += sizeof(struct aggregate_hdr) + plen;
+  }
+  return n > 1 ? n : 1;
+#else /* COLLECT_AGGREGATION */
+  return 1;
+#endif /* COLLECT_AGGREGATION */
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * This function divides the packets at the head of the send queue
+ * into the frames of the next burst, and marks each packet with its
+ * frame. Without bursts, only the first frame is sent before waiting
+ * for an ACK.
+ */
+static void
+plan_burst(struct collect_conn *c)
+{
+  struct packetqueue_item *i;
+  uint8_t mark;
+  int k, n;
+
+  c->burst_frames = 0;
+  c->burst_frame = 0;
+  i = packetqueue_first(&c->send_queue);
+  while(i != NULL && c->burst_frames < COLLECT_BURST_LENGTH) {
+    /* A dummy packet is not sent in a burst. */
+    if(c->burst_frames > 0 &&
+       queuebuf_datalen(packetqueue_queuebuf(i)) <= sizeof(struct data_msg_hdr)) {
+      break;
+    }
+    n = count_frame_packets(i);
+    c->frame_packets[c->burst_frames] = n;
+    for(k = 0; k < n && i != NULL; k++) {
+      mark = packetqueue_mark(i) & ~MARK_FRAME;
+      /* A packet that is sent again is not counted again. */
+      if(n > 1 && (mark & MARK_AGGREGATED) == 0) {
+        stats.aggsent++;
+        mark |= MARK_AGGREGATED;
+      }
+      packetqueue_set_mark(i, mark | (c->burst_frames + 1));
+      i = list_item_next(i);
+    }
+    c->burst_frames++;
+    if(c->frame_packets[0] == 1 &&
+       queuebuf_datalen(packetqueue_queuebuf(packetqueue_first(&c->send_queue))) <=
+       sizeof(struct data_msg_hdr)) {
+      break;
+    }
+  }
+  if(c->burst_frames > 1) {
+    stats.burstsent += c->burst_frames;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * This function places a frame of the current burst into the
+ * packetbuf. The packet attributes are those of the first packet in
+ * the frame. If the frame holds more than one packet, the packets are
+ * preceded by their own headers. The function returns zero if all
+ * packets of the frame have timed out of the queue.
+ */
+static int
+load_frame(struct collect_conn *c, int frame)
+{
+  struct packetqueue_item *i, *next;
+  int n;
+#if COLLECT_AGGREGATION
+  struct aggregate_hdr hdr;
+  struct queuebuf *q;
+  uint8_t *buf;
+  int k, len, plen;
+#endif /* COLLECT_AGGREGATION */
+
+  i = packetqueue_first(&c->send_queue);
+  while(i != NULL && (packetqueue_mark(i) & MARK_FRAME) != frame + 1) {
+    i = list_item_next(i);
+  }
+  if(i == NULL) {
+    return 0;
+  }
+
+  /* The packets of a frame stay next to each other in the queue. */
+  n = 0;
+  for(next = i; next != NULL &&
+        (packetqueue_mark(next) & MARK_FRAME) == frame + 1;
+      next = list_item_next(next)) {
+    n++;
+  }
+  c->frame_packets[frame] = n;
+
+  queuebuf_to_packetbuf(packetqueue_queuebuf(i));
+
+#if COLLECT_AGGREGATION
+  if(c->frame_packets[frame] > 1) {
+    buf = packetbuf_dataptr();
+    len = sizeof(struct data_msg_hdr);
+    for(k = 0; k < c->frame_packets[frame] && i != NULL; k++) {
+      q = packetqueue_queuebuf(i);
+      plen = queuebuf_datalen(q) - sizeof(struct data_msg_hdr);
+      linkaddr_copy(&hdr.originator, queuebuf_addr(q, PACKETBUF_ADDR_ESENDER));
+      hdr.eseqno = queuebuf_attr(q, PACKETBUF_ATTR_EPACKET_ID);
+      hdr.hops = queuebuf_attr(q, PACKETBUF_ATTR_HOPS);
+      hdr.ttl = queuebuf_attr(q, PACKETBUF_ATTR_TTL);
+      hdr.max_rexmit = queuebuf_attr(q, PACKETBUF_ATTR_MAX_REXMIT);
+      hdr.len = plen;
+      memcpy(&buf[len], &hdr, sizeof(struct aggregate_hdr));
+      len += sizeof(struct aggregate_hdr);
+      memcpy(&buf[len], (uint8_t *)queuebuf_dataptr(q) +
+             sizeof(struct data_msg_hdr), plen);
+      len += plen;
+      i = list_item_next(i);
+    }
+    packetbuf_set_datalen(len);
+  }
+#endif /* COLLECT_AGGREGATION */
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * This function fills in the header of the frame being sent.
+ */
+static void
+frame_header(struct collect_conn *c, struct data_msg_hdr *hdr)
+{
+  memset(hdr, 0, sizeof(struct data_msg_hdr));
+  hdr->rtmetric = c->rtmetric;
+  if(c->frame_packets[c->burst_frame] > 1) {
+    hdr->flags |= DATA_FLAGS_AGGREGATE;
+  }
+  if(c->burst_frames > 1) {
+    hdr->flags |= DATA_FLAGS_BURST;
+    hdr->burst_index = c->burst_frame;
+    if(c->burst_frame == c->burst_frames - 1) {
+      hdr->flags |= DATA_FLAGS_ACK_REQUEST;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * This function removes the packets of the acknowledged frames of the
+ * current burst from the send queue, and unmarks the others. Bit n in
+ * the acks parameter is set if frame n was acknowledged.
+ */
+static void
+remove_frames(struct collect_conn *c, uint8_t acks)
+{
+  struct packetqueue_item *i, *next;
+  uint8_t mark;
+
+  if(c->burst_frames == 0) {
+    packetqueue_dequeue(&c->send_queue);
+    return;
+  }
+
+  for(i = packetqueue_first(&c->send_queue); i != NULL; i = next) {
+    next = list_item_next(i);
+    mark = packetqueue_mark(i);
+    if((mark & MARK_FRAME) != 0) {
+      if(acks & (1 << ((mark & MARK_FRAME) - 1))) {
+        packetqueue_remove(&c->send_queue, i);
+      } else {
+        packetqueue_set_mark(i, mark & ~MARK_FRAME);
+      }
+    }
+  }
+  c->burst_frames = 0;
+}
+/*---------------------------------------------------------------------------*/
 /**
  * This function is called when a queued packet should be sent
  * out. The function takes the first packet on the output queue, adds
@@ -595,8 +828,10 @@ send_queued_packet(struct collect_conn *c)
   /* We should send the first packet from the queue. */
   q = packetqueue_queuebuf(i);
   if(q != NULL) {
-    /* Place the queued packet into the packetbuf. */
-    queuebuf_to_packetbuf(q);
+    /* Divide the packets at the head of the queue into the frames of
+       a burst and place the first frame into the packetbuf. */
+    plan_burst(c);
+    load_frame(c, 0);
 
     /* Pick the neighbor to which to send the packet. We use the
        parent in the n->parent. */
@@ -643,8 +878,7 @@ send_queued_packet(struct collect_conn *c)
 
       /* Copy our rtmetric into the packet header of the outgoing
          packet. */
-      memset(&hdr, 0, sizeof(hdr));
-      hdr.rtmetric = c->rtmetric;
+      frame_header(c, &hdr);
       memcpy(packetbuf_dataptr(), &hdr, sizeof(struct data_msg_hdr));
 
       /* Send the packet. */
@@ -698,8 +932,18 @@ retransmit_current_packet(struct collect_conn *c)
 
     update_rtmetric(c);
     
-    /* Place the queued packet into the packetbuf. */
-    queuebuf_to_packetbuf(q);
+    /* Place the current frame into the packetbuf. If its packets
+       have timed out of the queue, the remaining packets are sent in
+       a new burst. */
+    if(!load_frame(c, c->burst_frame)) {
+      remove_frames(c, 0);
+      c->seqno = (c->seqno + 1) % (1 << COLLECT_PACKET_ID_BITS);
+      ctimer_stop(&c->retransmission_timer);
+      c->sending = 0;
+      c->transmissions = 0;
+      send_queued_packet(c);
+      return;
+    }
 
     /* Pick the neighbor to which to send the packet. If we have found
        a better parent while we were transmitting this packet, we
@@ -744,8 +988,7 @@ retransmit_current_packet(struct collect_conn *c)
 
       /* Copy our rtmetric into the packet header of the outgoing
          packet. */
-      memset(&hdr, 0, sizeof(hdr));
-      hdr.rtmetric = c->rtmetric;
+      frame_header(c, &hdr);
       memcpy(packetbuf_dataptr(), &hdr, sizeof(struct data_msg_hdr));
 
       /* Send the packet. */
@@ -758,8 +1001,8 @@ retransmit_current_packet(struct collect_conn *c)
 static void
 send_next_packet(struct collect_conn *tc)
 {
-  /* Remove the first packet on the queue, the packet that was just sent. */
-  packetqueue_dequeue(&tc->send_queue);
+  /* Remove the first frame on the queue, the frame that was just sent. */
+  remove_frames(tc, 1);
   tc->seqno = (tc->seqno + 1) % (1 << COLLECT_PACKET_ID_BITS);
 
   /* Cancel retransmission timer. */
@@ -774,6 +1017,56 @@ send_next_packet(struct collect_conn *tc)
   send_queued_packet(tc);
 }
 /*---------------------------------------------------------------------------*/
+#if COLLECT_BURST_LENGTH > 1
+static void
+send_queued_packet_callback(void *ptr)
+{
+  send_queued_packet(ptr);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * This function is called when the ACK for the last frame of a burst
+ * is received. The ACK tells which frames of the burst were
+ * received. The packets in those frames are removed from the queue
+ * and the remaining packets are sent in a new burst.
+ */
+static void
+burst_acked(struct collect_conn *tc, struct collect_neighbor *n,
+            uint8_t acks)
+{
+  uint8_t all;
+
+  all = (1 << tc->burst_frames) - 1;
+  acks &= all;
+
+  PRINTF("%d.%d: burst of %d frames, acks %02x\n",
+         linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+         tc->burst_frames, acks);
+
+  remove_frames(tc, acks);
+  tc->seqno = (tc->seqno + 1) % (1 << COLLECT_PACKET_ID_BITS);
+
+  ctimer_stop(&tc->retransmission_timer);
+  tc->sending = 0;
+  tc->transmissions = 0;
+
+  if(acks == all) {
+    send_queued_packet(tc);
+  } else {
+    /* If no frame of the burst was received, the parent dropped the
+       packets without being congested, so we penalize it as for a
+       single dropped packet. */
+    if(acks == 0 && n != NULL) {
+      collect_neighbor_tx(n, tc->max_rexmits);
+      update_rtmetric(tc);
+    }
+    ctimer_set(&tc->retransmission_timer,
+               REXMIT_TIME + (random_rand() % (REXMIT_TIME)),
+               send_queued_packet_callback, tc);
+  }
+}
+#endif /* COLLECT_BURST_LENGTH > 1 */
+/*---------------------------------------------------------------------------*/
 static void
 handle_ack(struct collect_conn *tc)
 {
@@ -839,6 +1132,12 @@ handle_ack(struct collect_conn *tc)
       }
       update_rtmetric(tc);
     }
+#if COLLECT_BURST_LENGTH > 1
+    if(tc->burst_frames > 1) {
+      /* The ACK covers all frames of the burst. */
+      burst_acked(tc, n, msg.burst_acks);
+    } else
+#endif /* COLLECT_BURST_LENGTH > 1 */
     if((msg.flags & ACK_FLAGS_DROPPED) == 0) {
       /* If the packet was successfully received, we send the next packet. */
       send_next_packet(tc);
@@ -874,7 +1173,8 @@ handle_ack(struct collect_conn *tc)
 }
 /*---------------------------------------------------------------------------*/
 static void
-send_ack(struct collect_conn *tc, const linkaddr_t *to, int flags)
+send_ack(struct collect_conn *tc, const linkaddr_t *to, int flags,
+         uint8_t burst_acks)
 {
   struct ack_msg *ack;
   uint16_t packet_seqno = packetbuf_attr(PACKETBUF_ATTR_PACKET_ID);
@@ -885,6 +1185,7 @@ send_ack(struct collect_conn *tc, const linkaddr_t *to, int flags)
   memset(ack, 0, sizeof(struct ack_msg));
   ack->rtmetric = tc->rtmetric;
   ack->flags = flags;
+  ack->burst_acks = burst_acks;
 
   packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, to);
   packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE, PACKETBUF_ATTR_PACKET_TYPE_ACK);
@@ -904,6 +1205,20 @@ send_ack(struct collect_conn *tc, const linkaddr_t *to, int flags)
 }
 /*---------------------------------------------------------------------------*/
 static void
+add_to_recent_packets(struct collect_conn *tc, const linkaddr_t *originator,
+                      uint8_t eseqno)
+{
+  dupcache_add(tc, originator, eseqno);
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_recent_packet(struct collect_conn *tc, const linkaddr_t *originator,
+                 uint8_t eseqno)
+{
+  return dupcache_lookup(tc, originator, eseqno);
+}
+/*---------------------------------------------------------------------------*/
+static void
 add_packet_to_recent_packets(struct collect_conn *tc)
 {
   /* Remember that we have seen this packet for later, but only if
@@ -911,21 +1226,208 @@ add_packet_to_recent_packets(struct collect_conn *tc)
      zero are keepalive or proactive link estimate probes, so we do
      not record them in our history. */
   if(packetbuf_datalen() > sizeof(struct data_msg_hdr)) {
-    recent_packets[recent_packet_ptr].eseqno =
-      packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID);
-    linkaddr_copy(&recent_packets[recent_packet_ptr].originator,
-                  packetbuf_addr(PACKETBUF_ADDR_ESENDER));
-    recent_packets[recent_packet_ptr].conn = tc;
-    recent_packet_ptr = (recent_packet_ptr + 1) % NUM_RECENT_PACKETS;
+    add_to_recent_packets(tc, packetbuf_addr(PACKETBUF_ADDR_ESENDER),
+                          packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID));
   }
 }
 /*---------------------------------------------------------------------------*/
+/**
+ * This function acknowledges a received data frame. A frame that is
+ * part of a burst is only acknowledged if it is the last frame of the
+ * burst. The ACK then tells which frames of the burst were received.
+ */
+static void
+acknowledge(struct collect_conn *tc, const linkaddr_t *to,
+            const struct data_msg_hdr *hdr, int flags)
+{
+#if COLLECT_BURST_LENGTH > 1
+  struct burst_sender *s;
+  uint8_t seqno;
+  int i;
+
+  if(hdr->flags & DATA_FLAGS_BURST) {
+    seqno = packetbuf_attr(PACKETBUF_ATTR_PACKET_ID);
+    s = NULL;
+    for(i = 0; i < NUM_BURST_SENDERS; i++) {
+      if(burst_senders[i].conn == tc &&
+         linkaddr_cmp(&burst_senders[i].addr, to)) {
+        s = &burst_senders[i];
+        break;
+      }
+    }
+    if(s == NULL) {
+      s = &burst_senders[burst_sender_ptr];
+      burst_sender_ptr = (burst_sender_ptr + 1) % NUM_BURST_SENDERS;
+      s->conn = tc;
+      linkaddr_copy(&s->addr, to);
+      s->seqno = seqno;
+      s->received = 0;
+    }
+
+    /* A new packet ID starts a new burst. */
+    if(s->seqno != seqno) {
+      s->seqno = seqno;
+      s->received = 0;
+    }
+
+    /* Packets that were dropped because their lifetime was exceeded
+       must not be sent again, so we acknowledge them as well. */
+    if(hdr->burst_index < 8 &&
+       ((flags & ACK_FLAGS_DROPPED) == 0 ||
+        (flags & ACK_FLAGS_LIFETIME_EXCEEDED))) {
+      s->received |= 1 << hdr->burst_index;
+    }
+
+    if(hdr->flags & DATA_FLAGS_ACK_REQUEST) {
+      send_ack(tc, to, flags, s->received);
+    }
+    return;
+  }
+#endif /* COLLECT_BURST_LENGTH > 1 */
+  send_ack(tc, to, flags, 0);
+}
+/*---------------------------------------------------------------------------*/
+#if COLLECT_AGGREGATION
+/**
+ * This function handles a frame with aggregated packets. At the
+ * sink, each packet is passed to the application. At other nodes, each
+ * packet is put on the send queue, as if it had been received in a
+ * frame of its own.
+ */
+static void
+aggregate_received(struct collect_conn *tc, const linkaddr_t *from,
+                   const struct data_msg_hdr *hdr, uint8_t ackflags)
+{
+  struct aggregate_hdr ahdr;
+  uint16_t packet_id;
+  int len, pos, count, enqueued;
+
+  packet_id = packetbuf_attr(PACKETBUF_ATTR_PACKET_ID);
+  len = packetbuf_datalen();
+  memcpy(aggregate_buf, packetbuf_dataptr(), len);
+
+  count = 0;
+  pos = sizeof(struct data_msg_hdr);
+  while(pos + sizeof(struct aggregate_hdr) <= len) {
+    memcpy(&ahdr, &aggregate_buf[pos], sizeof(struct aggregate_hdr));
+    pos += sizeof(struct aggregate_hdr) + ahdr.len;
+    count++;
+  }
+  if(pos != len || count == 0) {
+    PRINTF("%d.%d: malformed aggregated frame from %d.%d\n",
+           linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+           from->u8[0], from->u8[1]);
+    return;
+  }
+
+  if(tc->rtmetric == RTMETRIC_SINK) {
+    /* We first send the ACK, since the packetbuf is reused for the
+       packets that we pass to the application. */
+    acknowledge(tc, from, hdr, 0);
+
+    for(pos = sizeof(struct data_msg_hdr); pos < len;
+        pos += sizeof(struct aggregate_hdr) + ahdr.len) {
+      memcpy(&ahdr, &aggregate_buf[pos], sizeof(struct aggregate_hdr));
+      if(is_recent_packet(tc, &ahdr.originator, ahdr.eseqno)) {
+        stats.duprecv++;
+        continue;
+      }
+      add_to_recent_packets(tc, &ahdr.originator, ahdr.eseqno);
+
+      packetbuf_clear();
+      packetbuf_copyfrom(&aggregate_buf[pos + sizeof(struct aggregate_hdr)],
+                         ahdr.len);
+      packetbuf_set_addr(PACKETBUF_ADDR_ESENDER, &ahdr.originator);
+      packetbuf_set_attr(PACKETBUF_ATTR_EPACKET_ID, ahdr.eseqno);
+      packetbuf_set_attr(PACKETBUF_ATTR_HOPS, ahdr.hops);
+
+      PRINTF("%d.%d: sink received aggregated packet %d from %d.%d via %d.%d\n",
+             linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+             ahdr.eseqno, ahdr.originator.u8[0], ahdr.originator.u8[1],
+             from->u8[0], from->u8[1]);
+
+      if(tc->cb->recv != NULL) {
+        tc->cb->recv(&ahdr.originator, ahdr.eseqno, ahdr.hops);
+      }
+    }
+    return;
+  }
+
+  if(tc->rtmetric == RTMETRIC_MAX) {
+    return;
+  }
+
+  /* We make sure that there is room for all packets of the frame on
+     the send queue, while still keeping entries for packets that are
+     originated by this node. */
+  if(packetqueue_len(&tc->send_queue) + count - 1 >
+     MAX_SENDING_QUEUE - MIN_AVAILABLE_QUEUE_ENTRIES) {
+    acknowledge(tc, from, hdr,
+                ackflags | ACK_FLAGS_DROPPED | ACK_FLAGS_CONGESTED);
+    PRINTF("%d.%d: aggregated frame dropped: no queue buffer available\n",
+           linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1]);
+    stats.qdrop += count;
+    return;
+  }
+
+  if(hdr->rtmetric <= tc->rtmetric) {
+    ackflags |= ACK_FLAGS_RTMETRIC_NEEDS_UPDATE;
+  }
+
+  enqueued = 0;
+  for(pos = sizeof(struct data_msg_hdr); pos < len;
+      pos += sizeof(struct aggregate_hdr) + ahdr.len) {
+    memcpy(&ahdr, &aggregate_buf[pos], sizeof(struct aggregate_hdr));
+    if(is_recent_packet(tc, &ahdr.originator, ahdr.eseqno)) {
+      stats.duprecv++;
+      continue;
+    }
+    if(ahdr.ttl <= 1) {
+      stats.ttldrop++;
+      continue;
+    }
+
+    packetbuf_clear();
+    packetbuf_copyfrom(&aggregate_buf[pos + sizeof(struct aggregate_hdr)],
+                       ahdr.len);
+    packetbuf_set_addr(PACKETBUF_ADDR_ESENDER, &ahdr.originator);
+    packetbuf_set_attr(PACKETBUF_ATTR_EPACKET_ID, ahdr.eseqno);
+    packetbuf_set_attr(PACKETBUF_ATTR_HOPS, ahdr.hops + 1);
+    packetbuf_set_attr(PACKETBUF_ATTR_TTL, ahdr.ttl - 1);
+    packetbuf_set_attr(PACKETBUF_ATTR_MAX_REXMIT, ahdr.max_rexmit);
+    packetbuf_hdralloc(sizeof(struct data_msg_hdr));
+
+    if(!packetqueue_enqueue_packetbuf(&tc->send_queue,
+                                      FORWARD_PACKET_LIFETIME_BASE *
+                                      ahdr.max_rexmit,
+                                      tc)) {
+      /* The packets that were already enqueued are recorded as
+         recent packets, so they are acknowledged as duplicates when
+         the frame is sent again. */
+      ackflags |= ACK_FLAGS_DROPPED | ACK_FLAGS_CONGESTED;
+      stats.qdrop++;
+      break;
+    }
+    add_to_recent_packets(tc, &ahdr.originator, ahdr.eseqno);
+    enqueued++;
+  }
+
+  /* The ACK uses the packet ID of the frame. */
+  packetbuf_clear();
+  packetbuf_set_attr(PACKETBUF_ATTR_PACKET_ID, packet_id);
+  acknowledge(tc, from, hdr, ackflags);
+
+  if(enqueued > 0) {
+    send_queued_packet(tc);
+  }
+}
+#endif /* COLLECT_AGGREGATION */
+/*---------------------------------------------------------------------------*/
 static void
 node_packet_received(struct unicast_conn *c, const linkaddr_t *from)
 {
   struct collect_conn *tc = (struct collect_conn *)
     ((char *)c - offsetof(struct collect_conn, unicast_conn));
-  int i;
   struct data_msg_hdr hdr;
   uint8_t ackflags = 0;
   struct collect_neighbor *n;
@@ -972,23 +1474,27 @@ node_packet_received(struct unicast_conn *c, const linkaddr_t *from)
       ackflags |= ACK_FLAGS_CONGESTED;
     }
 
-    for(i = 0; i < NUM_RECENT_PACKETS; i++) {
-      if(recent_packets[i].conn == tc &&
-         recent_packets[i].eseqno == packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID) &&
-         linkaddr_cmp(&recent_packets[i].originator,
-                      packetbuf_addr(PACKETBUF_ADDR_ESENDER))) {
-        /* This is a duplicate of a packet we recently received, so we
-           just send an ACK. */
-        PRINTF("%d.%d: found duplicate packet from %d.%d with seqno %d, via %d.%d\n",
-               linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
-               recent_packets[i].originator.u8[0], recent_packets[i].originator.u8[1],
-               packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID),
-               packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[0],
-               packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[1]);
-        send_ack(tc, &ack_to, ackflags);
-        stats.duprecv++;
-        return;
-      }
+#if COLLECT_AGGREGATION
+    if(hdr.flags & DATA_FLAGS_AGGREGATE) {
+      aggregate_received(tc, &ack_to, &hdr, ackflags);
+      return;
+    }
+#endif /* COLLECT_AGGREGATION */
+
+    if(is_recent_packet(tc, packetbuf_addr(PACKETBUF_ADDR_ESENDER),
+                        packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID))) {
+      /* This is a duplicate of a packet we recently received, so we
+         just send an ACK. */
+      PRINTF("%d.%d: found duplicate packet from %d.%d with seqno %d, via %d.%d\n",
+             linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+             packetbuf_addr(PACKETBUF_ADDR_ESENDER)->u8[0],
+             packetbuf_addr(PACKETBUF_ADDR_ESENDER)->u8[1],
+             packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID),
+             packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[0],
+             packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[1]);
+      acknowledge(tc, &ack_to, &hdr, ackflags);
+      stats.duprecv++;
+      return;
     }
 
     /* If we are the sink, the packet has reached its final
@@ -1002,7 +1508,7 @@ node_packet_received(struct unicast_conn *c, const linkaddr_t *from)
          first. */
       q = queuebuf_new_from_packetbuf();
       if(q != NULL) {
-        send_ack(tc, &ack_to, 0);
+        acknowledge(tc, &ack_to, &hdr, 0);
         queuebuf_to_packetbuf(q);
         queuebuf_free(q);
       } else {
@@ -1069,11 +1575,11 @@ node_packet_received(struct unicast_conn *c, const linkaddr_t *from)
                                        packetbuf_attr(PACKETBUF_ATTR_MAX_REXMIT),
                                        tc)) {
         add_packet_to_recent_packets(tc);
-        send_ack(tc, &ack_to, ackflags);
+        acknowledge(tc, &ack_to, &hdr, ackflags);
         send_queued_packet(tc);
       } else {
-        send_ack(tc, &ack_to,
-                 ackflags | ACK_FLAGS_DROPPED | ACK_FLAGS_CONGESTED);
+        acknowledge(tc, &ack_to, &hdr,
+                    ackflags | ACK_FLAGS_DROPPED | ACK_FLAGS_CONGESTED);
         PRINTF("%d.%d: packet dropped: no queue buffer available\n",
                   linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1]);
         stats.qdrop++;
@@ -1082,8 +1588,8 @@ node_packet_received(struct unicast_conn *c, const linkaddr_t *from)
       PRINTF("%d.%d: packet dropped: ttl %d\n",
              linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
              packetbuf_attr(PACKETBUF_ATTR_TTL));
-      send_ack(tc, &ack_to, ackflags |
-               ACK_FLAGS_DROPPED | ACK_FLAGS_LIFETIME_EXCEEDED);
+      acknowledge(tc, &ack_to, &hdr, ackflags |
+                  ACK_FLAGS_DROPPED | ACK_FLAGS_LIFETIME_EXCEEDED);
       stats.ttldrop++;
     }
   } else if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
@@ -1136,6 +1642,17 @@ node_packet_sent(struct unicast_conn *c, int status, int transmissions)
   if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
      PACKETBUF_ATTR_PACKET_TYPE_DATA) {
 
+    /* In a burst, the frames are sent back to back and only the last
+       frame asks for an ACK, so the transmissions are counted for the
+       last frame only. */
+    if(tc->burst_frames > 1 && tc->burst_frame < tc->burst_frames - 1) {
+      ctimer_stop(&tc->retransmission_timer);
+      tc->burst_frame++;
+      tc->sending = 0;
+      retransmit_current_packet(tc);
+      return;
+    }
+
     tc->transmissions += transmissions;
     PRINTF("tx %d\n", tc->transmissions);    
     PRINTF("%d.%d: MAC sent %d transmissions to %d.%d, status %d, total transmissions %d\n",
@@ -1386,6 +1903,7 @@ collect_close(struct collect_conn *tc)
   while(packetqueue_first(&tc->send_queue) != NULL) {
     packetqueue_dequeue(&tc->send_queue);
   }
+  dupcache_flush(tc);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -1401,6 +1919,7 @@ collect_set_sink(struct collect_conn *tc, int should_be_sink)
     while(packetqueue_len(&tc->send_queue) > 0) {
       packetqueue_dequeue(&tc->send_queue);
     }
+    tc->burst_frames = 0;
 
     /* Stop the retransmission timer. */
     ctimer_stop(&tc->retransmission_timer);
@@ -1547,12 +2066,12 @@ collect_purge(struct collect_conn *tc)
 void
 collect_print_stats(void)
 {
-  PRINTF("collect stats foundroute %lu newparent %lu routelost %lu acksent %lu datasent %lu datarecv %lu ackrecv %lu badack %lu duprecv %lu qdrop %lu rtdrop %lu ttldrop %lu ackdrop %lu timedout %lu\n",
+  PRINTF("collect stats foundroute %lu newparent %lu routelost %lu acksent %lu datasent %lu datarecv %lu ackrecv %lu badack %lu duprecv %lu qdrop %lu rtdrop %lu ttldrop %lu ackdrop %lu timedout %lu aggsent %lu burstsent %lu\n",
          stats.foundroute, stats.newparent, stats.routelost,
          stats.acksent, stats.datasent, stats.datarecv,
          stats.ackrecv, stats.badack, stats.duprecv,
          stats.qdrop, stats.rtdrop, stats.ttldrop, stats.ackdrop,
-         stats.timedout);
+         stats.timedout, stats.aggsent, stats.burstsent);
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
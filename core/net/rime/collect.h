@@ -114,6 +114,33 @@ struct collect_callbacks {
 #define COLLECT_ANNOUNCEMENTS COLLECT_CONF_ANNOUNCEMENTS
 #endif /* COLLECT_CONF_ANNOUNCEMENTS */
 
+/* COLLECT_CONF_AGGREGATION defines if packets on the send queue
+   should be packed into a single frame to the parent, as many as fit
+   into COLLECT_AGGREGATION_MAX_LEN bytes. All nodes in the network
+   must use the same setting. */
+#ifdef COLLECT_CONF_AGGREGATION
+#define COLLECT_AGGREGATION COLLECT_CONF_AGGREGATION
+#else /* COLLECT_CONF_AGGREGATION */
+#define COLLECT_AGGREGATION 0
+#endif /* COLLECT_CONF_AGGREGATION */
+
+#ifdef COLLECT_CONF_AGGREGATION_MAX_LEN
+#define COLLECT_AGGREGATION_MAX_LEN COLLECT_CONF_AGGREGATION_MAX_LEN
+#else /* COLLECT_CONF_AGGREGATION_MAX_LEN */
+#define COLLECT_AGGREGATION_MAX_LEN 80
+#endif /* COLLECT_CONF_AGGREGATION_MAX_LEN */
+
+/* COLLECT_CONF_BURST_LENGTH defines how many frames from the send
+   queue are sent back-to-back before waiting for an ACK from the
+   parent. The ACK of a burst tells which of its frames the parent
+   received. A burst length of one disables bursts, and the maximum is
+   eight. All nodes in the network must either use bursts or not. */
+#ifdef COLLECT_CONF_BURST_LENGTH
+#define COLLECT_BURST_LENGTH COLLECT_CONF_BURST_LENGTH
+#else /* COLLECT_CONF_BURST_LENGTH */
+#define COLLECT_BURST_LENGTH 1
+#endif /* COLLECT_CONF_BURST_LENGTH */
+
 struct collect_conn {
   struct unicast_conn unicast_conn;
 #if ! COLLECT_ANNOUNCEMENTS
@@ -140,6 +167,11 @@ struct collect_conn {
   uint8_t eseqno;
   uint8_t is_router;
 
+  /* The frames that are being sent: the number of queued packets in
+     each frame, the number of frames, and the frame being sent. */
+  uint8_t frame_packets[COLLECT_BURST_LENGTH];
+  uint8_t burst_frames, burst_frame;
+
   clock_time_t send_time;
 };
 
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A hashed cache of recently seen packets
+ */
+
+/**
+ * \addtogroup dupcache
+ * @{
+ */
+
+#include "contiki.h"
+#include "net/rime/dupcache.h"
+#include "net/rime/rimestats.h"
+
+/* The number of slots that are probed, starting at the hashed one. */
+#define PROBES 4
+
+struct dupcache_entry {
+  const void *owner;
+  linkaddr_t originator;
+  uint16_t seqno;
+  uint16_t time;
+};
+
+static struct dupcache_entry cache[DUPCACHE_SIZE];
+
+/*---------------------------------------------------------------------------*/
+static unsigned
+hash(const linkaddr_t *originator, uint16_t seqno)
+{
+  unsigned h;
+  int i;
+
+  h = seqno;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = h * 31 + originator->u8[i];
+  }
+  return (h ^ (h >> 5)) & (DUPCACHE_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+static int
+expired(struct dupcache_entry *e, uint16_t now)
+{
+  return e->owner == NULL || (uint16_t)(now - e->time) >= DUPCACHE_LIFETIME;
+}
+/*---------------------------------------------------------------------------*/
+static struct dupcache_entry *
+find(const void *owner, const linkaddr_t *originator, uint16_t seqno,
+     uint16_t now)
+{
+  struct dupcache_entry *e;
+  unsigned h;
+  int i;
+
+  h = hash(originator, seqno);
+  for(i = 0; i < PROBES; i++) {
+    e = &cache[(h + i) & (DUPCACHE_SIZE - 1)];
+    if(e->owner == owner && e->seqno == seqno &&
+       linkaddr_cmp(&e->originator, originator) && !expired(e, now)) {
+      return e;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+dupcache_lookup(const void *owner, const linkaddr_t *originator,
+                uint16_t seqno)
+{
+  if(find(owner, originator, seqno, (uint16_t)clock_seconds()) != NULL) {
+    RIMESTATS_ADD(dupdrop);
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+dupcache_add(const void *owner, const linkaddr_t *originator,
+             uint16_t seqno)
+{
+  struct dupcache_entry *e, *oldest;
+  uint16_t now;
+  unsigned h;
+  int i;
+
+  now = (uint16_t)clock_seconds();
+  e = find(owner, originator, seqno, now);
+  if(e == NULL) {
+    /* Take the first free slot, or else the oldest one. */
+    h = hash(originator, seqno);
+    oldest = NULL;
+    for(i = 0; i < PROBES; i++) {
+      e = &cache[(h + i) & (DUPCACHE_SIZE - 1)];
+      if(expired(e, now)) {
+        break;
+      }
+      if(oldest == NULL ||
+         (uint16_t)(now - e->time) > (uint16_t)(now - oldest->time)) {
+        oldest = e;
+      }
+    }
+    if(i == PROBES) {
+      RIMESTATS_ADD(dupevict);
+      e = oldest;
+    }
+    e->owner = owner;
+    linkaddr_copy(&e->originator, originator);
+    e->seqno = seqno;
+  }
+  e->time = now;
+}
+/*---------------------------------------------------------------------------*/
+void
+dupcache_flush(const void *owner)
+{
+  int i;
+
+  for(i = 0; i < DUPCACHE_SIZE; i++) {
+    if(cache[i].owner == owner) {
+      cache[i].owner = NULL;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
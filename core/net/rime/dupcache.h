@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the duplicate packet cache
+ */
+
+/**
+ * \addtogroup rime
+ * @{
+ */
+
+/**
+ * \defgroup dupcache Duplicate packet cache
+ * @{
+ *
+ * The dupcache module remembers recently seen packets, identified by
+ * their originator and sequence number, so that flooding and
+ * forwarding modules can drop duplicates. The cache is a hash table
+ * that is shared by all connections and looked up in constant time.
+ * Entries expire after DUPCACHE_LIFETIME seconds; when the table is
+ * full, the oldest entry in the probed slots is replaced.
+ *
+ */
+
+#ifndef DUPCACHE_H_
+#define DUPCACHE_H_
+
+#include "net/linkaddr.h"
+
+/* The number of entries in the cache. Must be a power of two. */
+#ifdef DUPCACHE_CONF_SIZE
+#define DUPCACHE_SIZE DUPCACHE_CONF_SIZE
+#else /* DUPCACHE_CONF_SIZE */
+#define DUPCACHE_SIZE 32
+#endif /* DUPCACHE_CONF_SIZE */
+
+#if (DUPCACHE_SIZE & (DUPCACHE_SIZE - 1)) != 0
+#error DUPCACHE_CONF_SIZE must be a power of two
+#endif
+
+/* The number of seconds that a packet is remembered. This must be at
+   least as long as a packet can be retransmitted: collect keeps a
+   packet in its send queue for up to FORWARD_PACKET_LIFETIME_BASE
+   times its maximum number of retransmissions, which is 248 seconds
+   with a channel check rate of 8 Hz. */
+#ifdef DUPCACHE_CONF_LIFETIME
+#define DUPCACHE_LIFETIME DUPCACHE_CONF_LIFETIME
+#else /* DUPCACHE_CONF_LIFETIME */
+#define DUPCACHE_LIFETIME 300
+#endif /* DUPCACHE_CONF_LIFETIME */
+
+/**
+ * \brief      Check if a packet has been seen recently
+ * \param owner The connection that the packet was received on
+ * \param originator The originator of the packet
+ * \param seqno The sequence number of the packet
+ * \retval 1   The packet is a duplicate
+ * \retval 0   The packet has not been seen
+ *
+ *             A hit is counted as a dropped duplicate in rimestats.
+ */
+int dupcache_lookup(const void *owner, const linkaddr_t *originator,
+                    uint16_t seqno);
+
+/**
+ * \brief      Remember a packet
+ * \param owner The connection that the packet was received on
+ * \param originator The originator of the packet
+ * \param seqno The sequence number of the packet
+ */
+void dupcache_add(const void *owner, const linkaddr_t *originator,
+                  uint16_t seqno);
+
+/**
+ * \brief      Forget all packets of a connection
+ * \param owner The connection
+ *
+ *             This function is called when a connection is closed,
+ *             so that a new connection at the same address does not
+ *             match its packets.
+ */
+void dupcache_flush(const void *owner);
+
+#endif /* DUPCACHE_H_ */
+/** @} */
+/** @} */
@@ -43,6 +43,7 @@
  */
 
 #include "net/rime/netflood.h"
+#include "net/rime/dupcache.h"
 
 #include <string.h>
 
@@ -87,8 +88,8 @@ recv_from_ipolite(struct ipolite_conn *ipolite, const linkaddr_t *from)
 
   packetbuf_hdrreduce(sizeof(struct netflood_hdr));
   if(c->u->recv != NULL) {
-    if(!(linkaddr_cmp(&hdr.originator, &c->last_originator) &&
-	 hdr.originator_seqno <= c->last_originator_seqno)) {
+    if(!dupcache_lookup(c, &hdr.originator, hdr.originator_seqno)) {
+      dupcache_add(c, &hdr.originator, hdr.originator_seqno);
 
       if(c->u->recv(c, from, &hdr.originator, hdr.originator_seqno,
 		    hops)) {
@@ -101,18 +102,14 @@ recv_from_ipolite(struct ipolite_conn *ipolite, const linkaddr_t *from)
 	  
 	  /* Rebroadcast received packet. */
 	  if(hops < HOPS_MAX) {
-	    PRINTF("%d.%d: netflood rebroadcasting %d.%d/%d (%d.%d/%d) hops %d\n",
+	    PRINTF("%d.%d: netflood rebroadcasting %d.%d/%d hops %d\n",
 		   linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
 		   hdr.originator.u8[0], hdr.originator.u8[1],
 		   hdr.originator_seqno,
-		   c->last_originator.u8[0], c->last_originator.u8[1],
-		   c->last_originator_seqno,
 		  hops);
 	    hdr.hops++;
 	    memcpy(packetbuf_dataptr(), &hdr, sizeof(struct netflood_hdr));
 	    send(c);
-	    linkaddr_copy(&c->last_originator, &hdr.originator);
-	    c->last_originator_seqno = hdr.originator_seqno;
 	  }
 	}
       }
@@ -156,6 +153,7 @@ void
 netflood_close(struct netflood_conn *c)
 {
   ipolite_close(&c->c);
+  dupcache_flush(c);
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -164,8 +162,8 @@ netflood_send(struct netflood_conn *c, uint8_t seqno)
   if(packetbuf_hdralloc(sizeof(struct netflood_hdr))) {
     struct netflood_hdr *hdr = packetbuf_hdrptr();
     linkaddr_copy(&hdr->originator, &linkaddr_node_addr);
-    linkaddr_copy(&c->last_originator, &hdr->originator);
-    c->last_originator_seqno = hdr->originator_seqno = seqno;
+    hdr->originator_seqno = seqno;
+    dupcache_add(c, &hdr->originator, seqno);
     hdr->hops = 0;
     PRINTF("%d.%d: netflood sending '%s'\n",
 	   linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
@@ -95,8 +95,6 @@ struct netflood_conn {
   struct ipolite_conn c;
   const struct netflood_callbacks *u;
   clock_time_t queue_time;
-  linkaddr_t last_originator;
-  uint8_t last_originator_seqno;
 };
 
 void netflood_open(struct netflood_conn *c, clock_time_t queue_time,
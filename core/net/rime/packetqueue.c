@@ -89,6 +89,7 @@ packetqueue_enqueue_packetbuf(struct packetqueue *q, clock_time_t lifetime,
 
   i->queue = q;
   i->ptr = ptr;
+  i->mark = 0;
 
   /* Setup a ctimer that removes the packet from the queue when its
      lifetime expires. If the lifetime is zero, we do not set a
@@ -123,6 +124,14 @@ packetqueue_dequeue(struct packetqueue *q)
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+packetqueue_remove(struct packetqueue *q, struct packetqueue_item *i)
+{
+  if(i != NULL) {
+    remove_queued_packet(i);
+  }
+}
+/*---------------------------------------------------------------------------*/
 int
 packetqueue_len(struct packetqueue *q)
 {
@@ -149,4 +158,22 @@ packetqueue_ptr(struct packetqueue_item *i)
   }
 }
 /*---------------------------------------------------------------------------*/
+uint8_t
+packetqueue_mark(struct packetqueue_item *i)
+{
+  if(i != NULL) {
+    return i->mark;
+  } else {
+    return 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+packetqueue_set_mark(struct packetqueue_item *i, uint8_t mark)
+{
+  if(i != NULL) {
+    i->mark = mark;
+  }
+}
+/*---------------------------------------------------------------------------*/
 /** @} */
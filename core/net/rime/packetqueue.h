@@ -89,6 +89,7 @@ struct packetqueue_item {
   struct packetqueue *queue;
   struct ctimer lifetimer;
   void *ptr;
+  uint8_t mark;
 };
 
 
@@ -178,6 +179,19 @@ struct packetqueue_item *packetqueue_first(struct packetqueue *q);
  */
 void packetqueue_dequeue(struct packetqueue *q);
 
+/**
+ * \brief      Remove an item from the packet queue.
+ * \param q    A pointer to a struct packetqueue.
+ * \param i    A pointer to an item on the packet queue.
+ *
+ *             This function removes an item from anywhere in the
+ *             packet queue, for example after the item has been
+ *             reached by traversing the queue from
+ *             packetqueue_first().
+ *
+ */
+void packetqueue_remove(struct packetqueue *q, struct packetqueue_item *i);
+
 /**
  * \brief      Get the length of the packet queue
  * \param q    A pointer to a struct packetqueue.
@@ -211,6 +225,25 @@ struct queuebuf *packetqueue_queuebuf(struct packetqueue_item *i);
  */
 
 void *packetqueue_ptr(struct packetqueue_item *i);
+
+/**
+ * \brief      Get the mark of a packet queue item.
+ * \param i    A packet queue item, obtained with packetqueue_first().
+ * \return     The mark of the item, which is zero when it is enqueued.
+ */
+uint8_t packetqueue_mark(struct packetqueue_item *i);
+
+/**
+ * \brief      Set the mark of a packet queue item.
+ * \param i    A packet queue item, obtained with packetqueue_first().
+ * \param mark The new mark.
+ *
+ *             The mark is not used by the packet queue. It lets the
+ *             module that owns the queue tag items, for example the
+ *             ones that are being sent, so that they can still be told
+ *             apart when other items time out of the queue.
+ */
+void packetqueue_set_mark(struct packetqueue_item *i, uint8_t mark);
 /**
  * @}
  */
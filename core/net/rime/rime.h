@@ -47,6 +47,7 @@
 
 #include "net/rime/announcement.h"
 #include "net/rime/collect.h"
+#include "net/rime/dupcache.h"
 #include "net/rime/ipolite.h"
 #include "net/rime/mesh.h"
 #include "net/rime/multihop.h"
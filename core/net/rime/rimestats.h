@@ -53,6 +53,9 @@ struct rimestats {
     sendingdrop; /* Packet dropped when we were sending a packet */
 
   unsigned long lltx, llrx;
+
+  unsigned long dupdrop, /* Duplicate packet dropped by the dupcache */
+    dupevict; /* Live dupcache entry replaced because the cache was full */
 };
 
 #if RIMESTATS_CONF_ENABLED
@@ -50,6 +50,7 @@
 
 #include <stdio.h>
 #include <stddef.h> /* for offsetof */
+#include <string.h>
 
 #include "net/rime/rime.h"
 #include "net/rime/polite.h"
@@ -80,6 +81,7 @@ enum {
 #define FLAG_LAST_SENT     0x01
 #define FLAG_LAST_RECEIVED 0x02
 #define FLAG_IS_STOPPED    0x04
+#define FLAG_PROGRESS      0x08
 
 #define DEBUG 0
 #if DEBUG
@@ -122,6 +124,7 @@ format_data(struct rudolph2_conn *c, int chunk)
   return len;
 }
 /*---------------------------------------------------------------------------*/
+#if !RUDOLPH2_WINDOWED
 static void
 write_data(struct rudolph2_conn *c, int chunk, uint8_t *data, int datalen)
 {
@@ -183,6 +186,280 @@ send_nack(struct rudolph2_conn *c)
 	 hdr->chunk);
   polite_send(&c->c, NACK_TIMEOUT, POLITE_HEADER);
 }
+#endif /* !RUDOLPH2_WINDOWED */
+/*---------------------------------------------------------------------------*/
+#if RUDOLPH2_WINDOWED
+/*
+ * In windowed transfers, rcv_nxt is the first chunk of the page that
+ * is being received, and all chunks before it have been written. The
+ * rcv_bitmap tells which chunks of the page are in the page buffer
+ * and page_chunks is the number of chunks in the page, which is only
+ * less than RUDOLPH2_PAGE_CHUNKS for the last page.
+ *
+ * A node sends one page at a time: snd_nxt is the first chunk of the
+ * page, snd_bitmap tells which of its chunks remain to be sent, and
+ * all pages before snd_end have been sent in full at least once.
+ */
+
+#define NACK_INTERVAL RESEND_INTERVAL
+
+static void timed_send_page(void *ptr);
+
+/*---------------------------------------------------------------------------*/
+static uint16_t
+page_mask(struct rudolph2_conn *c, uint16_t start)
+{
+  int n;
+
+  n = MIN(RUDOLPH2_PAGE_CHUNKS, c->rcv_nxt - start);
+  if(n <= 0) {
+    return 0;
+  }
+  return (uint16_t)((1UL << n) - 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_sending(struct rudolph2_conn *c)
+{
+  if(c->snd_bitmap == 0) {
+    ctimer_set(&c->t, RUDOLPH2_CHUNK_INTERVAL, timed_send_page, c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_page_nack(struct rudolph2_conn *c)
+{
+  struct rudolph2_hdr *hdr;
+  uint16_t missing;
+
+  missing = (uint16_t)((1UL << c->page_chunks) - 1) & ~c->rcv_bitmap;
+
+  packetbuf_clear();
+  hdr = packetbuf_dataptr();
+  hdr->type = TYPE_NACK;
+  hdr->hops_from_base = c->hops_from_base;
+  hdr->version = c->version;
+  hdr->chunk = c->rcv_nxt;
+  memcpy((uint8_t *)hdr + sizeof(struct rudolph2_hdr), &missing,
+         sizeof(missing));
+  packetbuf_set_datalen(sizeof(struct rudolph2_hdr) + sizeof(missing));
+
+  PRINTF("%d.%d: Sending nack for page %d, missing 0x%04x\n",
+	 linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+	 c->rcv_nxt, missing);
+  polite_send(&c->c, NACK_TIMEOUT, sizeof(struct rudolph2_hdr));
+}
+/*---------------------------------------------------------------------------*/
+static void
+nack_timeout(void *ptr)
+{
+  struct rudolph2_conn *c = ptr;
+
+  if((c->flags & (FLAG_LAST_RECEIVED | FLAG_IS_STOPPED)) == 0) {
+    /* If no new chunk has arrived since the last timeout, the
+       transfer has stalled and we ask for the rest of the page. */
+    if((c->flags & FLAG_PROGRESS) == 0) {
+      send_page_nack(c);
+    }
+    c->flags &= ~FLAG_PROGRESS;
+    ctimer_set(&c->nack_timer, NACK_INTERVAL, nack_timeout, c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+flush_page(struct rudolph2_conn *c)
+{
+  int len;
+  int last;
+
+  last = c->page_chunks < RUDOLPH2_PAGE_CHUNKS ||
+    c->last_len < RUDOLPH2_DATASIZE;
+  len = (c->page_chunks - 1) * RUDOLPH2_DATASIZE + c->last_len;
+
+  PRINTF("%d.%d: page %d complete, %d bytes\n",
+	 linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+	 c->rcv_nxt, len);
+
+  if((c->flags & FLAG_IS_STOPPED) == 0) {
+    if(c->rcv_nxt == 0) {
+      c->cb->write_chunk(c, 0, RUDOLPH2_FLAG_NEWFILE, c->page, 0);
+    }
+    c->cb->write_chunk(c, c->rcv_nxt * RUDOLPH2_DATASIZE,
+                       last ? RUDOLPH2_FLAG_LASTCHUNK : RUDOLPH2_FLAG_NONE,
+                       c->page, len);
+  }
+
+  c->rcv_nxt += c->page_chunks;
+  c->rcv_bitmap = 0;
+  c->page_chunks = RUDOLPH2_PAGE_CHUNKS;
+  c->last_len = RUDOLPH2_DATASIZE;
+  if(last) {
+    c->flags |= FLAG_LAST_RECEIVED;
+    ctimer_stop(&c->nack_timer);
+  }
+
+  /* Forward the page right away, while the next one is received. */
+  start_sending(c);
+}
+/*---------------------------------------------------------------------------*/
+static void
+receive_chunk(struct rudolph2_conn *c, uint16_t chunk, uint8_t *data,
+              int len)
+{
+  uint16_t bit;
+  uint16_t mask;
+
+  if(LT(chunk, c->rcv_nxt) || (c->flags & FLAG_LAST_RECEIVED)) {
+    /* We already have this chunk. */
+    return;
+  }
+  if(chunk - c->rcv_nxt >= c->page_chunks) {
+    /* The chunk belongs to a later page, so we have missed the end
+       of the current one. */
+    send_page_nack(c);
+    return;
+  }
+
+  bit = 1 << (chunk - c->rcv_nxt);
+  if((c->rcv_bitmap & bit) == 0) {
+    memcpy(&c->page[(chunk - c->rcv_nxt) * RUDOLPH2_DATASIZE], data,
+           MIN(len, RUDOLPH2_DATASIZE));
+    c->rcv_bitmap |= bit;
+    c->flags |= FLAG_PROGRESS;
+    if(len < RUDOLPH2_DATASIZE) {
+      /* This is the last chunk of the data. */
+      c->page_chunks = chunk - c->rcv_nxt + 1;
+      c->last_len = len;
+    }
+  }
+
+  mask = (uint16_t)((1UL << c->page_chunks) - 1);
+  if((c->rcv_bitmap & mask) == mask) {
+    flush_page(c);
+  } else if(chunk - c->rcv_nxt == c->page_chunks - 1) {
+    /* The last chunk of the page has arrived, but some of the others
+       are missing. */
+    send_page_nack(c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+nack_received(struct rudolph2_conn *c, uint16_t start, uint16_t missing)
+{
+  missing &= page_mask(c, start);
+  if(missing == 0 || !LT(start, c->snd_end)) {
+    /* We do not have the page, or we have not sent it yet. */
+    return;
+  }
+
+  if(c->snd_bitmap == 0) {
+    start_sending(c);
+    c->snd_nxt = start;
+    c->snd_bitmap = missing;
+  } else if(start == c->snd_nxt) {
+    c->snd_bitmap |= missing;
+  }
+  /* A NACK for another page than the one we are sending is ignored:
+     the receiver will send it again when it times out. */
+}
+/*---------------------------------------------------------------------------*/
+/* A chunk has been sent, either by us or by a neighbor at the same
+   distance from the base, so we do not need to send it again. */
+static void
+chunk_sent(struct rudolph2_conn *c)
+{
+  struct rudolph2_hdr *hdr = packetbuf_dataptr();
+
+  if(hdr->type == TYPE_DATA && hdr->version == c->version &&
+     !LT(hdr->chunk, c->snd_nxt) &&
+     hdr->chunk - c->snd_nxt < RUDOLPH2_PAGE_CHUNKS) {
+    c->snd_bitmap &= ~(1 << (hdr->chunk - c->snd_nxt));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+timed_send_page(void *ptr)
+{
+  struct rudolph2_conn *c = ptr;
+  int i;
+
+  if(c->flags & FLAG_IS_STOPPED) {
+    return;
+  }
+
+  if(c->snd_bitmap == 0 && LT(c->snd_end, c->rcv_nxt)) {
+    /* Move on to the next page that we have not sent yet. */
+    c->snd_nxt = c->snd_end;
+    c->snd_bitmap = page_mask(c, c->snd_nxt);
+    c->snd_end = MIN(c->snd_end + RUDOLPH2_PAGE_CHUNKS, c->rcv_nxt);
+  }
+
+  if(c->snd_bitmap != 0) {
+    for(i = 0; (c->snd_bitmap & (1 << i)) == 0; i++);
+    format_data(c, c->snd_nxt + i);
+    polite_send(&c->c, RUDOLPH2_CHUNK_INTERVAL, sizeof(struct rudolph2_hdr));
+    PRINTF("%d.%d: send_data chunk %d, rcv_nxt %d\n",
+	   linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+	   c->snd_nxt + i, c->rcv_nxt);
+    ctimer_set(&c->t, RUDOLPH2_CHUNK_INTERVAL, timed_send_page, c);
+  } else if((c->flags & FLAG_LAST_RECEIVED) && c->rcv_nxt > 0) {
+    /* Everything has been sent. We keep sending the last chunk, so
+       that nodes that have missed the transfer learn about it. */
+    format_data(c, c->rcv_nxt - 1);
+    polite_send(&c->c, STEADY_INTERVAL, sizeof(struct rudolph2_hdr));
+    ctimer_set(&c->t, STEADY_INTERVAL, timed_send_page, c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_windowed(struct rudolph2_conn *c)
+{
+  struct rudolph2_hdr *hdr = packetbuf_dataptr();
+  uint16_t missing;
+
+  if(hdr->type == TYPE_NACK && hdr->hops_from_base > c->hops_from_base) {
+    c->nacks++;
+    if(hdr->version == c->version) {
+      if(packetbuf_datalen() >= sizeof(struct rudolph2_hdr) + sizeof(missing)) {
+        memcpy(&missing, (uint8_t *)hdr + sizeof(struct rudolph2_hdr),
+               sizeof(missing));
+        PRINTF("%d.%d: Got NACK for page %d, missing 0x%04x\n",
+	       linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+	       hdr->chunk, missing);
+        nack_received(c, hdr->chunk, missing);
+      }
+    } else if(LT(hdr->version, c->version)) {
+      nack_received(c, 0, 0xffff);
+    }
+  } else if(hdr->type == TYPE_DATA &&
+            hdr->hops_from_base < c->hops_from_base) {
+    /* Only accept data from nodes that are closer to the base than
+       us. */
+    c->hops_from_base = hdr->hops_from_base + 1;
+    if(LT(c->version, hdr->version)) {
+      PRINTF("%d.%d: rudolph2 new version %d, chunk %d\n",
+	     linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+	     hdr->version, hdr->chunk);
+      c->version = hdr->version;
+      c->snd_nxt = c->rcv_nxt = c->snd_end = 0;
+      c->snd_bitmap = c->rcv_bitmap = 0;
+      c->page_chunks = RUDOLPH2_PAGE_CHUNKS;
+      c->last_len = RUDOLPH2_DATASIZE;
+      c->flags &= ~(FLAG_LAST_RECEIVED | FLAG_LAST_SENT | FLAG_PROGRESS);
+      ctimer_stop(&c->t);
+      ctimer_set(&c->nack_timer, NACK_INTERVAL, nack_timeout, c);
+    }
+    if(hdr->version == c->version) {
+      PRINTF("%d.%d: got chunk %d rcv_nxt %d\n",
+	     linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+	     hdr->chunk, c->rcv_nxt);
+      receive_chunk(c, hdr->chunk,
+                    (uint8_t *)hdr + sizeof(struct rudolph2_hdr),
+                    packetbuf_datalen() - sizeof(struct rudolph2_hdr));
+    }
+  }
+}
+#endif /* RUDOLPH2_WINDOWED */
 /*---------------------------------------------------------------------------*/
 #if 0 /* Function below not currently used in the code */
 static void
@@ -217,6 +494,9 @@ send_next(struct rudolph2_conn *c)
 static void
 sent(struct polite_conn *polite)
 {
+#if RUDOLPH2_WINDOWED
+  chunk_sent((struct rudolph2_conn *)polite);
+#endif /* RUDOLPH2_WINDOWED */
   /*  struct rudolph2_conn *c = (struct rudolph2_conn *)polite;
 
   if((c->flags & FLAG_IS_STOPPED) == 0 &&
@@ -233,6 +513,9 @@ sent(struct polite_conn *polite)
 static void
 dropped(struct polite_conn *polite)
 {
+#if RUDOLPH2_WINDOWED
+  chunk_sent((struct rudolph2_conn *)polite);
+#endif /* RUDOLPH2_WINDOWED */
   /*  struct rudolph2_conn *c = (struct rudolph2_conn *)polite;
   if((c->flags & FLAG_IS_STOPPED) == 0 &&
      (c->flags & FLAG_LAST_RECEIVED)) {
@@ -244,6 +527,7 @@ dropped(struct polite_conn *polite)
     }*/
 }
 /*---------------------------------------------------------------------------*/
+#if !RUDOLPH2_WINDOWED
 static void
 timed_send(void *ptr)
 {
@@ -284,11 +568,15 @@ timed_send(void *ptr)
     ctimer_set(&c->t, interval, timed_send, c);
   }
 }
+#endif /* !RUDOLPH2_WINDOWED */
 /*---------------------------------------------------------------------------*/
 static void
 recv(struct polite_conn *polite)
 {
   struct rudolph2_conn *c = (struct rudolph2_conn *)polite;
+#if RUDOLPH2_WINDOWED
+  recv_windowed(c);
+#else /* RUDOLPH2_WINDOWED */
   struct rudolph2_hdr *hdr = packetbuf_dataptr();
 
   /* Only accept NACKs from nodes that are farther away from the base
@@ -358,6 +646,7 @@ recv(struct polite_conn *polite)
       }
     }
   }
+#endif /* RUDOLPH2_WINDOWED */
 }
 /*---------------------------------------------------------------------------*/
 static const struct polite_callbacks polite = { recv, sent, dropped };
@@ -376,6 +665,10 @@ void
 rudolph2_close(struct rudolph2_conn *c)
 {
   polite_close(&c->c);
+#if RUDOLPH2_WINDOWED
+  ctimer_stop(&c->t);
+  ctimer_stop(&c->nack_timer);
+#endif /* RUDOLPH2_WINDOWED */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -393,8 +686,15 @@ rudolph2_send(struct rudolph2_conn *c, clock_time_t send_interval)
   }
   c->flags = FLAG_LAST_RECEIVED;
   /*  printf("Highest chunk %d\n", c->rcv_nxt);*/
+#if RUDOLPH2_WINDOWED
+  c->snd_end = 0;
+  c->snd_bitmap = 0;
+  ctimer_stop(&c->nack_timer);
+  timed_send_page(c);
+#else /* RUDOLPH2_WINDOWED */
   send_data(c, SEND_INTERVAL);
   ctimer_set(&c->t, SEND_INTERVAL, timed_send, c);
+#endif /* RUDOLPH2_WINDOWED */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -402,6 +702,10 @@ rudolph2_stop(struct rudolph2_conn *c)
 {
   polite_cancel(&c->c);
   c->flags |= FLAG_IS_STOPPED;
+#if RUDOLPH2_WINDOWED
+  ctimer_stop(&c->t);
+  ctimer_stop(&c->nack_timer);
+#endif /* RUDOLPH2_WINDOWED */
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
@@ -54,6 +54,15 @@
  * The rudolph2 module uses 2 channels; one for data packets and one
  * for NACK and repair packets.
  *
+ * \section rudolph2-windowed Windowed transfers
+ *
+ * With RUDOLPH2_CONF_WINDOWED, the data is transferred in pages of
+ * RUDOLPH2_PAGE_CHUNKS chunks. A receiver NACKs all missing chunks of
+ * a page with one bitmap, collects the page in RAM and writes it with
+ * one write_chunk() call. A node starts forwarding a page as soon as
+ * it has received it, without waiting for the rest of the data. All
+ * nodes must use the same mode.
+ *
  */
 
 #ifndef RUDOLPH2_H_
@@ -79,6 +88,26 @@ struct rudolph2_callbacks {
 
 #define RUDOLPH2_DATASIZE 64
 
+#ifdef RUDOLPH2_CONF_WINDOWED
+#define RUDOLPH2_WINDOWED RUDOLPH2_CONF_WINDOWED
+#else /* RUDOLPH2_CONF_WINDOWED */
+#define RUDOLPH2_WINDOWED 0
+#endif /* RUDOLPH2_CONF_WINDOWED */
+
+/* The number of chunks in a page, at most 16. */
+#ifdef RUDOLPH2_CONF_PAGE_CHUNKS
+#define RUDOLPH2_PAGE_CHUNKS RUDOLPH2_CONF_PAGE_CHUNKS
+#else /* RUDOLPH2_CONF_PAGE_CHUNKS */
+#define RUDOLPH2_PAGE_CHUNKS 8
+#endif /* RUDOLPH2_CONF_PAGE_CHUNKS */
+
+/* The interval between the chunks of a page. */
+#ifdef RUDOLPH2_CONF_CHUNK_INTERVAL
+#define RUDOLPH2_CHUNK_INTERVAL RUDOLPH2_CONF_CHUNK_INTERVAL
+#else /* RUDOLPH2_CONF_CHUNK_INTERVAL */
+#define RUDOLPH2_CHUNK_INTERVAL (CLOCK_SECOND / 4)
+#endif /* RUDOLPH2_CONF_CHUNK_INTERVAL */
+
 struct rudolph2_conn {
   struct polite_conn c;
   const struct rudolph2_callbacks *cb;
@@ -88,6 +117,13 @@ struct rudolph2_conn {
   uint8_t hops_from_base;
   uint8_t nacks;
   uint8_t flags;
+#if RUDOLPH2_WINDOWED
+  struct ctimer nack_timer;
+  uint16_t snd_end;
+  uint16_t snd_bitmap, rcv_bitmap;
+  uint8_t page_chunks, last_len;
+  uint8_t page[RUDOLPH2_PAGE_CHUNKS * RUDOLPH2_DATASIZE];
+#endif /* RUDOLPH2_WINDOWED */
 };
 
 void rudolph2_open(struct rudolph2_conn *c, uint16_t channel,
@@ -338,4 +338,37 @@
 #define RPL_DIS_START_DELAY             5
 #endif
 
+/*
+ * Multipath upward forwarding. When enabled, upward traffic is spread
+ * over the parents whose path cost is within RPL_MULTIPATH_COST_TOLERANCE
+ * of the best one, weighted by their ETX. All packets between the same
+ * pair of addresses go through the same parent to avoid reordering, and
+ * a change of weights only moves a matching share of the flows.
+ */
+#ifdef RPL_CONF_WITH_MULTIPATH
+#define RPL_WITH_MULTIPATH RPL_CONF_WITH_MULTIPATH
+#else
+#define RPL_WITH_MULTIPATH 0
+#endif
+
+/*
+ * Maximum number of parents that upward traffic is spread over
+ */
+#ifdef RPL_CONF_MULTIPATH_MAX_PARENTS
+#define RPL_MULTIPATH_MAX_PARENTS RPL_CONF_MULTIPATH_MAX_PARENTS
+#else
+#define RPL_MULTIPATH_MAX_PARENTS 3
+#endif
+
+/*
+ * Largest difference to the path cost of the best parent for which a
+ * parent is used for multipath forwarding. Expressed in the unit of the
+ * path cost of the OF, i.e. 128 corresponds to an ETX of 1 with MRHOF.
+ */
+#ifdef RPL_CONF_MULTIPATH_COST_TOLERANCE
+#define RPL_MULTIPATH_COST_TOLERANCE RPL_CONF_MULTIPATH_COST_TOLERANCE
+#else
+#define RPL_MULTIPATH_COST_TOLERANCE 128
+#endif
+
 #endif /* RPL_CONF_H */
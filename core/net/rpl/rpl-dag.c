@@ -227,6 +227,78 @@ rpl_parent_is_reachable(rpl_parent_t *p) {
   }
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * The candidate parents of each DAG are kept in a list ordered by the
+ * objective function: acceptable parents first, by increasing path cost.
+ * A parent is re-ranked whenever its rank or link metric has changed, so
+ * that the best parents are found at the head of the list without
+ * evaluating every neighbor.
+ */
+static void
+unrank_parent(rpl_parent_t *p)
+{
+  rpl_parent_t **pp;
+
+  if(p->dag != NULL) {
+    for(pp = &p->dag->ranked_parents; *pp != NULL; pp = &(*pp)->next) {
+      if(*pp == p) {
+        *pp = p->next;
+        break;
+      }
+    }
+  }
+  p->next = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+ranks_before(rpl_of_t *of, rpl_parent_t *p1, rpl_parent_t *p2)
+{
+  if((p1->flags ^ p2->flags) & RPL_PARENT_FLAG_UNACCEPTABLE) {
+    return !(p1->flags & RPL_PARENT_FLAG_UNACCEPTABLE);
+  }
+  if(p1->ranked_cost != p2->ranked_cost) {
+    return p1->ranked_cost < p2->ranked_cost;
+  }
+  /* Let the OF break ties, e.g., OF0 prefers the current preferred
+     parent, then the parent with the best link metric */
+  return !(p1->flags & RPL_PARENT_FLAG_UNACCEPTABLE) &&
+    of->best_parent(p1, p2) == p1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+rank_parent(rpl_parent_t *p)
+{
+  rpl_parent_t **pp;
+  rpl_of_t *of;
+
+  unrank_parent(p);
+
+  if(p->dag == NULL || p->dag->instance == NULL || p->dag->instance->of == NULL) {
+    return;
+  }
+
+  /* Parents announcing an infinite or invalid rank are not candidates */
+  if(p->rank == INFINITE_RANK || p->rank < ROOT_RANK(p->dag->instance)) {
+    return;
+  }
+
+  of = p->dag->instance->of;
+  p->ranked_cost = of->parent_path_cost(p);
+  if(of->best_parent(p, NULL) == p) {
+    p->flags &= ~RPL_PARENT_FLAG_UNACCEPTABLE;
+  } else {
+    p->flags |= RPL_PARENT_FLAG_UNACCEPTABLE;
+  }
+
+  for(pp = &p->dag->ranked_parents; *pp != NULL; pp = &(*pp)->next) {
+    if(ranks_before(of, p, *pp)) {
+      break;
+    }
+  }
+  p->next = *pp;
+  *pp = p;
+}
+/*---------------------------------------------------------------------------*/
 static void
 rpl_set_preferred_parent(rpl_dag_t *dag, rpl_parent_t *p)
 {
@@ -254,6 +326,11 @@ rpl_set_preferred_parent(rpl_dag_t *dag, rpl_parent_t *p)
     nbr_table_unlock(rpl_parents, dag->preferred_parent);
     nbr_table_lock(rpl_parents, p);
     dag->preferred_parent = p;
+
+    /* The OF may favor the preferred parent among parents of equal cost */
+    if(p != NULL) {
+      rank_parent(p);
+    }
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -644,6 +721,7 @@ rpl_free_instance(rpl_instance_t *instance)
   ctimer_stop(&instance->dio_timer);
   ctimer_stop(&instance->dao_timer);
   ctimer_stop(&instance->dao_lifetime_timer);
+  rpl_icmp6_discard_dao_batch(instance);
 
   if(default_instance == instance) {
     default_instance = NULL;
@@ -688,6 +766,12 @@ rpl_add_parent(rpl_dag_t *dag, rpl_dio_t *dio, uip_ipaddr_t *addr)
   PRINT6ADDR(addr);
   PRINTF("\n");
   if(lladdr != NULL) {
+    /* The entry is reinitialized if it exists, so take it out of its
+     * DAG's ranking first */
+    p = nbr_table_get_from_lladdr(rpl_parents, (linkaddr_t *)lladdr);
+    if(p != NULL) {
+      unrank_parent(p);
+    }
     /* Add parent in rpl_parents - again this is due to DIO */
     p = nbr_table_add_lladdr(rpl_parents, (linkaddr_t *)lladdr,
                              NBR_TABLE_REASON_RPL_DIO, dio);
@@ -700,6 +784,7 @@ rpl_add_parent(rpl_dag_t *dag, rpl_dio_t *dio, uip_ipaddr_t *addr)
 #if RPL_WITH_MC
       memcpy(&p->mc, &dio->mc, sizeof(p->mc));
 #endif /* RPL_WITH_MC */
+      rank_parent(p);
     }
   }
 
@@ -849,49 +934,80 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
   return best_dag;
 }
 /*---------------------------------------------------------------------------*/
+static int
+parent_is_candidate(rpl_dag_t *dag, rpl_parent_t *p, int fresh_only)
+{
+  /* Exclude parents from other DAGs or announcing an infinite rank */
+  if(p->dag != dag || p->rank == INFINITE_RANK || p->rank < ROOT_RANK(dag->instance)) {
+    return 0;
+  }
+
+  if(fresh_only && !rpl_parent_is_fresh(p)) {
+    /* Filter out non-fresh parents if fresh_only is set */
+    return 0;
+  }
+
+#if UIP_ND6_SEND_NS
+  {
+  uip_ds6_nbr_t *nbr = rpl_get_nbr(p);
+  /* Exclude links to a neighbor that is not reachable at a NUD level */
+  if(nbr == NULL || nbr->state != NBR_REACHABLE) {
+    return 0;
+  }
+  }
+#endif /* UIP_ND6_SEND_NS */
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 static rpl_parent_t *
 best_parent(rpl_dag_t *dag, int fresh_only)
 {
   rpl_parent_t *p;
+  rpl_parent_t *preferred;
   rpl_of_t *of;
-  rpl_parent_t *best = NULL;
 
   if(dag == NULL || dag->instance == NULL || dag->instance->of == NULL) {
     return NULL;
   }
 
   of = dag->instance->of;
-  /* Search for the best parent according to the OF */
-  for(p = nbr_table_head(rpl_parents); p != NULL; p = nbr_table_next(rpl_parents, p)) {
 
-    /* Exclude parents from other DAGs or announcing an infinite rank */
-    if(p->dag != dag || p->rank == INFINITE_RANK || p->rank < ROOT_RANK(dag->instance)) {
-      if(p->rank < ROOT_RANK(dag->instance)) {
-        PRINTF("RPL: Parent has invalid rank\n");
-      }
-      continue;
+  /* The first candidate in the ranking has the lowest path cost */
+  for(p = dag->ranked_parents; p != NULL; p = p->next) {
+    if(parent_is_candidate(dag, p, fresh_only)) {
+      break;
     }
+  }
 
-    if(fresh_only && !rpl_parent_is_fresh(p)) {
-      /* Filter out non-fresh parents if fresh_only is set */
-      continue;
-    }
+  /* Let the OF decide between it and the current preferred parent, which
+   * it may keep for stability */
+  preferred = dag->preferred_parent;
+  if(preferred != NULL && !parent_is_candidate(dag, preferred, fresh_only)) {
+    preferred = NULL;
+  }
 
-#if UIP_ND6_SEND_NS
-    {
-    uip_ds6_nbr_t *nbr = rpl_get_nbr(p);
-    /* Exclude links to a neighbor that is not reachable at a NUD level */
-    if(nbr == NULL || nbr->state != NBR_REACHABLE) {
-      continue;
-    }
-    }
-#endif /* UIP_ND6_SEND_NS */
+  return of->best_parent(p, preferred);
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_get_best_parents(rpl_dag_t *dag, rpl_parent_t **parents, int k)
+{
+  rpl_parent_t *p;
+  int n;
 
-    /* Now we have an acceptable parent, check if it is the new best */
-    best = of->best_parent(best, p);
+  n = 0;
+  if(dag == NULL || dag->instance == NULL) {
+    return 0;
   }
 
-  return best;
+  for(p = dag->ranked_parents; p != NULL && n < k; p = p->next) {
+    if(!(p->flags & RPL_PARENT_FLAG_UNACCEPTABLE) &&
+       parent_is_candidate(dag, p, 0)) {
+      parents[n++] = p;
+    }
+  }
+  return n;
 }
 /*---------------------------------------------------------------------------*/
 rpl_parent_t *
@@ -939,6 +1055,7 @@ rpl_remove_parent(rpl_parent_t *parent)
 
   rpl_nullify_parent(parent);
 
+  unrank_parent(parent);
   nbr_table_remove(rpl_parents, parent);
 }
 /*---------------------------------------------------------------------------*/
@@ -998,7 +1115,9 @@ rpl_move_parent(rpl_dag_t *dag_src, rpl_dag_t *dag_dst, rpl_parent_t *parent)
   PRINT6ADDR(rpl_get_parent_ipaddr(parent));
   PRINTF("\n");
 
+  unrank_parent(parent);
   parent->dag = dag_dst;
+  rank_parent(parent);
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -1371,6 +1490,9 @@ rpl_process_parent_event(rpl_instance_t *instance, rpl_parent_t *p)
 
   return_value = 1;
 
+  /* The rank or link metric of the parent has changed */
+  rank_parent(p);
+
   if(RPL_IS_STORING(instance)
       && uip_ds6_route_is_nexthop(rpl_get_parent_ipaddr(p))
       && !rpl_parent_is_reachable(p) && instance->mop > RPL_MOP_NON_STORING) {
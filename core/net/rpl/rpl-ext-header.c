@@ -322,11 +322,103 @@ count_matching_bytes(const void *p1, const void *p2, size_t n)
   return n;
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_NS_SRH_CACHE_SIZE > 0
+/* Source routing headers recently built by the root. An entry is valid
+ * as long as the epoch of the non-storing node table is unchanged. The
+ * cache is flushed when the epoch wraps. */
+struct srh_cache_entry {
+  rpl_ns_node_t *dest_node;
+  uint16_t epoch;
+  uint8_t ext_len;
+  uip_ipaddr_t next_hop;
+  uint8_t header[RPL_NS_SRH_CACHE_HEADER_LEN];
+};
+static struct srh_cache_entry srh_cache[RPL_NS_SRH_CACHE_SIZE];
+static uint8_t srh_cache_victim;
+/*---------------------------------------------------------------------------*/
+static struct srh_cache_entry *
+srh_cache_lookup(const rpl_ns_node_t *dest_node)
+{
+  struct srh_cache_entry *entry;
+  uint16_t epoch = rpl_ns_epoch();
+  for(entry = srh_cache; entry < &srh_cache[RPL_NS_SRH_CACHE_SIZE]; entry++) {
+    if(entry->dest_node == dest_node && entry->epoch == epoch) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+srh_cache_add(rpl_ns_node_t *dest_node, uint8_t ext_len)
+{
+  struct srh_cache_entry *entry;
+  uint16_t epoch = rpl_ns_epoch();
+
+  if(ext_len > RPL_NS_SRH_CACHE_HEADER_LEN) {
+    return;
+  }
+
+  /* Reuse a stale entry if there is one, otherwise replace in turn */
+  for(entry = srh_cache; entry < &srh_cache[RPL_NS_SRH_CACHE_SIZE]; entry++) {
+    if(entry->dest_node == NULL || entry->epoch != epoch) {
+      break;
+    }
+  }
+  if(entry == &srh_cache[RPL_NS_SRH_CACHE_SIZE]) {
+    entry = &srh_cache[srh_cache_victim];
+    srh_cache_victim = (srh_cache_victim + 1) % RPL_NS_SRH_CACHE_SIZE;
+  }
+
+  entry->dest_node = dest_node;
+  entry->epoch = epoch;
+  entry->ext_len = ext_len;
+  uip_ipaddr_copy(&entry->next_hop, &UIP_IP_BUF->destipaddr);
+  memcpy(entry->header, UIP_RH_BUF, ext_len);
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ext_header_srh_cache_flush(void)
+{
+  memset(srh_cache, 0, sizeof(srh_cache));
+  srh_cache_victim = 0;
+}
+#endif /* RPL_NS_SRH_CACHE_SIZE > 0 */
+/*---------------------------------------------------------------------------*/
+/* Make room for a routing header of ext_len bytes after the IPv6 header */
+static void
+open_srh_header(uint8_t ext_len)
+{
+  /* Move existing ext headers and payload uip_ext_len further */
+  memmove(uip_buf + uip_l2_l3_hdr_len + ext_len,
+      uip_buf + uip_l2_l3_hdr_len, uip_len - UIP_IPH_LEN);
+  memset(uip_buf + uip_l2_l3_hdr_len, 0, ext_len);
+
+  /* Insert source routing header */
+  UIP_RH_BUF->next = UIP_IP_BUF->proto;
+  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
+}
+/*---------------------------------------------------------------------------*/
+static void
+close_srh_header(uint8_t ext_len)
+{
+  uint8_t temp_len;
+
+  /* In-place update of IPv6 length field */
+  temp_len = UIP_IP_BUF->len[1];
+  UIP_IP_BUF->len[1] += ext_len;
+  if(UIP_IP_BUF->len[1] < temp_len) {
+    UIP_IP_BUF->len[0]++;
+  }
+
+  uip_ext_len += ext_len;
+  uip_len += ext_len;
+}
+/*---------------------------------------------------------------------------*/
 static int
 insert_srh_header(void)
 {
   /* Implementation of RFC6554 */
-  uint8_t temp_len;
   uint8_t path_len;
   uint8_t ext_len;
   uint8_t cmpri, cmpre; /* ComprI and ComprE fields of the RPL Source Routing Header */
@@ -337,6 +429,9 @@ insert_srh_header(void)
   rpl_ns_node_t *node;
   rpl_dag_t *dag;
   uip_ipaddr_t node_addr;
+#if RPL_NS_SRH_CACHE_SIZE > 0
+  struct srh_cache_entry *cache_entry;
+#endif /* RPL_NS_SRH_CACHE_SIZE > 0 */
 
   PRINTF("RPL: SRH creating source routing header with destination ");
   PRINT6ADDR(&UIP_IP_BUF->destipaddr);
@@ -358,6 +453,26 @@ insert_srh_header(void)
     return 1;
   }
 
+#if RPL_NS_SRH_CACHE_SIZE > 0
+  /* The path to the destination is unchanged since the header was
+   * built, so only copy it into the packet */
+  cache_entry = srh_cache_lookup(dest_node);
+  if(cache_entry != NULL) {
+    ext_len = cache_entry->ext_len;
+    if(uip_len + ext_len > UIP_BUFSIZE) {
+      PRINTF("RPL: Packet too long: impossible to add source routing header (%u bytes)\n", ext_len);
+      return 1;
+    }
+    PRINTF("RPL: SRH found in cache, ext len %u\n", ext_len);
+    open_srh_header(ext_len);
+    /* Keep the next header field set by open_srh_header() */
+    memcpy(((uint8_t *)UIP_RH_BUF) + 1, cache_entry->header + 1, ext_len - 1);
+    uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &cache_entry->next_hop);
+    close_srh_header(ext_len);
+    return 1;
+  }
+#endif /* RPL_NS_SRH_CACHE_SIZE > 0 */
+
   root_node = rpl_ns_get_node(dag, &dag->dag_id);
   if(root_node == NULL) {
     PRINTF("RPL: SRH root node not found\n");
@@ -413,14 +528,7 @@ insert_srh_header(void)
     return 1;
   }
 
-  /* Move existing ext headers and payload uip_ext_len further */
-  memmove(uip_buf + uip_l2_l3_hdr_len + ext_len,
-      uip_buf + uip_l2_l3_hdr_len, uip_len - UIP_IPH_LEN);
-  memset(uip_buf + uip_l2_l3_hdr_len, 0, ext_len);
-
-  /* Insert source routing header */
-  UIP_RH_BUF->next = UIP_IP_BUF->proto;
-  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
+  open_srh_header(ext_len);
 
   /* Initialize IPv6 Routing Header */
   UIP_RH_BUF->len = (ext_len - 8) / 8;
@@ -449,15 +557,11 @@ insert_srh_header(void)
   rpl_ns_get_node_global_addr(&node_addr, node);
   uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &node_addr);
 
-  /* In-place update of IPv6 length field */
-  temp_len = UIP_IP_BUF->len[1];
-  UIP_IP_BUF->len[1] += ext_len;
-  if(UIP_IP_BUF->len[1] < temp_len) {
-    UIP_IP_BUF->len[0]++;
-  }
+#if RPL_NS_SRH_CACHE_SIZE > 0
+  srh_cache_add(dest_node, ext_len);
+#endif /* RPL_NS_SRH_CACHE_SIZE > 0 */
 
-  uip_ext_len += ext_len;
-  uip_len += ext_len;
+  close_srh_header(ext_len);
 
   return 1;
 }
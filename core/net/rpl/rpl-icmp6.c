@@ -120,21 +120,6 @@ find_route_entry_by_dao_ack(uint8_t seq)
 }
 #endif /* RPL_WITH_DAO_ACK */
 
-#if RPL_WITH_STORING
-/* prepare for forwarding of DAO */
-static uint8_t
-prepare_for_dao_fwd(uint8_t sequence, uip_ds6_route_t *rep)
-{
-  /* not pending - or pending but not a retransmission */
-  RPL_LOLLIPOP_INCREMENT(dao_sequence);
-
-  /* set DAO pending and sequence numbers */
-  rep->state.dao_seqno_in = sequence;
-  rep->state.dao_seqno_out = dao_sequence;
-  RPL_ROUTE_SET_DAO_PENDING(rep);
-  return dao_sequence;
-}
-#endif /* RPL_WITH_STORING */
 /*---------------------------------------------------------------------------*/
 static int
 get_global_addr(uip_ipaddr_t *addr)
@@ -621,6 +606,213 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
 #endif /* RPL_LEAF_ONLY */
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_STORING
+/*
+ * DAO aggregation. The targets that a storing-mode router forwards to
+ * its preferred parent are collected in a batch and sent in a single DAO,
+ * with a transit information option after each run of targets that share
+ * a lifetime. The batch has its own sequence number, which is recorded as
+ * the outgoing DAO sequence number of the routes to its targets, so that
+ * the DAO-ACK of the batch is forwarded to every child that took part.
+ * Retransmitted targets are sent again with the sequence number they were
+ * first forwarded with, in a batch of their own.
+ */
+struct dao_target {
+  uip_ipaddr_t prefix;
+  uint8_t prefixlen;
+  uint8_t lifetime;
+};
+
+/* Room for the DAO in uip_buf */
+#define DAO_BATCH_MAX_LENGTH (UIP_BUFSIZE - UIP_LLH_LEN - UIP_IPICMPH_LEN)
+#if RPL_DAO_SPECIFY_DAG
+#define DAO_HEADER_LENGTH 20
+#else /* RPL_DAO_SPECIFY_DAG */
+#define DAO_HEADER_LENGTH 4
+#endif /* RPL_DAO_SPECIFY_DAG */
+/* A target option, and the transit information option that may follow */
+#define DAO_TARGET_LENGTH(prefixlen) (4 + ((prefixlen) + 7) / CHAR_BIT + 6)
+
+static struct dao_target dao_batch[RPL_DAO_AGGREGATION_MAX_TARGETS];
+static uint8_t dao_batch_count;
+static uint16_t dao_batch_length;
+static uint8_t dao_batch_flags;
+static uint8_t dao_batch_seqno;
+static uint8_t dao_batch_retransmit;
+static rpl_instance_t *dao_batch_instance;
+static struct ctimer dao_batch_timer;
+/*---------------------------------------------------------------------------*/
+static void
+dao_batch_flush(void)
+{
+  rpl_dag_t *dag;
+  uip_ipaddr_t *parent_ipaddr;
+  unsigned char *buffer;
+  struct dao_target *t;
+  int pos;
+  int i;
+
+  ctimer_stop(&dao_batch_timer);
+  if(dao_batch_count == 0) {
+    return;
+  }
+
+  dag = dao_batch_instance->current_dag;
+  parent_ipaddr = NULL;
+  if(dag != NULL && dag->preferred_parent != NULL) {
+    parent_ipaddr = rpl_get_parent_ipaddr(dag->preferred_parent);
+  }
+  if(parent_ipaddr == NULL) {
+    PRINTF("RPL: No parent to forward %u DAO targets to\n", dao_batch_count);
+    dao_batch_count = 0;
+    return;
+  }
+
+  uip_clear_buf();
+  buffer = UIP_ICMP_PAYLOAD;
+  pos = 0;
+
+  buffer[pos++] = dao_batch_instance->instance_id;
+  buffer[pos] = dao_batch_flags;
+#if RPL_DAO_SPECIFY_DAG
+  buffer[pos] |= RPL_DAO_D_FLAG;
+#endif /* RPL_DAO_SPECIFY_DAG */
+  ++pos;
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = dao_batch_seqno;
+#if RPL_DAO_SPECIFY_DAG
+  memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
+  pos += sizeof(dag->dag_id);
+#endif /* RPL_DAO_SPECIFY_DAG */
+
+  for(i = 0; i < dao_batch_count; i++) {
+    t = &dao_batch[i];
+
+    buffer[pos++] = RPL_OPTION_TARGET;
+    buffer[pos++] = 2 + ((t->prefixlen + 7) / CHAR_BIT);
+    buffer[pos++] = 0; /* reserved */
+    buffer[pos++] = t->prefixlen;
+    memcpy(buffer + pos, &t->prefix, (t->prefixlen + 7) / CHAR_BIT);
+    pos += ((t->prefixlen + 7) / CHAR_BIT);
+
+    /* The transit information applies to all preceding targets */
+    if(i == dao_batch_count - 1 || dao_batch[i + 1].lifetime != t->lifetime) {
+      buffer[pos++] = RPL_OPTION_TRANSIT;
+      buffer[pos++] = 4;
+      buffer[pos++] = 0; /* flags - ignored */
+      buffer[pos++] = 0; /* path control - ignored */
+      buffer[pos++] = 0; /* path seq - ignored */
+      buffer[pos++] = t->lifetime;
+    }
+  }
+
+  PRINTF("RPL: Forwarding %u DAO targets to parent ", dao_batch_count);
+  PRINT6ADDR(parent_ipaddr);
+  PRINTF(" out seq: %u\n", dao_batch_seqno);
+
+  dao_batch_count = 0;
+  uip_icmp6_send(parent_ipaddr, ICMP6_RPL, RPL_CODE_DAO, pos);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_dao_batch_timer(void *ptr)
+{
+  dao_batch_flush();
+}
+/*---------------------------------------------------------------------------*/
+static void
+dao_batch_add(rpl_instance_t *instance, uint8_t sequence,
+              uip_ipaddr_t *prefix, uint8_t prefixlen, uint8_t lifetime,
+              uip_ds6_route_t *rep, uint8_t flags)
+{
+  struct dao_target *t;
+  uint8_t retransmit;
+  int i;
+
+  /* if this is pending and we get the same seq no it is a retrans */
+  retransmit = rep != NULL && RPL_ROUTE_IS_DAO_PENDING(rep) &&
+    rep->state.dao_seqno_in == sequence;
+
+  if(dao_batch_count > 0 &&
+     (dao_batch_instance != instance ||
+      dao_batch_retransmit != retransmit ||
+      (retransmit && dao_batch_seqno != rep->state.dao_seqno_out))) {
+    dao_batch_flush();
+  }
+
+  /* A target that is already in the batch is advertised once, with the
+     latest lifetime */
+  t = NULL;
+  for(i = 0; i < dao_batch_count; i++) {
+    if(dao_batch[i].prefixlen == prefixlen &&
+       uip_ipaddr_cmp(&dao_batch[i].prefix, prefix)) {
+      t = &dao_batch[i];
+      break;
+    }
+  }
+
+  /* Send the batch first if the target might not fit in uip_buf */
+  if(t == NULL && dao_batch_count > 0 &&
+     dao_batch_length + DAO_TARGET_LENGTH(prefixlen) > DAO_BATCH_MAX_LENGTH) {
+    dao_batch_flush();
+  }
+
+  if(dao_batch_count == 0) {
+    if(retransmit) {
+      /* keep the same seq-no as before for parent also */
+      dao_batch_seqno = rep->state.dao_seqno_out;
+    } else {
+      RPL_LOLLIPOP_INCREMENT(dao_sequence);
+      dao_batch_seqno = dao_sequence;
+    }
+    dao_batch_retransmit = retransmit;
+    dao_batch_length = DAO_HEADER_LENGTH;
+    dao_batch_flags = 0;
+    dao_batch_instance = instance;
+  } else {
+    /* The target does not need a DAO of its own */
+    RPL_STAT(rpl_stats.dao_saved++);
+  }
+
+  if(t == NULL) {
+    t = &dao_batch[dao_batch_count++];
+    uip_ipaddr_copy(&t->prefix, prefix);
+    t->prefixlen = prefixlen;
+    dao_batch_length += DAO_TARGET_LENGTH(prefixlen);
+  }
+  t->lifetime = lifetime;
+  dao_batch_flags |= flags & RPL_DAO_K_FLAG;
+
+  if(rep != NULL) {
+    /* set DAO pending and sequence numbers */
+    rep->state.dao_seqno_in = sequence;
+    rep->state.dao_seqno_out = dao_batch_seqno;
+    RPL_ROUTE_SET_DAO_PENDING(rep);
+  }
+
+  if(dao_batch_count == RPL_DAO_AGGREGATION_MAX_TARGETS) {
+    dao_batch_flush();
+  } else if(RPL_DAO_AGGREGATION_DELAY > 0 && ctimer_expired(&dao_batch_timer)) {
+    ctimer_set(&dao_batch_timer, RPL_DAO_AGGREGATION_DELAY,
+               handle_dao_batch_timer, NULL);
+  }
+}
+#endif /* RPL_WITH_STORING */
+/*---------------------------------------------------------------------------*/
+/* Drop the targets that are waiting to be forwarded for an instance that
+   is being freed */
+void
+rpl_icmp6_discard_dao_batch(rpl_instance_t *instance)
+{
+#if RPL_WITH_STORING
+  if(dao_batch_instance == instance) {
+    ctimer_stop(&dao_batch_timer);
+    dao_batch_count = 0;
+    dao_batch_instance = NULL;
+  }
+#endif /* RPL_WITH_STORING */
+}
+/*---------------------------------------------------------------------------*/
 static void
 dao_input_storing(void)
 {
@@ -639,20 +831,26 @@ dao_input_storing(void)
     uint8_t pathcontrol;
     uint8_t pathsequence;
   */
-  uip_ipaddr_t prefix;
+  struct dao_target targets[RPL_DAO_MAX_TARGETS];
+  int target_count;
+  int forward_count;
+  int group_start;
+  int truncated;
+  uip_ipaddr_t *prefix;
   uip_ds6_route_t *rep;
-  uint8_t buffer_length;
+  uint16_t buffer_length;
   int pos;
   int len;
   int i;
   int learned_from;
   rpl_parent_t *parent;
-  uip_ds6_nbr_t *nbr;
   int is_root;
+  int can_forward;
+  int nbr_updated;
+  int ack_now;
+  uint8_t status;
 
-  prefixlen = 0;
   parent = NULL;
-  memset(&prefix, 0, sizeof(prefix));
 
   uip_ipaddr_copy(&dao_sender_addr, &UIP_IP_BUF->srcipaddr);
 
@@ -715,184 +913,210 @@ dao_input_storing(void)
     }
   }
 
-  /* Check if there are any RPL options present. */
+  /* Collect the targets. A transit information option applies to the
+     targets that precede it, and the ones without transit information
+     get the default lifetime. */
+  target_count = 0;
+  group_start = 0;
+  truncated = 0;
   for(i = pos; i < buffer_length; i += len) {
     subopt_type = buffer[i];
     if(subopt_type == RPL_OPTION_PAD1) {
       len = 1;
-    } else {
+    } else if(i + 1 < buffer_length) {
       /* The option consists of a two-byte header and a payload. */
       len = 2 + buffer[i + 1];
+    } else {
+      len = 2;
+    }
+    if(i + len > buffer_length) {
+      PRINTF("RPL: Truncated DAO option, ignoring the rest\n");
+      break;
     }
 
     switch(subopt_type) {
       case RPL_OPTION_TARGET:
         /* Handle the target option. */
+        if(target_count == RPL_DAO_MAX_TARGETS) {
+          PRINTF("RPL: Too many targets in DAO, refusing the rest\n");
+          truncated = 1;
+          break;
+        }
+        if(len < 4 || buffer[i + 3] > sizeof(uip_ipaddr_t) * CHAR_BIT ||
+           len < 4 + (buffer[i + 3] + 7) / CHAR_BIT) {
+          PRINTF("RPL: Invalid target option in DAO\n");
+          break;
+        }
         prefixlen = buffer[i + 3];
-        memset(&prefix, 0, sizeof(prefix));
-        memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
+        targets[target_count].prefixlen = prefixlen;
+        targets[target_count].lifetime = lifetime;
+        memset(&targets[target_count].prefix, 0, sizeof(uip_ipaddr_t));
+        memcpy(&targets[target_count].prefix, buffer + i + 4,
+               (prefixlen + 7) / CHAR_BIT);
+        target_count++;
         break;
       case RPL_OPTION_TRANSIT:
         /* The path sequence and control are ignored. */
         /*      pathcontrol = buffer[i + 3];
                 pathsequence = buffer[i + 4];*/
-        lifetime = buffer[i + 5];
+        if(len < 6) {
+          PRINTF("RPL: Invalid transit information option in DAO\n");
+          break;
+        }
+        for(; group_start < target_count; group_start++) {
+          targets[group_start].lifetime = buffer[i + 5];
+        }
         /* The parent address is also ignored. */
         break;
     }
   }
 
-  PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
-         (unsigned)lifetime, (unsigned)prefixlen);
-  PRINT6ADDR(&prefix);
-  PRINTF("\n");
+  can_forward = dag->preferred_parent != NULL &&
+    rpl_get_parent_ipaddr(dag->preferred_parent) != NULL;
+  forward_count = 0;
+  nbr_updated = 0;
+  ack_now = 1;
+  if(truncated) {
+    /* The sender must not count on routes to the targets we skipped */
+    status = is_root ? RPL_DAO_ACK_UNABLE_TO_ADD_ROUTE_AT_ROOT :
+      RPL_DAO_ACK_UNABLE_TO_ACCEPT;
+  } else {
+    status = RPL_DAO_ACK_UNCONDITIONAL_ACCEPT;
+  }
+
+  for(i = 0; i < target_count; i++) {
+    prefix = &targets[i].prefix;
+    prefixlen = targets[i].prefixlen;
+    lifetime = targets[i].lifetime;
+
+    PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
+           (unsigned)lifetime, (unsigned)prefixlen);
+    PRINT6ADDR(prefix);
+    PRINTF("\n");
 
 #if RPL_WITH_MULTICAST
-  if(uip_is_addr_mcast_global(&prefix)) {
-    /*
-     * "rep" is used for a unicast route which we don't need now; so set NULL so
-     * that operations on "rep" will be skipped.
-     */
-    rep = NULL;
-    mcast_group = uip_mcast6_route_add(&prefix);
-    if(mcast_group) {
-      mcast_group->dag = dag;
-      mcast_group->lifetime = RPL_LIFETIME(instance, lifetime);
+    if(uip_is_addr_mcast_global(prefix)) {
+      mcast_group = uip_mcast6_route_add(prefix);
+      if(mcast_group) {
+        mcast_group->dag = dag;
+        mcast_group->lifetime = RPL_LIFETIME(instance, lifetime);
+      }
+      if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
+        /* There is no route to acknowledge the DAO for */
+        ack_now = 0;
+        if(can_forward) {
+          targets[forward_count++] = targets[i];
+        }
+      }
+      continue;
     }
-    goto fwd_dao;
-  }
 #endif
 
-  rep = uip_ds6_route_lookup(&prefix);
-
-  if(lifetime == RPL_ZERO_LIFETIME) {
-    PRINTF("RPL: No-Path DAO received\n");
-    /* No-Path DAO received; invoke the route purging routine. */
-    if(rep != NULL &&
-       !RPL_ROUTE_IS_NOPATH_RECEIVED(rep) &&
-       rep->length == prefixlen &&
-       uip_ds6_route_nexthop(rep) != NULL &&
-       uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), &dao_sender_addr)) {
-      PRINTF("RPL: Setting expiration timer for prefix ");
-      PRINT6ADDR(&prefix);
-      PRINTF("\n");
-      RPL_ROUTE_SET_NOPATH_RECEIVED(rep);
-      rep->state.lifetime = RPL_NOPATH_REMOVAL_DELAY;
-
-      /* We forward the incoming No-Path DAO to our parent, if we have
-         one. */
-      if(dag->preferred_parent != NULL &&
-         rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
-        uint8_t out_seq;
-        out_seq = prepare_for_dao_fwd(sequence, rep);
-
-        PRINTF("RPL: Forwarding No-path DAO to parent - out_seq:%d",
-               out_seq);
-        PRINT6ADDR(rpl_get_parent_ipaddr(dag->preferred_parent));
+    rep = uip_ds6_route_lookup(prefix);
+
+    if(lifetime == RPL_ZERO_LIFETIME) {
+      PRINTF("RPL: No-Path DAO received\n");
+      /* No-Path DAO received; invoke the route purging routine. */
+      if(rep != NULL &&
+         !RPL_ROUTE_IS_NOPATH_RECEIVED(rep) &&
+         rep->length == prefixlen &&
+         uip_ds6_route_nexthop(rep) != NULL &&
+         uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), &dao_sender_addr)) {
+        PRINTF("RPL: Setting expiration timer for prefix ");
+        PRINT6ADDR(prefix);
         PRINTF("\n");
+        RPL_ROUTE_SET_NOPATH_RECEIVED(rep);
+        rep->state.lifetime = RPL_NOPATH_REMOVAL_DELAY;
 
-        buffer = UIP_ICMP_PAYLOAD;
-        buffer[3] = out_seq; /* add an outgoing seq no before fwd */
-        uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
-                       ICMP6_RPL, RPL_CODE_DAO, buffer_length);
+        /* We forward the incoming No-Path DAO to our parent, if we have
+           one. */
+        if(can_forward) {
+          targets[forward_count++] = targets[i];
+        }
       }
+      /* independent if we remove or not - ACK the request */
+      continue;
     }
-    /* independent if we remove or not - ACK the request */
-    if(flags & RPL_DAO_K_FLAG) {
-      /* indicate that we accepted the no-path DAO */
-      uip_clear_buf();
-      dao_ack_output(instance, &dao_sender_addr, sequence,
-                     RPL_DAO_ACK_UNCONDITIONAL_ACCEPT);
-    }
-    return;
-  }
 
-  PRINTF("RPL: Adding DAO route\n");
+    PRINTF("RPL: Adding DAO route\n");
 
-  /* Update and add neighbor - if no room - fail. */
-  if((nbr = rpl_icmp6_update_nbr_table(&dao_sender_addr, NBR_TABLE_REASON_RPL_DAO, instance)) == NULL) {
-    PRINTF("RPL: Out of Memory, dropping DAO from ");
-    PRINT6ADDR(&dao_sender_addr);
-    PRINTF(", ");
-    PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
-    PRINTF("\n");
-    if(flags & RPL_DAO_K_FLAG) {
-      /* signal the failure to add the node */
-      dao_ack_output(instance, &dao_sender_addr, sequence,
-                     is_root ? RPL_DAO_ACK_UNABLE_TO_ADD_ROUTE_AT_ROOT :
-                     RPL_DAO_ACK_UNABLE_TO_ACCEPT);
+    /* Update and add neighbor - if no room - fail. */
+    if(!nbr_updated) {
+      if(rpl_icmp6_update_nbr_table(&dao_sender_addr, NBR_TABLE_REASON_RPL_DAO, instance) == NULL) {
+        PRINTF("RPL: Out of Memory, dropping DAO from ");
+        PRINT6ADDR(&dao_sender_addr);
+        PRINTF(", ");
+        PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
+        PRINTF("\n");
+        /* signal the failure to add the node */
+        status = is_root ? RPL_DAO_ACK_UNABLE_TO_ADD_ROUTE_AT_ROOT :
+          RPL_DAO_ACK_UNABLE_TO_ACCEPT;
+        break;
+      }
+      nbr_updated = 1;
     }
-    return;
-  }
 
-  rep = rpl_add_route(dag, &prefix, prefixlen, &dao_sender_addr);
-  if(rep == NULL) {
-    RPL_STAT(rpl_stats.mem_overflows++);
-    PRINTF("RPL: Could not add a route after receiving a DAO\n");
-    if(flags & RPL_DAO_K_FLAG) {
+    rep = rpl_add_route(dag, prefix, prefixlen, &dao_sender_addr);
+    if(rep == NULL) {
+      RPL_STAT(rpl_stats.mem_overflows++);
+      PRINTF("RPL: Could not add a route after receiving a DAO\n");
       /* signal the failure to add the node */
-      dao_ack_output(instance, &dao_sender_addr, sequence,
-                     is_root ? RPL_DAO_ACK_UNABLE_TO_ADD_ROUTE_AT_ROOT :
-                     RPL_DAO_ACK_UNABLE_TO_ACCEPT);
+      status = is_root ? RPL_DAO_ACK_UNABLE_TO_ADD_ROUTE_AT_ROOT :
+        RPL_DAO_ACK_UNABLE_TO_ACCEPT;
+      continue;
     }
-    return;
-  }
 
-  /* set lifetime and clear NOPATH bit */
-  rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
-  RPL_ROUTE_CLEAR_NOPATH_RECEIVED(rep);
+    /* set lifetime and clear NOPATH bit */
+    rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
+    RPL_ROUTE_CLEAR_NOPATH_RECEIVED(rep);
 
-#if RPL_WITH_MULTICAST
-fwd_dao:
-#endif
-
-  if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
-    int should_ack = 0;
-
-    if(flags & RPL_DAO_K_FLAG) {
-      if(rep != NULL) {
-        /*
-         * check if this route is already installed and we can ack now!
-         * not pending - and same seq-no means that we can ack.
-         * (e.g. the route is installed already so it will not take any
-         * more room that it already takes - so should be ok!)
-         */
-        if((!RPL_ROUTE_IS_DAO_PENDING(rep) &&
-            rep->state.dao_seqno_in == sequence) ||
-           dag->rank == ROOT_RANK(instance)) {
-          should_ack = 1;
-        }
-      }
+    if(learned_from != RPL_ROUTE_FROM_UNICAST_DAO) {
+      ack_now = 0;
+      continue;
     }
 
-    if(dag->preferred_parent != NULL &&
-       rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
-      uint8_t out_seq = 0;
-      if(rep != NULL) {
-        /* if this is pending and we get the same seq no it is a retrans */
-        if(RPL_ROUTE_IS_DAO_PENDING(rep) &&
-           rep->state.dao_seqno_in == sequence) {
-          /* keep the same seq-no as before for parent also */
-          out_seq = rep->state.dao_seqno_out;
-        } else {
-          out_seq = prepare_for_dao_fwd(sequence, rep);
-        }
-      }
+    /*
+     * check if this route is already installed and we can ack now!
+     * not pending - and same seq-no means that we can ack.
+     * (e.g. the route is installed already so it will not take any
+     * more room that it already takes - so should be ok!)
+     * Otherwise, the DAO is acknowledged when our parent acknowledges
+     * the DAO that we forward.
+     */
+    if(!((!RPL_ROUTE_IS_DAO_PENDING(rep) &&
+          rep->state.dao_seqno_in == sequence) || is_root)) {
+      ack_now = 0;
+    }
 
-      PRINTF("RPL: Forwarding DAO to parent ");
-      PRINT6ADDR(rpl_get_parent_ipaddr(dag->preferred_parent));
-      PRINTF(" in seq: %d out seq: %d\n", sequence, out_seq);
+    if(can_forward) {
+      targets[forward_count++] = targets[i];
+    }
+  }
 
-      buffer = UIP_ICMP_PAYLOAD;
-      buffer[3] = out_seq; /* add an outgoing seq no before fwd */
-      uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
-                     ICMP6_RPL, RPL_CODE_DAO, buffer_length);
+  /* Forward the targets only once they have all been processed: sending
+     a batch overwrites uip_buf and the packetbuf attributes, including
+     the link-layer sender of this DAO. */
+  for(i = 0; i < forward_count; i++) {
+    prefix = &targets[i].prefix;
+    rep = uip_ds6_route_lookup(prefix);
+#if RPL_WITH_MULTICAST
+    if(uip_is_addr_mcast_global(prefix)) {
+      rep = NULL;
     }
-    if(should_ack) {
+#endif
+    dao_batch_add(instance, sequence, prefix, targets[i].prefixlen,
+                  targets[i].lifetime, rep, flags);
+  }
+
+  if(RPL_DAO_AGGREGATION_DELAY == 0) {
+    dao_batch_flush();
+  }
+
+  if(flags & RPL_DAO_K_FLAG) {
+    if(status >= RPL_DAO_ACK_UNABLE_TO_ACCEPT || ack_now) {
       PRINTF("RPL: Sending DAO ACK\n");
       uip_clear_buf();
-      dao_ack_output(instance, &dao_sender_addr, sequence,
-                     RPL_DAO_ACK_UNCONDITIONAL_ACCEPT);
+      dao_ack_output(instance, &dao_sender_addr, sequence, status);
     }
   }
 #endif /* RPL_WITH_STORING */
@@ -1310,31 +1534,60 @@ dao_ack_input(void)
 #endif
 
   } else if(RPL_IS_STORING(instance)) {
-    /* this DAO ACK should be forwarded to another recently registered route */
+    /* this DAO ACK should be forwarded to the recently registered routes.
+       As the DAO may have aggregated targets from several DAOs, one DAO
+       ACK is forwarded for each of them. */
     uip_ds6_route_t *re;
+    uip_ds6_route_t *next;
     uip_ipaddr_t *nexthop;
-    if((re = find_route_entry_by_dao_ack(sequence)) != NULL) {
-      /* pick the recorded seq no from that node and forward DAO ACK - and
-         clear the pending flag*/
-      RPL_ROUTE_CLEAR_DAO_PENDING(re);
+    uip_ipaddr_t child_addr;
+    uint8_t child_seqno;
+    int has_nexthop;
 
+    if(find_route_entry_by_dao_ack(sequence) == NULL) {
+      PRINTF("RPL: No route entry found to forward DAO ACK (seqno %u)\n", sequence);
+    }
+
+    while((re = find_route_entry_by_dao_ack(sequence)) != NULL) {
+      /* pick the recorded seq no from that node and forward DAO ACK - and
+         clear the pending flag of all routes that it registered in the
+         DAO */
+      child_seqno = re->state.dao_seqno_in;
       nexthop = uip_ds6_route_nexthop(re);
-      if(nexthop == NULL) {
+      has_nexthop = nexthop != NULL;
+      if(has_nexthop) {
+        uip_ipaddr_copy(&child_addr, nexthop);
+      }
+
+      for(; re != NULL; re = next) {
+        next = uip_ds6_route_next(re);
+        if(re->state.dao_seqno_out != sequence ||
+           !RPL_ROUTE_IS_DAO_PENDING(re) ||
+           re->state.dao_seqno_in != child_seqno) {
+          continue;
+        }
+        nexthop = uip_ds6_route_nexthop(re);
+        if(has_nexthop ?
+           (nexthop == NULL || !uip_ipaddr_cmp(nexthop, &child_addr)) :
+           nexthop != NULL) {
+          continue;
+        }
+        RPL_ROUTE_CLEAR_DAO_PENDING(re);
+
+        if(status >= RPL_DAO_ACK_UNABLE_TO_ACCEPT) {
+          /* this node did not get in to the routing tables above... - remove */
+          uip_ds6_route_rm(re);
+        }
+      }
+
+      if(!has_nexthop) {
         PRINTF("RPL: No next hop to fwd DAO ACK to\n");
       } else {
         PRINTF("RPL: Fwd DAO ACK to:");
-        PRINT6ADDR(nexthop);
+        PRINT6ADDR(&child_addr);
         PRINTF("\n");
-        buffer[2] = re->state.dao_seqno_in;
-        uip_icmp6_send(nexthop, ICMP6_RPL, RPL_CODE_DAO_ACK, 4);
-      }
-
-      if(status >= RPL_DAO_ACK_UNABLE_TO_ACCEPT) {
-        /* this node did not get in to the routing tables above... - remove */
-        uip_ds6_route_rm(re);
+        dao_ack_output(instance, &child_addr, child_seqno, status);
       }
-    } else {
-      PRINTF("RPL: No route entry found to forward DAO ACK (seqno %u)\n", sequence);
     }
   }
 #endif /* RPL_WITH_DAO_ACK */
@@ -111,6 +111,8 @@ dao_ack_callback(rpl_parent_t *p, int status)
     /* punish the total lack of ACK with a similar punishment */
     link_stats_packet_sent(rpl_get_parent_lladdr(p), MAC_TX_OK, 10);
   }
+  /* The path cost has changed, have the parent ranked again */
+  p->flags |= RPL_PARENT_FLAG_UPDATED;
 }
 #endif /* RPL_WITH_DAO_ACK */
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup uip6
+ * @{
+ */
+/**
+ * \file
+ *         Load-balanced upward forwarding over several RPL parents.
+ *
+ *         Upward packets are normally all sent to the preferred parent.
+ *         With multipath forwarding, the parents whose path cost is close
+ *         to the one of the best parent share the upward traffic in
+ *         proportion to the quality of their links. A flow, identified by
+ *         its source and destination addresses, is assigned to a parent
+ *         with weighted rendezvous hashing: every parent gets a score from
+ *         a hash of the flow and of its address, scaled by its weight, and
+ *         the highest score wins. When the weight of a parent changes, or
+ *         a parent comes or goes, only the flows whose best score changes
+ *         hands move, so that the packets of most flows are not reordered.
+ */
+
+#include "net/rpl/rpl-private.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/link-stats.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#if RPL_WITH_MULTIPATH
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+/* Weight of a parent with a perfect link (ETX 1) */
+#define WEIGHT_SCALE 256
+
+/*---------------------------------------------------------------------------*/
+static uint32_t
+flow_hash(void)
+{
+  uint32_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < sizeof(uip_ipaddr_t); i++) {
+    h = h * 31 + UIP_IP_BUF->srcipaddr.u8[i];
+    h = h * 31 + UIP_IP_BUF->destipaddr.u8[i];
+  }
+  return h;
+}
+/*---------------------------------------------------------------------------*/
+/* Hash of a flow for a given parent, uniform over 16 bits */
+static uint16_t
+parent_hash(uint32_t flow, rpl_parent_t *p)
+{
+  uip_ipaddr_t *addr;
+  uint32_t h;
+  int i;
+
+  h = flow;
+  addr = rpl_get_parent_ipaddr(p);
+  if(addr != NULL) {
+    for(i = 8; i < sizeof(uip_ipaddr_t); i++) {
+      h = h * 31 + addr->u8[i];
+    }
+  }
+  h ^= h >> 16;
+  h *= 0x45d9f3bUL;
+  h ^= h >> 16;
+  return (uint16_t)h;
+}
+/*---------------------------------------------------------------------------*/
+/* -log2(u / 65536) for 0 < u <= 65536, in 1/256 units. The mantissa
+   is approximated by a parabola, within 0.5% of the exact value. The
+   result is at least 1. */
+static uint16_t
+neg_log2(uint32_t u)
+{
+  uint32_t frac;
+  int msb;
+  int r;
+
+  for(msb = 16; !(u & (1UL << msb)); msb--);
+  frac = ((u << 8) >> msb) & 0xff;
+  frac += (frac * (256 - frac) * 89) >> 16;
+  r = ((16 - msb) << 8) - (int)frac;
+  return r > 0 ? r : 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Weighted rendezvous score: w / -ln(hash), so that each parent wins a
+   share of the flows proportional to its weight */
+static uint32_t
+score(uint16_t hash, uint16_t weight)
+{
+  return ((uint32_t)weight << 16) / neg_log2((uint32_t)hash + 1);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+parent_weight(rpl_parent_t *p)
+{
+  const struct link_stats *stats;
+
+  stats = rpl_get_parent_link_stats(p);
+  if(stats == NULL || stats->etx == 0) {
+    return 1;
+  }
+  /* Weights are inversely proportional to the ETX of the link */
+  return MAX((uint32_t)WEIGHT_SCALE * LINK_STATS_ETX_DIVISOR / stats->etx, 1);
+}
+/*---------------------------------------------------------------------------*/
+uip_ipaddr_t *
+rpl_multipath_get_next_hop(uip_ipaddr_t *defrt)
+{
+  rpl_dag_t *dag;
+  rpl_parent_t *parents[RPL_MULTIPATH_MAX_PARENTS];
+  uint16_t weights[RPL_MULTIPATH_MAX_PARENTS];
+  uint32_t flow;
+  uint32_t best_score;
+  uint32_t s;
+  int best;
+  int count;
+  int n;
+  int i;
+
+  if(default_instance == NULL || default_instance->current_dag == NULL) {
+    return defrt;
+  }
+  dag = default_instance->current_dag;
+
+  /* Only balance traffic that would otherwise go to the preferred parent */
+  if(dag->preferred_parent == NULL ||
+     !uip_ipaddr_cmp(defrt, rpl_get_parent_ipaddr(dag->preferred_parent))) {
+    return defrt;
+  }
+
+  count = rpl_get_best_parents(dag, parents, RPL_MULTIPATH_MAX_PARENTS);
+  if(count <= 1) {
+    return defrt;
+  }
+
+  /* Keep the parents that are close to the best one and that have a
+     lower rank than ours, so that sending to them is loop-free */
+  n = 0;
+  for(i = 0; i < count; i++) {
+    if(parents[i]->ranked_cost > parents[0]->ranked_cost + RPL_MULTIPATH_COST_TOLERANCE ||
+       DAG_RANK(parents[i]->rank, default_instance) >= DAG_RANK(dag->rank, default_instance) ||
+       uip_ds6_nbr_lookup(rpl_get_parent_ipaddr(parents[i])) == NULL) {
+      continue;
+    }
+    parents[n] = parents[i];
+    weights[n] = parent_weight(parents[i]);
+    n++;
+  }
+
+  if(n <= 1) {
+    return defrt;
+  }
+
+  flow = flow_hash();
+  best = 0;
+  best_score = 0;
+  for(i = 0; i < n; i++) {
+    s = score(parent_hash(flow, parents[i]), weights[i]);
+    if(s > best_score) {
+      best_score = s;
+      best = i;
+    }
+  }
+
+  PRINTF("RPL: multipath next hop ");
+  PRINT6ADDR(rpl_get_parent_ipaddr(parents[best]));
+  PRINTF(" (%d of %d)\n", best, n);
+
+  return rpl_get_parent_ipaddr(parents[best]);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* RPL_WITH_MULTIPATH */
+
+/** @}*/
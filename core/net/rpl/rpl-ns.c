@@ -63,6 +63,60 @@ static int num_nodes;
 LIST(nodelist);
 MEMB(nodememb, rpl_ns_node_t, RPL_NS_LINK_NUM);
 
+#if (RPL_NS_HASH_SIZE & (RPL_NS_HASH_SIZE - 1)) != 0 || RPL_NS_HASH_SIZE > 65536
+#error RPL_NS_HASH_SIZE must be a power of two, and at most 65536
+#endif
+
+/* The nodes hashed by link identifier, for constant-time lookups */
+static rpl_ns_node_t *node_table[RPL_NS_HASH_SIZE];
+
+/* Incremented whenever a path in the graph may have changed, so that
+ * state derived from the paths (such as cached source routing headers)
+ * can be invalidated */
+static uint16_t epoch;
+
+/*---------------------------------------------------------------------------*/
+static void
+paths_changed(void)
+{
+  epoch++;
+#if RPL_NS_SRH_CACHE_SIZE > 0
+  /* Cached headers are tagged with the epoch they were built in. Once the
+   * epoch wraps, an old tag would match again, so drop them all. */
+  if(epoch == 0) {
+    rpl_ext_header_srh_cache_flush();
+  }
+#endif /* RPL_NS_SRH_CACHE_SIZE > 0 */
+}
+/*---------------------------------------------------------------------------*/
+static rpl_ns_node_t **
+node_bucket(const unsigned char *link_identifier)
+{
+  uint16_t hash = 0;
+  int i;
+  for(i = 0; i < 8; i++) {
+    hash = (hash * 31) + link_identifier[i];
+  }
+  return &node_table[hash & (RPL_NS_HASH_SIZE - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static void
+node_remove(rpl_ns_node_t *node)
+{
+  rpl_ns_node_t **bucket;
+  for(bucket = node_bucket(node->link_identifier); *bucket != NULL;
+      bucket = &(*bucket)->hash_next) {
+    if(*bucket == node) {
+      *bucket = node->hash_next;
+      break;
+    }
+  }
+  list_remove(nodelist, node);
+  memb_free(&nodememb, node);
+  num_nodes--;
+  paths_changed();
+}
+
 /*---------------------------------------------------------------------------*/
 int
 rpl_ns_num_nodes(void)
@@ -85,7 +139,11 @@ rpl_ns_node_t *
 rpl_ns_get_node(const rpl_dag_t *dag, const uip_ipaddr_t *addr)
 {
   rpl_ns_node_t *l;
-  for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
+  if(addr == NULL) {
+    return NULL;
+  }
+  for(l = *node_bucket(((const unsigned char *)addr) + 8); l != NULL;
+      l = l->hash_next) {
     /* Compare prefix and node identifier */
     if(node_matches_address(dag, l, addr)) {
       return l;
@@ -114,6 +172,7 @@ rpl_ns_expire_parent(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr
   /* Check if parent matches */
   if(l != NULL && node_matches_address(dag, l->parent, parent)) {
     l->lifetime = RPL_NOPATH_REMOVAL_DELAY;
+    paths_changed();
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -123,6 +182,7 @@ rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t
   rpl_ns_node_t *child_node = rpl_ns_get_node(dag, child);
   rpl_ns_node_t *parent_node = rpl_ns_get_node(dag, parent);
   rpl_ns_node_t *old_parent_node;
+  rpl_ns_node_t **bucket;
 
   if(parent != NULL) {
     /* No node for the parent, add one with infinite lifetime */
@@ -142,6 +202,10 @@ rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t
       return NULL;
     }
     child_node->parent = NULL;
+    memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
+    bucket = node_bucket(child_node->link_identifier);
+    child_node->hash_next = *bucket;
+    *bucket = child_node;
     list_add(nodelist, child_node);
     num_nodes++;
   }
@@ -149,11 +213,10 @@ rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t
   /* Initialize node */
   child_node->dag = dag;
   child_node->lifetime = lifetime;
-  memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
+  old_parent_node = child_node->parent;
 
   /* Is the node reachable before the update? */
   if(rpl_ns_is_node_reachable(dag, child)) {
-    old_parent_node = child_node->parent;
     /* Update node */
     child_node->parent = parent_node;
     /* Has the node become unreachable? May happen if we create a loop. */
@@ -167,6 +230,10 @@ rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t
     child_node->parent = parent_node;
   }
 
+  if(child_node->parent != old_parent_node) {
+    paths_changed();
+  }
+
   return child_node;
 }
 /*---------------------------------------------------------------------------*/
@@ -176,6 +243,8 @@ rpl_ns_init(void)
   num_nodes = 0;
   memb_init(&nodememb);
   list_init(nodelist);
+  memset(node_table, 0, sizeof(node_table));
+  paths_changed();
 }
 /*---------------------------------------------------------------------------*/
 rpl_ns_node_t *
@@ -199,10 +268,17 @@ rpl_ns_get_node_global_addr(uip_ipaddr_t *addr, rpl_ns_node_t *node)
   }
 }
 /*---------------------------------------------------------------------------*/
+uint16_t
+rpl_ns_epoch(void)
+{
+  return epoch;
+}
+/*---------------------------------------------------------------------------*/
 void
 rpl_ns_periodic(void)
 {
   rpl_ns_node_t *l;
+  rpl_ns_node_t *next;
   /* First pass, decrement lifetime for all nodes with non-infinite lifetime */
   for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
     /* Don't touch infinite lifetime nodes */
@@ -211,7 +287,8 @@ rpl_ns_periodic(void)
     }
   }
   /* Second pass, for all expire nodes, deallocate them iff no child points to them */
-  for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
+  for(l = list_head(nodelist); l != NULL; l = next) {
+    next = list_item_next(l);
     if(l->lifetime == 0) {
       rpl_ns_node_t *l2;
       for(l2 = list_head(nodelist); l2 != NULL; l2 = list_item_next(l2)) {
@@ -219,10 +296,10 @@ rpl_ns_periodic(void)
           break;
         }
       }
-      /* No child found, deallocate node */
-      list_remove(nodelist, l);
-      memb_free(&nodememb, l);
-      num_nodes--;
+      if(l2 == NULL) {
+        /* No child found, deallocate node */
+        node_remove(l);
+      }
     }
   }
 }
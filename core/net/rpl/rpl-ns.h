@@ -49,8 +49,47 @@
 #define RPL_NS_LINK_NUM 32
 #endif /* RPL_NS_CONF_LINK_NUM */
 
+/* Number of buckets in the hash table used to look up nodes by address.
+ * Must be a power of two. By default, there is one bucket for every two
+ * nodes, so that chains remain short in large networks. */
+#ifdef RPL_NS_CONF_HASH_SIZE
+#define RPL_NS_HASH_SIZE RPL_NS_CONF_HASH_SIZE
+#elif RPL_NS_LINK_NUM <= 16
+#define RPL_NS_HASH_SIZE 8
+#elif RPL_NS_LINK_NUM <= 32
+#define RPL_NS_HASH_SIZE 16
+#elif RPL_NS_LINK_NUM <= 64
+#define RPL_NS_HASH_SIZE 32
+#elif RPL_NS_LINK_NUM <= 128
+#define RPL_NS_HASH_SIZE 64
+#elif RPL_NS_LINK_NUM <= 256
+#define RPL_NS_HASH_SIZE 128
+#elif RPL_NS_LINK_NUM <= 512
+#define RPL_NS_HASH_SIZE 256
+#elif RPL_NS_LINK_NUM <= 1024
+#define RPL_NS_HASH_SIZE 512
+#else
+#define RPL_NS_HASH_SIZE 1024
+#endif /* RPL_NS_CONF_HASH_SIZE */
+
+/* Number of destinations for which the root caches the source routing
+ * header, and the maximum length of a cached header. 0 disables the cache. */
+#ifdef RPL_NS_CONF_SRH_CACHE_SIZE
+#define RPL_NS_SRH_CACHE_SIZE RPL_NS_CONF_SRH_CACHE_SIZE
+#else /* RPL_NS_CONF_SRH_CACHE_SIZE */
+#define RPL_NS_SRH_CACHE_SIZE 8
+#endif /* RPL_NS_CONF_SRH_CACHE_SIZE */
+
+#ifdef RPL_NS_CONF_SRH_CACHE_HEADER_LEN
+#define RPL_NS_SRH_CACHE_HEADER_LEN RPL_NS_CONF_SRH_CACHE_HEADER_LEN
+#else /* RPL_NS_CONF_SRH_CACHE_HEADER_LEN */
+#define RPL_NS_SRH_CACHE_HEADER_LEN 64
+#endif /* RPL_NS_CONF_SRH_CACHE_HEADER_LEN */
+
 typedef struct rpl_ns_node {
   struct rpl_ns_node *next;
+  /* Next node in the same hash bucket */
+  struct rpl_ns_node *hash_next;
   uint32_t lifetime;
   rpl_dag_t *dag;
   /* Store only IPv6 link identifiers as all nodes in the DAG share the same prefix */
@@ -68,5 +107,6 @@ rpl_ns_node_t *rpl_ns_get_node(const rpl_dag_t *dag, const uip_ipaddr_t *addr);
 int rpl_ns_is_node_reachable(const rpl_dag_t *dag, const uip_ipaddr_t *addr);
 void rpl_ns_get_node_global_addr(uip_ipaddr_t *addr, rpl_ns_node_t *node);
 void rpl_ns_periodic(void);
+uint16_t rpl_ns_epoch(void);
 
 #endif /* RPL_NS_H */
@@ -123,6 +123,35 @@
 #define RPL_DAO_DELAY                 (CLOCK_SECOND * 4)
 #endif /* RPL_CONF_DAO_DELAY */
 
+/* Targets forwarded by storing-mode routers are collected for
+   RPL_DAO_AGGREGATION_DELAY and sent to the preferred parent in as few
+   DAOs as possible. With a zero delay, only the targets of each received
+   DAO are forwarded together. */
+#ifdef RPL_CONF_DAO_AGGREGATION_DELAY
+#define RPL_DAO_AGGREGATION_DELAY     RPL_CONF_DAO_AGGREGATION_DELAY
+#else /* RPL_CONF_DAO_AGGREGATION_DELAY */
+#define RPL_DAO_AGGREGATION_DELAY     (CLOCK_SECOND / 4)
+#endif /* RPL_CONF_DAO_AGGREGATION_DELAY */
+
+/* Maximum number of targets in an aggregated DAO. Each target takes up
+   to 26 bytes with its transit information; a batch is also sent as soon
+   as the next target might not fit in uip_buf, so small buffers get fewer
+   targets per DAO. */
+#ifdef RPL_CONF_DAO_AGGREGATION_MAX_TARGETS
+#define RPL_DAO_AGGREGATION_MAX_TARGETS RPL_CONF_DAO_AGGREGATION_MAX_TARGETS
+#else /* RPL_CONF_DAO_AGGREGATION_MAX_TARGETS */
+#define RPL_DAO_AGGREGATION_MAX_TARGETS 8
+#endif /* RPL_CONF_DAO_AGGREGATION_MAX_TARGETS */
+
+/* Maximum number of targets processed in a received DAO, whatever the
+   DAO aggregation settings of the sender. A DAO with more targets is
+   answered with a negative DAO-ACK, if it asks for an ACK. */
+#ifdef RPL_CONF_DAO_MAX_TARGETS
+#define RPL_DAO_MAX_TARGETS           RPL_CONF_DAO_MAX_TARGETS
+#else /* RPL_CONF_DAO_MAX_TARGETS */
+#define RPL_DAO_MAX_TARGETS           8
+#endif /* RPL_CONF_DAO_MAX_TARGETS */
+
 /* Delay between reception of a no-path DAO and actual route removal */
 #ifdef RPL_CONF_NOPATH_REMOVAL_DELAY
 #define RPL_NOPATH_REMOVAL_DELAY          RPL_CONF_NOPATH_REMOVAL_DELAY
@@ -324,6 +353,7 @@ struct rpl_stats {
   uint16_t loop_errors;
   uint16_t loop_warnings;
   uint16_t root_repairs;
+  uint16_t dao_saved;
 };
 typedef struct rpl_stats rpl_stats_t;
 
@@ -351,6 +381,7 @@ void dao_output(rpl_parent_t *, uint8_t lifetime);
 void dao_output_target(rpl_parent_t *, uip_ipaddr_t *, uint8_t lifetime);
 void dao_ack_output(rpl_instance_t *, uip_ipaddr_t *, uint8_t, uint8_t);
 void rpl_icmp6_register_handlers(void);
+void rpl_icmp6_discard_dao_batch(rpl_instance_t *);
 uip_ds6_nbr_t *rpl_icmp6_update_nbr_table(uip_ipaddr_t *from,
                                           nbr_table_reason_t r, void *data);
 
@@ -376,6 +407,7 @@ void rpl_nullify_parent(rpl_parent_t *);
 void rpl_remove_parent(rpl_parent_t *);
 void rpl_move_parent(rpl_dag_t *dag_src, rpl_dag_t *dag_dst, rpl_parent_t *parent);
 rpl_parent_t *rpl_select_parent(rpl_dag_t *dag);
+int rpl_get_best_parents(rpl_dag_t *dag, rpl_parent_t **parents, int k);
 rpl_dag_t *rpl_select_dag(rpl_instance_t *instance,rpl_parent_t *parent);
 void rpl_recalculate_ranks(void);
 
@@ -402,6 +434,9 @@ void rpl_reset_periodic_timer(void);
 /* Route poisoning. */
 void rpl_poison_routes(rpl_dag_t *, rpl_parent_t *);
 
+/* Source routing header cache. */
+void rpl_ext_header_srh_cache_flush(void);
+
 
 rpl_instance_t *rpl_get_default_instance(void);
 
@@ -402,7 +402,6 @@ get_probing_target(rpl_dag_t *dag)
 
   rpl_parent_t *p;
   rpl_parent_t *probing_target = NULL;
-  rpl_rank_t probing_target_rank = INFINITE_RANK;
   clock_time_t probing_target_age = 0;
   clock_time_t clock_now = clock_time();
 
@@ -421,20 +420,14 @@ get_probing_target(rpl_dag_t *dag)
     return dag->preferred_parent;
   }
 
-  /* With 50% probability: probe best non-fresh parent */
+  /* With 50% probability: probe best non-fresh parent, i.e., the first
+   * non-fresh parent in the ranking of the DAG */
   if(random_rand() % 2 == 0) {
-    p = nbr_table_head(rpl_parents);
-    while(p != NULL) {
-      if(p->dag == dag && !rpl_parent_is_fresh(p)) {
-        /* p is in our dag and needs probing */
-        rpl_rank_t p_rank = rpl_rank_via_parent(p);
-        if(probing_target == NULL
-            || p_rank < probing_target_rank) {
-          probing_target = p;
-          probing_target_rank = p_rank;
-        }
+    for(p = dag->ranked_parents; p != NULL; p = p->next) {
+      if(!rpl_parent_is_fresh(p)) {
+        probing_target = p;
+        break;
       }
-      p = nbr_table_next(rpl_parents, p);
     }
   }
 
@@ -110,13 +110,18 @@ struct rpl_dag;
 /*---------------------------------------------------------------------------*/
 #define RPL_PARENT_FLAG_UPDATED           0x1
 #define RPL_PARENT_FLAG_LINK_METRIC_VALID 0x2
+#define RPL_PARENT_FLAG_UNACCEPTABLE      0x4
 
 struct rpl_parent {
+  /* Next parent in the ranked candidate list of the DAG */
+  struct rpl_parent *next;
   struct rpl_dag *dag;
 #if RPL_WITH_MC
   rpl_metric_container_t mc;
 #endif /* RPL_WITH_MC */
   rpl_rank_t rank;
+  /* Path cost of the parent when it was last ranked */
+  uint16_t ranked_cost;
   uint8_t dtsn;
   uint8_t flags;
 };
@@ -142,6 +147,8 @@ struct rpl_dag {
   /* live data for the DAG */
   uint8_t joined;
   rpl_parent_t *preferred_parent;
+  /* Candidate parents, best first according to the objective function */
+  rpl_parent_t *ranked_parents;
   rpl_rank_t rank;
   struct rpl_instance *instance;
   rpl_prefix_t prefix_info;
@@ -293,6 +300,7 @@ uip_ds6_nbr_t *rpl_get_nbr(rpl_parent_t *parent);
 void rpl_print_neighbor_list(void);
 int rpl_process_srh_header(void);
 int rpl_srh_get_next_hop(uip_ipaddr_t *ipaddr);
+uip_ipaddr_t *rpl_multipath_get_next_hop(uip_ipaddr_t *defrt);
 
 /* Per-parent RPL information */
 NBR_TABLE_DECLARE(rpl_parents);
@@ -129,6 +129,22 @@
 
 #define CC_ACCESS_NOW(type, variable) (*(volatile type *)&(variable))
 
+/** \def CC_COMPILER_BARRIER()
+ * This macro prevents the compiler from moving memory accesses across
+ * it. On the single-core platforms Contiki runs on, this is enough to
+ * order the accesses of the main thread with respect to the accesses
+ * of interrupt handlers, e.g., to write an element before publishing
+ * its index. Platforms whose compiler does not support the GCC syntax
+ * can provide their own barrier through CC_CONF_COMPILER_BARRIER.
+ */
+#ifdef CC_CONF_COMPILER_BARRIER
+#define CC_COMPILER_BARRIER() CC_CONF_COMPILER_BARRIER()
+#elif defined(__GNUC__)
+#define CC_COMPILER_BARRIER() __asm__ __volatile__("" : : : "memory")
+#else
+#define CC_COMPILER_BARRIER()
+#endif
+
 #ifndef NULL
 #define NULL 0
 #endif /* NULL */
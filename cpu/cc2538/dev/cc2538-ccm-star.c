@@ -76,6 +76,7 @@ static void
 set_key(const uint8_t *key)
 {
   cc2538_aes_128_driver.set_key(key);
+  ccm_star_deselect_context();
 }
 /*---------------------------------------------------------------------------*/
 static void
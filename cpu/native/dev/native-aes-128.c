@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         AES-128 driver for x86 CPUs with the AES-NI instructions.
+ *         Whether the CPU supports AES-NI is checked at run time, so
+ *         the same binary runs on hosts without it.
+ */
+
+#include "native-aes-128.h"
+#include "lib/aes-128-ttable.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define WITH_AES_NI 1
+#else
+#define WITH_AES_NI 0
+#endif
+
+#if WITH_AES_NI
+#include <wmmintrin.h>
+
+#define AES_NI __attribute__((target("aes,sse2")))
+
+/* Round keys are kept in memory in the byte order of the block, so
+   that they can be stored in the schedule of a context */
+static uint8_t schedule[AES_128_SCHEDULE_WORDS * 4];
+/* Points either to the schedule above or to the one of a context */
+static const uint8_t *round_keys = schedule;
+static int has_aes_ni = -1;
+
+#define ROUND_KEY(i) \
+  _mm_loadu_si128((const __m128i *)(round_keys + (i) * AES_128_BLOCK_SIZE))
+
+/*---------------------------------------------------------------------------*/
+static int
+use_aes_ni(void)
+{
+  if(has_aes_ni < 0) {
+    __builtin_cpu_init();
+    has_aes_ni = __builtin_cpu_supports("aes") != 0;
+  }
+  return has_aes_ni;
+}
+/*---------------------------------------------------------------------------*/
+static AES_NI __m128i
+expand_key(__m128i key, __m128i keygened)
+{
+  keygened = _mm_shuffle_epi32(keygened, _MM_SHUFFLE(3, 3, 3, 3));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, keygened);
+}
+/*---------------------------------------------------------------------------*/
+/* The round constant of _mm_aeskeygenassist_si128 must be an
+   immediate */
+#define EXPAND_KEY(i, rcon) \
+  rk[i] = expand_key(rk[i - 1], _mm_aeskeygenassist_si128(rk[i - 1], rcon))
+
+static AES_NI void
+expand_key_ni(uint8_t *result, const uint8_t *key)
+{
+  __m128i rk[11];
+  int i;
+
+  rk[0] = _mm_loadu_si128((const __m128i *)key);
+  EXPAND_KEY(1, 0x01);
+  EXPAND_KEY(2, 0x02);
+  EXPAND_KEY(3, 0x04);
+  EXPAND_KEY(4, 0x08);
+  EXPAND_KEY(5, 0x10);
+  EXPAND_KEY(6, 0x20);
+  EXPAND_KEY(7, 0x40);
+  EXPAND_KEY(8, 0x80);
+  EXPAND_KEY(9, 0x1b);
+  EXPAND_KEY(10, 0x36);
+  for(i = 0; i < 11; i++) {
+    _mm_storeu_si128((__m128i *)(result + i * AES_128_BLOCK_SIZE), rk[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static AES_NI void
+encrypt_ni(uint8_t *plaintext_and_result)
+{
+  __m128i state;
+  int round;
+
+  state = _mm_loadu_si128((const __m128i *)plaintext_and_result);
+  state = _mm_xor_si128(state, ROUND_KEY(0));
+  for(round = 1; round < 10; round++) {
+    state = _mm_aesenc_si128(state, ROUND_KEY(round));
+  }
+  state = _mm_aesenclast_si128(state, ROUND_KEY(10));
+  _mm_storeu_si128((__m128i *)plaintext_and_result, state);
+}
+#endif /* WITH_AES_NI */
+/*---------------------------------------------------------------------------*/
+static void
+set_key(const uint8_t *key)
+{
+#if WITH_AES_NI
+  if(use_aes_ni()) {
+    expand_key_ni(schedule, key);
+    round_keys = schedule;
+    return;
+  }
+#endif /* WITH_AES_NI */
+  aes_128_ttable_driver.set_key(key);
+}
+/*---------------------------------------------------------------------------*/
+static void
+encrypt(uint8_t *plaintext_and_result)
+{
+#if WITH_AES_NI
+  if(has_aes_ni > 0) {
+    encrypt_ni(plaintext_and_result);
+    return;
+  }
+#endif /* WITH_AES_NI */
+  aes_128_ttable_driver.encrypt(plaintext_and_result);
+}
+/*---------------------------------------------------------------------------*/
+static void
+init_context(struct aes_128_context *context)
+{
+#if WITH_AES_NI
+  if(use_aes_ni()) {
+    expand_key_ni((uint8_t *)context->schedule, context->key);
+    return;
+  }
+#endif /* WITH_AES_NI */
+  aes_128_ttable_driver.init_context(context);
+}
+/*---------------------------------------------------------------------------*/
+static void
+select_context(const struct aes_128_context *context)
+{
+#if WITH_AES_NI
+  if(use_aes_ni()) {
+    round_keys = (const uint8_t *)context->schedule;
+    return;
+  }
+#endif /* WITH_AES_NI */
+  aes_128_ttable_driver.select_context(context);
+}
+/*---------------------------------------------------------------------------*/
+const struct aes_128_driver native_aes_128_driver = {
+  set_key,
+  encrypt,
+  init_context,
+  select_context
+};
+/*---------------------------------------------------------------------------*/
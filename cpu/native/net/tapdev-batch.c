@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Batched frame I/O for the tap device.
+ */
+
+#include "tapdev-batch.h"
+
+#if TAPDEV_BATCH_SIZE > 1
+
+#include "lib/ringbufindex.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) fprintf(stderr, __VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+struct tapdev_frame {
+  uint16_t len;
+  uint8_t data[UIP_BUFSIZE];
+};
+
+static int fd = -1;
+static uint8_t in_batch;
+
+static struct ringbufindex rx_ring;
+static struct tapdev_frame rx_frames[TAPDEV_BATCH_SIZE];
+static struct ringbufindex tx_ring;
+static struct tapdev_frame tx_frames[TAPDEV_BATCH_SIZE];
+
+/*---------------------------------------------------------------------------*/
+void
+tapdev_batch_init(int tapfd)
+{
+  int flags;
+
+  fd = tapfd;
+  ringbufindex_init(&rx_ring, TAPDEV_BATCH_SIZE);
+  ringbufindex_init(&tx_ring, TAPDEV_BATCH_SIZE);
+  in_batch = 0;
+
+  /* Reads stop at the first EAGAIN instead of waiting in select() */
+  flags = fcntl(fd, F_GETFL, 0);
+  if(flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+    perror("tapdev: tapdev_batch_init: fcntl");
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+refill(void)
+{
+  int i;
+  int ret;
+
+  while((i = ringbufindex_peek_put(&rx_ring)) != -1) {
+    ret = read(fd, rx_frames[i].data, UIP_BUFSIZE);
+    if(ret <= 0) {
+      if(ret == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        perror("tapdev: tapdev_batch_read: read");
+      }
+      return;
+    }
+    rx_frames[i].len = ret;
+    ringbufindex_put(&rx_ring);
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+tapdev_batch_read(void)
+{
+  int i;
+  uint16_t len;
+
+  if(fd < 0) {
+    return 0;
+  }
+
+  if(ringbufindex_empty(&rx_ring)) {
+    refill();
+    PRINTF("tapdev_batch_read: read %d frames\n",
+           ringbufindex_elements(&rx_ring));
+  }
+
+  i = ringbufindex_peek_get(&rx_ring);
+  if(i == -1) {
+    return 0;
+  }
+  len = rx_frames[i].len;
+  memcpy(uip_buf, rx_frames[i].data, len);
+  ringbufindex_get(&rx_ring);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_frame(const uint8_t *buf, uint16_t len)
+{
+  if(write(fd, buf, len) == -1) {
+    if(errno == EAGAIN || errno == EWOULDBLOCK) {
+      /* The interface queue is full: drop, as a NIC would */
+      PRINTF("tapdev_batch_write: dropped a %u bytes frame\n", len);
+      return;
+    }
+    perror("tapdev: tapdev_batch_write: write");
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+flush(void)
+{
+  int i;
+
+  while((i = ringbufindex_peek_get(&tx_ring)) != -1) {
+    write_frame(tx_frames[i].data, tx_frames[i].len);
+    ringbufindex_get(&tx_ring);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tapdev_batch_write(const uint8_t *buf, uint16_t len)
+{
+  int i;
+
+  if(fd < 0) {
+    return;
+  }
+
+  if(!in_batch) {
+    write_frame(buf, len);
+    return;
+  }
+
+  i = ringbufindex_peek_put(&tx_ring);
+  if(i == -1) {
+    flush();
+    i = ringbufindex_peek_put(&tx_ring);
+  }
+  tx_frames[i].len = MIN(len, UIP_BUFSIZE);
+  memcpy(tx_frames[i].data, buf, tx_frames[i].len);
+  ringbufindex_put(&tx_ring);
+}
+/*---------------------------------------------------------------------------*/
+void
+tapdev_batch_begin(void)
+{
+  in_batch = 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+tapdev_batch_end(void)
+{
+  in_batch = 0;
+  if(fd >= 0) {
+    PRINTF("tapdev_batch_end: writing %d frames\n",
+           ringbufindex_elements(&tx_ring));
+    flush();
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* TAPDEV_BATCH_SIZE > 1 */
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Batched frame I/O for the tap device.
+ *
+ *         With batching, a single wakeup of the TAP driver reads all the
+ *         frames pending on the tap file descriptor into a ring, and
+ *         they are then fed to the stack back to back. Frames sent while
+ *         the driver processes a batch are queued as well, and written
+ *         when the batch ends.
+ */
+
+#ifndef TAPDEV_BATCH_H_
+#define TAPDEV_BATCH_H_
+
+#include "contiki-net.h"
+
+/* Maximum number of frames read or queued for writing per batch. Must
+ * be a power of two, and at most 128. With 1, the tap device reads and
+ * writes one frame at a time, as it used to. */
+#ifdef TAPDEV_CONF_BATCH_SIZE
+#define TAPDEV_BATCH_SIZE TAPDEV_CONF_BATCH_SIZE
+#else /* TAPDEV_CONF_BATCH_SIZE */
+#define TAPDEV_BATCH_SIZE 1
+#endif /* TAPDEV_CONF_BATCH_SIZE */
+
+/* Check if TAPDEV_BATCH_SIZE fits in a ringbufindex */
+#if TAPDEV_BATCH_SIZE < 1 || TAPDEV_BATCH_SIZE > 128 || \
+  (TAPDEV_BATCH_SIZE & (TAPDEV_BATCH_SIZE - 1)) != 0
+#error TAPDEV_BATCH_SIZE must be power of two, at most 128
+#endif
+
+#if TAPDEV_BATCH_SIZE > 1
+
+/* Set fd up for batched I/O. It is made non-blocking. */
+void tapdev_batch_init(int fd);
+/* Copy the next received frame to uip_buf and return its length, or 0
+ * if there is none. When the ring is empty, it is first refilled with
+ * all the frames pending on the file descriptor. */
+uint16_t tapdev_batch_read(void);
+/* Write a frame, or queue it if a batch is being processed */
+void tapdev_batch_write(const uint8_t *buf, uint16_t len);
+/* Start processing a batch of input frames */
+void tapdev_batch_begin(void);
+/* Stop processing a batch, and write the queued frames */
+void tapdev_batch_end(void);
+
+#else /* TAPDEV_BATCH_SIZE > 1 */
+
+#define tapdev_batch_begin()
+#define tapdev_batch_end()
+
+#endif /* TAPDEV_BATCH_SIZE > 1 */
+
+#endif /* TAPDEV_BATCH_H_ */
@@ -41,6 +41,7 @@
 #endif /* NETSTACK_CONF_WITH_IPV6 */
 
 #include "tapdev-drv.h"
+#include "tapdev-batch.h"
 
 #define BUF ((struct uip_eth_hdr *)&uip_buf[0])
 #define IPBUF ((struct uip_tcpip_hdr *)&uip_buf[UIP_LLH_LEN])
@@ -59,10 +60,8 @@ tapdev_output(void)
 #endif
 /*---------------------------------------------------------------------------*/
 static void
-pollhandler(void)
+input(void)
 {
-  uip_len = tapdev_poll();
-
   if(uip_len > 0) {
 #if NETSTACK_CONF_WITH_IPV6
     if(BUF->type == uip_htons(UIP_ETHTYPE_IPV6)) {
@@ -88,6 +87,55 @@ pollhandler(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+pollhandler(void)
+{
+  int n;
+
+  /* Feed up to a batch of frames to the stack, and hold back the
+     frames sent meanwhile until the end of the batch */
+  tapdev_batch_begin();
+  for(n = 0; n < TAPDEV_BATCH_SIZE; n++) {
+    uip_len = tapdev_poll();
+    if(uip_len == 0) {
+      break;
+    }
+    input();
+  }
+  tapdev_batch_end();
+
+#if TAPDEV_BATCH_SIZE > 1
+  if(n == TAPDEV_BATCH_SIZE) {
+    /* More frames may be pending. Let other processes run first. */
+    process_poll(&tapdev_process);
+  }
+#endif /* TAPDEV_BATCH_SIZE > 1 */
+}
+/*---------------------------------------------------------------------------*/
+#ifdef CONTIKI_TARGET_NATIVE
+static int
+set_fd(fd_set *rset, fd_set *wset)
+{
+  if(tapdev_fd() < 0) {
+    return 0;
+  }
+  FD_SET(tapdev_fd(), rset);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_fd(fd_set *rset, fd_set *wset)
+{
+  if(tapdev_fd() >= 0 && FD_ISSET(tapdev_fd(), rset)) {
+    process_poll(&tapdev_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const struct select_callback tapdev_select_callback = {
+  set_fd, handle_fd
+};
+#endif /* CONTIKI_TARGET_NATIVE */
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(tapdev_process, ev, data)
 {
   PROCESS_POLLHANDLER(pollhandler());
@@ -95,6 +143,12 @@ PROCESS_THREAD(tapdev_process, ev, data)
   PROCESS_BEGIN();
 
   tapdev_init();
+#ifdef CONTIKI_TARGET_NATIVE
+  /* Get polled from the select() loop of the native platform */
+  if(tapdev_fd() >= 0) {
+    select_set_callback(tapdev_fd(), &tapdev_select_callback);
+  }
+#endif /* CONTIKI_TARGET_NATIVE */
 #if !NETSTACK_CONF_WITH_IPV6
   tcpip_set_outputfunc(tapdev_output);
 #else
@@ -104,6 +158,11 @@ PROCESS_THREAD(tapdev_process, ev, data)
 
   PROCESS_WAIT_UNTIL(ev == PROCESS_EVENT_EXIT);
 
+#ifdef CONTIKI_TARGET_NATIVE
+  if(tapdev_fd() >= 0) {
+    select_set_callback(tapdev_fd(), NULL);
+  }
+#endif /* CONTIKI_TARGET_NATIVE */
   tapdev_exit();
 
   PROCESS_END();
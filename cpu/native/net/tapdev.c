@@ -61,6 +61,7 @@
 
 #include "contiki-net.h"
 #include "tapdev.h"
+#include "tapdev-batch.h"
 
 #define DROP 0
 
@@ -143,12 +144,19 @@ tapdev_init(void)
   fprintf(stderr, "%s\n", buf);
   atexit(remove_route);
 
+#if TAPDEV_BATCH_SIZE > 1
+  tapdev_batch_init(fd);
+#endif /* TAPDEV_BATCH_SIZE > 1 */
+
   lasttime = 0;
 }
 /*---------------------------------------------------------------------------*/
 uint16_t
 tapdev_poll(void)
 {
+#if TAPDEV_BATCH_SIZE > 1
+  return tapdev_batch_read();
+#else /* TAPDEV_BATCH_SIZE > 1 */
   fd_set fdset;
   struct timeval tv;
   int ret;
@@ -173,12 +181,15 @@ tapdev_poll(void)
     perror("tapdev_poll: read");
   }
   return ret;
+#endif /* TAPDEV_BATCH_SIZE > 1 */
 }
 /*---------------------------------------------------------------------------*/
 void
 tapdev_send(void)
 {
+#if TAPDEV_BATCH_SIZE <= 1
   int ret;
+#endif /* TAPDEV_BATCH_SIZE <= 1 */
 
   if(fd <= 0) {
     return;
@@ -196,12 +207,16 @@ tapdev_send(void)
 #endif /* DROP */
 
   PRINTF("tapdev_send: sending %d bytes\n", uip_len);
+#if TAPDEV_BATCH_SIZE > 1
+  tapdev_batch_write(uip_buf, uip_len);
+#else /* TAPDEV_BATCH_SIZE > 1 */
   ret = write(fd, uip_buf, uip_len);
 
   if(ret == -1) {
     perror("tap_dev: tapdev_send: writev");
     exit(1);
   }
+#endif /* TAPDEV_BATCH_SIZE > 1 */
 }
 /*---------------------------------------------------------------------------*/
 void
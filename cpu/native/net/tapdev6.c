@@ -73,6 +73,7 @@
 #endif
 
 #include "tapdev6.h"
+#include "tapdev-batch.h"
 #include "contiki-net.h"
 
 #define DROP 0
@@ -111,6 +112,9 @@ tapdev_fd(void)
 uint16_t
 tapdev_poll(void)
 {
+#if TAPDEV_BATCH_SIZE > 1
+  return tapdev_batch_read();
+#else /* TAPDEV_BATCH_SIZE > 1 */
   fd_set fdset;
   struct timeval tv;
   int ret;
@@ -136,6 +140,7 @@ tapdev_poll(void)
     perror("tapdev_poll: read");
   }
   return ret;
+#endif /* TAPDEV_BATCH_SIZE > 1 */
 }
 /*---------------------------------------------------------------------------*/
 #if defined(__APPLE__)
@@ -337,6 +342,10 @@ tapdev_init(void)
   }
   printf("%s\n", buf);
   
+#if TAPDEV_BATCH_SIZE > 1
+  tapdev_batch_init(fd);
+#endif /* TAPDEV_BATCH_SIZE > 1 */
+
   /*  */
   lasttime = 0;
   
@@ -349,7 +358,9 @@ tapdev_init(void)
 static void
 do_send(void)
 {
+#if TAPDEV_BATCH_SIZE <= 1
   int ret;
+#endif /* TAPDEV_BATCH_SIZE <= 1 */
 
   if(fd <= 0) {
     return;
@@ -366,12 +377,16 @@ do_send(void)
   }
 #endif /* DROP */
 
+#if TAPDEV_BATCH_SIZE > 1
+  tapdev_batch_write(uip_buf, uip_len);
+#else /* TAPDEV_BATCH_SIZE > 1 */
   ret = write(fd, uip_buf, uip_len);
 
   if(ret == -1) {
     perror("tap_dev: tapdev_send: writev");
     exit(1);
   }
+#endif /* TAPDEV_BATCH_SIZE > 1 */
 }
 /*---------------------------------------------------------------------------*/
 uint8_t
@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	Performance benchmark for Antelope queries over generated relations.
+ */
+
+#include <stdio.h>
+
+#include "contiki.h"
+
+#include "antelope.h"
+#include "relation.h"
+
+#ifdef DB_BENCHMARK_CONF_ROWS
+#define DB_BENCHMARK_ROWS DB_BENCHMARK_CONF_ROWS
+#else
+#define DB_BENCHMARK_ROWS 1000
+#endif
+
+#ifdef DB_BENCHMARK_CONF_SENSORS
+#define DB_BENCHMARK_SENSORS DB_BENCHMARK_CONF_SENSORS
+#else
+#define DB_BENCHMARK_SENSORS 50
+#endif
+
+
+#ifdef DB_BENCHMARK_CONF_SAMPLES
+#define DB_BENCHMARK_SAMPLES DB_BENCHMARK_CONF_SAMPLES
+#else
+#define DB_BENCHMARK_SAMPLES 5000
+#endif
+
+/* Measurements are repeated until they have taken at least this long,
+   since the clock only has a resolution of a few milliseconds. */
+#define MIN_TIME (CLOCK_SECOND / 2)
+
+PROCESS(db_benchmark, "DB benchmark");
+AUTOSTART_PROCESSES(&db_benchmark);
+
+/*---------------------------------------------------------------------------*/
+static void
+query(const char *format, int a, int b)
+{
+  db_result_t result;
+
+  result = db_query(NULL, format, a, b);
+  if(DB_ERROR(result)) {
+    printf("Query \"%s\" failed: %s\n", format, db_get_result_message(result));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+generate_relations(void)
+{
+  int i;
+
+  query("REMOVE RELATION readings;", 0, 0);
+  query("REMOVE RELATION calib;", 0, 0);
+
+  query("CREATE RELATION readings;", 0, 0);
+  query("CREATE ATTRIBUTE sensor DOMAIN INT IN readings;", 0, 0);
+  query("CREATE ATTRIBUTE value DOMAIN INT IN readings;", 0, 0);
+
+  query("CREATE RELATION calib;", 0, 0);
+  query("CREATE ATTRIBUTE sensor DOMAIN INT IN calib;", 0, 0);
+  query("CREATE ATTRIBUTE offset DOMAIN INT IN calib;", 0, 0);
+
+  /* Both relations are generated in the order of the sensor attribute,
+     so that inline indexes can be used on it. */
+  for(i = 0; i < DB_BENCHMARK_ROWS; i++) {
+    query("INSERT (%d, %d) INTO readings;",
+          (long)i * DB_BENCHMARK_SENSORS / DB_BENCHMARK_ROWS, i);
+  }
+  for(i = 0; i < DB_BENCHMARK_SENSORS; i++) {
+    query("INSERT (%d, %d) INTO calib;", i, 100 + i);
+  }
+
+  query("CREATE INDEX readings.sensor TYPE INLINE;", 0, 0);
+  query("CREATE INDEX calib.sensor TYPE INLINE;", 0, 0);
+}
+/*---------------------------------------------------------------------------*/
+/* Log samples through the relation API, as a sensor logging
+   application would, and measure the insertion rate. The relation is
+   recreated until the insertions have taken at least MIN_TIME. */
+static void
+insert_samples(void)
+{
+  relation_t *rel;
+  attribute_value_t values[2];
+  unsigned long total;
+  clock_time_t start;
+  clock_time_t elapsed;
+  long i;
+
+  values[0].domain = DOMAIN_LONG;
+  values[1].domain = DOMAIN_INT;
+
+  total = 0;
+  elapsed = 0;
+  while(elapsed < MIN_TIME) {
+    query("REMOVE RELATION samples;", 0, 0);
+    query("CREATE RELATION samples;", 0, 0);
+    query("CREATE ATTRIBUTE time DOMAIN LONG IN samples;", 0, 0);
+    query("CREATE ATTRIBUTE value DOMAIN INT IN samples;", 0, 0);
+
+    rel = relation_load("samples");
+    if(rel == NULL) {
+      printf("Insert: failed to load the relation\n");
+      return;
+    }
+
+    start = clock_time();
+    for(i = 0; i < DB_BENCHMARK_SAMPLES; i++) {
+      VALUE_LONG(&values[0]) = i;
+      VALUE_INT(&values[1]) = i & 0x3ff;
+      if(DB_ERROR(relation_insert(rel, values))) {
+        printf("Insert: failed at row %ld\n", i);
+        relation_release(rel);
+        return;
+      }
+    }
+    relation_release(rel);
+    db_flush();
+    elapsed += clock_time() - start;
+    total += DB_BENCHMARK_SAMPLES;
+  }
+
+  printf("Insert: %lu rows/s\n", total * CLOCK_SECOND / elapsed);
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+execute(const char *aql, tuple_id_t *rows)
+{
+  static db_handle_t handle;
+  db_result_t result;
+
+  result = db_query(&handle, aql);
+  if(DB_ERROR(result)) {
+    db_free(&handle);
+    return result;
+  }
+
+  *rows = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      (*rows)++;
+    } else if(result == DB_FINISHED || DB_ERROR(result)) {
+      break;
+    }
+  }
+  db_free(&handle);
+
+  return result;
+}
+/*---------------------------------------------------------------------------*/
+/* Log samples with one AQL query per row, and check that all of them
+   have been stored. */
+static void
+insert_queries(void)
+{
+  unsigned long total;
+  clock_time_t start;
+  clock_time_t elapsed;
+  tuple_id_t rows;
+  int i;
+
+  total = 0;
+  elapsed = 0;
+  while(elapsed < MIN_TIME) {
+    query("REMOVE RELATION samples;", 0, 0);
+    query("CREATE RELATION samples;", 0, 0);
+    query("CREATE ATTRIBUTE time DOMAIN LONG IN samples;", 0, 0);
+    query("CREATE ATTRIBUTE value DOMAIN INT IN samples;", 0, 0);
+
+    start = clock_time();
+    for(i = 0; i < DB_BENCHMARK_SAMPLES; i++) {
+      query("INSERT (%d, %d) INTO samples;", i, i & 0x3ff);
+    }
+    db_flush();
+    elapsed += clock_time() - start;
+    total += DB_BENCHMARK_SAMPLES;
+  }
+
+  if(DB_ERROR(execute("SELECT value FROM samples;", &rows))) {
+    printf("AQL insert: failed to read the relation\n");
+    return;
+  }
+  printf("AQL insert: %lu rows/s, %lu of %d rows stored\n",
+         total * CLOCK_SECOND / elapsed, (unsigned long)rows,
+         DB_BENCHMARK_SAMPLES);
+}
+/*---------------------------------------------------------------------------*/
+/* Measure the mean execution time of a query, executing it repeatedly
+   for at least MIN_TIME. */
+static void
+run(const char *name, const char *aql)
+{
+  db_result_t result;
+  tuple_id_t rows;
+  unsigned long queries;
+  clock_time_t start;
+  clock_time_t elapsed;
+
+  queries = 0;
+  start = clock_time();
+  do {
+    result = execute(aql, &rows);
+    if(DB_ERROR(result)) {
+      printf("%s: query failed: %s\n", name, db_get_result_message(result));
+      return;
+    }
+    queries++;
+    elapsed = clock_time() - start;
+  } while(elapsed < MIN_TIME);
+
+  printf("%s: %lu rows, %lu us per query\n", name, (unsigned long)rows,
+         (unsigned long)elapsed * (1000000UL / CLOCK_SECOND) / queries);
+}
+/*---------------------------------------------------------------------------*/
+/* Measure the number of rows per second that a query processes when
+   it is executed repeatedly for at least MIN_TIME. */
+static void
+throughput(const char *name, const char *aql)
+{
+  db_result_t result;
+  tuple_id_t rows;
+  unsigned long total;
+  clock_time_t start;
+  clock_time_t elapsed;
+
+  total = 0;
+  start = clock_time();
+  do {
+    result = execute(aql, &rows);
+    if(DB_ERROR(result)) {
+      printf("%s: query failed: %s\n", name, db_get_result_message(result));
+      return;
+    }
+    total += rows;
+    elapsed = clock_time() - start;
+  } while(elapsed < MIN_TIME);
+
+  printf("%s: %lu rows/s\n", name, total * CLOCK_SECOND / elapsed);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(db_benchmark, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  printf("Generating %d readings from %d sensors\n",
+         DB_BENCHMARK_ROWS, DB_BENCHMARK_SENSORS);
+  generate_relations();
+
+  /* Let the indexer process load the new indexes. */
+  etimer_set(&et, CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  run("Index join",
+      "JOIN readings, calib ON sensor PROJECT value, offset TYPE INDEX;");
+  run("Hash join",
+      "JOIN readings, calib ON sensor PROJECT value, offset TYPE HASH;");
+  run("Merge join",
+      "JOIN readings, calib ON sensor PROJECT value, offset TYPE MERGE;");
+  run("Automatic join",
+      "JOIN readings, calib ON sensor PROJECT value, offset;");
+
+  run("Full scan",
+          "SELECT value FROM readings;");
+  run("Predicate scan",
+          "SELECT value FROM readings WHERE sensor > 10 AND value < 900;");
+  run("Arithmetic predicate scan",
+          "SELECT value FROM readings "
+          "WHERE value - (sensor * 20) > 10 OR sensor = 3;");
+
+  run("Range scan",
+      "SELECT value FROM readings WHERE value > 100 AND value < 200;");
+  query("CREATE INDEX readings.value TYPE BTREE;", 0, 0);
+  run("B+-tree range search",
+      "SELECT value FROM readings WHERE value > 100 AND value < 200;");
+
+  insert_queries();
+  insert_samples();
+  throughput("Sequential scan", "SELECT value FROM samples;");
+
+  printf("Benchmark finished\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
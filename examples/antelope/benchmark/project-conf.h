@@ -0,0 +1,11 @@
+#undef QUEUEBUF_CONF_NUM
+#define QUEUEBUF_CONF_NUM	4
+
+#undef NETSTACK_CONF_RDC
+#define NETSTACK_CONF_RDC       nullrdc_driver
+
+#ifdef CONTIKI_TARGET_NATIVE
+/* The LVM bytecode is larger with 64-bit long operands. */
+#undef DB_VM_BYTECODE_SIZE
+#define DB_VM_BYTECODE_SIZE	256
+#endif /* CONTIKI_TARGET_NATIVE */
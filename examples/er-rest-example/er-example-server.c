@@ -67,6 +67,7 @@ extern resource_t
   res_hello,
   res_mirror,
   res_chunks,
+  res_json,
   res_separate,
   res_push,
   res_event,
@@ -134,6 +135,7 @@ PROCESS_THREAD(er_example_server, ev, data)
   rest_activate_resource(&res_hello, "test/hello");
 /*  rest_activate_resource(&res_mirror, "debug/mirror"); */
 /*  rest_activate_resource(&res_chunks, "test/chunks"); */
+  rest_activate_resource(&res_json, "test/json");
 /*  rest_activate_resource(&res_separate, "test/separate"); */
   rest_activate_resource(&res_push, "test/push");
 /*  rest_activate_resource(&res_event, "sensors/button"); */
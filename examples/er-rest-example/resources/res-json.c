@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      Example resource serving a JSON tree blockwise
+ */
+
+#include "contiki.h"
+#include "rest-engine.h"
+#include "jsontree.h"
+
+static void res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+
+/*
+ * The JSON representation is usually larger than a block. It is rendered
+ * with jsontree_fill() directly into the response buffer, and the context
+ * is kept between the requests of a blockwise transfer, so that each block
+ * continues the rendering where the previous one stopped.
+ */
+RESOURCE(res_json,
+         "title=\"Resources as JSON\";rt=\"Data\"",
+         res_get_handler,
+         NULL,
+         NULL,
+         NULL);
+
+/*---------------------------------------------------------------------------*/
+/* One resource per call */
+static int
+output_resources(struct jsontree_context *js_ctx)
+{
+  resource_t *resource;
+  int i;
+
+  resource = list_head(rest_get_resources());
+  for(i = 0; resource != NULL && i < js_ctx->callback_state; i++) {
+    resource = list_item_next(resource);
+  }
+
+  if(js_ctx->callback_state == 0) {
+    jsontree_write_atom(js_ctx, "[");
+  }
+  if(resource == NULL) {
+    jsontree_write_atom(js_ctx, "]");
+    return 0;
+  }
+  if(js_ctx->callback_state > 0) {
+    jsontree_write_atom(js_ctx, ",");
+  }
+  jsontree_write_atom(js_ctx, "{\"url\":");
+  jsontree_write_string(js_ctx, resource->url);
+  jsontree_write_atom(js_ctx, ",\"attributes\":");
+  jsontree_write_string(js_ctx, resource->attributes);
+  jsontree_write_atom(js_ctx, "}");
+  js_ctx->callback_state++;
+  return 1;
+}
+static struct jsontree_callback resources_callback =
+  JSONTREE_CALLBACK(output_resources, NULL);
+
+static struct jsontree_string version = JSONTREE_STRING(CONTIKI_VERSION_STRING);
+
+JSONTREE_OBJECT(tree,
+                JSONTREE_PAIR("version", &version),
+                JSONTREE_PAIR("resources", &resources_callback));
+
+static struct jsontree_context json;
+/*---------------------------------------------------------------------------*/
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  int len;
+
+  if(*offset == 0 || json.values[0] == NULL) {
+    /* A new transfer: render the current state from the start */
+    jsontree_setup(&json, (struct jsontree_value *)&tree, NULL);
+  }
+  /* Resumes from the previous block, or starts over if the client asks
+     for an earlier one */
+  jsontree_seek(&json, *offset);
+  len = jsontree_fill(&json, (char *)buffer, preferred_size);
+
+  REST.set_header_content_type(response, REST.type.APPLICATION_JSON);
+  REST.set_response_payload(response, buffer, len);
+
+  /* IMPORTANT for chunk-wise resources: Signal chunk awareness to REST engine. */
+  *offset += len;
+
+  /* Signal end of resource representation. */
+  if(json.done) {
+    *offset = -1;
+  }
+}
+/*---------------------------------------------------------------------------*/
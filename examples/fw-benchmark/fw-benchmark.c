@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	Forwarding benchmark for the IPv4 stack: measures the rate at
+ *	which uip-fw dispatches packets to network interfaces, including
+ *	the ARP lookup of the Ethernet interface.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv4/uip_arp.h"
+#include "net/ipv4/uip-fw.h"
+
+/* Number of hosts on the local Ethernet network, all in the ARP table */
+#ifdef FW_BENCHMARK_CONF_HOSTS
+#define FW_BENCHMARK_HOSTS FW_BENCHMARK_CONF_HOSTS
+#else
+#define FW_BENCHMARK_HOSTS 48
+#endif
+
+/* Number of network interfaces besides the Ethernet one */
+#ifdef FW_BENCHMARK_CONF_NETIFS
+#define FW_BENCHMARK_NETIFS FW_BENCHMARK_CONF_NETIFS
+#else
+#define FW_BENCHMARK_NETIFS 8
+#endif
+
+/* Number of flows, i.e., destination addresses */
+#ifdef FW_BENCHMARK_CONF_FLOWS
+#define FW_BENCHMARK_FLOWS FW_BENCHMARK_CONF_FLOWS
+#else
+#define FW_BENCHMARK_FLOWS 64
+#endif
+
+/* Number of flows of the second run, few enough to fit in the route
+   cache of uip-fw */
+#ifdef FW_BENCHMARK_CONF_CACHED_FLOWS
+#define FW_BENCHMARK_CACHED_FLOWS FW_BENCHMARK_CONF_CACHED_FLOWS
+#else
+#define FW_BENCHMARK_CACHED_FLOWS 8
+#endif
+
+#define BATCH 1000
+
+/* ARP packet, as in uip_arp.c */
+struct arp_hdr {
+  struct uip_eth_hdr ethhdr;
+  uint16_t hwtype;
+  uint16_t protocol;
+  uint8_t hwlen;
+  uint8_t protolen;
+  uint16_t opcode;
+  struct uip_eth_addr shwaddr;
+  uip_ipaddr_t sipaddr;
+  struct uip_eth_addr dhwaddr;
+  uip_ipaddr_t dipaddr;
+};
+
+#define ARPBUF ((struct arp_hdr *)&uip_buf[0])
+#define ETHBUF ((struct uip_eth_hdr *)&uip_buf[0])
+#define UDPBUF ((struct uip_udpip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+static unsigned long eth_frames;
+static unsigned long arp_requests;
+static unsigned long other_frames;
+
+static struct uip_fw_netif eth_netif =
+  {UIP_FW_NETIF(10,0,0,1, 255,255,0,0, NULL)};
+static struct uip_fw_netif netifs[FW_BENCHMARK_NETIFS];
+static struct uip_fw_netif default_netif =
+  {UIP_FW_NETIF(0,0,0,0, 0,0,0,0, NULL)};
+
+static uip_ipaddr_t flows[FW_BENCHMARK_FLOWS];
+
+PROCESS(fw_benchmark, "Forwarding benchmark");
+AUTOSTART_PROCESSES(&fw_benchmark);
+
+/*---------------------------------------------------------------------------*/
+static uint8_t
+eth_output(void)
+{
+  uip_arp_out();
+  if(ETHBUF->type == UIP_HTONS(UIP_ETHTYPE_ARP)) {
+    arp_requests++;
+  } else {
+    eth_frames++;
+  }
+  return UIP_FW_OK;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+other_output(void)
+{
+  other_frames++;
+  return UIP_FW_OK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+host_addr(uip_ipaddr_t *addr, int host)
+{
+  uip_ipaddr(addr, 10, 0, 1 + host / 200, 2 + host % 200);
+}
+/*---------------------------------------------------------------------------*/
+/* Fill the ARP table the way replies to our requests do */
+static void
+arp_reply(int host)
+{
+  memset(uip_buf, 0, sizeof(struct arp_hdr));
+  ARPBUF->opcode = UIP_HTONS(2);
+  ARPBUF->shwaddr.addr[0] = 0x02;
+  ARPBUF->shwaddr.addr[4] = host >> 8;
+  ARPBUF->shwaddr.addr[5] = host & 0xff;
+  host_addr(&ARPBUF->sipaddr, host);
+  uip_ipaddr_copy(&ARPBUF->dipaddr, &uip_hostaddr);
+  uip_len = sizeof(struct arp_hdr);
+  uip_arp_arpin();
+}
+/*---------------------------------------------------------------------------*/
+static void
+send(const uip_ipaddr_t *dest)
+{
+  UDPBUF->vhl = 0x45;
+  UDPBUF->ttl = 64;
+  UDPBUF->proto = UIP_PROTO_UDP;
+  UDPBUF->len[0] = 0;
+  UDPBUF->len[1] = UIP_IPUDPH_LEN;
+  uip_ipaddr_copy(&UDPBUF->srcipaddr, &uip_hostaddr);
+  uip_ipaddr_copy(&UDPBUF->destipaddr, dest);
+  uip_len = UIP_IPUDPH_LEN;
+  uip_fw_output();
+}
+/*---------------------------------------------------------------------------*/
+static void
+setup(void)
+{
+  uip_ipaddr_t addr;
+  int i;
+
+  uip_ipaddr(&addr, 10, 0, 0, 1);
+  uip_sethostaddr(&addr);
+  uip_ipaddr(&addr, 255, 255, 0, 0);
+  uip_setnetmask(&addr);
+  uip_ipaddr(&addr, 10, 0, 0, 254);
+  uip_setdraddr(&addr);
+
+  uip_arp_init();
+  uip_fw_init();
+
+  /* Registered first, the Ethernet interface is matched last */
+  eth_netif.output = eth_output;
+  uip_fw_register(&eth_netif);
+  for(i = 0; i < FW_BENCHMARK_NETIFS; i++) {
+    uip_ipaddr(&netifs[i].ipaddr, 172, 16, i, 1);
+    uip_ipaddr(&netifs[i].netmask, 255, 255, 255, 0);
+    netifs[i].output = other_output;
+    uip_fw_register(&netifs[i]);
+  }
+  default_netif.output = other_output;
+  uip_fw_default(&default_netif);
+
+  for(i = 0; i < FW_BENCHMARK_HOSTS; i++) {
+    arp_reply(i);
+  }
+
+  /* Most flows go to local hosts, some to the other interfaces and
+     some to remote hosts through the default interface */
+  for(i = 0; i < FW_BENCHMARK_FLOWS; i++) {
+    switch(i % 4) {
+    case 3:
+      uip_ipaddr(&flows[i], 192, 168, i >> 8, i & 0xff);
+      break;
+    case 2:
+      uip_ipaddr(&flows[i], 172, 16, i % (FW_BENCHMARK_NETIFS + 1), 2 + i);
+      break;
+    default:
+      host_addr(&flows[i], i % FW_BENCHMARK_HOSTS);
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Forward packets to the first nflows flows in turn for at least a
+   second */
+static void
+forward(int nflows)
+{
+  unsigned long count;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int i;
+
+  eth_frames = arp_requests = other_frames = 0;
+#if UIP_STATISTICS == 1
+  memset(&uip_fw_stat, 0, sizeof(uip_fw_stat));
+#endif /* UIP_STATISTICS == 1 */
+  count = 0;
+  start = clock_time();
+  do {
+    for(i = 0; i < BATCH; i++) {
+      send(&flows[count % nflows]);
+      count++;
+    }
+    elapsed = clock_time() - start;
+  } while(elapsed < CLOCK_SECOND);
+
+  printf("Forwarding, %d flows: %lu packets/s (%lu Ethernet, %lu ARP requests, %lu other)\n",
+         nflows, count * CLOCK_SECOND / elapsed,
+         eth_frames, arp_requests, other_frames);
+#if UIP_STATISTICS == 1
+  printf("Route cache: %lu hits, %lu misses\n",
+         uip_fw_stat.route_cache_hits, uip_fw_stat.route_cache_misses);
+#endif /* UIP_STATISTICS == 1 */
+}
+/*---------------------------------------------------------------------------*/
+/* Check that ARP entries are flushed once they are too old */
+static void
+aging(void)
+{
+  uip_ipaddr_t addr;
+  int i;
+
+  for(i = 0; i < UIP_ARP_MAXAGE; i++) {
+    uip_arp_timer();
+  }
+
+  arp_requests = 0;
+  for(i = 0; i < FW_BENCHMARK_HOSTS; i++) {
+    host_addr(&addr, i);
+    send(&addr);
+  }
+  printf("Aging: %lu of %u entries expired\n",
+         arp_requests, FW_BENCHMARK_HOSTS);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(fw_benchmark, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("%u hosts, ARP table of %u entries in sets of %u, %u interfaces, %u flows\n",
+         FW_BENCHMARK_HOSTS, UIP_ARPTAB_SIZE, UIP_ARP_SET_SIZE,
+         FW_BENCHMARK_NETIFS + 2, FW_BENCHMARK_FLOWS);
+
+  setup();
+  forward(FW_BENCHMARK_FLOWS);
+  forward(MIN(FW_BENCHMARK_CACHED_FLOWS, FW_BENCHMARK_FLOWS));
+  aging();
+
+  printf("Benchmark finished\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
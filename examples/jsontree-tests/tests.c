@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Tests for the buffered output of jsontree: the output rendered
+ *         in chunks, or from an offset, must match the output written
+ *         through putchar.
+ */
+
+#include "contiki.h"
+#include "jsontree.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_OUTPUT 512
+#define BLOCK_SIZE 16
+#define SAMPLES 6
+
+static const int32_t samples[SAMPLES] = {
+  0, -1, 65535, -2147483647, 1234567890, 42
+};
+static unsigned long callback_calls;
+
+/*---------------------------------------------------------------------------*/
+/* One sample per call, so that the callback is resumed across chunks */
+static int
+output_samples(struct jsontree_context *js_ctx)
+{
+  callback_calls++;
+  if(js_ctx->callback_state == 0) {
+    jsontree_write_atom(js_ctx, "[");
+  } else {
+    jsontree_write_atom(js_ctx, ",");
+  }
+  jsontree_write_int(js_ctx, samples[js_ctx->callback_state]);
+  if(++js_ctx->callback_state < SAMPLES) {
+    return 1;
+  }
+  jsontree_write_atom(js_ctx, "]");
+  return 0;
+}
+static struct jsontree_callback samples_callback =
+  JSONTREE_CALLBACK(output_samples, NULL);
+/*---------------------------------------------------------------------------*/
+
+static struct jsontree_string name =
+  JSONTREE_STRING("a \"quoted\" name, longer than a block");
+static struct jsontree_string empty = JSONTREE_STRING("");
+static struct jsontree_uint big = { JSON_TYPE_UINT, 4294967295U };
+static struct jsontree_int negative = { JSON_TYPE_INT, -1234567890 };
+static int16_t s16 = -32768;
+static struct jsontree_ptr s16_ptr = { JSON_TYPE_S16PTR, &s16 };
+
+JSONTREE_OBJECT(values_tree,
+                JSONTREE_PAIR("big", &big),
+                JSONTREE_PAIR("negative", &negative),
+                JSONTREE_PAIR("s16", &s16_ptr));
+
+JSONTREE_OBJECT(tree,
+                JSONTREE_PAIR("name", &name),
+                JSONTREE_PAIR("empty", &empty),
+                JSONTREE_PAIR("values", &values_tree),
+                JSONTREE_PAIR("samples", &samples_callback));
+
+static char reference[MAX_OUTPUT];
+static int reference_len;
+static char output[MAX_OUTPUT];
+
+/*---------------------------------------------------------------------------*/
+static int
+reference_putchar(int c)
+{
+  if(reference_len < MAX_OUTPUT) {
+    reference[reference_len++] = c;
+  }
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+static void
+render_reference(void)
+{
+  struct jsontree_context js_ctx;
+
+  reference_len = 0;
+  jsontree_setup(&js_ctx, (struct jsontree_value *)&tree, reference_putchar);
+  while(jsontree_print_next(&js_ctx));
+}
+/*---------------------------------------------------------------------------*/
+/* Fill the output from the current position of the context, in chunks
+   of the given size, starting at start. Returns the length written, or
+   -1 if a chunk came back empty before the end. */
+static int
+fill_all(struct jsontree_context *js_ctx, int start, int chunk_size)
+{
+  int len;
+  int n;
+
+  len = 0;
+  while(!js_ctx->done && start + len < MAX_OUTPUT) {
+    n = jsontree_fill(js_ctx, &output[start + len],
+                      MIN(chunk_size, MAX_OUTPUT - start - len));
+    if(n == 0 && !js_ctx->done) {
+      return -1;
+    }
+    len += n;
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+/* Render in chunks of every size, so that chunk boundaries fall inside
+   every string and number */
+static void
+test_chunks(void)
+{
+  struct jsontree_context js_ctx;
+  int size;
+
+  printf("Testing chunks of every size ... ");
+
+  for(size = 1; size <= reference_len + 1; size++) {
+    jsontree_setup(&js_ctx, (struct jsontree_value *)&tree, NULL);
+    if(fill_all(&js_ctx, 0, size) != reference_len ||
+       memcmp(output, reference, reference_len) != 0) {
+      printf("Failure (size %d)\n", size);
+      return;
+    }
+  }
+  printf("Success\n");
+}
+/*---------------------------------------------------------------------------*/
+/* Split the output at every offset: a first chunk up to the offset,
+   and the rest from a context that has been seeked to the offset */
+static void
+test_split(void)
+{
+  struct jsontree_context js_ctx;
+  int offset;
+  int len;
+
+  printf("Testing a split at every offset ... ");
+
+  for(offset = 0; offset <= reference_len; offset++) {
+    jsontree_setup(&js_ctx, (struct jsontree_value *)&tree, NULL);
+    len = offset > 0 ? jsontree_fill(&js_ctx, output, offset) : 0;
+    len += fill_all(&js_ctx, len, MAX_OUTPUT);
+    if(len != reference_len || memcmp(output, reference, len) != 0) {
+      printf("Failure (first chunk, offset %d)\n", offset);
+      return;
+    }
+
+    jsontree_setup(&js_ctx, (struct jsontree_value *)&tree, NULL);
+    jsontree_seek(&js_ctx, offset);
+    len = fill_all(&js_ctx, 0, MAX_OUTPUT);
+    if(len != reference_len - offset ||
+       memcmp(output, reference + offset, len) != 0) {
+      printf("Failure (seek, offset %d)\n", offset);
+      return;
+    }
+  }
+  printf("Success\n");
+}
+/*---------------------------------------------------------------------------*/
+/* Serve the output block by block from one context, as a CoAP Block2
+   handler does. Each block resumes where the previous one stopped, so
+   the callback is only called again for the sample cut by a block. */
+static void
+test_blocks(void)
+{
+  static struct jsontree_context js_ctx;
+  int offset;
+  int blocks;
+  int n;
+
+  printf("Testing Block2-style seeks ... ");
+
+  jsontree_setup(&js_ctx, (struct jsontree_value *)&tree, NULL);
+  callback_calls = 0;
+  offset = 0;
+  blocks = 0;
+  while(!js_ctx.done) {
+    jsontree_seek(&js_ctx, offset);
+    n = jsontree_fill(&js_ctx, &output[offset], BLOCK_SIZE);
+    offset += n;
+    blocks++;
+  }
+  if(offset != reference_len || memcmp(output, reference, offset) != 0) {
+    printf("Failure (output)\n");
+    return;
+  }
+  if(callback_calls > SAMPLES + blocks) {
+    printf("Failure (%lu callback calls for %d blocks)\n",
+           callback_calls, blocks);
+    return;
+  }
+
+  /* A block requested again starts over */
+  jsontree_seek(&js_ctx, BLOCK_SIZE);
+  n = jsontree_fill(&js_ctx, output, BLOCK_SIZE);
+  if(n != BLOCK_SIZE || memcmp(output, reference + BLOCK_SIZE, n) != 0) {
+    printf("Failure (backward seek)\n");
+    return;
+  }
+  printf("Success\n");
+}
+/*---------------------------------------------------------------------------*/
+/* A context that is reset in the middle of the output starts over, and
+   can still be printed through putchar */
+static void
+test_reset(void)
+{
+  struct jsontree_context js_ctx;
+  int len;
+
+  printf("Testing reset ... ");
+
+  jsontree_setup(&js_ctx, (struct jsontree_value *)&tree, reference_putchar);
+  jsontree_fill(&js_ctx, output, BLOCK_SIZE + 3);
+  jsontree_reset(&js_ctx);
+  len = fill_all(&js_ctx, 0, BLOCK_SIZE);
+  if(len != reference_len || memcmp(output, reference, len) != 0) {
+    printf("Failure (fill)\n");
+    return;
+  }
+
+  /* The putchar output replaces the reference, which was just checked */
+  jsontree_reset(&js_ctx);
+  reference_len = 0;
+  while(jsontree_print_next(&js_ctx));
+  if(reference_len != len || memcmp(output, reference, len) != 0) {
+    printf("Failure (putchar)\n");
+    return;
+  }
+  printf("Success\n");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(jsontree_tests_process, "jsontree tests process");
+AUTOSTART_PROCESSES(&jsontree_tests_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(jsontree_tests_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  render_reference();
+  printf("Reference output: %.*s\n", reference_len, reference);
+
+  test_chunks();
+  test_split();
+  test_blocks();
+  test_reset();
+
+  printf("jsontree tests done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Throughput of the AES-128 drivers in blocks per second
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "lib/aes-128-ttable.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Blocks encrypted between two reads of the clock */
+#ifdef AES_128_BENCHMARK_CONF_BATCH
+#define AES_128_BENCHMARK_BATCH AES_128_BENCHMARK_CONF_BATCH
+#else
+#define AES_128_BENCHMARK_BATCH 1000
+#endif
+
+struct driver {
+  const char *name;
+  const struct aes_128_driver *driver;
+};
+
+static const struct driver drivers[] = {
+  { "reference", &aes_128_driver },
+  { "T-table", &aes_128_ttable_driver },
+  { "AES_128", &AES_128 },
+};
+
+static const uint8_t keys[2][AES_128_KEY_LENGTH] = {
+  { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c },
+  { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f },
+};
+
+/*---------------------------------------------------------------------------*/
+/* Encrypt a block over and over for at least a second. */
+static void
+benchmark(const struct driver *d)
+{
+  uint8_t block[AES_128_BLOCK_SIZE];
+  unsigned long blocks;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int i;
+
+  memset(block, 0, sizeof(block));
+  d->driver->set_key(keys[0]);
+
+  blocks = 0;
+  start = clock_time();
+  do {
+    for(i = 0; i < AES_128_BENCHMARK_BATCH; i++) {
+      d->driver->encrypt(block);
+    }
+    blocks += AES_128_BENCHMARK_BATCH;
+    elapsed = clock_time() - start;
+  } while(elapsed < CLOCK_SECOND);
+
+  printf("%s: %lu blocks/s (last block %02x%02x)\n", d->name,
+         blocks * CLOCK_SECOND / elapsed, block[0], block[1]);
+}
+/*---------------------------------------------------------------------------*/
+/* Alternate between two keys for at least half a second, either by
+   setting them or by selecting their contexts, and return the number
+   of key changes per second. */
+static unsigned long
+key_changes(const struct driver *d, int with_contexts)
+{
+  static struct aes_128_context contexts[2];
+  unsigned long changes;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int i;
+
+  for(i = 0; i < 2; i++) {
+    memcpy(contexts[i].key, keys[i], AES_128_KEY_LENGTH);
+    d->driver->init_context(&contexts[i]);
+  }
+
+  changes = 0;
+  start = clock_time();
+  do {
+    for(i = 0; i < AES_128_BENCHMARK_BATCH; i++) {
+      if(with_contexts) {
+        d->driver->select_context(&contexts[i & 1]);
+      } else {
+        d->driver->set_key(keys[i & 1]);
+      }
+    }
+    changes += AES_128_BENCHMARK_BATCH;
+    elapsed = clock_time() - start;
+  } while(elapsed < CLOCK_SECOND / 2);
+
+  return changes * CLOCK_SECOND / elapsed;
+}
+/*---------------------------------------------------------------------------*/
+static void
+benchmark_keys(const struct driver *d)
+{
+  if(d->driver->init_context == NULL || d->driver->select_context == NULL) {
+    return;
+  }
+  printf("%s: %lu set_key/s, %lu select_context/s\n", d->name,
+         key_changes(d, 0), key_changes(d, 1));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(aes_128_benchmark_process, "AES-128 benchmark process");
+AUTOSTART_PROCESSES(&aes_128_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(aes_128_benchmark_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < sizeof(drivers) / sizeof(drivers[0]); i++) {
+    benchmark(&drivers[i]);
+  }
+  for(i = 0; i < sizeof(drivers) / sizeof(drivers[0]); i++) {
+    benchmark_keys(&drivers[i]);
+  }
+  printf("AES-128 benchmark done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Known-answer tests for the AES-128 drivers
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "lib/aes-128-ttable.h"
+#include "lib/ccm-star.h"
+#include "lib/random.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CROSS_CHECKS 1000
+#define N_VECTORS (sizeof(vectors) / sizeof(vectors[0]))
+
+struct driver {
+  const char *name;
+  const struct aes_128_driver *driver;
+};
+
+static const struct driver drivers[] = {
+  { "reference", &aes_128_driver },
+  { "T-table", &aes_128_ttable_driver },
+  { "AES_128", &AES_128 },
+};
+
+struct test_vector {
+  uint8_t key[AES_128_KEY_LENGTH];
+  uint8_t plaintext[AES_128_BLOCK_SIZE];
+  uint8_t ciphertext[AES_128_BLOCK_SIZE];
+};
+
+/* FIPS-197 appendices C.1 and B, SP 800-38A F.1.1 and the all-zero
+   block */
+static const struct test_vector vectors[] = {
+  { { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+      0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f },
+    { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+      0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff },
+    { 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+      0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a } },
+  { { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+      0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c },
+    { 0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d,
+      0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34 },
+    { 0x39, 0x25, 0x84, 0x1d, 0x02, 0xdc, 0x09, 0xfb,
+      0xdc, 0x11, 0x85, 0x97, 0x19, 0x6a, 0x0b, 0x32 } },
+  { { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+      0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c },
+    { 0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+      0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a },
+    { 0x3a, 0xd7, 0x7b, 0xb4, 0x0d, 0x7a, 0x36, 0x60,
+      0xa8, 0x9e, 0xca, 0xf3, 0x24, 0x66, 0xef, 0x97 } },
+  { { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+      0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c },
+    { 0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+      0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51 },
+    { 0xf5, 0xd3, 0xd5, 0x85, 0x03, 0xb9, 0x69, 0x9d,
+      0xe7, 0x85, 0x89, 0x5a, 0x96, 0xfd, 0xba, 0xaf } },
+  { { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+      0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c },
+    { 0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+      0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef },
+    { 0x43, 0xb1, 0xcd, 0x7f, 0x59, 0x8e, 0xce, 0x23,
+      0x88, 0x1b, 0x00, 0xe3, 0xed, 0x03, 0x06, 0x88 } },
+  { { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+      0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c },
+    { 0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+      0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10 },
+    { 0x7b, 0x0c, 0x78, 0x5e, 0x27, 0xe8, 0xad, 0x3f,
+      0x82, 0x23, 0x20, 0x71, 0x04, 0x72, 0x5d, 0xd4 } },
+  { { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    { 0x66, 0xe9, 0x4b, 0xd4, 0xef, 0x8a, 0x2c, 0x3b,
+      0x88, 0x4c, 0xfa, 0x59, 0xca, 0x34, 0x2b, 0x2e } },
+};
+
+/*---------------------------------------------------------------------------*/
+static void
+test_known_answers(const struct driver *d)
+{
+  uint8_t block[AES_128_BLOCK_SIZE];
+  int i;
+
+  printf("Testing %s known answers ... ", d->name);
+
+  for(i = 0; i < N_VECTORS; i++) {
+    d->driver->set_key(vectors[i].key);
+    memcpy(block, vectors[i].plaintext, AES_128_BLOCK_SIZE);
+    d->driver->encrypt(block);
+    if(memcmp(block, vectors[i].ciphertext, AES_128_BLOCK_SIZE) != 0) {
+      printf("Failure (vector %d)\n", i);
+      return;
+    }
+  }
+  printf("Success\n");
+}
+/*---------------------------------------------------------------------------*/
+/* Compare the driver with the reference implementation for random
+   keys and blocks. */
+static void
+test_cross_check(const struct driver *d)
+{
+  uint8_t key[AES_128_KEY_LENGTH];
+  uint8_t expected[AES_128_BLOCK_SIZE];
+  uint8_t block[AES_128_BLOCK_SIZE];
+  int i;
+  int j;
+
+  printf("Testing %s against reference ... ", d->name);
+
+  for(i = 0; i < CROSS_CHECKS; i++) {
+    for(j = 0; j < AES_128_KEY_LENGTH; j++) {
+      key[j] = random_rand();
+      block[j] = random_rand();
+    }
+    memcpy(expected, block, AES_128_BLOCK_SIZE);
+    aes_128_driver.set_key(key);
+    aes_128_driver.encrypt(expected);
+    d->driver->set_key(key);
+    d->driver->encrypt(block);
+    if(memcmp(block, expected, AES_128_BLOCK_SIZE) != 0) {
+      printf("Failure (check %d)\n", i);
+      return;
+    }
+  }
+  printf("Success\n");
+}
+/*---------------------------------------------------------------------------*/
+/* Check that the keys of several contexts can be selected in turn, and
+   that setting a key in between does not alter the contexts. */
+static void
+test_contexts(const struct driver *d)
+{
+  static struct aes_128_context contexts[N_VECTORS];
+  uint8_t block[AES_128_BLOCK_SIZE];
+  int round;
+  int next;
+  int i;
+
+  if(d->driver->init_context == NULL || d->driver->select_context == NULL) {
+    return;
+  }
+
+  printf("Testing %s contexts ... ", d->name);
+
+  for(i = 0; i < N_VECTORS; i++) {
+    memcpy(contexts[i].key, vectors[i].key, AES_128_KEY_LENGTH);
+    d->driver->init_context(&contexts[i]);
+  }
+
+  for(round = 0; round < 2; round++) {
+    for(i = N_VECTORS - 1; i >= 0; i--) {
+      d->driver->select_context(&contexts[i]);
+      memcpy(block, vectors[i].plaintext, AES_128_BLOCK_SIZE);
+      d->driver->encrypt(block);
+      if(memcmp(block, vectors[i].ciphertext, AES_128_BLOCK_SIZE) != 0) {
+        printf("Failure (context %d)\n", i);
+        return;
+      }
+
+      /* A key that is set replaces the selected context */
+      next = (i + 1) % N_VECTORS;
+      d->driver->set_key(vectors[next].key);
+      memcpy(block, vectors[next].plaintext, AES_128_BLOCK_SIZE);
+      d->driver->encrypt(block);
+      if(memcmp(block, vectors[next].ciphertext, AES_128_BLOCK_SIZE) != 0) {
+        printf("Failure (key %d)\n", next);
+        return;
+      }
+    }
+  }
+  printf("Success\n");
+}
+/*---------------------------------------------------------------------------*/
+/* Check that a context selected for CCM* again after CCM_STAR.set_key()
+   gets its key back. */
+static void
+test_ccm_star_contexts(void)
+{
+  static struct aes_128_context context;
+  uint8_t block[AES_128_BLOCK_SIZE];
+
+  printf("Testing CCM* context selection ... ");
+
+  ccm_star_init_context(&context, vectors[0].key);
+  ccm_star_select_context(&context);
+  CCM_STAR.set_key(vectors[1].key);
+  ccm_star_select_context(&context);
+
+  memcpy(block, vectors[0].plaintext, AES_128_BLOCK_SIZE);
+  AES_128.encrypt(block);
+  if(memcmp(block, vectors[0].ciphertext, AES_128_BLOCK_SIZE) != 0) {
+    printf("Failure\n");
+    return;
+  }
+  printf("Success\n");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(aes_128_tests_process, "AES-128 tests process");
+AUTOSTART_PROCESSES(&aes_128_tests_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(aes_128_tests_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < sizeof(drivers) / sizeof(drivers[0]); i++) {
+    test_known_answers(&drivers[i]);
+    test_contexts(&drivers[i]);
+    if(i > 0) {
+      test_cross_check(&drivers[i]);
+    }
+  }
+  test_ccm_star_contexts();
+  printf("AES-128 tests done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
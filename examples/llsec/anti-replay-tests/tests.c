@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2017, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Tests the sliding anti-replay window with in-order, reordered,
+ *         replayed and too old frame counters.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/llsec/anti-replay.h"
+#include "net/llsec/llsec802154.h"
+#include <stdio.h>
+#include <string.h>
+
+static const linkaddr_t receiver = { { 0x01, 0x02, 0x03, 0x04,
+                                       0x05, 0x06, 0x07, 0x08 } };
+static struct anti_replay_info info;
+static int failed;
+
+/*---------------------------------------------------------------------------*/
+static void
+set_frame(uint32_t counter, int broadcast)
+{
+  frame802154_frame_counter_t reordered_counter;
+
+  packetbuf_clear();
+  reordered_counter.u32 = LLSEC802154_HTONL(counter);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_0_1, reordered_counter.u16[0]);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_2_3, reordered_counter.u16[1]);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER,
+                     broadcast ? &linkaddr_null : &receiver);
+}
+/*---------------------------------------------------------------------------*/
+static void
+check(uint32_t counter, int broadcast, int expected)
+{
+  set_frame(counter, broadcast);
+  if(anti_replay_was_replayed(&info) != expected) {
+    printf("(%s frame %lu should%s be dropped) ",
+           broadcast ? "broadcast" : "unicast",
+           (unsigned long)counter, expected ? "" : " not");
+    failed = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *name)
+{
+  printf("Testing %s ... %s\n", name, failed ? "Failure" : "Success");
+  failed = 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(anti_replay_tests_process, "Anti-replay tests process");
+AUTOSTART_PROCESSES(&anti_replay_tests_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(anti_replay_tests_process, ev, data)
+{
+  uint32_t i;
+
+  PROCESS_BEGIN();
+
+  set_frame(100, 0);
+  anti_replay_init_info(&info);
+  memset(&anti_replay_stats, 0, sizeof(anti_replay_stats));
+
+  check(100, 0, 1);
+  check(101, 0, 0);
+  check(102, 0, 0);
+  check(102, 0, 1);
+  report("in-order frames and replays");
+
+  check(105, 0, 0);
+  check(104, 0, 0);
+  check(103, 0, 0);
+  check(104, 0, 1);
+  check(103, 0, 1);
+  report("reordered frames");
+
+  check(105 + ANTI_REPLAY_WINDOW_SIZE - 1, 0, 0);
+  check(106, 0, 0);
+  check(105, 0, 1);
+  check(100, 0, 1);
+  report("window bounds");
+
+  /* A jump beyond the window forgets all previous counters */
+  check(1000, 0, 0);
+  check(1000 - ANTI_REPLAY_WINDOW_SIZE, 0, 1);
+  for(i = 999; i > 1000 - ANTI_REPLAY_WINDOW_SIZE; i--) {
+    check(i, 0, 0);
+  }
+  for(i = 1000; i > 1000 - ANTI_REPLAY_WINDOW_SIZE; i--) {
+    check(i, 0, 1);
+  }
+  report("large jumps");
+
+  /* Counters of broadcast and unicast frames are tracked separately */
+  check(101, 1, 0);
+  check(1001, 1, 0);
+  check(1001, 0, 0);
+  check(101, 1, 1);
+  report("broadcast and unicast windows");
+
+  /* 103, 104, 106 and the frames below 1000 were reordered */
+  if(anti_replay_stats.reorders == ANTI_REPLAY_WINDOW_SIZE + 2) {
+    printf("Testing statistics ... Success\n");
+  } else {
+    printf("Testing statistics ... Failure (%lu replays, %lu reorders)\n",
+           (unsigned long)anti_replay_stats.replays,
+           (unsigned long)anti_replay_stats.reorders);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2017, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Cross-checks CCM_STAR against a straightforward implementation
+ *         that computes the MIC and the CTR mode encryption in two
+ *         separate passes, for random keys, nonces, lengths and
+ *         alignments.
+ */
+
+#include "contiki.h"
+#include "lib/ccm-star.h"
+#include "lib/aes-128.h"
+#include "lib/random.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CROSS_CHECKS 2000
+#define MAX_A_LEN 40
+#define MAX_M_LEN 110
+
+/* see RFC 3610 */
+#define AUTH_FLAGS(Adata, M) ((Adata ? (1u << 6) : 0) | (((M - 2u) >> 1) << 3) | 1u)
+#define ENCRYPTION_FLAGS     1
+
+/*---------------------------------------------------------------------------*/
+static void
+set_iv(uint8_t *iv, uint8_t flags, const uint8_t *nonce, uint8_t counter)
+{
+  iv[0] = flags;
+  memcpy(iv + 1, nonce, CCM_STAR_NONCE_LENGTH);
+  iv[14] = 0;
+  iv[15] = counter;
+}
+/*---------------------------------------------------------------------------*/
+static void
+ctr_step(const uint8_t *nonce, uint8_t pos,
+    uint8_t *m, uint8_t m_len, uint8_t counter)
+{
+  uint8_t a[AES_128_BLOCK_SIZE];
+  uint8_t i;
+
+  set_iv(a, ENCRYPTION_FLAGS, nonce, counter);
+  AES_128.encrypt(a);
+  for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
+    m[pos + i] ^= a[i];
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+mic(const uint8_t *nonce,
+    const uint8_t *m, uint8_t m_len,
+    const uint8_t *a, uint8_t a_len,
+    uint8_t *result, uint8_t mic_len)
+{
+  uint8_t x[AES_128_BLOCK_SIZE];
+  uint8_t pos;
+  uint8_t i;
+
+  set_iv(x, AUTH_FLAGS(a_len, mic_len), nonce, m_len);
+  AES_128.encrypt(x);
+
+  if(a_len) {
+    x[1] = x[1] ^ a_len;
+    for(i = 2; (i - 2 < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
+      x[i] ^= a[i - 2];
+    }
+    AES_128.encrypt(x);
+    pos = 14;
+    while(pos < a_len) {
+      for(i = 0; (pos + i < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
+        x[i] ^= a[pos + i];
+      }
+      pos += AES_128_BLOCK_SIZE;
+      AES_128.encrypt(x);
+    }
+  }
+
+  pos = 0;
+  while(pos < m_len) {
+    for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
+      x[i] ^= m[pos + i];
+    }
+    pos += AES_128_BLOCK_SIZE;
+    AES_128.encrypt(x);
+  }
+
+  ctr_step(nonce, 0, x, AES_128_BLOCK_SIZE, 0);
+  memcpy(result, x, mic_len);
+}
+/*---------------------------------------------------------------------------*/
+static void
+ctr(const uint8_t *nonce, uint8_t *m, uint8_t m_len)
+{
+  uint8_t pos;
+  uint8_t counter;
+
+  counter = 1;
+  for(pos = 0; pos < m_len; pos += AES_128_BLOCK_SIZE) {
+    ctr_step(nonce, pos, m, m_len, counter++);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+two_pass_aead(const uint8_t *nonce,
+    uint8_t *m, uint8_t m_len,
+    const uint8_t *a, uint8_t a_len,
+    uint8_t *result, uint8_t mic_len,
+    int forward)
+{
+  if(!forward) {
+    ctr(nonce, m, m_len);
+  }
+  mic(nonce, m, m_len, a, a_len, result, mic_len);
+  if(forward) {
+    ctr(nonce, m, m_len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill_random(uint8_t *buf, uint8_t len)
+{
+  uint8_t i;
+
+  for(i = 0; i < len; i++) {
+    buf[i] = random_rand();
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Frames are laid out as in the packetbuf: the header, the payload and
+   the MIC follow each other and are processed in place. The frame
+   starts at a random offset so as to exercise unaligned blocks. */
+static void
+test_cross_check(void)
+{
+  static uint32_t expected_words[(MAX_A_LEN + MAX_M_LEN + 16 + 3) / 4 + 1];
+  static uint32_t frame_words[(MAX_A_LEN + MAX_M_LEN + 16 + 3) / 4 + 1];
+  static const uint8_t mic_lens[] = { 0, 4, 8, 16 };
+  uint8_t key[AES_128_KEY_LENGTH];
+  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  uint8_t *expected;
+  uint8_t *frame;
+  uint8_t a_len;
+  uint8_t m_len;
+  uint8_t mic_len;
+  uint8_t offset;
+  int forward;
+  int i;
+
+  printf("Testing against two-pass CCM* ... ");
+
+  for(i = 0; i < CROSS_CHECKS; i++) {
+    fill_random(key, sizeof(key));
+    fill_random(nonce, sizeof(nonce));
+    a_len = random_rand() % (MAX_A_LEN + 1);
+    m_len = random_rand() % (MAX_M_LEN + 1);
+    mic_len = mic_lens[random_rand() % sizeof(mic_lens)];
+    offset = random_rand() % 4;
+    forward = i & 1;
+
+    expected = (uint8_t *)expected_words + offset;
+    frame = (uint8_t *)frame_words + offset;
+    fill_random(expected, a_len + m_len);
+    memcpy(frame, expected, a_len + m_len);
+
+    AES_128.set_key(key);
+    two_pass_aead(nonce, expected + a_len, m_len, expected, a_len,
+        expected + a_len + m_len, mic_len, forward);
+    CCM_STAR.set_key(key);
+    CCM_STAR.aead(nonce, frame + a_len, m_len, frame, a_len,
+        frame + a_len + m_len, mic_len, forward);
+
+    if(memcmp(frame, expected, a_len + m_len + mic_len) != 0) {
+      printf("Failure (check %d: a_len %u m_len %u mic_len %u forward %d)\n",
+          i, a_len, m_len, mic_len, forward);
+      return;
+    }
+  }
+  printf("Success\n");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(ccm_star_tests_process, "CCM* tests process");
+AUTOSTART_PROCESSES(&ccm_star_tests_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ccm_star_tests_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  test_cross_check();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	Packet rate benchmark for the tap device of the native platform.
+ *
+ *	A generator process is forked, which sends UDP datagrams as fast
+ *	as it can through the host stack to the Contiki node behind tap0.
+ *	The node echoes each datagram, and the rates of received and
+ *	echoed packets are measured. Opening the tap device requires
+ *	root privileges.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "net/ipv4/uip_arp.h"
+#include "tapdev-drv.h"
+#include "tapdev-batch.h"
+
+#ifdef TAPDEV_BENCHMARK_CONF_DURATION
+#define TAPDEV_BENCHMARK_DURATION TAPDEV_BENCHMARK_CONF_DURATION
+#else
+#define TAPDEV_BENCHMARK_DURATION 3
+#endif
+
+#ifdef TAPDEV_BENCHMARK_CONF_PAYLOAD_LEN
+#define TAPDEV_BENCHMARK_PAYLOAD_LEN TAPDEV_BENCHMARK_CONF_PAYLOAD_LEN
+#else
+#define TAPDEV_BENCHMARK_PAYLOAD_LEN 64
+#endif
+
+#define PORT 3000
+
+/* The host side of tap0 is 172.18.0.1, as configured by tapdev.c */
+#define NODE_ADDR "172.18.0.2"
+
+#define UIP_IP_BUF ((struct uip_udpip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+PROCESS(tapdev_benchmark, "Tapdev benchmark");
+PROCESS(echo_process, "UDP echo");
+AUTOSTART_PROCESSES(&tapdev_benchmark);
+
+static unsigned long received;
+static unsigned long echoed;
+
+/*---------------------------------------------------------------------------*/
+/* CPU time used by the node so far, in microseconds */
+static unsigned long long
+cpu_time(void)
+{
+  struct rusage usage;
+
+  getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL +
+    usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Runs in the forked process: send datagrams to the node until the
+   benchmark process kills us, or exits. */
+static void
+generate(pid_t parent)
+{
+  struct sockaddr_in addr;
+  char payload[TAPDEV_BENCHMARK_PAYLOAD_LEN];
+  unsigned long n;
+  int s;
+
+  s = socket(AF_INET, SOCK_DGRAM, 0);
+  if(s == -1) {
+    perror("generator: socket");
+    return;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(PORT);
+  inet_pton(AF_INET, NODE_ADDR, &addr.sin_addr);
+  memset(payload, 'x', sizeof(payload));
+
+  for(n = 0; (n & 0x3ff) != 0 || getppid() == parent; n++) {
+    /* Errors, e.g., ENOBUFS when the tap queue is full, are ignored */
+    sendto(s, payload, sizeof(payload), 0,
+           (struct sockaddr *)&addr, sizeof(addr));
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(echo_process, ev, data)
+{
+  static struct uip_udp_conn *conn;
+
+  PROCESS_BEGIN();
+
+  conn = udp_new(NULL, 0, NULL);
+  udp_bind(conn, UIP_HTONS(PORT));
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == tcpip_event);
+    if(uip_newdata()) {
+      received++;
+      uip_udp_packet_sendto(conn, uip_appdata, uip_datalen(),
+                            &UIP_IP_BUF->srcipaddr, UIP_IP_BUF->srcport);
+      echoed++;
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tapdev_benchmark, ev, data)
+{
+  static struct etimer et;
+  static pid_t generator;
+  static unsigned long start_received;
+  static unsigned long start_echoed;
+  static clock_time_t start;
+  static unsigned long long start_cpu;
+  clock_time_t elapsed;
+  unsigned long long cpu;
+  unsigned long packets;
+  uip_ipaddr_t addr;
+  struct uip_eth_addr eaddr = {{ 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 }};
+
+  PROCESS_BEGIN();
+
+  uip_ipaddr(&addr, 172, 18, 0, 2);
+  uip_sethostaddr(&addr);
+  uip_ipaddr(&addr, 255, 255, 0, 0);
+  uip_setnetmask(&addr);
+  uip_setethaddr(eaddr);
+
+  process_start(&tapdev_process, NULL);
+  if(tapdev_fd() < 0) {
+    printf("Could not open the tap device\n");
+    PROCESS_EXIT();
+  }
+  process_start(&echo_process, NULL);
+
+  generator = fork();
+  if(generator == -1) {
+    perror("fork");
+    PROCESS_EXIT();
+  }
+  if(generator == 0) {
+    generate(getppid());
+    _exit(0);
+  }
+
+  printf("Tap I/O in batches of %d frames, %d bytes payload\n",
+         TAPDEV_BATCH_SIZE, TAPDEV_BENCHMARK_PAYLOAD_LEN);
+
+  /* Let ARP resolve and the queues fill up */
+  etimer_set(&et, CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  start_received = received;
+  start_echoed = echoed;
+  start = clock_time();
+  start_cpu = cpu_time();
+  etimer_set(&et, TAPDEV_BENCHMARK_DURATION * CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  elapsed = clock_time() - start;
+  cpu = cpu_time() - start_cpu;
+  packets = received - start_received;
+
+  kill(generator, SIGTERM);
+  waitpid(generator, NULL, 0);
+
+  printf("Received: %lu packets/s\n", packets * CLOCK_SECOND / elapsed);
+  printf("Echoed: %lu packets/s\n",
+         (echoed - start_echoed) * CLOCK_SECOND / elapsed);
+  if(packets > 0) {
+    /* The rate may be bounded by the generator: the CPU time the node
+       spends per packet tells how much the I/O path costs */
+    printf("CPU time: %llu ns per packet\n",
+           cpu * 1000 / packets);
+  }
+  printf("Benchmark finished\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -110,6 +110,7 @@ set_key(const uint8_t *key)
     memcpy(&current_key, key, sizeof(current_key));
     current_key_is_new = 1;
   }
+  ccm_star_deselect_context();
 }
 /*---------------------------------------------------------------------------*/
 const struct ccm_star_driver ccm_star_driver_jn516x = {
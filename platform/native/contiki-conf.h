@@ -266,6 +266,10 @@ typedef unsigned long clock_time_t;
 /* Not part of C99 but actually present */
 int strcasecmp(const char*, const char*);
 
+#ifndef AES_128_CONF
+#define AES_128_CONF native_aes_128_driver
+#endif /* AES_128_CONF */
+
 /* include the project config */
 /* PROJECT_CONF_H might be defined in the project Makefile */
 #ifdef PROJECT_CONF_H
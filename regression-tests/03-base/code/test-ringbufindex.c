@@ -345,6 +345,51 @@ UNIT_TEST(test_ringbufindex_empty)
   UNIT_TEST_END();
 }
 
+UNIT_TEST_REGISTER(test_ringbufindex_batch, "Batch");
+UNIT_TEST(test_ringbufindex_batch)
+{
+  int ret;
+  int first;
+
+  UNIT_TEST_BEGIN();
+
+  ringbufindex_init(&ri, ri_size);
+
+  /* Nothing in ringbuf; empty batch */
+  ret = ringbufindex_peek_get_batch(&ri, &first);
+  UNIT_TEST_ASSERT(ret == 0 && first == 0 && ri.put_ptr == 0 && ri.get_ptr == 0);
+
+  /* Nothing in ringbuf; nothing removed */
+  ret = ringbufindex_get_batch(&ri, 1);
+  UNIT_TEST_ASSERT(ret == 0 && ri.put_ptr == 0 && ri.get_ptr == 0);
+
+  /* Put the first item */
+  ret = ringbufindex_put(&ri);
+  UNIT_TEST_ASSERT(ret == 1 && ri.put_ptr == 1 && ri.get_ptr == 0);
+
+  /* One item in the batch, starting at index 0 */
+  ret = ringbufindex_peek_get_batch(&ri, &first);
+  UNIT_TEST_ASSERT(ret == 1 && first == 0 && ri.put_ptr == 1 && ri.get_ptr == 0);
+
+  /* Remove more items than available; only the first one is removed */
+  ret = ringbufindex_get_batch(&ri, 2);
+  UNIT_TEST_ASSERT(ret == 1 && ri.put_ptr == 1 && ri.get_ptr == 1);
+
+  /* Put the second item */
+  ret = ringbufindex_put(&ri);
+  UNIT_TEST_ASSERT(ret == 1 && ri.put_ptr == 0 && ri.get_ptr == 1);
+
+  /* One item in the batch, starting at index 1 */
+  ret = ringbufindex_peek_get_batch(&ri, &first);
+  UNIT_TEST_ASSERT(ret == 1 && first == 1 && ri.put_ptr == 0 && ri.get_ptr == 1);
+
+  /* Remove the batch */
+  ret = ringbufindex_get_batch(&ri, ret);
+  UNIT_TEST_ASSERT(ret == 1 && ri.put_ptr == 0 && ri.get_ptr == 0);
+
+  UNIT_TEST_END();
+}
+
 PROCESS_THREAD(test_process, ev, data)
 {
   PROCESS_BEGIN();
@@ -360,6 +405,7 @@ PROCESS_THREAD(test_process, ev, data)
   UNIT_TEST_RUN(test_ringbufindex_elements);
   UNIT_TEST_RUN(test_ringbufindex_full);
   UNIT_TEST_RUN(test_ringbufindex_empty);
+  UNIT_TEST_RUN(test_ringbufindex_batch);
 
   printf("=check-me= DONE\n");
   PROCESS_END();
@@ -0,0 +1,230 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2017, SICS Swedish ICT
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+# 3. Neither the name of the Institute nor the names of its contributors
+#    may be used to endorse or promote products derived from this software
+#    without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+# OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+# HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+# OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+# SUCH DAMAGE.
+#
+# This file is part of the Contiki operating system.
+#
+
+"""Decoder for TSCH binary traces (core/net/mac/tsch/tsch-trace.[ch]).
+
+Reads the "#TT " lines a node prints when built with
+TSCH_TRACE_CONF_ENABLED, from a serial log or a Cooja log, or raw
+records with --raw (e.g. output through TSCH_TRACE_CONF_OUTPUT, or a
+memory dump of tsch_trace_array from a little-endian platform).
+Outputs the records as CSV and/or pcap (LINKTYPE_USER0, one record per
+packet, timestamped from the ASN), and prints per-link statistics:
+packet delivery ratio of unicast transmissions, receptions, deadline
+misses and skipped slots.
+
+Usage: tsch-trace-decode.py [--raw] [--csv FILE] [--pcap FILE]
+                            [--slot-us US] [--rtimer-hz HZ] [FILE...]
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+RECORD = struct.Struct("<IBBBBHBBhBB")
+RECORD_LEN = 16
+LINE_PREFIX = "#TT "
+NODE_ID = re.compile(r"ID:(\d+)")
+
+EVENTS = {1: "tx", 2: "rx", 3: "deadline-miss", 4: "skipped-slot", 5: "dropped"}
+TX_STATUS = {0: "ok", 1: "collision", 2: "noack", 3: "deferred", 4: "err", 5: "err-fatal"}
+
+INFO_UNICAST = 0x80
+INFO_DATA = 0x40
+INFO_NUM_TX = 0x3f
+
+LINKTYPE_USER0 = 147
+
+class Record(object):
+    def __init__(self, node, data):
+        (asn_ls4b, asn_ms1b, self.event, self.status, self.sf, self.ts,
+         self.choff, self.nbr, self.delta, self.len, self.info) = RECORD.unpack(data)
+        self.node = node
+        self.asn = (asn_ms1b << 32) | asn_ls4b
+        self.raw = data
+
+    def link(self):
+        if self.sf == 0xff:
+            return None
+        return (self.sf, self.ts, self.choff)
+
+def parse_lines(f, records):
+    for line in f:
+        pos = line.find(LINE_PREFIX)
+        if pos < 0:
+            continue
+        m = NODE_ID.search(line, 0, pos)
+        node = int(m.group(1)) if m else 0
+        hexdata = line[pos + len(LINE_PREFIX):].strip()
+        try:
+            data = bytearray.fromhex(hexdata)
+        except ValueError:
+            sys.stderr.write("Skipping malformed line: %s\n" % line.strip())
+            continue
+        if len(data) % RECORD_LEN != 0:
+            sys.stderr.write("Skipping truncated line: %s\n" % line.strip())
+            continue
+        for i in range(0, len(data), RECORD_LEN):
+            records.append(Record(node, bytes(data[i:i + RECORD_LEN])))
+
+def parse_raw(f, records):
+    data = f.read()
+    for i in range(0, len(data) - RECORD_LEN + 1, RECORD_LEN):
+        records.append(Record(0, data[i:i + RECORD_LEN]))
+
+def write_csv(f, records):
+    f.write("node,asn,event,status,slotframe,timeslot,channel_offset,nbr,delta,len,unicast,data,num_tx\n")
+    for r in records:
+        if r.event == 1:
+            status = TX_STATUS.get(r.status, str(r.status))
+        else:
+            status = str(r.status)
+        link = r.link()
+        f.write("%d,%d,%s,%s,%s,%s,%s,%d,%d,%d,%d,%d,%d\n" % (
+            r.node, r.asn, EVENTS.get(r.event, str(r.event)), status,
+            link[0] if link else "", link[1] if link else "", link[2] if link else "",
+            r.nbr, r.delta, r.len,
+            1 if r.info & INFO_UNICAST else 0, 1 if r.info & INFO_DATA else 0,
+            r.info & INFO_NUM_TX if r.event == 1 else 0))
+
+def write_pcap(f, records, slot_us):
+    f.write(struct.pack("<IHHiIII", 0xa1b2c3d4, 2, 4, 0, 0, 65535, LINKTYPE_USER0))
+    for r in records:
+        us = r.asn * slot_us
+        f.write(struct.pack("<IIII", us // 1000000, us % 1000000, RECORD_LEN, RECORD_LEN))
+        f.write(r.raw)
+
+class LinkStats(object):
+    def __init__(self):
+        self.tx = 0
+        self.tx_unicast = 0
+        self.tx_ok = 0
+        self.tx_noack = 0
+        self.tx_other = 0
+        self.rx = 0
+        self.misses = 0
+        self.max_lateness = 0
+        self.skipped = 0
+
+def print_stats(f, records, rtimer_hz):
+    links = {}
+    dropped = {}
+
+    def stats_for(key):
+        if key not in links:
+            links[key] = LinkStats()
+        return links[key]
+
+    for r in records:
+        link = r.link()
+        if r.event == 1:
+            s = stats_for((r.node, link, r.nbr))
+            s.tx += 1
+            if r.info & INFO_UNICAST:
+                s.tx_unicast += 1
+                if r.status == 0:
+                    s.tx_ok += 1
+                elif r.status == 2:
+                    s.tx_noack += 1
+                else:
+                    s.tx_other += 1
+        elif r.event == 2:
+            stats_for((r.node, link, r.nbr)).rx += 1
+        elif r.event == 3:
+            s = stats_for((r.node, link, None))
+            s.misses += 1
+            s.max_lateness = max(s.max_lateness, r.delta)
+        elif r.event == 4:
+            stats_for((r.node, link, None)).skipped += 1
+        elif r.event == 5:
+            dropped[r.node] = dropped.get(r.node, 0) + r.delta
+
+    f.write("%-5s %-16s %-4s %6s %6s %6s %6s %7s %6s %6s %10s %7s\n" % (
+        "node", "link (sf-ts-ch)", "nbr", "tx", "uc-tx", "uc-ok", "noack", "pdr", "rx",
+        "misses", "max-late", "skipped"))
+
+    def sort_key(item):
+        (node, link, nbr) = item[0]
+        return (node, link or (-1, -1, -1), -1 if nbr is None else nbr)
+
+    for (node, link, nbr), s in sorted(links.items(), key=sort_key):
+        pdr = "%.1f%%" % (100.0 * s.tx_ok / s.tx_unicast) if s.tx_unicast else "-"
+        late = "%dus" % (s.max_lateness * 1000000 // rtimer_hz) if s.misses else "-"
+        f.write("%-5d %-16s %-4s %6d %6d %6d %6d %7s %6d %6d %10s %7d\n" % (
+            node, "%d-%d-%d" % link if link else "none", "-" if nbr is None else nbr,
+            s.tx, s.tx_unicast, s.tx_ok, s.tx_noack, pdr, s.rx,
+            s.misses, late, s.skipped))
+
+    for node in sorted(dropped):
+        f.write("node %d: %d records lost\n" % (node, dropped[node]))
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode TSCH binary traces")
+    parser.add_argument("files", nargs="*", help="input files (default: stdin)")
+    parser.add_argument("--raw", action="store_true", help="inputs are raw records")
+    parser.add_argument("--csv", help="write the records as CSV to this file ('-' for stdout)")
+    parser.add_argument("--pcap", help="write the records as pcap to this file")
+    parser.add_argument("--slot-us", type=int, default=10000,
+                        help="timeslot duration, for pcap timestamps (default: 10000)")
+    parser.add_argument("--rtimer-hz", type=int, default=32768,
+                        help="rtimer frequency, for timing deltas (default: 32768)")
+    args = parser.parse_args()
+
+    records = []
+    if args.raw:
+        if args.files:
+            for name in args.files:
+                with open(name, "rb") as f:
+                    parse_raw(f, records)
+        else:
+            parse_raw(getattr(sys.stdin, "buffer", sys.stdin), records)
+    else:
+        if args.files:
+            for name in args.files:
+                with open(name, "r") as f:
+                    parse_lines(f, records)
+        else:
+            parse_lines(sys.stdin, records)
+
+    if args.csv == "-":
+        write_csv(sys.stdout, records)
+    elif args.csv:
+        with open(args.csv, "w") as f:
+            write_csv(f, records)
+    if args.pcap:
+        with open(args.pcap, "wb") as f:
+            write_pcap(f, records, args.slot_us)
+    if args.csv != "-":
+        print_stats(sys.stdout, records, args.rtimer_hz)
+
+if __name__ == "__main__":
+    main()